@@ -121,10 +121,16 @@ AnalogSynthAudioProcessor::AnalogSynthAudioProcessor()
         synth_.modulation_matrix.RemoveAll();
         synth_.Reset();
     };
+
+    // 留一半的核心给宿主和其他插件
+    int num_workers = std::clamp(juce::SystemStats::getNumCpus() / 2 - 1, 0, 3);
+    voice_pool_.Start(static_cast<size_t>(num_workers));
+    synth_.SetWorkerPool(&voice_pool_);
 }
 
 AnalogSynthAudioProcessor::~AnalogSynthAudioProcessor()
 {
+    voice_pool_.Stop();
     value_tree_ = nullptr;
 }
 
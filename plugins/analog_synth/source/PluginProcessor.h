@@ -48,6 +48,7 @@ public:
     std::unique_ptr<pluginshared::PresetManager> preset_manager_;
 
     analogsynth::Synth synth_;
+    pluginshared::RTWorkerPool voice_pool_;
     juce::MidiKeyboardState midi_state_;
 private:
     //==============================================================================
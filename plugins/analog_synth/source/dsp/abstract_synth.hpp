@@ -1,6 +1,10 @@
 #pragma once
-#include <vector>
+#include <algorithm>
+#include <array>
+#include <cstddef>
 #include <cstdint>
+#include <utility>
+#include <pluginshared/voice_allocator.hpp>
 
 namespace analogsynth {
 template<class T>
@@ -20,109 +24,102 @@ template<class Voice>
 class AbstractSynth {
 protected:
     static constexpr size_t kMaxPoly = 8;
+    using VoiceAllocator = pluginshared::VoiceAllocator<kMaxPoly>;
 
     AbstractSynth() {
-        active_channels_.reserve(kMaxPoly);
-        free_channels_.reserve(kMaxPoly);
-        pending_notes_.reserve(128);
         SetNumVoices(kMaxPoly);
     }
 
     void NoteOn(int note, float velocity, bool join_pending = true) {
-        if (free_channels_.empty()) {
+        uint32_t const free_channel = voices_.FindFree();
+        if (free_channel == VoiceAllocator::kInvalid) {
             uint32_t allocate_channel = static_cast<Voice*>(this)->FindVoiceToSteal();
-            if (join_pending && playing_notes_[allocate_channel] != note && playing_notes_[allocate_channel] != -1) {
-                pending_notes_.push_back({playing_notes_[allocate_channel], playing_velocity_[allocate_channel]});
+            int const stolen_note = voices_.GetNote(allocate_channel);
+            if (join_pending && stolen_note != note && stolen_note != -1) {
+                PushPendingNote(stolen_note, playing_velocity_[allocate_channel]);
             }
 
-            float gliding_begin_pitch = is_legato_ ? static_cast<Voice*>(this)->GetCurrentGlidingPitch(allocate_channel) : static_cast<Voice*>(this)->GetCurrentGlidingPitch(active_channels_.back());
+            float gliding_begin_pitch = is_legato_ ? static_cast<Voice*>(this)->GetCurrentGlidingPitch(allocate_channel) : static_cast<Voice*>(this)->GetCurrentGlidingPitch(voices_.Newest());
             static_cast<Voice*>(this)->StartNewChannel(allocate_channel, note, velocity, !is_legato_, gliding_begin_pitch, static_cast<float>(note));
-            playing_notes_[allocate_channel] = note;
             playing_velocity_[allocate_channel] = velocity;
             // if this stealing voice is triggerd, bring it to the next gliding pitch begin
             if (!is_legato_) {
-                auto it = std::find(active_channels_.begin(), active_channels_.end(), allocate_channel);
-                active_channels_.erase(it);
-                active_channels_.push_back(allocate_channel);
+                voices_.Activate(allocate_channel, note);
+            }
+            else {
+                voices_.Retarget(allocate_channel, note);
             }
         }
         else {
-            uint32_t allocated_channel = free_channels_.back();
-            free_channels_.pop_back();
-
-            float gliding_begin_pitch = active_channels_.empty() ? static_cast<float>(note) : static_cast<Voice*>(this)->GetCurrentGlidingPitch(active_channels_.back());
-            static_cast<Voice*>(this)->StartNewChannel(allocated_channel, note, velocity, true, gliding_begin_pitch, static_cast<float>(note));
+            float gliding_begin_pitch = voices_.Empty() ? static_cast<float>(note) : static_cast<Voice*>(this)->GetCurrentGlidingPitch(voices_.Newest());
+            static_cast<Voice*>(this)->StartNewChannel(free_channel, note, velocity, true, gliding_begin_pitch, static_cast<float>(note));
 
-            playing_notes_[allocated_channel] = note;
-            playing_velocity_[allocated_channel] = velocity;
-            active_channels_.push_back(allocated_channel);
+            playing_velocity_[free_channel] = velocity;
+            voices_.Activate(free_channel, note);
         }
     }
 
     void NoteOff(int note) {
         size_t note_off_count = 0;
-        for (auto channel : active_channels_) {
-            if (playing_notes_[channel] == note) {
-                static_cast<Voice*>(this)->StopChannel(channel);
-                playing_notes_[channel] = -1;
-                ++note_off_count;
-            }
-        }
-
-        auto it = std::remove_if(pending_notes_.begin(), pending_notes_.end(), [note](auto const& it_val) {
-            return it_val.first == note;
+        voices_.ForEachVoiceOfNote(note, [this, &note_off_count](uint32_t channel) {
+            static_cast<Voice*>(this)->StopChannel(channel);
+            voices_.DetachNote(channel);
+            ++note_off_count;
         });
-        pending_notes_.erase(it, pending_notes_.end());
 
-        size_t renoteon_count = std::min(note_off_count, pending_notes_.size());
+        RemovePendingNote(note);
+
+        size_t renoteon_count = std::min(note_off_count, num_pending_notes_);
         for (size_t i = 0; i < renoteon_count; ++i) {
-            auto data = pending_notes_.back();
-            pending_notes_.pop_back();
+            auto data = pending_notes_[--num_pending_notes_];
             NoteOn(data.first, data.second, false);
         }
     }
 
     void SetNumVoices(size_t num_voices) {
-        num_max_voices_ = std::min(num_voices, kMaxPoly);
-        pending_notes_.clear();
-        free_channels_.clear();
-        active_channels_.clear();
-        for (size_t i = 0; i < num_max_voices_; ++i) {
-            free_channels_.push_back(static_cast<uint32_t>(i));
-        }
-        std::fill_n(playing_notes_, kMaxPoly, -1);
+        num_pending_notes_ = 0;
+        voices_.SetNumVoices(num_voices);
     }
 
     void RemoveDeadChannels() {
-        for (auto it = active_channels_.begin(); it != active_channels_.end();) {
-            if (static_cast<Voice*>(this)->VoiceShouldRemove(*it)) {
-                free_channels_.push_back(*it);
-                it = active_channels_.erase(it);
-            }
-            else {
-                ++it;
+        uint32_t channel = voices_.Oldest();
+        while (channel != VoiceAllocator::kInvalid) {
+            uint32_t const next = voices_.Next(channel);
+            if (static_cast<Voice*>(this)->VoiceShouldRemove(channel)) {
+                voices_.Free(channel);
             }
+            channel = next;
         }
     }
 
     void AllNoteOff() noexcept {
-        pending_notes_.clear();
-        active_channels_.clear();
-        free_channels_.clear();
-        for (size_t i = 0; i < num_max_voices_; ++i) {
-            free_channels_.push_back(static_cast<uint32_t>(i));
-        }
-        std::fill_n(playing_notes_, kMaxPoly, -1);
+        num_pending_notes_ = 0;
+        voices_.Clear();
     }
 
-    std::vector<uint32_t> active_channels_;
+    // 从旧到新遍历活动的复音
+    VoiceAllocator voices_;
     bool is_legato_{};
 private:
-    size_t num_max_voices_{kMaxPoly};
-    std::vector<uint32_t> free_channels_;
-    int playing_notes_[kMaxPoly]{};
+    /**
+     * @brief 每个音高最多只有一项，重复的音高移到最后，所以不会超过128项
+     */
+    void PushPendingNote(int note, float velocity) noexcept {
+        RemovePendingNote(note);
+        pending_notes_[num_pending_notes_++] = {note, velocity};
+    }
+
+    void RemovePendingNote(int note) noexcept {
+        auto end = pending_notes_.begin() + static_cast<std::ptrdiff_t>(num_pending_notes_);
+        auto it = std::remove_if(pending_notes_.begin(), end, [note](auto const& it_val) {
+            return it_val.first == note;
+        });
+        num_pending_notes_ = static_cast<size_t>(it - pending_notes_.begin());
+    }
+
     float playing_velocity_[kMaxPoly]{};
 
-    std::vector<std::pair<int, float>> pending_notes_;
+    std::array<std::pair<int, float>, VoiceAllocator::kNumNotes> pending_notes_{};
+    size_t num_pending_notes_{};
 };
 }
@@ -4,4 +4,9 @@ namespace analogsynth {
 static constexpr int kMaxUnison = 16;
 static constexpr size_t kMaxPoly = 8;
 static constexpr size_t kBlockSize = 256;
+// 调制矩阵每kModBlockSize个样本更新一次参数
+static constexpr size_t kModBlockSize = 16;
+static constexpr size_t kNumModBlocks = kBlockSize / kModBlockSize;
+// 复音每kVoiceLanes个一组，osc1/osc2和包络放进SIMD通道一起计算
+static constexpr size_t kVoiceLanes = 4;
 }
\ No newline at end of file
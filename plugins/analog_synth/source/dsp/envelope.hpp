@@ -4,6 +4,7 @@
 #include <qwqdsp/polymath.hpp>
 #include <qwqdsp/oscillator/smooth_noise.hpp>
 #include <qwqdsp/adsr_envelope.hpp>
+#include <qwqdsp/simd_element/adsr_envelope.hpp>
 
 namespace analogsynth {
 class ModEnvelope : public IModulator {
@@ -12,12 +13,25 @@ public:
         : IModulator(name) {
     }
 
-    void Process(size_t channel, bool exp, size_t num_samples) noexcept {
+    /**
+     * @param lanes kVoiceLanes个复音，前num_channels个有效，其余通道只计算不写回
+     */
+    void Process(uint32_t const* lanes, size_t num_channels, bool exp, size_t num_samples) noexcept {
+        qwqdsp_simd_element::AdsrEnvelope<kVoiceLanes> envelope;
+        std::array<float, kBlockSize> unused;
+        float* block[kVoiceLanes];
+        for (size_t lane = 0; lane < kVoiceLanes; ++lane) {
+            envelope.Load(lane, envelope_[lanes[lane]]);
+            block[lane] = lane < num_channels ? modulator_output[lanes[lane]].data() : unused.data();
+        }
         if (exp) {
-            envelope_[channel].ProcessExp({modulator_output[channel].data(), num_samples});
+            envelope.ProcessExp(block, num_samples);
         }
         else {
-            envelope_[channel].Process({modulator_output[channel].data(), num_samples});
+            envelope.Process(block, num_samples);
+        }
+        for (size_t lane = 0; lane < num_channels; ++lane) {
+            envelope.Store(lane, envelope_[lanes[lane]]);
         }
     }
 
@@ -25,7 +25,9 @@ public:
 
     Lfo(juce::StringRef name)
         : IModulator(name) {
-        noise_.GetNoise().SetSeed(static_cast<uint32_t>(rand()));
+        for (auto& noise : noise_) {
+            noise.GetNoise().SetSeed(static_cast<uint32_t>(rand()));
+        }
     }
 
     void Process(Parameter const& param, size_t num_samples, size_t channel) noexcept {
@@ -62,23 +64,23 @@ public:
                 break;
             case Shape::Noise:
                 for (size_t i = 0; i < num_samples; ++i) {
-                    modulator_output[channel][i] = noise_.GetNoise().Next();
+                    modulator_output[channel][i] = noise_[channel].GetNoise().Next();
                 }
                 break;
             case Shape::SmoothNoise:
-                noise_.SetRate(param.phase_inc);
+                noise_[channel].SetRate(param.phase_inc);
                 for (size_t i = 0; i < num_samples; ++i) {
-                    modulator_output[channel][i] = noise_.Tick();
+                    modulator_output[channel][i] = noise_[channel].Tick();
                 }
                 break;
             case Shape::HoldNoise:
                 for (size_t i = 0; i < num_samples; ++i) {
                     phase_[channel] += param.phase_inc;
                     if (phase_[channel] > 1) {
-                        noise_.GetNoise().NextUInt();
+                        noise_[channel].GetNoise().NextUInt();
                         phase_[channel] -= 1;
                     }
-                    float val01 = static_cast<float>(noise_.GetNoise().GetReg()) * noise_.GetNoise().kScale;
+                    float val01 = static_cast<float>(noise_[channel].GetNoise().GetReg()) * noise_[channel].GetNoise().kScale;
                     modulator_output[channel][i] = val01 * 2 - 1;
                 }
                 break;
@@ -100,6 +102,7 @@ public:
     }
 private:
     float phase_[kMaxPoly]{};
-    qwqdsp_oscillator::SmoothNoise noise_;
+    // 每个复音一个，复音可能在不同的工作线程上运行
+    qwqdsp_oscillator::SmoothNoise noise_[kMaxPoly];
 };
 }
@@ -181,153 +181,237 @@ void Synth::SyncBpm(juce::AudioProcessor& p) {
     }
 }
 
-void Synth::ProcessAndAddBlock(size_t channel, float* left, float* right, size_t num_samples) noexcept {
+void Synth::ProcessVoices(float* left, float* right, size_t num_samples) noexcept {
+    size_t num_channels = 0;
+    for (auto channel : voices_) {
+        part_channels_[num_channels++] = channel;
+    }
+
+    size_t num_parts = 1;
+    if (worker_pool_ != nullptr && num_channels >= kMinVoicesToSplit) {
+        num_parts = std::min({worker_pool_->GetNumWorkers() + 1, num_channels, kMaxVoiceParts});
+    }
+
+    if (num_parts == 1) {
+        for (size_t i = 0; i < num_channels; i += kVoiceLanes) {
+            ProcessVoiceGroup(part_channels_.data() + i, std::min(kVoiceLanes, num_channels - i), left, right, num_samples);
+        }
+        return;
+    }
+
+    num_voice_parts_ = num_parts;
+    num_part_channels_ = num_channels;
+    part_num_samples_ = num_samples;
+    worker_pool_->Run(&Synth::ProcessVoicePart, this, num_parts);
+
+    // 按固定顺序求和，结果和线程调度无关
+    for (size_t part = 0; part < num_parts; ++part) {
+        for (size_t i = 0; i < num_samples; ++i) {
+            left[i] += part_left_[part][i];
+            right[i] += part_right_[part][i];
+        }
+    }
+}
+
+void Synth::ProcessVoicePart(void* ctx, size_t part) noexcept {
+    auto& self = *static_cast<Synth*>(ctx);
+    size_t const begin = self.num_part_channels_ * part / self.num_voice_parts_;
+    size_t const end = self.num_part_channels_ * (part + 1) / self.num_voice_parts_;
+    float* left = self.part_left_[part].data();
+    float* right = self.part_right_[part].data();
+    std::fill_n(left, self.part_num_samples_, 0.0f);
+    std::fill_n(right, self.part_num_samples_, 0.0f);
+    for (size_t i = begin; i < end; i += kVoiceLanes) {
+        self.ProcessVoiceGroup(self.part_channels_.data() + i, std::min(kVoiceLanes, end - i), left, right, self.part_num_samples_);
+    }
+}
+
+void Synth::ProcessVoiceGroup(uint32_t const* channels, size_t num_channels, float* left, float* right, size_t num_samples) noexcept {
     juce::ignoreUnused(right);
+    // 不满kVoiceLanes个复音时，空的通道重复第一个复音，只计算不写回
+    std::array<uint32_t, kVoiceLanes> lanes;
+    for (size_t lane = 0; lane < kVoiceLanes; ++lane) {
+        lanes[lane] = channels[lane < num_channels ? lane : 0];
+    }
+
     // -------------------- tick modulators --------------------
     // tick lfos
-    Lfo::Parameter lfo_param;
-    lfo_param.phase_inc = param_lfo1_freq.GetModCR(channel) / fs_;
-    lfo_param.shape = static_cast<Lfo::Shape>(param_lfo1_shape.Get());
-    lfo1_.Process(lfo_param, num_samples, channel);
-    lfo_param.phase_inc = param_lfo2_freq.GetModCR(channel) / fs_;
-    lfo_param.shape = static_cast<Lfo::Shape>(param_lfo2_shape.Get());
-    lfo2_.Process(lfo_param, num_samples, channel);
-    lfo_param.phase_inc = param_lfo3_freq.GetModCR(channel) / fs_;
-    lfo_param.shape = static_cast<Lfo::Shape>(param_lfo3_shape.Get());
-    lfo3_.Process(lfo_param, num_samples, channel);
+    for (size_t lane = 0; lane < num_channels; ++lane) {
+        size_t const channel = channels[lane];
+        Lfo::Parameter lfo_param;
+        lfo_param.phase_inc = param_lfo1_freq.GetModCR(channel) / fs_;
+        lfo_param.shape = static_cast<Lfo::Shape>(param_lfo1_shape.Get());
+        lfo1_.Process(lfo_param, num_samples, channel);
+        lfo_param.phase_inc = param_lfo2_freq.GetModCR(channel) / fs_;
+        lfo_param.shape = static_cast<Lfo::Shape>(param_lfo2_shape.Get());
+        lfo2_.Process(lfo_param, num_samples, channel);
+        lfo_param.phase_inc = param_lfo3_freq.GetModCR(channel) / fs_;
+        lfo_param.shape = static_cast<Lfo::Shape>(param_lfo3_shape.Get());
+        lfo3_.Process(lfo_param, num_samples, channel);
+    }
     // tick envelopes
-    qwqdsp::AdsrEnvelope::Parameter env_param;
-    env_param.attack_ms = param_env_volume_attack.GetModCR(channel);
-    env_param.decay_ms = param_env_volume_decay.GetModCR(channel);
-    env_param.fs = fs_;
-    env_param.release_ms = param_env_volume_release.GetModCR(channel);
-    env_param.sustain_level = param_env_volume_sustain.GetModCR(channel);
-    volume_env_.envelope_[channel].Update(env_param);
-    volume_env_.Process(channel, param_env_volume_exp.Get(), num_samples);
-    env_param.attack_ms = param_env_mod_attack.GetModCR(channel);
-    env_param.decay_ms = param_env_mod_decay.GetModCR(channel);
-    env_param.fs = fs_;
-    env_param.release_ms = param_env_mod_release.GetModCR(channel);
-    env_param.sustain_level = param_env_mod_sustain.GetModCR(channel);
-    mod_env_.envelope_[channel].Update(env_param);
-    mod_env_.Process(channel, param_env_mod_exp.Get(), num_samples);
-    // tick marcos
-    marco1_.Update(channel);
-    marco2_.Update(channel);
-    marco3_.Update(channel);
-    marco4_.Update(channel);
-
-    // -------------------- tick parameters --------------------
-    modulation_matrix.Process(num_samples, channel);
-    
-    // -------------------- tick oscillators --------------------
-    float pitch_buffer[kBlockSize];
-    for (size_t i = 0; i < num_samples; ++i) {
-        gliding_pitch_[channel] = target_pitch_[channel] + gliding_factor_ * (gliding_pitch_[channel] - target_pitch_[channel]);
-        pitch_buffer[i] = gliding_pitch_[channel];
-    }
-    // oscillator 1
-    float freq1 = qwqdsp::convert::Pitch2Freq(pitch_buffer[0] + param_osc1_detune.GetModCR(channel));
-    freq1 = std::clamp(freq1, 0.1f, fs_ / BlepCoeff::kHalfLen);
-    float osc1_phase_inc = freq1 / fs_;
-    float osc1_pwm = param_osc1_pwm.GetModCR(channel);
-
-    std::array<float, kBlockSize> osc_buffer;
-    std::array<bool, kBlockSize> sync_buffer;
-    std::array<float, kBlockSize> frac_sync_buffer;
-    float osc_gain = param_osc1_vol.GetModCR(channel);
-    switch (param_osc1_shape.Get()) {
-        case 0:
-            for (size_t i = 0; i < num_samples; ++i) {
-                osc1_phase_[channel] += osc1_phase_inc;
-                osc_buffer[i] = osc_gain * osc1_.Sawtooth(osc1_phase_[channel], osc1_phase_inc);
-                sync_buffer[i] = osc1_phase_[channel] > 1.0;
-                osc1_phase_[channel] -= std::floor(osc1_phase_[channel]);
-                frac_sync_buffer[i] = osc1_phase_[channel] / osc1_phase_inc;
-            }
-            break;
-        case 1:
-            for (size_t i = 0; i < num_samples; ++i) {
-                osc1_phase_[channel] += osc1_phase_inc;
-                osc_buffer[i] = osc_gain * osc1_.Triangle(osc1_phase_[channel], osc1_phase_inc);
-                sync_buffer[i] = osc1_phase_[channel] > 1.0;
-                osc1_phase_[channel] -= std::floor(osc1_phase_[channel]);
-                frac_sync_buffer[i] = osc1_phase_[channel] / osc1_phase_inc;
-            }
-            break;
-        case 2:
-            for (size_t i = 0; i < num_samples; ++i) {
-                osc1_phase_[channel] += osc1_phase_inc;
-                osc_buffer[i] = osc_gain * osc1_.PWM_Classic(osc1_phase_[channel], osc1_phase_inc, osc1_pwm);
-                sync_buffer[i] = osc1_phase_[channel] > 1.0;
-                osc1_phase_[channel] -= std::floor(osc1_phase_[channel]);
-                frac_sync_buffer[i] = osc1_phase_[channel] / osc1_phase_inc;
-            }
-            break;
-        default:
-            jassertfalse;
+    for (size_t lane = 0; lane < num_channels; ++lane) {
+        size_t const channel = channels[lane];
+        qwqdsp::AdsrEnvelope::Parameter env_param;
+        env_param.attack_ms = param_env_volume_attack.GetModCR(channel);
+        env_param.decay_ms = param_env_volume_decay.GetModCR(channel);
+        env_param.fs = fs_;
+        env_param.release_ms = param_env_volume_release.GetModCR(channel);
+        env_param.sustain_level = param_env_volume_sustain.GetModCR(channel);
+        volume_env_.envelope_[channel].Update(env_param);
+        env_param.attack_ms = param_env_mod_attack.GetModCR(channel);
+        env_param.decay_ms = param_env_mod_decay.GetModCR(channel);
+        env_param.fs = fs_;
+        env_param.release_ms = param_env_mod_release.GetModCR(channel);
+        env_param.sustain_level = param_env_mod_sustain.GetModCR(channel);
+        mod_env_.envelope_[channel].Update(env_param);
     }
+    volume_env_.Process(lanes.data(), num_channels, param_env_volume_exp.Get(), num_samples);
+    mod_env_.Process(lanes.data(), num_channels, param_env_mod_exp.Get(), num_samples);
 
-    // oscillator 2
-    float freq2 = qwqdsp::convert::Pitch2Freq(pitch_buffer[0] + param_osc2_detune.GetModCR(channel));
-    freq2 = std::clamp(freq2, 0.1f, fs_ / BlepCoeff::kHalfLen);
-    osc2_[channel].SetFreq(freq2, fs_);
-    osc_gain = param_osc2_vol.GetModCR(channel);
-    float osc_pwm = param_osc2_pwm.GetModCR(channel);
-    osc2_[channel].SetPWM(osc_pwm);
-    if (param_osc2_sync.Get()) {
-        switch (param_osc2_shape.Get()) {
-            case 0:
-                for (size_t i = 0; i < num_samples; ++i) {
-                    osc_buffer[i] += osc_gain * osc2_[channel].Sawtooth(sync_buffer[i], frac_sync_buffer[i]);
-                }
-                break;
-            case 1:
-                for (size_t i = 0; i < num_samples; ++i) {
-                    osc_buffer[i] += osc_gain * osc2_[channel].Triangle(sync_buffer[i], frac_sync_buffer[i]);
-                }
-                break;
-            case 2:
-                for (size_t i = 0; i < num_samples; ++i) {
-                    osc_buffer[i] += osc_gain * osc2_[channel].PWM(sync_buffer[i], frac_sync_buffer[i]);
-                }
-                break;
-            case 3:
-                for (size_t i = 0; i < num_samples; ++i) {
-                    osc_buffer[i] += osc_gain * osc2_[channel].Sine(sync_buffer[i], frac_sync_buffer[i]);
-                }
-                break;
-            default:
-                jassertfalse;
+    std::array<VoiceBlock, kVoiceLanes> pitch_buffer;
+    for (size_t lane = 0; lane < num_channels; ++lane) {
+        size_t const channel = channels[lane];
+        // tick marcos
+        marco1_.Update(channel, num_samples);
+        marco2_.Update(channel, num_samples);
+        marco3_.Update(channel, num_samples);
+        marco4_.Update(channel, num_samples);
+
+        // -------------------- tick parameters --------------------
+        modulation_matrix.Process(num_samples, channel);
+
+        for (size_t i = 0; i < num_samples; ++i) {
+            gliding_pitch_[channel] = target_pitch_[channel] + gliding_factor_ * (gliding_pitch_[channel] - target_pitch_[channel]);
+            pitch_buffer[lane][i] = gliding_pitch_[channel];
         }
     }
-    else {
+
+    // -------------------- tick oscillators and filter --------------------
+    std::array<VoiceBlock, kVoiceLanes> osc_buffer;
+    ProcessBlepOscillators(lanes.data(), num_channels, pitch_buffer.data(), osc_buffer.data(), num_samples);
+    // 被调制的参数每个子块更新一次
+    for (size_t lane = 0; lane < num_channels; ++lane) {
+        size_t const channel = channels[lane];
+        for (size_t offset = 0, sub_block = 0; offset < num_samples; offset += kModBlockSize, ++sub_block) {
+            size_t const cando = std::min(kModBlockSize, num_samples - offset);
+            modulation_matrix.SelectSubBlock(sub_block, channel);
+            ProcessOscillators(channel, pitch_buffer[lane].data() + offset, osc_buffer[lane].data() + offset, cando);
+            filter_.Process(*this, channel, {osc_buffer[lane].data() + offset, cando});
+        }
+    }
+
+    // -------------------- tick volume envelope --------------------
+    auto const& volume_env_buffer = volume_env_.modulator_output;
+    for (size_t lane = 0; lane < num_channels; ++lane) {
+        size_t const channel = channels[lane];
+        for (size_t i = 0; i < num_samples; ++i) {
+            left[i] += osc_buffer[lane][i] * volume_env_buffer[channel][i];
+        }
+    }
+}
+
+void Synth::ProcessBlepOscillators(uint32_t const* lanes, size_t num_channels, VoiceBlock const* pitch_buffer, VoiceBlock* osc_buffer, size_t num_samples) noexcept {
+    // osc1和osc2整个块一起计算，osc2的状态每块只交换一次
+    VoicePack osc1_phase;
+    VoiceBlepSync osc2;
+    for (size_t lane = 0; lane < kVoiceLanes; ++lane) {
+        osc1_phase[lane] = osc1_phase_[lanes[lane]];
+        osc2.Load(lane, osc2_[lanes[lane]]);
+    }
+
+    auto tick = [&]<size_t kOsc1Shape, size_t kOsc2Shape, bool kOsc2Sync>(
+        std::integral_constant<size_t, kOsc1Shape>, std::integral_constant<size_t, kOsc2Shape>, std::bool_constant<kOsc2Sync>) {
+        for (size_t offset = 0, sub_block = 0; offset < num_samples; offset += kModBlockSize, ++sub_block) {
+            size_t const cando = std::min(kModBlockSize, num_samples - offset);
+            VoicePack osc1_phase_inc;
+            VoicePack osc1_pwm;
+            VoicePack osc1_gain;
+            VoicePack osc2_freq;
+            VoicePack osc2_pwm;
+            VoicePack osc2_gain;
+            for (size_t lane = 0; lane < kVoiceLanes; ++lane) {
+                size_t const channel = lanes[lane];
+                float const pitch = pitch_buffer[lane < num_channels ? lane : 0][offset];
+                modulation_matrix.SelectSubBlock(sub_block, channel);
+                float freq1 = qwqdsp::convert::Pitch2Freq(pitch + param_osc1_detune.GetModCR(channel));
+                freq1 = std::clamp(freq1, 0.1f, fs_ / BlepCoeff::kHalfLen);
+                osc1_phase_inc[lane] = freq1 / fs_;
+                osc1_pwm[lane] = param_osc1_pwm.GetModCR(channel);
+                osc1_gain[lane] = param_osc1_vol.GetModCR(channel);
+                float freq2 = qwqdsp::convert::Pitch2Freq(pitch + param_osc2_detune.GetModCR(channel));
+                osc2_freq[lane] = std::clamp(freq2, 0.1f, fs_ / BlepCoeff::kHalfLen);
+                osc2_pwm[lane] = param_osc2_pwm.GetModCR(channel);
+                osc2_gain[lane] = param_osc2_vol.GetModCR(channel);
+            }
+            osc2.SetFreq(osc2_freq, fs_);
+            osc2.SetPWM(osc2_pwm);
+
+            // 先整包写入再转置，逐通道写入会让编译器放弃向量化
+            std::array<VoicePack, kModBlockSize> out;
+            for (size_t i = 0; i < cando; ++i) {
+                osc1_phase += osc1_phase_inc;
+                VoicePack const osc1_out = osc1_gain * TickVoiceOsc1<kOsc1Shape>(osc1_phase, osc1_phase_inc, osc1_pwm);
+                VoiceMask const sync = osc1_phase > VoicePack::vBroadcast(1.0f);
+                osc1_phase = VoiceBlep::Wrap(osc1_phase);
+                VoicePack const frac_sync = osc1_phase / osc1_phase_inc;
+                out[i] = osc1_out + osc2_gain * TickVoiceOsc2<kOsc2Shape, kOsc2Sync>(osc2, sync, frac_sync);
+            }
+            for (size_t lane = 0; lane < kVoiceLanes; ++lane) {
+                for (size_t i = 0; i < cando; ++i) {
+                    osc_buffer[lane][offset + i] = out[i][lane];
+                }
+            }
+        }
+    };
+    auto tick_sync = [&](auto osc1_shape, auto osc2_shape) {
+        if (param_osc2_sync.Get()) {
+            tick(osc1_shape, osc2_shape, std::true_type{});
+        }
+        else {
+            tick(osc1_shape, osc2_shape, std::false_type{});
+        }
+    };
+    auto tick_osc2 = [&](auto osc1_shape) {
         switch (param_osc2_shape.Get()) {
             case 0:
-                for (size_t i = 0; i < num_samples; ++i) {
-                    osc_buffer[i] += osc_gain * osc2_[channel].Sawtooth();
-                }
+                tick_sync(osc1_shape, std::integral_constant<size_t, 0>{});
                 break;
             case 1:
-                for (size_t i = 0; i < num_samples; ++i) {
-                    osc_buffer[i] += osc_gain * osc2_[channel].Triangle();
-                }
+                tick_sync(osc1_shape, std::integral_constant<size_t, 1>{});
                 break;
             case 2:
-                for (size_t i = 0; i < num_samples; ++i) {
-                    osc_buffer[i] += osc_gain * osc2_[channel].PWM();
-                }
+                tick_sync(osc1_shape, std::integral_constant<size_t, 2>{});
                 break;
             case 3:
-                for (size_t i = 0; i < num_samples; ++i) {
-                    osc_buffer[i] += osc_gain * osc2_[channel].Sine();
-                }
+                tick_sync(osc1_shape, std::integral_constant<size_t, 3>{});
                 break;
             default:
                 jassertfalse;
         }
+    };
+    switch (param_osc1_shape.Get()) {
+        case 0:
+            tick_osc2(std::integral_constant<size_t, 0>{});
+            break;
+        case 1:
+            tick_osc2(std::integral_constant<size_t, 1>{});
+            break;
+        case 2:
+            tick_osc2(std::integral_constant<size_t, 2>{});
+            break;
+        default:
+            jassertfalse;
     }
 
+    for (size_t lane = 0; lane < num_channels; ++lane) {
+        osc1_phase_[lanes[lane]] = osc1_phase[lane];
+        osc2.Store(lane, osc2_[lanes[lane]]);
+    }
+}
+
+void Synth::ProcessOscillators(size_t channel, float const* pitch_buffer, float* osc_buffer, size_t num_samples) noexcept {
+    // osc1和osc2在ProcessBlepOscillators里按复音组计算，这里从osc3开始累加
     // oscillator 3
     float osc3_detune = param_osc3_detune.GetModCR(channel);
     float osc3_unison_detune = param_osc3_unison_detune.GetModCR(channel);
@@ -357,42 +441,91 @@ void Synth::ProcessAndAddBlock(size_t channel, float* left, float* right, size_t
         default:
             jassertfalse;
     }
-    osc_gain = param_osc3_vol.GetModCR(channel);
-    osc_pwm = param_osc3_pwm.GetModCR(channel);
+    float const osc_gain = param_osc3_vol.GetModCR(channel);
+    float const osc_pwm = param_osc3_pwm.GetModCR(channel);
+    // unison数量够多时放进SIMD通道并行计算，超出unison数量的通道增益为0并且不推进相位
+    // 4~7个用4通道，8个以上用8通道；更少时打包的开销比计算还大，仍然逐个计算
     auto& osc3_phases_ = osc3_data_[channel].osc3_phases_;
+    size_t const num_unison = static_cast<size_t>(osc3_unison_num);
+    auto tick_packed = [&]<size_t kLanes>(std::integral_constant<size_t, kLanes>, auto pack_wave) {
+        using Pack = qwqdsp_simd_element::PackFloat<kLanes>;
+        constexpr size_t kMaxPacks = static_cast<size_t>(kMaxUnison) / kLanes;
+        size_t const num_packs = (num_unison + kLanes - 1) / kLanes;
+        std::array<Pack, kMaxPacks> phases;
+        std::array<Pack, kMaxPacks> advance_incs;
+        std::array<Pack, kMaxPacks> blep_incs;
+        std::array<Pack, kMaxPacks> gains;
+        for (size_t p = 0; p < num_packs; ++p) {
+            for (size_t l = 0; l < kLanes; ++l) {
+                size_t const j = p * kLanes + l;
+                bool const used = j < num_unison;
+                phases[p][l] = osc3_phases_[j];
+                advance_incs[p][l] = used ? phase_incs_[j] : 0.0f;
+                // 不用的通道给一个合法的phase_inc，避免0/0
+                blep_incs[p][l] = used ? phase_incs_[j] : 0.25f;
+                gains[p][l] = used ? osc_gain : 0.0f;
+            }
+        }
+        for (size_t i = 0; i < num_samples; ++i) {
+            Pack sum{};
+            for (size_t p = 0; p < num_packs; ++p) {
+                phases[p] = UnisonBlep<kLanes>::Wrap(phases[p] + advance_incs[p]);
+                sum += gains[p] * pack_wave(phases[p], blep_incs[p]);
+            }
+            osc_buffer[i] += qwqdsp_simd_element::PackOps::ReduceAdd(sum);
+        }
+        for (size_t p = 0; p < num_packs; ++p) {
+            for (size_t l = 0; l < kLanes; ++l) {
+                osc3_phases_[p * kLanes + l] = phases[p][l];
+            }
+        }
+    };
+    auto tick_unison = [&](auto scalar_wave, auto pack_wave) {
+        if (num_unison >= kWidePackedUnison) {
+            tick_packed(std::integral_constant<size_t, kWidePackedUnison>{}, pack_wave);
+            return;
+        }
+        if (num_unison >= kMinPackedUnison) {
+            tick_packed(std::integral_constant<size_t, kMinPackedUnison>{}, pack_wave);
+            return;
+        }
+        for (size_t i = 0; i < num_samples; ++i) {
+            float sum{};
+            for (size_t j = 0; j < num_unison; ++j) {
+                osc3_phases_[j] += phase_incs_[j];
+                osc3_phases_[j] -= std::floor(osc3_phases_[j]);
+                sum += osc_gain * scalar_wave(osc3_phases_[j], phase_incs_[j]);
+            }
+            osc_buffer[i] += sum;
+        }
+    };
     switch (param_osc3_shape.Get()) {
         case 0:
-            for (size_t i = 0; i < num_samples; ++i) {
-                float sum{};
-                for (int j = 0; j < osc3_unison_num; ++j) {
-                    osc3_phases_[size_t(j)] += phase_incs_[size_t(j)];
-                    osc3_phases_[size_t(j)] -= std::floor(osc3_phases_[size_t(j)]);
-                    sum += osc_gain * osc1_.Sawtooth(osc3_phases_[size_t(j)], phase_incs_[size_t(j)]);
-                }
-                osc_buffer[i] += sum;
-            }
+            tick_unison(
+                [this](float phase, float phase_inc) {
+                    return osc1_.Sawtooth(phase, phase_inc);
+                },
+                []<size_t N>(qwqdsp_simd_element::PackFloat<N> const& phase, qwqdsp_simd_element::PackFloat<N> const& phase_inc) {
+                    return UnisonBlep<N>::Sawtooth(phase, phase_inc);
+                });
             break;
         case 1:
-            for (size_t i = 0; i < num_samples; ++i) {
-                float sum{};
-                for (int j = 0; j < osc3_unison_num; ++j) {
-                    osc3_phases_[size_t(j)] += phase_incs_[size_t(j)];
-                    osc3_phases_[size_t(j)] -= std::floor(osc3_phases_[size_t(j)]);
-                    sum += osc_gain * osc1_.Triangle(osc3_phases_[size_t(j)], phase_incs_[size_t(j)]);
-                }
-                osc_buffer[i] += sum;
-            }
+            tick_unison(
+                [this](float phase, float phase_inc) {
+                    return osc1_.Triangle(phase, phase_inc);
+                },
+                []<size_t N>(qwqdsp_simd_element::PackFloat<N> const& phase, qwqdsp_simd_element::PackFloat<N> const& phase_inc) {
+                    return UnisonBlep<N>::Triangle(phase, phase_inc);
+                });
             break;
         case 2:
-            for (size_t i = 0; i < num_samples; ++i) {
-                float sum{};
-                for (int j = 0; j < osc3_unison_num; ++j) {
-                    osc3_phases_[size_t(j)] += phase_incs_[size_t(j)];
-                    osc3_phases_[size_t(j)] -= std::floor(osc3_phases_[size_t(j)]);
-                    sum += osc_gain * osc1_.PWM_Classic(osc3_phases_[size_t(j)], phase_incs_[size_t(j)], osc_pwm);
-                }
-                osc_buffer[i] += sum;
-            }
+            tick_unison(
+                [this, osc_pwm](float phase, float phase_inc) {
+                    return osc1_.PWM_Classic(phase, phase_inc, osc_pwm);
+                },
+                [osc_pwm]<size_t N>(qwqdsp_simd_element::PackFloat<N> const& phase, qwqdsp_simd_element::PackFloat<N> const& phase_inc) {
+                    return UnisonBlep<N>::PWM_Classic(phase, phase_inc, osc_pwm);
+                });
             break;
         default:
             jassertfalse;
@@ -454,15 +587,6 @@ void Synth::ProcessAndAddBlock(size_t channel, float* left, float* right, size_t
                 break;
         }
     }
-
-    // -------------------- tick filter --------------------
-    filter_.Process(*this, channel, {osc_buffer.data(), num_samples});
-
-    // -------------------- tick volume envelope --------------------
-    auto const& volume_env_buffer = volume_env_.modulator_output;
-    for (size_t i = 0; i < num_samples; ++i) {
-        left[i] += osc_buffer[i] * volume_env_buffer[channel][i];
-    }
 }
 
 juce::ValueTree Synth::SaveFxChainState() {
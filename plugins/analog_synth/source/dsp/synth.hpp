@@ -9,8 +9,11 @@
 #include <qwqdsp/oscillator/noise.hpp>
 #include <qwqdsp/convert.hpp>
 #include <qwqdsp/simd_element/algebraic_waveshaper.hpp>
+#include <qwqdsp/simd_element/polyblep.hpp>
+#include <qwqdsp/simd_element/polyblep_sync.hpp>
 #include <qwqdsp/misc/smoother.hpp>
 #include <juce_audio_processors/juce_audio_processors.h>
+#include <pluginshared/rt_worker_pool.hpp>
 
 #include "imodulator.hpp"
 #include "lfo.hpp"
@@ -97,22 +100,41 @@ public:
         }
     }
 
+    /**
+     * @brief 计算一个block里每个子块的调制量，开销只和调制路由的数量有关
+     */
     void Process(size_t num_samples, size_t channel) noexcept {
+        size_t const num_blocks = (num_samples + kModBlockSize - 1) / kModBlockSize;
         for (auto p : parameters_) {
-            p->ClearModBuffer();
+            std::fill_n(p->block_buffer[channel].begin(), num_blocks, 0.0f);
         }
 
-        for (auto* m : doing_modulations_) {
-            if (!m->enable) continue;
+        for (size_t r = 0; r < num_routes_; ++r) {
+            ModulationInfo const& m = *route_infos_[r];
+            if (!m.enable) continue;
 
-            float mod = m->source->modulator_output[channel][0];
-            if (m->bipolar) {
-                mod = mod * 2.0f - 1.0f;
+            // bipolar: (2x - 1) * amount
+            float scale = m.amount;
+            float offset = 0.0f;
+            if (m.bipolar) {
+                offset = -scale;
+                scale *= 2.0f;
+            }
+            float const* src = route_sources_[r]->modulator_output[channel].data();
+            float* dst = route_targets_[r]->block_buffer[channel].data();
+            for (size_t k = 0; k < num_blocks; ++k) {
+                dst[k] += src[k * kModBlockSize] * scale + offset;
             }
-            m->target->buffer[channel] += mod * m->amount;
         }
+    }
 
-        std::ignore = num_samples;
+    /**
+     * @brief 被调制的参数切换到第sub_block个子块，之后GetModCR得到这个子块的值
+     */
+    void SelectSubBlock(size_t sub_block, size_t channel) noexcept {
+        for (auto p : parameters_) {
+            p->buffer[channel] = p->block_buffer[channel][sub_block];
+        }
     }
 
     std::pair<ModulationInfo*, bool> Add(IModulator* source, FloatParam* target) {
@@ -132,6 +154,7 @@ public:
         alloc_modulation->target = target;
         AddModInfoToModulator(alloc_modulation, source);
         AddModInfoToParameter(alloc_modulation, target);
+        RebuildRoutes();
         changed = true;
         return {alloc_modulation, true};
     }
@@ -146,6 +169,7 @@ public:
         free_modulations_.push_back(pinfo);
         RemoveModInfoFromModulator(pinfo, source);
         RemoveModInfoFromParameter(pinfo, target);
+        RebuildRoutes();
         changed = true;
     }
 
@@ -154,6 +178,7 @@ public:
         RemoveModInfoFromModulator(info, info->source);
         info->source = new_source;
         AddModInfoToModulator(info, new_source);
+        RebuildRoutes();
         changed = true;
     }
 
@@ -162,6 +187,7 @@ public:
         RemoveModInfoFromParameter(info, info->target);
         info->target = new_target;
         AddModInfoToParameter(info, new_target);
+        RebuildRoutes();
         changed = true;
     }
 
@@ -189,6 +215,7 @@ public:
         free_modulations_.push_back(info);
         RemoveModInfoFromModulator(info, info->source);
         RemoveModInfoFromParameter(info, info->target);
+        RebuildRoutes();
         changed = true;
     }
 
@@ -204,6 +231,7 @@ public:
         for (size_t i = 0; i < kMaxModulations; ++i) {
             free_modulations_.push_back(&modulations_[i]);
         }
+        RebuildRoutes();
         changed = true;
     }
 
@@ -273,6 +301,21 @@ private:
     std::vector<ModulationInfo*> free_modulations_;
     std::vector<ModulationInfo*> doing_modulations_;
     std::vector<FloatParam*> parameters_;
+    // 音频线程使用的路由表(SoA)，修改路由的时候重建
+    std::array<IModulator*, kMaxModulations> route_sources_{};
+    std::array<FloatParam*, kMaxModulations> route_targets_{};
+    std::array<ModulationInfo const*, kMaxModulations> route_infos_{};
+    size_t num_routes_{};
+
+    void RebuildRoutes() noexcept {
+        num_routes_ = 0;
+        for (auto* m : doing_modulations_) {
+            route_sources_[num_routes_] = m->source;
+            route_targets_[num_routes_] = m->target;
+            route_infos_[num_routes_] = m;
+            ++num_routes_;
+        }
+    }
 
     void AddModInfoToModulator(ModulationInfo* info, IModulator* source) {
         modulator_counter_[source].push_back(info);
@@ -308,6 +351,10 @@ class Synth : public AbstractSynth<Synth> {
 public:
     using SimdType = qwqdsp_psimd::Float32x4;
 
+    // 活动的复音少于这个数时在音频线程直接渲染
+    static constexpr size_t kMinVoicesToSplit = 3;
+    static constexpr size_t kMaxVoiceParts = std::min(pluginshared::RTWorkerPool::kMaxWorkers + 1, kMaxPoly);
+
     Synth();
 
     void Init(float fs) noexcept;
@@ -316,6 +363,13 @@ public:
 
     void SyncBpm(juce::AudioProcessor& p);
 
+    /**
+     * @brief 活动的复音较多时分给线程池并行渲染，nullptr为单线程
+     */
+    void SetWorkerPool(pluginshared::RTWorkerPool* pool) noexcept {
+        worker_pool_ = pool;
+    }
+
     void Process(juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midi_buffer) {
         is_legato_ = param_legato.Get();
         gliding_factor_ = qwqdsp_misc::ExpSmoother::ComputeSmoothFactor(param_glide_time.GetNoMod(), fs_, 2.0f);
@@ -719,7 +773,7 @@ public:
         uint32_t min_vol_and_release_channel = kMaxPoly;
         float min_vol = std::numeric_limits<float>::infinity();
         float min_vol_and_release = std::numeric_limits<float>::infinity();
-        for (auto channel : active_channels_) {
+        for (auto channel : voices_) {
             float vol_output = volume_env_.envelope_[channel].GetLastOutput();
             if (vol_output < min_vol) {
                 min_vol = vol_output;
@@ -800,7 +854,12 @@ private:
     }
 
     // -------------------- processing blocks --------------------
-    void ProcessAndAddBlock(size_t channel, float* left, float* right, size_t num_samples) noexcept;
+    using VoiceBlock = std::array<float, kBlockSize>;
+    void ProcessVoiceGroup(uint32_t const* channels, size_t num_channels, float* left, float* right, size_t num_samples) noexcept;
+    void ProcessBlepOscillators(uint32_t const* lanes, size_t num_channels, VoiceBlock const* pitch_buffer, VoiceBlock* osc_buffer, size_t num_samples) noexcept;
+    void ProcessOscillators(size_t channel, float const* pitch_buffer, float* osc_buffer, size_t num_samples) noexcept;
+    void ProcessVoices(float* left, float* right, size_t num_samples) noexcept;
+    static void ProcessVoicePart(void* ctx, size_t part) noexcept;
     void ProcessSection(float* left, float* right, size_t num_samples) noexcept {
         while (num_samples != 0) {
             size_t cando = std::min<size_t>(num_samples, kBlockSize);
@@ -808,9 +867,7 @@ private:
             std::fill_n(right, cando, 0.0f);
 
             // -------------------- tick oscillator and filter --------------------
-            for (auto channel : active_channels_) {
-                ProcessAndAddBlock(channel, left, right, cando);
-            }
+            ProcessVoices(left, right, cando);
 
             // -------------------- tick effects --------------------
             std::array<qwqdsp_psimd::Float32x4, kBlockSize> fx_temp;
@@ -835,6 +892,15 @@ private:
         RemoveDeadChannels();
     }
 
+    // 多线程渲染复音，每块负责一段连续的复音，写入自己的缓冲区
+    pluginshared::RTWorkerPool* worker_pool_{};
+    size_t num_voice_parts_{1};
+    size_t part_num_samples_{};
+    size_t num_part_channels_{};
+    std::array<uint32_t, kMaxPoly> part_channels_{};
+    std::array<std::array<float, kBlockSize>, kMaxVoiceParts> part_left_{};
+    std::array<std::array<float, kBlockSize>, kMaxVoiceParts> part_right_{};
+
     // polynomial management
     size_t last_trigger_channel_{};
     size_t was_num_voices_{kMaxPoly};
@@ -844,6 +910,59 @@ private:
 
     // oscillator section
     using BlepCoeff = qwqdsp_oscillator::blep_coeff::BlackmanNutallApprox;
+    // osc3的unison按4个或8个一组并行
+    static constexpr size_t kMinPackedUnison = 4;
+    static constexpr size_t kWidePackedUnison = 8;
+    template<size_t kLanes>
+    using UnisonBlep = qwqdsp_simd_element::PolyBlep<BlepCoeff, kLanes>;
+    using VoicePack = qwqdsp_simd_element::PackFloat<kVoiceLanes>;
+    using VoiceMask = qwqdsp_simd_element::PackUint32<kVoiceLanes>;
+    using VoiceBlep = qwqdsp_simd_element::PolyBlep<BlepCoeff, kVoiceLanes>;
+    using VoiceBlepSync = qwqdsp_simd_element::PolyBlepSync<BlepCoeff, kVoiceLanes>;
+    // 波形作为模板参数，保证内联进每个采样点的循环
+    template<size_t kShape>
+    QWQDSP_FORCE_INLINE
+    static VoicePack TickVoiceOsc1(VoicePack const& phase, VoicePack const& phase_inc, VoicePack const& pwm) noexcept {
+        if constexpr (kShape == 0) {
+            return VoiceBlep::Sawtooth(phase, phase_inc);
+        }
+        else if constexpr (kShape == 1) {
+            return VoiceBlep::Triangle(phase, phase_inc);
+        }
+        else {
+            return VoiceBlep::PWM_Classic(phase, phase_inc, pwm);
+        }
+    }
+    template<size_t kShape, bool kSync>
+    QWQDSP_FORCE_INLINE
+    static VoicePack TickVoiceOsc2(VoiceBlepSync& osc, VoiceMask const& reset, VoicePack const& frac) noexcept {
+        if constexpr (!kSync) {
+            if constexpr (kShape == 0) {
+                return osc.Sawtooth();
+            }
+            else if constexpr (kShape == 1) {
+                return osc.Triangle();
+            }
+            else if constexpr (kShape == 2) {
+                return osc.PWM();
+            }
+            else {
+                return osc.Sine();
+            }
+        }
+        else if constexpr (kShape == 0) {
+            return osc.Sawtooth(reset, frac);
+        }
+        else if constexpr (kShape == 1) {
+            return osc.Triangle(reset, frac);
+        }
+        else if constexpr (kShape == 2) {
+            return osc.PWM(reset, frac);
+        }
+        else {
+            return osc.Sine(reset, frac);
+        }
+    }
     float osc1_phase_[kMaxPoly]{};
     qwqdsp_oscillator::PolyBlep<BlepCoeff> osc1_;
     qwqdsp_oscillator::PolyBlepSync<BlepCoeff> osc2_[kMaxPoly];
@@ -887,8 +1006,8 @@ private:
             : IModulator(name)
             , param_(param) {}
         
-        void Update(size_t channel) noexcept {
-            this->modulator_output[channel][0] = param_.GetNoMod();
+        void Update(size_t channel, size_t num_samples) noexcept {
+            std::fill_n(this->modulator_output[channel].begin(), num_samples, param_.GetNoMod());
         }
     private:
         FloatParam& param_;
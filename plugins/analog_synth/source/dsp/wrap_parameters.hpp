@@ -45,10 +45,16 @@ public:
 
     void ClearModBuffer() noexcept {
         std::fill_n(buffer, kMaxPoly, 0.0f);
+        for (auto& b : block_buffer) {
+            b.fill(0.0f);
+        }
     }
 
     juce::AudioParameterFloat* ptr_{};
+    // 当前子块的调制量
     float buffer[kMaxPoly]{};
+    // 一个block里每个子块的调制量，由ModulationMatrix填写
+    std::array<float, kNumModBlocks> block_buffer[kMaxPoly]{};
 
     juce::String name_;
     juce::NormalisableRange<float> range_;
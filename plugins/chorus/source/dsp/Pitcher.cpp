@@ -1,27 +1,34 @@
 #include "Pitcher.h"
 
-void Pitcher::init(WindowMode _mode) {
+void Pitcher::Shared::init(WindowMode _mode) {
+    mode = _mode;
+    int winSize = windowSizes[_mode];
+    history.init(winSize * 2, kMaxBlockSize);
+    fftmem1.assign(winSize * 2, 0.f);
+    fftmem2.assign(winSize * 2, 0.f);
+    numAligned = 0;
+}
+
+void Pitcher::init(WindowMode _mode, Shared& shared) {
+    jassert(shared.mode == _mode);
     mode = _mode;
     int winSize = windowSizes[_mode];
-    buffer.init(winSize * 2);
 
     acf = acfFlags[_mode];
     lastHeadSpeed = readHeadSpeed = 1.f;
     crossFadeSamples = winSize / 2;
-    fftmem1.resize(winSize * 2, 0.f);
-    fftmem2.resize(winSize * 2, 0.f);
 
-    readHead1 = buffer.size * .5f;
+    readHead1 = shared.history.size * .5f;
     readHead2 = -1.f;
 }
 
 // calculates the ACF and finds its maximum.
-float Pitcher::computeMaxACFPosition() {
+float Pitcher::computeMaxACFPosition(Shared& shared) {
     int winsize = windowSizes[mode];
     int fftSize = winsize * 2;
-    float* B1 = fftmem2.data();
-    float* B2 = fftmem1.data();
-    auto& fft = fftSet.get(mode);
+    float* B1 = shared.fftmem2.data();
+    float* B2 = shared.fftmem1.data();
+    auto& fft = shared.fftSet.get(mode);
 
     fft.performRealOnlyForwardTransform(B1);
     fft.performRealOnlyForwardTransform(B2);
@@ -83,73 +90,94 @@ float Pitcher::getSpeedFromSemis(float semis) {
     return std::pow(2.f, semis / 12.f) - 1.0f;
 }
 
-void Pitcher::update(float l, float r) {
-    readHead1 -= readHeadSpeed;
-
-    if (fader.count <= 0.f) {
-        fade = false;
-        fader.count = 1.f;
-        readHead1 = readHead2;
+// Voices that start a crossfade on the same sample in the same direction copy
+// the same two windows out of the shared history, so the ACF is only
+// computed once for them.
+float Pitcher::findAlignment(Shared& shared, int n, int src, int target, bool pitchUp) {
+    uint64_t count = shared.history.countAt(n);
+    for (int i = 0; i < shared.numAligned; ++i) {
+        auto const& cached = shared.alignCache[i];
+        if (cached.count == count && cached.pitchUp == pitchUp) return cached.position;
     }
 
-    buffer.write(l, r);
-    buffer.read(readHead1);
-    float L1 = buffer.outL;
-    float R1 = buffer.outR;
+    std::fill(shared.fftmem1.begin(), shared.fftmem1.end(), 0.f);
+    std::fill(shared.fftmem2.begin(), shared.fftmem2.end(), 0.f);
+    shared.history.copyFromBuffer(shared.fftmem1.data(), n, src,
+                                  crossFadeSamples); // left
+    shared.history.copyFromBuffer(shared.fftmem2.data(), n, target,
+                                  crossFadeSamples); // right
+    float position = computeMaxACFPosition(shared);
 
-    if (fade) // Crossfade active
-    {
-        buffer.read(readHead2);
-        readHead2 -= readHeadSpeed;
-        float L2 = buffer.outL;
-        float R2 = buffer.outR;
+    if (shared.numAligned < Shared::kCacheSize) {
+        shared.alignCache[shared.numAligned++] = {count, pitchUp, position};
+    }
+    return position;
+}
 
-        fader.eval();
+void Pitcher::process(Shared& shared, float* outLeft, float* outRight, int numSamples) {
+    jassert(numSamples <= Shared::kMaxBlockSize);
+    auto const& history = shared.history;
 
-        outL = L1 * fader.w + L2 * (1.0f - fader.w);
-        outR = R1 * fader.w + R2 * (1.0f - fader.w);
-    }
-    else {
-        int src, target;
-        bool crit;
+    for (int n = 0; n < numSamples; ++n) {
+        readHead1 -= readHeadSpeed;
 
-        if (readHeadSpeed <= 0.0f) // pitching down
-        {
-            src = buffer.size - crossFadeSamples;
-            crit = readHead1 > src;
-            target = crossFadeSamples + crossFadeSamples;
+        if (fader.count <= 0.f) {
+            fade = false;
+            fader.count = 1.f;
+            readHead1 = readHead2;
         }
-        else // pitching up
+
+        float L1, R1;
+        history.read(n, readHead1, L1, R1);
+
+        if (fade) // Crossfade active
         {
-            src = crossFadeSamples;
-            crit = readHead1 <= src;
-            target = buffer.size - crossFadeSamples;
+            float L2, R2;
+            history.read(n, readHead2, L2, R2);
+            readHead2 -= readHeadSpeed;
+
+            fader.eval();
+
+            outLeft[n] += L1 * fader.w + L2 * (1.0f - fader.w);
+            outRight[n] += R1 * fader.w + R2 * (1.0f - fader.w);
         }
+        else {
+            int src, target;
+            bool crit;
+            bool pitchUp = readHeadSpeed > 0.0f;
+
+            if (!pitchUp) // pitching down
+            {
+                src = history.size - crossFadeSamples;
+                crit = readHead1 > src;
+                target = crossFadeSamples + crossFadeSamples;
+            }
+            else // pitching up
+            {
+                src = crossFadeSamples;
+                crit = readHead1 <= src;
+                target = history.size - crossFadeSamples;
+            }
 
-        if (crit) {
-            // We're over the crossFadeSample boundary. Time to quickly
-            // initialize the crossfade. We determine the phase shift between the
-            // cross fade sections using an autocorrelation between them. We then
-            // jump into the buffer with an offset that corresponds to the peak
-            // in the autocorrelation function.
-            float cmax_position = 0.f;
-            if (acf) {
-                std::fill(fftmem1.begin(), fftmem1.end(), 0.f);
-                std::fill(fftmem2.begin(), fftmem2.end(), 0.f);
-                buffer.copyFromBuffer(fftmem1.data(), src,
-                                      crossFadeSamples); // left
-                buffer.copyFromBuffer(fftmem2.data(), target,
-                                      crossFadeSamples); // right
-                cmax_position = computeMaxACFPosition();
+            if (crit) {
+                // We're over the crossFadeSample boundary. Time to quickly
+                // initialize the crossfade. We determine the phase shift between the
+                // cross fade sections using an autocorrelation between them. We then
+                // jump into the buffer with an offset that corresponds to the peak
+                // in the autocorrelation function.
+                float cmax_position = 0.f;
+                if (acf) {
+                    cmax_position = findAlignment(shared, n, src, target, pitchUp);
+                }
+
+                fader.prepare(std::floor(crossFadeSamples / std::max(1.1f, std::abs(readHeadSpeed))));
+                readHead2 = target - cmax_position;
+                fade = true;
             }
 
-            fader.prepare(std::floor(crossFadeSamples / std::max(1.1f, std::abs(readHeadSpeed))));
-            readHead2 = target - cmax_position;
-            fade = true;
+            // No fade, just normal output
+            outLeft[n] += L1;
+            outRight[n] += R1;
         }
-
-        // No fade, just normal output
-        outL = L1;
-        outR = R1;
     }
 }
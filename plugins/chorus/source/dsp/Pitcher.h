@@ -11,47 +11,68 @@
 #include <juce_dsp/juce_dsp.h>
 
 #include <algorithm>
+#include <array>
 #include <cmath>
+#include <cstdint>
 #include <vector>
 
-class RingBuffer {
+// Stereo input history shared by every Pitcher of a chorus.
+// Written once per block, power-of-two and mirrored, so reads never wrap.
+// Positions are given relative to the write position after sample `n` of the
+// last written block, in a logical ring of `size` samples (like the old
+// per-voice buffer).
+class SharedHistory {
 public:
-    std::vector<float> left, right;
-    int writePos = 0;
     int size = 0;
-    float outL = 0.f;
-    float outR = 0.f;
-
-    void init(int _size) {
-        size = _size;
-        left.resize(size, 0.f);
-        right.resize(size, 0.f);
-        while (writePos >= size) writePos -= size;
+
+    void init(int logicalSize, int maxBlockSize) {
+        jassert(juce::isPowerOfTwo(logicalSize));
+        size = logicalSize;
+        capacity = juce::nextPowerOfTwo(logicalSize + maxBlockSize + 4);
+        mask = capacity - 1;
+        left.assign((size_t)capacity * 2, 0.f);
+        right.assign((size_t)capacity * 2, 0.f);
+        writePos = 0;
+        writeCount = 0;
+        blockStart = 0;
+        blockStartCount = 0;
     }
 
-    inline void write(float l, float r) {
-        left[writePos] = l;
-        right[writePos] = r;
-        writePos = (writePos + 1) % size;
+    void write(const float* l, const float* r, int numSamples) {
+        blockStart = writePos;
+        blockStartCount = writeCount;
+        int remaining = numSamples;
+        while (remaining > 0) {
+            int chunk = std::min(capacity - writePos, remaining);
+            std::copy_n(l, chunk, left.data() + writePos);
+            std::copy_n(l, chunk, left.data() + writePos + capacity);
+            std::copy_n(r, chunk, right.data() + writePos);
+            std::copy_n(r, chunk, right.data() + writePos + capacity);
+            writePos = (writePos + chunk) & mask;
+            l += chunk;
+            r += chunk;
+            remaining -= chunk;
+        }
+        writeCount += (uint64_t)numSamples;
     }
 
-    inline int wrap(int idx) const {
-        while (idx < 0) idx += size;
-        while (idx >= size) idx -= size;
-        return idx;
+    // number of samples written up to and including sample n of the last block
+    uint64_t countAt(int n) const {
+        return blockStartCount + (uint64_t)n + 1;
     }
 
-    inline void read(float dtime) {
-        float readPos = (float)writePos - dtime;
+    inline void read(int n, float dtime, float& outL, float& outR) const {
+        int logicalWrite = (int)(countAt(n) & (uint64_t)(size - 1));
+        float readPos = (float)logicalWrite - dtime;
         while (readPos < 0.f) readPos += (float)size;
         while (readPos >= (float)size) readPos -= (float)size;
 
         int i1 = (int)std::floor(readPos);
         float t = readPos - (float)i1;
 
-        int i0 = wrap(i1 - 1);
-        int i2 = wrap(i1 + 1);
-        int i3 = wrap(i1 + 2);
+        // logical index i1 holds the sample written `behind` (1..size) samples ago
+        int behind = ((logicalWrite - i1 - 1) & (size - 1)) + 1;
+        int write = physicalWrite(n);
 
         float t2 = t * t;
         float t3 = t2 * t;
@@ -61,34 +82,53 @@ public:
         float a2 = -1.5f * t3 + 2.0f * t2 + 0.5f * t;
         float a3 = 0.5f * t3 - 0.5f * t2;
 
-        outL = a0 * left[i0] + a1 * left[i1] + a2 * left[i2] + a3 * left[i3];
-        outR = a0 * right[i0] + a1 * right[i1] + a2 * right[i2] + a3 * right[i3];
+        if (behind >= 3 && behind < size) {
+            int base = (write - behind - 1) & mask;
+            const float* l = left.data() + base;
+            const float* r = right.data() + base;
+            outL = a0 * l[0] + a1 * l[1] + a2 * l[2] + a3 * l[3];
+            outR = a0 * r[0] + a1 * r[1] + a2 * r[2] + a3 * r[3];
+        }
+        else {
+            // the taps wrap around the logical ring
+            int i0 = (write - wrapBehind(behind + 1)) & mask;
+            int i1p = (write - behind) & mask;
+            int i2 = (write - wrapBehind(behind - 1)) & mask;
+            int i3 = (write - wrapBehind(behind - 2)) & mask;
+            outL = a0 * left[i0] + a1 * left[i1p] + a2 * left[i2] + a3 * left[i3];
+            outR = a0 * right[i0] + a1 * right[i1p] + a2 * right[i2] + a3 * right[i3];
+        }
     }
 
-    // Copies 'copyLength' samples from 'delay' behind writePos into a linear
-    // target array
-    void copyFromBuffer(float* target, int delay, int copyLength) const {
-        int start = writePos - delay;
-        while (start < 0) start += size;
-        start %= size;
-
-        int remaining = copyLength;
-        int pos = start;
-        int out = 0;
-
-        while (remaining > 0) {
-            int chunk = std::min(size - pos, remaining);
+    // Copies 'copyLength' mono samples from 'delay' behind the write position
+    // after sample n into a linear target array
+    void copyFromBuffer(float* target, int n, int delay, int copyLength) const {
+        int start = (physicalWrite(n) - delay) & mask;
+        const float* l = left.data() + start;
+        const float* r = right.data() + start;
+        for (int i = 0; i < copyLength; ++i) {
+            target[i] = 0.5f * (l[i] + r[i]);
+        }
+    }
 
-            for (int i = 0; i < chunk; ++i) {
-                int idx = pos + i;
-                target[out + i] = 0.5f * (left[idx] + right[idx]);
-            }
+private:
+    inline int wrapBehind(int behind) const {
+        if (behind < 1) return behind + size;
+        if (behind > size) return behind - size;
+        return behind;
+    }
 
-            out += chunk;
-            remaining -= chunk;
-            pos = (pos + chunk) % size;
-        }
+    inline int physicalWrite(int n) const {
+        return (blockStart + n + 1) & mask;
     }
+
+    std::vector<float> left, right;
+    int capacity = 0;
+    int mask = 0;
+    int writePos = 0;
+    uint64_t writeCount = 0;
+    int blockStart = 0;
+    uint64_t blockStartCount = 0;
 };
 
 class Pitcher {
@@ -139,9 +179,9 @@ public:
     static constexpr int O_WIN_MEDIUM = 10;
     static constexpr int O_WIN_LARGE = 11;
 
-    std::array<int, 3> windowSizes{1 << O_WIN_SMALL, 1 << O_WIN_MEDIUM, 1 << O_WIN_LARGE};
-    std::array<int, 3> fftOrders{O_WIN_SMALL, O_WIN_MEDIUM, O_WIN_LARGE};
-    std::array<bool, 3> acfFlags{false, true, true};
+    static constexpr std::array<int, 3> windowSizes{1 << O_WIN_SMALL, 1 << O_WIN_MEDIUM, 1 << O_WIN_LARGE};
+    static constexpr std::array<int, 3> fftOrders{O_WIN_SMALL, O_WIN_MEDIUM, O_WIN_LARGE};
+    static constexpr std::array<bool, 3> acfFlags{false, true, true};
 
     struct FFTSet {
         juce::dsp::FFT fftSmall{O_WIN_SMALL};
@@ -163,22 +203,47 @@ public:
         }
     };
 
+    // Everything the voices of one chorus have in common: the input history,
+    // the FFTs and scratch for phase alignment, and the alignment results of
+    // the current block (voices that start a crossfade on the same sample in
+    // the same direction search identical windows).
+    struct Shared {
+        static constexpr int kMaxBlockSize = 256;
+        static constexpr int kCacheSize = 8;
+
+        struct AlignResult {
+            uint64_t count = 0;
+            bool pitchUp = false;
+            float position = 0.f;
+        };
+
+        WindowMode mode = WindowMode::kSmall;
+        SharedHistory history;
+        FFTSet fftSet;
+        std::vector<float> fftmem1; // Fft buffers used for phase alignment (only
+                                    // needed when use_acf = 1).
+        std::vector<float> fftmem2;
+        std::array<AlignResult, kCacheSize> alignCache{};
+        int numAligned = 0;
+
+        void init(WindowMode mode);
+        // call after writing the history of a new block
+        void beginBlock() { numAligned = 0; }
+    };
+
     WindowMode mode = WindowMode::kSmall;
-    float outL = 0.f;
-    float outR = 0.f;
 
-    void init(WindowMode mode);
-    float computeMaxACFPosition();
-    void update(float l, float r);
+    void init(WindowMode mode, Shared& shared);
+    // adds numSamples (<= Shared::kMaxBlockSize) of output, the input must
+    // already be written to shared.history
+    void process(Shared& shared, float* outLeft, float* outRight, int numSamples);
     void setSpeed(float newHeadSpeed);
     float getSpeedFromSemis(float semis);
 private:
-    RingBuffer buffer; //
+    float computeMaxACFPosition(Shared& shared);
+    float findAlignment(Shared& shared, int n, int src, int target, bool pitchUp);
+
     CosineFade fader;
-    FFTSet fftSet;
-    std::vector<float> fftmem1; // Fft buffers used for phase alignment (only
-                                // needed when use_acf = 1).
-    std::vector<float> fftmem2;
     float readHead1 = 0.f;
     float readHead2 = 0.f;
     float lastHeadSpeed = 0.f;
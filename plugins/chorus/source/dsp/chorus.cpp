@@ -40,29 +40,32 @@ static constexpr std::array<std::array<float, 16>, 16> kPanTable{
 // clang-format on
 
 void Chorus::Init(float fs) {
+    shared_.init(Pitcher::WindowMode::kMedium);
     for (size_t i = 0; i < 16; ++i) {
-        pitch_shifter_[i].init(Pitcher::WindowMode::kMedium);
+        pitch_shifter_[i].init(Pitcher::WindowMode::kMedium, shared_);
     }
 }
 
 void Chorus::Process(float* left, float* right, size_t num_samples) {
-    while (num_samples--) {
-        float lx = *left;
-        float rx = *right;
+    // the input history is written once per block and read by every voice
+    while (num_samples != 0) {
+        int const cando = static_cast<int>(std::min<size_t>(num_samples, Pitcher::Shared::kMaxBlockSize));
 
-        float ly = 0;
-        float ry = 0;
+        shared_.history.write(left, right, cando);
+        shared_.beginBlock();
+
+        std::fill_n(out_left_.begin(), cando, 0.0f);
+        std::fill_n(out_right_.begin(), cando, 0.0f);
         for (size_t i = 0; i < 16; ++i) {
-            pitch_shifter_[i].update(lx, rx);
-            ly += pitch_shifter_[i].outL;
-            ry += pitch_shifter_[i].outR;
+            pitch_shifter_[i].process(shared_, out_left_.data(), out_right_.data(), cando);
         }
 
-        *left = ly;
-        *right = ry;
+        std::copy_n(out_left_.begin(), cando, left);
+        std::copy_n(out_right_.begin(), cando, right);
 
-        ++left;
-        ++right;
+        left += cando;
+        right += cando;
+        num_samples -= static_cast<size_t>(cando);
     }
 }
 
@@ -15,7 +15,10 @@ public:
     float detune{};
     float spread{};
 private:
+    Pitcher::Shared shared_;
     std::array<Pitcher, 16> pitch_shifter_;
+    std::array<float, Pitcher::Shared::kMaxBlockSize> out_left_{};
+    std::array<float, Pitcher::Shared::kMaxBlockSize> out_right_{};
 };
 
 } // namespace chorus
@@ -7,10 +7,12 @@
 // ---------------------------------------- time prev ----------------------------------------
 
 void TimeView::UpdateGui() {
-    std::copy_n(p_.coeffs_.begin(), p_.coeff_len_, coeff_buffer_.begin());
+    auto coeffs = p_.gui_coeffs_.View();
+    coeff_len_ = coeffs.size();
+    std::copy(coeffs.begin(), coeffs.end(), coeff_buffer_.begin());
 
-    if (p_.coeff_len_ != 0) {
-        coeff_buffer_[p_.coeff_len_] = coeff_buffer_[p_.coeff_len_ - 1];
+    if (coeff_len_ != 0) {
+        coeff_buffer_[coeff_len_] = coeff_buffer_[coeff_len_ - 1];
     }
     repaint();
 }
@@ -31,7 +33,7 @@ void TimeView::paint(juce::Graphics& g) {
     g.setColour(ui::line_fore);
     float lasty = juce::jmap(coeff_buffer_[0], -1.0f, 1.0f, bf.getBottom(), bf.getY());
     float lastx = bf.getX();
-    float const fcoeff_len = static_cast<float>(p_.coeff_len_);
+    float const fcoeff_len = static_cast<float>(coeff_len_);
     for (int x = 0; x < b.getWidth(); ++x) {
         size_t const idx = static_cast<size_t>(static_cast<float>(x) * fcoeff_len / static_cast<float>(b.getWidth()));
         float const val = coeff_buffer_[idx];
@@ -60,6 +62,10 @@ void TimeView::paint(juce::Graphics& g) {
 }
 
 void TimeView::mouseDrag(const juce::MouseEvent& e) {
+    if (coeff_len_ == 0) {
+        return;
+    }
+
     // 获取图表bound
     auto b = getLocalBounds();
     b.removeFromTop(title_.getHeight());
@@ -69,10 +75,10 @@ void TimeView::mouseDrag(const juce::MouseEvent& e) {
     pos.x = std::clamp(pos.x, b.getX(), b.getRight());
     pos.y = std::clamp(pos.y, b.getY(), b.getBottom());
 
-    float const fcoeff_len = static_cast<float>(p_.coeff_len_);
+    float const fcoeff_len = static_cast<float>(coeff_len_);
     auto bf = b.toFloat();
     size_t idx = static_cast<size_t>((static_cast<float>(pos.getX()) - bf.getX()) * fcoeff_len / static_cast<float>(bf.getWidth()));
-    idx = std::clamp(idx, 0ull, p_.coeff_len_ - 1);
+    idx = std::clamp(idx, 0ull, coeff_len_ - 1);
 
     float val = juce::jmap(static_cast<float>(pos.y), bf.getY(), bf.getBottom(), 1.0f, -1.0f);
     if (e.mods.isRightButtonDown()) {
@@ -106,10 +112,8 @@ void TimeView::SendCoeffs() {
 }
 
 void TimeView::CopyCoeffesToCustom() {
-    {
-        juce::ScopedLock _{p_.getCallbackLock()};
-        std::copy_n(p_.coeffs_.begin(), p_.coeff_len_, p_.custom_coeffs_.begin());
-    }
+    auto coeffs = p_.gui_coeffs_.View();
+    std::copy(coeffs.begin(), coeffs.end(), p_.custom_coeffs_.begin());
     std::copy(p_.custom_coeffs_.begin(), p_.custom_coeffs_.end(), coeff_buffer_.begin());
     repaint();
 }
@@ -134,7 +138,7 @@ void SpectralView::paint(juce::Graphics& g) {
     g.fillRect(b);
 
     // 绘制频谱音量数字
-    float const fcoeff_len = static_cast<float>(time_.p_.coeff_len_);
+    float const fcoeff_len = static_cast<float>(time_.coeff_len_);
     constexpr size_t kNumLines = 5;
     float const centerx = text_bound.getCentreX();
     g.setColour(juce::Colours::white);
@@ -181,7 +185,7 @@ void SpectralView::paint(juce::Graphics& g) {
 
 void SpectralView::UpdateGui() {
     std::array<float, kGainFFTSize> fft_buffer{};
-    std::copy_n(time_.coeff_buffer_.begin(), time_.p_.coeff_len_, fft_buffer.begin());
+    std::copy_n(time_.coeff_buffer_.begin(), time_.coeff_len_, fft_buffer.begin());
     fft_.FFTGainPhase(fft_buffer, gains_);
 
     for (auto& x : gains_) {
@@ -213,7 +217,10 @@ void SpectralView::mouseDrag(const juce::MouseEvent& e) {
     pos.x = std::clamp(pos.x, b.getX(), b.getRight());
     pos.y = std::clamp(pos.y, b.getY(), b.getBottom());
 
-    size_t const coeff_len = time_.p_.coeff_len_;
+    size_t const coeff_len = time_.coeff_len_;
+    if (coeff_len == 0) {
+        return;
+    }
     float const fcoeff_len = static_cast<float>(coeff_len);
     size_t idx = static_cast<size_t>((static_cast<float>(pos.getX()) - bf.getX()) * fcoeff_len / bf.getWidth());
     idx = std::clamp(idx, 0ull, coeff_len - 1);
@@ -353,6 +360,8 @@ DeepPhaserAudioProcessorEditor::DeepPhaserAudioProcessorEditor (DeepPhaserAudioP
 
     custom_.setToggleState(p.is_using_custom_, juce::sendNotificationSync);
 
+    p_.gui_coeffs_.Update();
+    UpdateGui();
     startTimerHz(30);
 }
 
@@ -448,7 +457,7 @@ void DeepPhaserAudioProcessorEditor::resized() {
 }
 
 void DeepPhaserAudioProcessorEditor::timerCallback() {
-    if (p_.have_new_coeff_.exchange(false)) {
+    if (p_.gui_coeffs_.Update()) {
         UpdateGui();
     }
 }
@@ -78,6 +78,7 @@ private:
     ui::FlatButton clear_;
     ui::Switch display_custom_{"show ctm"};
     std::array<float, kMaxCoeffLen + 1> coeff_buffer_{};
+    size_t coeff_len_{};
 
     friend class SpectralView;
 };
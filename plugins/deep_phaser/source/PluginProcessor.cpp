@@ -240,7 +240,6 @@ DeepPhaserAudioProcessor::DeepPhaserAudioProcessor()
     preset_manager_ = std::make_unique<pluginshared::PresetManager>(*value_tree_, *this);
     // preset_manager_->external_load_default_operations = [this]{
     //     is_using_custom_ = false;
-    //     have_new_coeff_ = true;
     //     should_update_fir_ = true;
     //     std::ranges::fill(custom_coeffs_, float{});
     //     std::ranges::fill(custom_spectral_gains, float{});
@@ -827,7 +826,7 @@ void DeepPhaserAudioProcessor::UpdateCoeff() {
     }
     fir_gain_ = 1.0f / std::sqrt(energy + 1e-10f);
 
-    have_new_coeff_ = true;
+    gui_coeffs_.Publish(kernel);
 }
 
 void DeepPhaserAudioProcessor::Panic() {
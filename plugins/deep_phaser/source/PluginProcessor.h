@@ -2,6 +2,7 @@
 #include <pluginshared/juce_param_listener.hpp>
 #include <pluginshared/preset_manager.hpp>
 #include <pluginshared/bpm_sync_lfo.hpp>
+#include <pluginshared/snapshot.hpp>
 
 #include "deep_phaser.hpp"
 
@@ -68,7 +69,8 @@ public:
     juce::AudioParameterFloat* param_drywet_;
 
     std::atomic<bool> should_update_fir_{};
-    std::atomic<bool> have_new_coeff_{};
+    // 音频线程更新系数后发布给UI
+    pluginshared::ArraySnapshot<float, kMaxCoeffLen> gui_coeffs_;
 
     static constexpr size_t kSIMDMaxCoeffLen = ((kMaxCoeffLen + 3) / 4) * 4;
 
@@ -8,20 +8,45 @@
 #include <qwqdsp/convert.hpp>
 #include <qwqdsp/simd_element/simd_element.hpp>
 
+#include "simd_detector.h"
+
 using SimdType = qwqdsp_simd_element::PackFloat<4>;
 using SimdIntType = qwqdsp_simd_element::PackInt32<4>;
 
+/**
+ * @brief 一阶全通级联，左右声道分开存放
+ *        y[k] = xlag[k] + c * (x[k] - ylag[k]) 可以拆成 s[k] + c * y[k-1]，其中s[k]只依赖上一个样本的状态
+ *        同一个样本内所有级共享同一个c，于是整条级联是常系数一阶递推，可以在4/8个通道上做前缀扫描
+ */
 class AllpassBuffer2 {
 public:
+    enum class ProcessArch {
+        kVector4,
+        kVector8,
+        kNothing
+    };
+
     static constexpr size_t kRealNumApf = 512;
     static constexpr size_t kNumApf = kRealNumApf / SimdType::kSize;
     static constexpr size_t kIndexSize = kNumApf * SimdType::kSize;
     static constexpr size_t kIndexMask = kNumApf * SimdType::kSize - 1;
     static constexpr float kMaxIndex = kIndexSize;
 
+    AllpassBuffer2() {
+        process_arch_ = ProcessArch::kNothing;
+        if (simd_detector::is_supported(simd_detector::InstructionSet::PLUGIN_VEC8_DISPATCH_ISET)) {
+            process_arch_ = ProcessArch::kVector8;
+        }
+        else if (simd_detector::is_supported(simd_detector::InstructionSet::PLUGIN_VEC4_DISPATCH_ISET)) {
+            process_arch_ = ProcessArch::kVector4;
+        }
+    }
+
     void Reset() noexcept {
-        std::ranges::fill(output_buffer_, SimdType{});
-        std::ranges::fill(xlags_, SimdType{});
+        std::ranges::fill(left_xlags_, 0.0f);
+        std::ranges::fill(right_xlags_, 0.0f);
+        std::ranges::fill(left_ylags_, 0.0f);
+        std::ranges::fill(right_ylags_, 0.0f);
     }
 
     QWQDSP_FORCE_INLINE
@@ -34,54 +59,49 @@ public:
             SimdType right;
         };
 
-        SimdType const* buffer = xlags_.data();
         SimdType y0;
-        y0[0] = buffer[irpos[0]][0];
-        y0[1] = buffer[irpos[1]][0];
-        y0[2] = buffer[irpos[2]][0];
-        y0[3] = buffer[irpos[3]][0];
+        y0[0] = left_xlags_[irpos[0]];
+        y0[1] = left_xlags_[irpos[1]];
+        y0[2] = left_xlags_[irpos[2]];
+        y0[3] = left_xlags_[irpos[3]];
         SimdType y1;
-        y1[0] = buffer[irpos[0]][1];
-        y1[1] = buffer[irpos[1]][1];
-        y1[2] = buffer[irpos[2]][1];
-        y1[3] = buffer[irpos[3]][1];
+        y1[0] = right_xlags_[irpos[0]];
+        y1[1] = right_xlags_[irpos[1]];
+        y1[2] = right_xlags_[irpos[2]];
+        y1[3] = right_xlags_[irpos[3]];
         return LRSimdType{y0,y1};
     }
 
+    /**
+     * @note 向量路径会把级数向上取整到4/8的倍数，多出来的几级状态在SetZero扩大级数时清零
+     */
     QWQDSP_FORCE_INLINE
     void Push(float left_x, float rightx, float left_coeff, float right_coeff, size_t num_cascade) noexcept {
-        SimdType* xlag_ptr = xlags_.data();
-        SimdType* ylag_ptr = output_buffer_.data();
-        SimdType coeff{left_coeff, right_coeff};
-        SimdType x{left_x, rightx};
-        for (size_t i = 0; i < num_cascade; ++i) {
-            SimdType yout = *xlag_ptr + coeff * (x - *ylag_ptr);
-            *xlag_ptr = x;
-            *ylag_ptr = yout;
-            x = yout;
-            ++xlag_ptr;
-            ++ylag_ptr;
-            // float left_y = xlag_ptr[0] + left_coeff * (left_x - ylag_ptr[0]);
-            // float righty = xlag_ptr[1] + right_coeff * (rightx - ylag_ptr[1]);
-            // xlag_ptr[0] = left_x;
-            // xlag_ptr[1] = rightx;
-            // ylag_ptr[0] = left_y;
-            // ylag_ptr[1] = righty;
-            // left_x = left_y;
-            // rightx = righty;
-            // xlag_ptr += 2;
-            // ylag_ptr += 2;
+        if (process_arch_ == ProcessArch::kVector8) {
+            PushVec8(left_x, rightx, left_coeff, right_coeff, num_cascade);
+        }
+        else if (process_arch_ == ProcessArch::kVector4) {
+            PushVec4(left_x, rightx, left_coeff, right_coeff, num_cascade);
+        }
+        else {
+            PushScalar(left_x, left_coeff, left_xlags_.data(), left_ylags_.data(), num_cascade);
+            PushScalar(rightx, right_coeff, right_xlags_.data(), right_ylags_.data(), num_cascade);
         }
     }
 
+    void PushVec4(float left_x, float rightx, float left_coeff, float right_coeff, size_t num_cascade) noexcept;
+    void PushVec8(float left_x, float rightx, float left_coeff, float right_coeff, size_t num_cascade) noexcept;
+
     void SetZero(size_t last_num, size_t curr_num) noexcept {
         size_t const begin_idx = last_num;
         size_t const end_idx = curr_num;
         for (size_t i = begin_idx; i < end_idx; ++i) {
-            output_buffer_[i] = {};
+            left_ylags_[i] = 0;
+            right_ylags_[i] = 0;
         }
         for (size_t i = begin_idx; i < end_idx; ++i) {
-            xlags_[i] = {};
+            left_xlags_[i] = 0;
+            right_xlags_[i] = 0;
         }
     }
 
@@ -99,10 +119,26 @@ public:
     }
 
     SimdType GetLR(size_t filter_idx) const noexcept {
-        // return SimdType{xlags_[filter_idx * 2], xlags_[filter_idx * 2 + 1]};
-        return xlags_[filter_idx];
+        return SimdType{left_xlags_[filter_idx], right_xlags_[filter_idx], 0.0f, 0.0f};
+    }
+
+    ProcessArch GetProcessArch() const noexcept {
+        return process_arch_;
     }
 private:
-    alignas(16) std::array<SimdType, kRealNumApf> output_buffer_{};
-    alignas(16) std::array<SimdType, kRealNumApf> xlags_{};
+    QWQDSP_FORCE_INLINE
+    static void PushScalar(float x, float coeff, float* xlag_ptr, float* ylag_ptr, size_t num_cascade) noexcept {
+        for (size_t i = 0; i < num_cascade; ++i) {
+            float yout = xlag_ptr[i] + coeff * (x - ylag_ptr[i]);
+            xlag_ptr[i] = x;
+            ylag_ptr[i] = yout;
+            x = yout;
+        }
+    }
+
+    ProcessArch process_arch_{};
+    alignas(32) std::array<float, kRealNumApf> left_xlags_{};
+    alignas(32) std::array<float, kRealNumApf> right_xlags_{};
+    alignas(32) std::array<float, kRealNumApf> left_ylags_{};
+    alignas(32) std::array<float, kRealNumApf> right_ylags_{};
 };
@@ -1,4 +1,5 @@
 #pragma once
+#include <cstddef>
 
 static constexpr size_t kMaxCoeffLen = 16;
 static constexpr size_t kFFTSize = 512;
@@ -0,0 +1,41 @@
+#include "deep_phaser.hpp"
+
+#include "x86/sse4.1.h"
+
+/**
+ * @brief 每4级做一次前缀扫描，组之间串行传递最后一级的输出
+ */
+static void PushScan4(float x, float coeff, float* xlag_ptr, float* ylag_ptr, size_t num_cascade) noexcept {
+    // coeff_pow[i] = c^(i+1)
+    float const c2 = coeff * coeff;
+    simde__m128 const coeff_pow = simde_mm_set_ps(c2 * c2, c2 * coeff, c2, coeff);
+    simde__m128 const vc1 = simde_mm_set1_ps(coeff);
+    simde__m128 const vc2 = simde_mm_set1_ps(c2);
+    simde__m128 carry = simde_mm_set1_ps(x);
+
+    for (size_t i = 0; i < num_cascade; i += 4) {
+        simde__m128 const xlag = simde_mm_load_ps(xlag_ptr + i);
+        simde__m128 const ylag = simde_mm_load_ps(ylag_ptr + i);
+
+        // s[k] = xlag[k] - c * ylag[k]
+        simde__m128 y = simde_mm_sub_ps(xlag, simde_mm_mul_ps(vc1, ylag));
+        // y[j] = sum_{m<=j} c^(j-m) s[m]
+        simde__m128 shifted = simde_mm_castsi128_ps(simde_mm_slli_si128(simde_mm_castps_si128(y), 4));
+        y = simde_mm_add_ps(y, simde_mm_mul_ps(vc1, shifted));
+        shifted = simde_mm_castsi128_ps(simde_mm_slli_si128(simde_mm_castps_si128(y), 8));
+        y = simde_mm_add_ps(y, simde_mm_mul_ps(vc2, shifted));
+        // 加上前一组的输出
+        y = simde_mm_add_ps(y, simde_mm_mul_ps(coeff_pow, carry));
+
+        // 这一级的输入就是上一级的输出
+        shifted = simde_mm_castsi128_ps(simde_mm_slli_si128(simde_mm_castps_si128(y), 4));
+        simde_mm_store_ps(xlag_ptr + i, simde_mm_blend_ps(shifted, carry, 0b0001));
+        simde_mm_store_ps(ylag_ptr + i, y);
+        carry = simde_mm_shuffle_ps(y, y, SIMDE_MM_SHUFFLE(3, 3, 3, 3));
+    }
+}
+
+void AllpassBuffer2::PushVec4(float left_x, float rightx, float left_coeff, float right_coeff, size_t num_cascade) noexcept {
+    PushScan4(left_x, left_coeff, left_xlags_.data(), left_ylags_.data(), num_cascade);
+    PushScan4(rightx, right_coeff, right_xlags_.data(), right_ylags_.data(), num_cascade);
+}
@@ -0,0 +1,53 @@
+#include "deep_phaser.hpp"
+
+#include "x86/avx2.h"
+#include "x86/fma.h"
+
+/**
+ * @brief 每8级做一次前缀扫描，组之间串行传递最后一级的输出
+ */
+static void PushScan8(float x, float coeff, float* xlag_ptr, float* ylag_ptr, size_t num_cascade) noexcept {
+    // coeff_pow[i] = c^(i+1)
+    float const c2 = coeff * coeff;
+    float const c4 = c2 * c2;
+    simde__m256 const coeff_pow = simde_mm256_set_ps(
+        c4 * c4, c4 * c2 * coeff, c4 * c2, c4 * coeff,
+        c4, c2 * coeff, c2, coeff
+    );
+    simde__m256 const vc1 = simde_mm256_set1_ps(coeff);
+    simde__m256 const vc2 = simde_mm256_set1_ps(c2);
+    simde__m256 const vc4 = simde_mm256_set1_ps(c4);
+    simde__m256 const zero = simde_mm256_setzero_ps();
+    simde__m256i const shift1_idx = simde_mm256_set_epi32(6, 5, 4, 3, 2, 1, 0, 0);
+    simde__m256i const shift2_idx = simde_mm256_set_epi32(5, 4, 3, 2, 1, 0, 0, 0);
+    simde__m256i const last_idx = simde_mm256_set1_epi32(7);
+    simde__m256 carry = simde_mm256_set1_ps(x);
+
+    for (size_t i = 0; i < num_cascade; i += 8) {
+        simde__m256 const xlag = simde_mm256_load_ps(xlag_ptr + i);
+        simde__m256 const ylag = simde_mm256_load_ps(ylag_ptr + i);
+
+        // s[k] = xlag[k] - c * ylag[k]
+        simde__m256 y = simde_mm256_fnmadd_ps(vc1, ylag, xlag);
+        // y[j] = sum_{m<=j} c^(j-m) s[m]，扫描与carry无关，可以和上一组重叠执行
+        simde__m256 shifted = simde_mm256_blend_ps(simde_mm256_permutevar8x32_ps(y, shift1_idx), zero, 0b00000001);
+        y = simde_mm256_fmadd_ps(vc1, shifted, y);
+        shifted = simde_mm256_blend_ps(simde_mm256_permutevar8x32_ps(y, shift2_idx), zero, 0b00000011);
+        y = simde_mm256_fmadd_ps(vc2, shifted, y);
+        shifted = simde_mm256_permute2f128_ps(y, y, 0x08);
+        y = simde_mm256_fmadd_ps(vc4, shifted, y);
+        // 加上前一组的输出
+        y = simde_mm256_fmadd_ps(coeff_pow, carry, y);
+
+        // 这一级的输入就是上一级的输出
+        shifted = simde_mm256_blend_ps(simde_mm256_permutevar8x32_ps(y, shift1_idx), carry, 0b00000001);
+        simde_mm256_store_ps(xlag_ptr + i, shifted);
+        simde_mm256_store_ps(ylag_ptr + i, y);
+        carry = simde_mm256_permutevar8x32_ps(y, last_idx);
+    }
+}
+
+void AllpassBuffer2::PushVec8(float left_x, float rightx, float left_coeff, float right_coeff, size_t num_cascade) noexcept {
+    PushScan8(left_x, left_coeff, left_xlags_.data(), left_ylags_.data(), num_cascade);
+    PushScan8(rightx, right_coeff, right_xlags_.data(), right_ylags_.data(), num_cascade);
+}
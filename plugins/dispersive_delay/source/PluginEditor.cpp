@@ -16,47 +16,29 @@ DispersiveDelayAudioProcessorEditor::DispersiveDelayAudioProcessorEditor (Disper
 
     delay_time_.BindParam(apvt, "delay_time");
     delay_time_.setHelpText("delay time, unit is ms");
-    delay_time_.slider.onValueChange = [this] {
-        TryUpdateGroupDelay();
-    };
 
     f_begin_.BindParam(apvt, "f_begin");
     f_begin_.setHelpText("frequency begin, unit is semitone");
-    f_begin_.slider.onValueChange = [this] {
-        TryUpdateGroupDelay();
-    };
 
     f_end_.BindParam(apvt, "f_end");
     f_end_.setHelpText("frequency end, unit is semitone");
-    f_end_.slider.onValueChange = [this] {
-        TryUpdateGroupDelay();
-    };
 
     flat_.BindParam(apvt, "flat");
     flat_.setHelpText("control the all pass filter pole radius behavior");
-    flat_.slider.onValueChange = [this] {
-        TryUpdateGroupDelay();
-    };
 
     min_bw_.BindParam(apvt, "min_bw");
-    min_bw_.slider.onValueChange = [this] {
-        TryUpdateGroupDelay();
-    };
 
     x_axis_.setButtonText("pitch-x");
     x_axis_.setTooltip("if enable, x axis is pitch unit. otherwise, x axis is hz unit");
     x_axis_attachment_ = std::make_unique<juce::ButtonParameterAttachment>(*p.pitch_x_asix_, x_axis_);
-    x_axis_.onStateChange = [this] {
-        TryUpdateGroupDelay();
-    };
+
+    fir_render_.BindParam(apvt, "fir_render");
+    fir_render_.setTooltip("render the allpass cascade to an impulse response and convolve it, much cheaper for dense curves. uses the allpass cascade while editing");
 
     ui::SetLableBlack(res_label_);
     res_label_.setText("resolution", juce::dontSendNotification);
     reslution_.addItemList(p.resolution_->choices, 1);
     resolution_attachment_ = std::make_unique<juce::ComboBoxParameterAttachment>(*p.resolution_, reslution_);
-    reslution_.onChange = [this] {
-        TryUpdateGroupDelay();
-    };
 
     panic_.setButtonText("panic");
     panic_.onClick = [this] {
@@ -84,6 +66,7 @@ DispersiveDelayAudioProcessorEditor::DispersiveDelayAudioProcessorEditor (Disper
     ui::SetLableBlack(num_filter_label_);
     addAndMakeVisible(num_filter_label_);
     addAndMakeVisible(x_axis_);
+    addAndMakeVisible(fir_render_);
     addAndMakeVisible(reslution_);
     addAndMakeVisible(res_label_);
     addAndMakeVisible(clear_curve_);
@@ -97,13 +80,13 @@ DispersiveDelayAudioProcessorEditor::DispersiveDelayAudioProcessorEditor (Disper
     curve_.SetSnapGrid(true);
     curve_.SetGridNum(16, 8);
 
-    p_.curve_->AddListener(this);
     TryUpdateGroupDelay();
+    startTimerHz(30);
 }
 
 
 DispersiveDelayAudioProcessorEditor::~DispersiveDelayAudioProcessorEditor() {
-    p_.curve_->RemoveListener(this);
+    stopTimer();
     resolution_attachment_ = nullptr;
     x_axis_attachment_ = nullptr;
 }
@@ -175,7 +158,11 @@ void DispersiveDelayAudioProcessorEditor::resized() {
                 btn_aera.removeFromTop(4);
                 panic_.setBounds(btn_aera.removeFromTop(25));
             }
-            x_axis_.setBounds(buttons_aera.removeFromTop(30).reduced(4, 0));
+            {
+                auto switch_aera = buttons_aera.removeFromTop(30).reduced(4, 0);
+                x_axis_.setBounds(switch_aera.removeFromLeft(switch_aera.getWidth() / 2));
+                fir_render_.setBounds(switch_aera);
+            }
             num_filter_label_.setBounds(buttons_aera);
         }
         {
@@ -189,52 +176,30 @@ void DispersiveDelayAudioProcessorEditor::resized() {
 }
 
 void DispersiveDelayAudioProcessorEditor::TryUpdateGroupDelay() {
+    const juce::ScopedLock lock{ p_.design_lock_ };
+    last_design_count_ = p_.design_count_.load();
     num_filter_label_.setText(juce::String{ "n.filters: " } + juce::String(p_.delays_.GetNumFilters()), juce::dontSendNotification);
 
     constexpr auto pi = std::numbers::pi_v<float>;
     auto fs = static_cast<float>(p_.getSampleRate());
 
-    group_delay_cache_.clear();
-    auto size = group_delay_cache_.capacity();
-    if (x_axis_.getToggleState()) {
-        for (size_t i = 0; i < size; ++i) {
-            auto nor = i / static_cast<float>(size);
-            auto hz = MelMap(nor);
-            auto w = hz / fs * 2 * pi;
-            auto delay_num_samples = p_.delays_.GetGroupDelay(w);
-            auto delay_num_ms = delay_num_samples * 1000.0f / fs;
-            group_delay_cache_.emplace_back(delay_num_ms);
-        }
+    auto size = group_delay_cache_.size();
+    group_delay_w_.resize(size);
+    for (size_t i = 0; i < size; ++i) {
+        auto nor = i / static_cast<float>(size);
+        auto hz = x_axis_.getToggleState() ? MelMap(nor) : std::lerp(20.0f, 20000.0f, nor);
+        group_delay_w_[i] = hz / fs * 2 * pi;
     }
-    else {
-        for (size_t i = 0; i < size; ++i) {
-            auto nor = i / static_cast<float>(size);
-            auto hz = std::lerp(20.0f, 20000.0f, nor);
-            auto w = hz / fs * 2 * pi;
-            auto delay_num_samples = p_.delays_.GetGroupDelay(w);
-            auto delay_num_ms = delay_num_samples * 1000.0f / fs;
-            group_delay_cache_.emplace_back(delay_num_ms);
-        }
+    p_.delays_.GetGroupDelay(group_delay_w_, group_delay_cache_);
+    for (auto& delay : group_delay_cache_) {
+        delay *= 1000.0f / fs;
     }
     repaint();
 }
 
-void DispersiveDelayAudioProcessorEditor::OnAddPoint(mana::CurveV2* generator, mana::CurveV2::Point p, int before_idx) {
-    TryUpdateGroupDelay();
-}
-
-void DispersiveDelayAudioProcessorEditor::OnRemovePoint(mana::CurveV2* generator, int remove_idx) {
-    TryUpdateGroupDelay();
-}
-
-void DispersiveDelayAudioProcessorEditor::OnPointXyChanged(mana::CurveV2* generator, int changed_idx) {
-    TryUpdateGroupDelay();
-}
-
-void DispersiveDelayAudioProcessorEditor::OnPointPowerChanged(mana::CurveV2* generator, int changed_idx) {
-    TryUpdateGroupDelay();
-}
-
-void DispersiveDelayAudioProcessorEditor::OnReload(mana::CurveV2* generator) {
-    TryUpdateGroupDelay();
+void DispersiveDelayAudioProcessorEditor::timerCallback() {
+    auto const design_count = p_.design_count_.load();
+    if (design_count != last_design_count_) {
+        TryUpdateGroupDelay();
+    }
 }
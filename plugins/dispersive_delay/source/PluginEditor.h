@@ -11,7 +11,7 @@ class DispersiveDelayAudioProcessor;
 //==============================================================================
 class DispersiveDelayAudioProcessorEditor final 
     : public juce::AudioProcessorEditor
-    , public mana::CurveV2::Listener {
+    , public juce::Timer {
 public:
     explicit DispersiveDelayAudioProcessorEditor (DispersiveDelayAudioProcessor&);
     ~DispersiveDelayAudioProcessorEditor() override;
@@ -23,12 +23,8 @@ public:
 
 private:
     void TryUpdateGroupDelay();
-    // implement for Listener
-    void OnAddPoint(mana::CurveV2* generator, mana::CurveV2::Point p, int before_idx) override;
-    void OnRemovePoint(mana::CurveV2* generator, int remove_idx) override;
-    void OnPointXyChanged(mana::CurveV2* generator, int changed_idx) override;
-    void OnPointPowerChanged(mana::CurveV2* generator, int changed_idx) override;
-    void OnReload(mana::CurveV2* generator) override;
+    // 级联在工作线程设计，设计完成后再刷新群延迟
+    void timerCallback() override;
 
     DispersiveDelayAudioProcessor& p_;
     pluginshared::PresetPanel preset_panel_;
@@ -42,6 +38,7 @@ private:
     juce::Label num_filter_label_;
     ui::Switch x_axis_{"mel", "hz"};
     std::unique_ptr<juce::ButtonParameterAttachment> x_axis_attachment_;
+    ui::Switch fir_render_{"fir"};
 
     juce::Label res_label_;
     juce::ComboBox reslution_;
@@ -54,7 +51,9 @@ private:
     ui::Dial delay_{"delay"};
     ui::Dial damp_{"damp"};
 
+    std::vector<float> group_delay_w_;
     std::vector<float> group_delay_cache_;
+    uint32_t last_design_count_{};
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (DispersiveDelayAudioProcessorEditor)
 };
@@ -100,6 +100,20 @@ DispersiveDelayAudioProcessor::DispersiveDelayAudioProcessor()
         resolution_ = p.get();
         layout.add(std::move(p));
     }
+    {
+        auto p = std::make_unique<juce::AudioParameterBool>(juce::ParameterID{ "fir_render",0 },
+                                                            "fir_render",
+                                                            false);
+        fir_render_ = p.get();
+        layout.add(std::move(p));
+    }
+    {
+        auto p = std::make_unique<juce::AudioParameterFloat>(juce::ParameterID{ "ir_threshold",0 },
+                                                             "ir_threshold",
+                                                             -140.0f, -40.0f, -100.0f);
+        ir_threshold_ = p.get();
+        layout.add(std::move(p));
+    }
 
     value_tree_ = std::make_unique<juce::AudioProcessorValueTreeState>(*this, nullptr, "PARAMETERS", std::move(layout));
     preset_manager_ = std::make_unique<pluginshared::PresetManager>(*value_tree_, *this);
@@ -111,15 +125,19 @@ DispersiveDelayAudioProcessor::DispersiveDelayAudioProcessor()
     value_tree_->addParameterListener("pitch_x", this);
     value_tree_->addParameterListener("min_bw", this);
     value_tree_->addParameterListener("resolution", this);
+    value_tree_->addParameterListener("ir_threshold", this);
     OnReload(curve_.get());
 
     preset_manager_->external_load_default_operations = [this]{
         curve_->Init(mana::CurveV2::CurveInitEnum::kRamp);
     };
+
+    design_thread_.startThread();
 }
 
 DispersiveDelayAudioProcessor::~DispersiveDelayAudioProcessor()
 {
+    design_thread_.stopThread(-1);
     value_tree_ = nullptr;
 }
 
@@ -191,9 +209,13 @@ void DispersiveDelayAudioProcessor::changeProgramName (int index, const juce::St
 //==============================================================================
 void DispersiveDelayAudioProcessor::prepareToPlay (double sampleRate, int samplesPerBlock)
 {
-    // why this value not set on startup
-    delays_.PrepareProcess(1000.0f, sampleRate);
-    parameterChanged(beta_->getParameterID(), beta_->get());
+    {
+        const juce::ScopedLock lock{ design_lock_ };
+        delays_.PrepareProcess(1000.0f, sampleRate);
+    }
+    // 第一个block就需要正确的级联
+    cascade_dirty_ = true;
+    DesignCascade();
 }
 
 void DispersiveDelayAudioProcessor::releaseResources()
@@ -231,6 +253,7 @@ void DispersiveDelayAudioProcessor::processBlock (juce::AudioBuffer<float>& buff
 {
     juce::ScopedNoDenormals noDenormals;
 
+    delays_.SetFirEnable(fir_render_->get());
     delays_.Process(
         buffer.getWritePointer(0),
         buffer.getWritePointer(1),
@@ -264,6 +287,8 @@ void DispersiveDelayAudioProcessor::getStateInformation (juce::MemoryBlock& dest
     j["delay_time"] = delay_time_->get();
     j["pitch_x"] = pitch_x_asix_->get();
     j["resolution"] = resolution_->getIndex();
+    j["fir_render"] = fir_render_->get();
+    j["ir_threshold"] = ir_threshold_->get();
 
     auto d = j.dump();
     destData.append(d.data(), d.size());
@@ -295,6 +320,8 @@ void DispersiveDelayAudioProcessor::setStateInformation (const void* data, int s
         }
         resolution_->setValueNotifyingHost(resolution_->convertTo0to1(j.value<int>("resolution", kResulitionNames.indexOf("1024"))));
         beta_->setValueNotifyingHost(beta_->convertTo0to1(j.value<float>("flat", GetDefaultValue(beta_))));
+        fir_render_->setValueNotifyingHost(j.value<bool>("fir_render", false) ? 1.0f : 0.0f);
+        ir_threshold_->setValueNotifyingHost(ir_threshold_->convertTo0to1(j.value<float>("ir_threshold", GetDefaultValue(ir_threshold_))));
         UpdateFilters();
     }
     catch (...) {
@@ -313,24 +340,29 @@ void DispersiveDelayAudioProcessor::setStateInformation (const void* data, int s
 
 void DispersiveDelayAudioProcessor::parameterChanged(const juce::String& parameterID, float newValue)
 {
-    if (parameterID == beta_->getParameterID()) {
-        auto ripple = std::pow(10.0f, beta_->get() / 20.0f);
-        delays_.SetBeta(ripple);
-    }
-    else if (parameterID == min_bw_->getParameterID()) {
-        auto bw = min_bw_->get();
-        delays_.SetMinBw(bw);
-        UpdateFilters();
-    }
-    else {
-        UpdateFilters();
-    }
+    // 可能在音频线程被调用，只做标记
+    cascade_dirty_ = true;
+    last_edit_ms_ = juce::Time::getMillisecondCounter();
 }
 
 void DispersiveDelayAudioProcessor::UpdateFilters()
 {
-    const juce::ScopedLock lock{ getCallbackLock() };
+    {
+        const juce::ScopedLock lock{ design_lock_ };
+        auto const& datas = curve_->GetDatas();
+        curve_snapshot_.assign(datas.begin(), datas.end());
+    }
+    cascade_dirty_ = true;
+    last_edit_ms_ = juce::Time::getMillisecondCounter();
+}
+
+void DispersiveDelayAudioProcessor::DesignCascade()
+{
+    if (!cascade_dirty_.exchange(false)) {
+        return;
+    }
 
+    const juce::ScopedLock lock{ design_lock_ };
     auto resolution_size = kResulitionTable[resolution_->getIndex()];
     auto f_begin = f_begin_->get();
     auto f_end = f_end_->get();
@@ -339,7 +371,35 @@ void DispersiveDelayAudioProcessor::UpdateFilters()
     }
 
     auto delay = delay_time_->get();
-    delays_.SetCurve(*curve_,resolution_size, delay, f_begin, f_end, pitch_x_asix_->get());
+    delays_.SetMinBw(min_bw_->get());
+    delays_.SetBeta(std::pow(10.0f, beta_->get() / 20.0f));
+    delays_.SetIRThreshold(ir_threshold_->get());
+    delays_.SetCurve(curve_snapshot_, resolution_size, delay, f_begin, f_end, pitch_x_asix_->get());
+    if (!delays_.PublishCascade()) {
+        // 音频线程还没归还缓冲区，下次再试
+        cascade_dirty_ = true;
+        return;
+    }
+    ++design_count_;
+}
+
+void DispersiveDelayAudioProcessor::RenderIR()
+{
+    delays_.FreeRetiredIR();
+    if (!fir_render_->get()) {
+        return;
+    }
+    if (juce::Time::getMillisecondCounter() - last_edit_ms_.load() < DesignThread::kEditSettleMs) {
+        return;
+    }
+
+    {
+        const juce::ScopedLock lock{ design_lock_ };
+        if (!delays_.PrepareRender(render_job_)) {
+            return;
+        }
+    }
+    delays_.PublishIR(delays_.RenderIR(render_job_));
 }
 
 void DispersiveDelayAudioProcessor::RandomParameter()
@@ -350,12 +410,6 @@ void DispersiveDelayAudioProcessor::RandomParameter()
     f_end_->setValueNotifyingHost(random_.nextFloat());
     delay_time_->setValueNotifyingHost(random_.nextFloat());
     pitch_x_asix_->setValueNotifyingHost(random_.nextFloat());
-
-    auto bw = min_bw_->get();
-    delays_.SetMinBw(bw);
-    UpdateFilters();
-    auto ripple = std::pow(10.0f, beta_->get() / 20.0f);
-    delays_.SetBeta(ripple);
 }
 
 void DispersiveDelayAudioProcessor::PanicFilterFb()
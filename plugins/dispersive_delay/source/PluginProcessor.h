@@ -64,13 +64,48 @@ public:
     juce::AudioParameterFloat* delay_time_{};
     juce::AudioParameterBool* pitch_x_asix_{};
     juce::AudioParameterChoice* resolution_{};
+    juce::AudioParameterBool* fir_render_{};
+    juce::AudioParameterFloat* ir_threshold_{};
 
     juce::Random random_;
 
+    // 设计端的数据(级联的设计结果、曲线快照)，不会在音频线程上锁
+    juce::CriticalSection design_lock_;
+    // 每发布一次级联加一，UI用来刷新群延迟
+    std::atomic<uint32_t> design_count_{};
+
 private:
     //==============================================================================
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (DispersiveDelayAudioProcessor)
 
+    /**
+     * @brief 参数或曲线改变后重新设计级联，曲线停止编辑一段时间后渲染FIR模式的IR
+     */
+    class DesignThread : public juce::Thread {
+    public:
+        static constexpr int kPollIntervalMs = 10;
+        static constexpr uint32_t kEditSettleMs = 200;
+
+        explicit DesignThread(DispersiveDelayAudioProcessor& p)
+            : juce::Thread("cascade design")
+            , processor_(p)
+        {}
+
+        void run() override {
+            juce::ScopedNoDenormals no_denormals;
+            while (!threadShouldExit()) {
+                processor_.DesignCascade();
+                processor_.RenderIR();
+                wait(kPollIntervalMs);
+            }
+        }
+    private:
+        DispersiveDelayAudioProcessor& processor_;
+    };
+
+    void DesignCascade();
+    void RenderIR();
+
     // 通过 Listener 继承
     void parameterChanged(const juce::String& parameterID, float newValue) override;
 
@@ -82,4 +117,11 @@ private:
     void OnPointXyChanged(mana::CurveV2* generator, int changed_idx) override;
     void OnPointPowerChanged(mana::CurveV2* generator, int changed_idx) override;
     void OnReload(mana::CurveV2* generator) override;
+
+    std::atomic<bool> cascade_dirty_{true};
+    std::atomic<uint32_t> last_edit_ms_{};
+    std::vector<float> curve_snapshot_;
+    SDelay::IRRenderJob render_job_;
+    // 最后构造，最先停止
+    DesignThread design_thread_{*this};
 };
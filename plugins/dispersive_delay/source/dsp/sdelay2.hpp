@@ -1,29 +1,101 @@
 #pragma once
 #include <vector>
+#include <cassert>
+#include <algorithm>
 #include <numbers>
-#include <complex>
 #include <array>
-#include "curve_v2.h"
+#include <atomic>
+#include <memory>
+#include <span>
+#include <cmath>
 #include "qwqdsp/simd_element/align_allocator.hpp"
+#include "qwqdsp/simd_element/simd_pack.hpp"
 #include "qwqdsp/filter/one_pole.hpp"
 #include "qwqdsp/fx/delay_line.hpp"
+#include "qwqdsp/fx/nonuniform_convolution.hpp"
 
+/**
+ * @brief 全通级联色散延迟
+ *        FIR模式: 级联在两次SetCurve之间是时不变的，工作线程渲染它的冲激响应，
+ *        前kFirHeadSize个点直接卷积，剩下的交给分块卷积，整体没有延迟，可以放在反馈环路里。
+ *        曲线正在编辑(IR还没渲染完)时使用IIR级联
+ *
+ * 线程:
+ *   设计线程: SetCurve/SetBeta/SetMinBw/SetIRThreshold 之后 PublishCascade，GetGroupDelay也属于设计端
+ *   音频线程: Process 在block开始时无锁地换入新的系数，并和旧的级联交叉淡化
+ */
 class SDelay {
 public:
     static constexpr size_t kMaxCascade = 8192;
+    static constexpr size_t kFirHeadSize = 64;
+    static constexpr size_t kModeFadeSamples = 512;
+    static constexpr size_t kCascadeFadeSamples = 256;
+    // 滤波器数量变化时新级联从零状态开始，先在后台运行这么久再淡化
+    static constexpr size_t kCascadeWarmupSamples = 4096;
+    // FIR切回IIR前，IIR从零状态开始预热的最长时间
+    static constexpr float kMaxIIRWarmupSeconds = 0.25f;
+    static constexpr size_t kNumCascadeBuffers = 4;
+    static constexpr float kMaxIRSeconds = 4.0f;
+
+    /**
+     * @brief 渲染IR需要的级联快照，在工作线程使用
+     */
+    struct IRRenderJob {
+        std::vector<float> a1;
+        std::vector<float> a2;
+        size_t max_length{};
+        float threshold{};
+        uint32_t version{};
+    };
+
+    /**
+     * @brief 渲染好的IR，头部是反转的直接卷积系数
+     */
+    struct FirIR {
+        alignas(32) std::array<float, kFirHeadSize> head{};
+        std::unique_ptr<qwqdsp_fx::NonUniformConvolution::PartitionSet> left_tail;
+        std::unique_ptr<qwqdsp_fx::NonUniformConvolution::PartitionSet> right_tail;
+        size_t length{};
+        uint32_t version{};
+    };
 
     SDelay() {
         magic_beta_ = std::sqrt(beta_ / (1 - beta_));
-        filters_.resize(kMaxCascade / 8 + 1);
         center_.resize(kMaxCascade + 8);
         bw_.resize(kMaxCascade + 8);
         radius_.resize(kMaxCascade + 8);
+        // 音频线程最多同时持有current和fading，另外一个在pending，设计端至少还有一个可以写
+        current_ = std::make_unique<Cascade>();
+        free_cascades_.reserve(kNumCascadeBuffers);
+        for (size_t i = 1; i < kNumCascadeBuffers; ++i) {
+            free_cascades_.push_back(std::make_unique<Cascade>());
+        }
+        // 每kFirHeadSize个样本处理一次，没有延迟
+        left_tail_.Init(kFirHeadSize, true);
+        right_tail_.Init(kFirHeadSize, true);
+        left_tail_.SetCrossfadeBlocks(0);
+        right_tail_.SetCrossfadeBlocks(0);
     }
 
+    ~SDelay() {
+        delete pending_cascade_.exchange(nullptr);
+        delete retired_cascade_.exchange(nullptr);
+        delete pending_fir_.exchange(nullptr);
+        delete retired_fir_.exchange(nullptr);
+        delete retiring_fir_;
+    }
+
+    /**
+     * @note 之后需要重新SetCurve和PublishCascade
+     */
     void PrepareProcess(float max_delay_time_ms, float sample_rate) {
         sample_rate_ = sample_rate;
         left_delay_.Init(max_delay_time_ms, sample_rate);
         right_delay_.Init(max_delay_time_ms, sample_rate);
+        // 采样率变了，旧的IR不再有效
+        ++design_version_;
+        // 播放开始时没有在输出的级联，下一个直接换上
+        cascade_installed_ = false;
     }
 
     void Process(
@@ -38,185 +110,256 @@ public:
         }
         right_damp_.CopyFrom(left_damp_);
 
+        if (fading_ == nullptr) {
+            InstallPendingCascade();
+        }
+        // 直接替换正在输出的IR会有跳变，先淡化到IIR再换
+        if (fir_enable_ && fir_mix_ == 0.0f) {
+            InstallPendingIR();
+        }
+
         float const delay_samples = delay_ms * sample_rate_ / 1000.0f;
-        size_t const cascade_loop_count = num_cascade_filters_ / 8;
-        size_t const scalar_loop_count = num_cascade_filters_ & 8;
-        alignas(32) float vy_first[8]{};
-        alignas(32) float vy_second[8]{};
-#ifndef __AVX2__
-        alignas(32) float vx[9]{};
-#endif
-        /**
-         * 简要的概况并行加速，所有的biquad均为转置直接二型
-         * 更新步骤即为 y = x*a2 + lag1
-         *         lag1 = (x-y)*a1 + lag2
-         *         lag2 = x - y*a2
-         * 注意到我们可以缓存每个滤波器的y和x，因为底层lag1和lag2的更新在每个滤波器是独立的
-         * 因此我们只需要顺序计算y，然后并行更新滤波器的lag1和lag2
-         */
         for (size_t xidx = 0; xidx < num_samples; ++xidx) {
             // x永远是最后一个滤波器的输出
             left_delay_.Push(left_out_);
             float x_first = first[xidx] + feedback * left_damp_.Tick(left_delay_.GetAfterPush(delay_samples));
             right_delay_.Push(right_out_);
             float x_second = second[xidx] + feedback * right_damp_.Tick(right_delay_.GetAfterPush(delay_samples));
-            auto* filter_ptr = filters_.data();
-            for (size_t i = 0; i < cascade_loop_count; ++i) {
-                float const begin_x_input_first = x_first;
-                float const begin_x_input_second = x_second;
-                // left channel serial
-                float* a2_ptr = filter_ptr->a2;
-                float* lag1_ptr = filter_ptr->lag1;
-                for (size_t j = 0; j < 8; ++j) {
-                    x_first = x_first * *a2_ptr + *lag1_ptr;
-                    vy_first[j] = x_first;
-                    ++a2_ptr;
-                    ++lag1_ptr;
+
+            float const fir_target = fir_enable_ && FirReady() ? 1.0f : 0.0f;
+            bool const run_iir = fir_mix_ < 1.0f || fir_target < 1.0f;
+            // 关闭FIR之后也要继续运行到淡出完成
+            if (fir_enable_ || fir_mix_ > 0.0f) {
+                float fir_first = x_first;
+                float fir_second = x_second;
+                TickFir(fir_first, fir_second);
+                if (fir_warmup_ != 0) {
+                    --fir_warmup_;
+                }
+
+                if (run_iir) {
+                    if (iir_stale_) {
+                        // IIR关闭期间的状态已经过期，清空后保持FIR输出，等IIR的状态跟上输入再淡化
+                        ClearCascadeLags();
+                        iir_stale_ = false;
+                        iir_warmup_ = std::min(last_fir_length_, static_cast<size_t>(sample_rate_ * kMaxIIRWarmupSeconds));
+                    }
+                    TickIIR(x_first, x_second);
+                    x_first += fir_mix_ * (fir_first - x_first);
+                    x_second += fir_mix_ * (fir_second - x_second);
+                    if (iir_warmup_ != 0 && fir_target < fir_mix_) {
+                        --iir_warmup_;
+                    }
+                    else if (fir_target > fir_mix_) {
+                        fir_mix_ = std::min(fir_target, fir_mix_ + 1.0f / kModeFadeSamples);
+                    }
+                    else {
+                        fir_mix_ = std::max(fir_target, fir_mix_ - 1.0f / kModeFadeSamples);
+                    }
+                    iir_stale_ = fir_mix_ >= 1.0f && fir_target >= 1.0f;
                 }
-                // right channel serial
-                a2_ptr = filter_ptr->a2;
-                float* lag1_ptr_2 = filter_ptr->lag1_second;
-                for (size_t j = 0; j < 8; ++j) {
-                    x_second = x_second * *a2_ptr + *lag1_ptr_2;
-                    vy_second[j] = x_second;
-                    ++a2_ptr;
-                    ++lag1_ptr_2;
+                else {
+                    x_first = fir_first;
+                    x_second = fir_second;
                 }
-                a2_ptr = filter_ptr->a2;
+            }
+            else {
+                TickIIR(x_first, x_second);
+            }
 
-                // vy现在是每个滤波器的输出
-                // left channel
-#ifdef __AVX2__
-                auto shuffle_mask = _mm256_set_epi32(6, 5, 4, 3, 2, 1, 0, 7);
-#endif
-                auto y = _mm256_load_ps(vy_first);
-#ifndef __AVX2__
-                vx[0] = begin_x_input_first;
-                _mm256_storeu_ps(vx + 1, y);
-                auto x = _mm256_load_ps(vx);
-#else
-                auto shuffled_reg = _mm256_permutevar8x32_ps(y, shuffle_mask);
-                auto iwantx = _mm256_set1_ps(begin_x_input_first);
-                auto x = _mm256_blend_ps(shuffled_reg, iwantx, 0b00000001);
-#endif
-                // update lag1
-                auto a1 = _mm256_load_ps(filter_ptr->a1);
-                auto lag2 = _mm256_load_ps(filter_ptr->lag2);
-                auto lag1 = _mm256_add_ps(lag2, _mm256_sub_ps(_mm256_mul_ps(x, a1), _mm256_mul_ps(y, a1)));
-                _mm256_store_ps(filter_ptr->lag1, lag1);
+            left_out_ = x_first;
+            right_out_ = x_second;
+            first[xidx] = x_first;
+            second[xidx] = x_second;
+        }
 
-                // update lag2
-                auto a2 = _mm256_load_ps(a2_ptr);
-                lag2 = _mm256_sub_ps(x, _mm256_mul_ps(y, a2));
-                _mm256_store_ps(filter_ptr->lag2, lag2);
+        if (fading_ != nullptr && cascade_fade_pos_ >= kCascadeFadeSamples) {
+            RetireFadingCascade();
+        }
+    }
 
+    /**
+     * @brief 开启FIR模式，只在音频线程调用
+     */
+    void SetFirEnable(bool enable) noexcept {
+        // 还在淡出的FIR状态依然有效，直接接着用
+        if (enable && !fir_enable_ && fir_mix_ == 0.0f) {
+            ResetFir();
+        }
+        fir_enable_ = enable;
+    }
 
-                // right channel
-                y = _mm256_load_ps(vy_second);
-#ifndef __AVX2__
-                vx[0] = begin_x_input_second;
-                _mm256_storeu_ps(vx + 1, y);
-                x = _mm256_load_ps(vx);
-#else
-                shuffled_reg = _mm256_permutevar8x32_ps(y, shuffle_mask);
-                iwantx = _mm256_set1_ps(begin_x_input_second);
-                x = _mm256_blend_ps(shuffled_reg, iwantx, 0b00000001);
-#endif
-                // update lag1
-                lag2 = _mm256_load_ps(filter_ptr->lag2_second);
-                lag1 = _mm256_add_ps(lag2, _mm256_sub_ps(_mm256_mul_ps(x, a1), _mm256_mul_ps(y, a1)));
-                _mm256_store_ps(filter_ptr->lag1_second, lag1);
+    /**
+     * @brief 设计端
+     * @param db 截断后剩余能量相对于总能量，例如-80dB
+     */
+    void SetIRThreshold(float db) noexcept {
+        float const threshold = std::pow(10.0f, db / 10.0f);
+        if (threshold != ir_threshold_) {
+            ir_threshold_ = threshold;
+            ++design_version_;
+        }
+    }
 
-                // update lag2
-                lag2 = _mm256_sub_ps(x, _mm256_mul_ps(y, a2));
-                _mm256_store_ps(filter_ptr->lag2_second, lag2);
+    /**
+     * @brief 设计端，把当前设计好的系数写入空闲缓冲区并交给音频线程
+     * @return false 暂时没有空闲缓冲区，稍后再试
+     */
+    bool PublishCascade() noexcept {
+        FreeRetiredCascade();
+        if (free_cascades_.empty()) {
+            return false;
+        }
+        auto cascade = std::move(free_cascades_.back());
+        free_cascades_.pop_back();
 
-                ++filter_ptr;
-            }
+        size_t const n = num_cascade_filters_;
+        for (size_t i = 0; i < n; ++i) {
+            float const radius = radius_[i];
+            cascade->filters[i / 8].a1[i & 7] = -2 * radius * std::cos(center_[i]);
+            cascade->filters[i / 8].a2[i & 7] = radius * radius;
+        }
+        cascade->num_filters = n;
+        cascade->version = design_version_;
 
-            //// 处理凑不齐8个的
-            float begin_x_input_first = x_first;
-            float begin_x_input_second = x_second;
-            // left channel
-            float* a2_ptr = filter_ptr->a2;
-            float* lag1_ptr = filter_ptr->lag1;
-            for (size_t j = 0; j < scalar_loop_count; ++j) {
-                x_first = x_first * *a2_ptr + *lag1_ptr;
-                vy_first[j] = x_first;
-                ++a2_ptr;
-                ++lag1_ptr;
+        // 还没被取走的旧系数直接回收
+        Cascade* old = pending_cascade_.exchange(cascade.release(), std::memory_order_acq_rel);
+        if (old != nullptr) {
+            free_cascades_.emplace_back(old);
+        }
+        return true;
+    }
+
+    /**
+     * @brief 设计端，复制当前设计好的级联系数
+     * @return false 当前设计已经请求过渲染
+     */
+    bool PrepareRender(IRRenderJob& job) {
+        if (render_version_ == design_version_) {
+            return false;
+        }
+        render_version_ = design_version_;
+
+        size_t const n = num_cascade_filters_;
+        job.a1.resize(n);
+        job.a2.resize(n);
+        for (size_t i = 0; i < n; ++i) {
+            job.a1[i] = -2 * radius_[i] * std::cos(center_[i]);
+            job.a2[i] = radius_[i] * radius_[i];
+        }
+        job.max_length = static_cast<size_t>(sample_rate_ * kMaxIRSeconds);
+        job.threshold = ir_threshold_;
+        job.version = design_version_;
+        return true;
+    }
+
+    /**
+     * @brief 在工作线程渲染级联的冲激响应并按能量截断，会分配内存
+     */
+    std::unique_ptr<FirIR> RenderIR(IRRenderJob const& job) const {
+        constexpr size_t kChunkSize = 2048;
+        size_t const num_filters = job.a1.size();
+        std::vector<float> lags(num_filters * 2);
+        std::vector<float> ir;
+        ir.reserve(job.max_length);
+
+        // 全通级联的冲激响应能量为1，剩余能量 = 1 - 已经渲染的能量
+        double energy = 0;
+        while (ir.size() < job.max_length) {
+            size_t const begin = ir.size();
+            size_t const len = std::min(kChunkSize, job.max_length - begin);
+            ir.resize(begin + len);
+            if (begin == 0) {
+                ir[0] = 1.0f;
             }
-            // right channel
-            a2_ptr = filter_ptr->a2;
-            float* lag1_ptr_2 = filter_ptr->lag1_second;
-            for (size_t j = 0; j < scalar_loop_count; ++j) {
-                x_second = x_second * *a2_ptr + *lag1_ptr_2;
-                vy_second[j] = x_second;
-                ++a2_ptr;
-                ++lag1_ptr_2;
+            std::span<float> chunk{ir.data() + begin, len};
+            // 一级一级地处理整段，系数和状态都在寄存器里
+            for (size_t i = 0; i < num_filters; ++i) {
+                float const a1 = job.a1[i];
+                float const a2 = job.a2[i];
+                float lag1 = lags[2 * i];
+                float lag2 = lags[2 * i + 1];
+                for (auto& s : chunk) {
+                    float const x = s;
+                    float const y = x * a2 + lag1;
+                    lag1 = (x - y) * a1 + lag2;
+                    lag2 = x - y * a2;
+                    s = y;
+                }
+                lags[2 * i] = lag1;
+                lags[2 * i + 1] = lag2;
             }
-            a2_ptr = filter_ptr->a2;
 
-            // left channel
-#ifdef __AVX2__
-            auto shuffle_mask = _mm256_set_epi32(6, 5, 4, 3, 2, 1, 0, 7);
-#endif
-            auto y = _mm256_load_ps(vy_first);
-#ifndef __AVX2__
-            vx[0] = begin_x_input_first;
-            _mm256_storeu_ps(vx + 1, y);
-            auto x = _mm256_load_ps(vx);
-#else
-            auto shuffled_reg = _mm256_permutevar8x32_ps(y, shuffle_mask);
-            auto iwantx = _mm256_set1_ps(begin_x_input_first);
-            auto x = _mm256_blend_ps(shuffled_reg, iwantx, 0b00000001);
-#endif
-            // update lag1
-            auto a1 = _mm256_load_ps(filter_ptr->a1);
-            auto lag2 = _mm256_load_ps(filter_ptr->lag2);
-            auto lag1 = _mm256_add_ps(lag2, _mm256_sub_ps(_mm256_mul_ps(x, a1), _mm256_mul_ps(y, a1)));
-            _mm256_store_ps(filter_ptr->lag1, lag1);
+            double chunk_energy = 0;
+            for (float x : chunk) {
+                chunk_energy += static_cast<double>(x) * x;
+            }
+            energy += chunk_energy;
+            if (1.0 - energy <= job.threshold) {
+                break;
+            }
+            // float的舍入误差使得能量不一定能精确凑到1，主体过去之后按每段的能量判断
+            if (energy > 0.5 && chunk_energy <= energy * job.threshold) {
+                break;
+            }
+        }
 
-            // update lag2
-            auto a2 = _mm256_load_ps(a2_ptr);
-            lag2 = _mm256_sub_ps(x, _mm256_mul_ps(y, a2));
-            _mm256_store_ps(filter_ptr->lag2, lag2);
+        // 截断: 剩余能量小于总能量*threshold
+        double const remain_limit = energy * job.threshold;
+        double remain = 0;
+        size_t len = ir.size();
+        while (len > 1) {
+            double const e = static_cast<double>(ir[len - 1]) * ir[len - 1];
+            if (remain + e > remain_limit) {
+                break;
+            }
+            remain += e;
+            --len;
+        }
+        ir.resize(std::max(len, kFirHeadSize + 1));
 
+        auto fir = std::make_unique<FirIR>();
+        for (size_t i = 0; i < kFirHeadSize; ++i) {
+            fir->head[kFirHeadSize - 1 - i] = ir[i];
+        }
+        std::span<const float> tail{ir.data() + kFirHeadSize, ir.size() - kFirHeadSize};
+        fir->left_tail = left_tail_.PrepareIR(tail);
+        fir->right_tail = right_tail_.PrepareIR(tail);
+        fir->length = ir.size();
+        fir->version = job.version;
+        return fir;
+    }
 
-            // right channel
-            y = _mm256_load_ps(vy_second);
-#ifndef __AVX2__
-            vx[0] = begin_x_input_second;
-            _mm256_storeu_ps(vx + 1, y);
-            x = _mm256_load_ps(vx);
-#else
-            shuffled_reg = _mm256_permutevar8x32_ps(y, shuffle_mask);
-            iwantx = _mm256_set1_ps(begin_x_input_second);
-            x = _mm256_blend_ps(shuffled_reg, iwantx, 0b00000001);
-#endif
-            // update lag1
-            lag2 = _mm256_load_ps(filter_ptr->lag2_second);
-            lag1 = _mm256_add_ps(lag2, _mm256_sub_ps(_mm256_mul_ps(x, a1), _mm256_mul_ps(y, a1)));
-            _mm256_store_ps(filter_ptr->lag1_second, lag1);
+    /**
+     * @brief 无锁地把IR交给音频线程，只允许一个工作线程调用
+     */
+    void PublishIR(std::unique_ptr<FirIR> fir) noexcept {
+        delete pending_fir_.exchange(fir.release(), std::memory_order_acq_rel);
+    }
 
-            // update lag2
-            lag2 = _mm256_sub_ps(x, _mm256_mul_ps(y, a2));
-            _mm256_store_ps(filter_ptr->lag2_second, lag2);
+    /**
+     * @brief 释放音频线程换下来的IR，在工作线程定期调用
+     */
+    void FreeRetiredIR() noexcept {
+        delete retired_fir_.exchange(nullptr, std::memory_order_acquire);
+        left_tail_.FreeRetiredIR();
+        right_tail_.FreeRetiredIR();
+    }
 
-            left_out_ = x_first;
-            right_out_ = x_second;
-            first[xidx] = x_first;
-            second[xidx] = x_second;
-        }
+    /**
+     * @return 当前是否完全在使用FIR渲染
+     */
+    bool IsUsingFir() const noexcept {
+        return fir_enable_ && fir_mix_ >= 1.0f;
     }
 
+    /**
+     * @brief 需要和Process互斥
+     */
     void PaincFilterFb() {
-        size_t const simd_loop = (num_cascade_filters_ + 7) / 8;
-        for (size_t i = 0; i < simd_loop; ++i) {
-            std::fill_n(filters_[i].lag1, 8, 0);
-            std::fill_n(filters_[i].lag2, 8, 0);
-            std::fill_n(filters_[i].lag1_second, 8, 0);
-            std::fill_n(filters_[i].lag2_second, 8, 0);
+        ClearCascadeLags();
+        if (fading_ != nullptr) {
+            ClearLags(*fading_);
         }
         left_damp_.Reset();
         right_damp_.Reset();
@@ -224,6 +367,7 @@ public:
         right_delay_.Reset();
         left_out_ = 0;
         right_out_ = 0;
+        ResetFir();
     }
 
     inline static float Hz2Mel(float hz) {
@@ -238,12 +382,14 @@ public:
     inline static const auto kMaxMel = Hz2Mel(20000.0f);
 
     /**
-     * @param curve unit: ms
+     * @brief 设计端
+     * @param curve 0~1，均匀采样，最后两个点是插值用的保护点(和CurveV2::GetDatas()一致)
+     * @param max_delay_ms unit: ms
      * @param p_begin 0~1
      * @param p_end 0~1
      */
     void SetCurve(
-        mana::CurveV2& curve, size_t resulotion, float max_delay_ms,
+        std::span<const float> curve, size_t resulotion, float max_delay_ms,
         float p_begin, float p_end,
         bool log_scale
     ) {
@@ -272,19 +418,20 @@ public:
             width_ratio_mul = 1;
         }
         
-        size_t const old_num = num_cascade_filters_;
+        ++design_version_;
         num_cascade_filters_ = 0;
         float intergal = 0.0f;
         float allpass_begin_w = begin_w;
         float allpass_end_w = begin_w;
-
-        size_t simd_counter = 0;
-        size_t scalar_counter = 0;
+        float const curve_last = static_cast<float>(curve.size() - 2);
 
         for (size_t i = 0; i < resulotion;) {
             while (intergal < fourpi && i < resulotion) {
                 auto nor = i / (resulotion - 1.0f);
-                auto delay_ms = curve.GetNormalize(nor) * max_delay_ms;
+                auto const curve_idx = nor * curve_last;
+                auto const curve_before = static_cast<size_t>(curve_idx);
+                auto const curve_value = std::lerp(curve[curve_before], curve[curve_before + 1], curve_idx - static_cast<float>(curve_before));
+                auto delay_ms = curve_value * max_delay_ms;
                 auto delay_samples = delay_ms * sample_rate_ / 1000.0f;
                 intergal += w_width * delay_samples;
                 allpass_end_w += w_width;
@@ -312,24 +459,10 @@ public:
                     center_[num_cascade_filters_] = center;
                     radius_[num_cascade_filters_] = pole_radius;
                     bw_[num_cascade_filters_] = bw;
-                    filters_[simd_counter].a1[scalar_counter] = -2 * pole_radius * std::cos(center);
-                    filters_[simd_counter].a2[scalar_counter] = pole_radius * pole_radius;
                     ++num_cascade_filters_;
-                    ++scalar_counter;
-                    if (scalar_counter > 7) {
-                        scalar_counter = 0;
-                        ++simd_counter;
-                    }
                 }
             }
         }
-
-        // 清除新滤波器的数据
-        size_t const old_num_simd_loop = old_num / 8;
-        size_t const new_num_simd_loop = (num_cascade_filters_ + 7) / 8;
-        for (size_t i = old_num_simd_loop; i < new_num_simd_loop; ++i) {
-            filters_[i].ClearLags();
-        }
     }
 
     void SetMinBw(float bw) {
@@ -337,76 +470,476 @@ public:
         min_bw_ = bw / sample_rate_ * twopi;
     }
 
+    /**
+     * @brief 设计端
+     */
     void SetBeta(float beta) {
         beta_ = beta;
         magic_beta_ = std::sqrt(beta_ / (1 - beta_));
+        ++design_version_;
 
-        size_t const simd_loop = num_cascade_filters_ / 8;
-        size_t const scalar_loop = num_cascade_filters_ & 7;
-        size_t fidx = 0;
-        for (size_t i = 0; i < simd_loop; ++i) {
-            for (size_t j = 0; j < 8; ++j) {
-                auto radius = GetPoleRadius(bw_[fidx]);
-                radius_[fidx] = radius;
-                filters_[i].a1[j] = -2 * radius * std::cos(center_[fidx]);
-                filters_[i].a2[j] = radius * radius;
-                ++fidx;
+        for (size_t i = 0; i < num_cascade_filters_; ++i) {
+            radius_[i] = GetPoleRadius(bw_[i]);
+        }
+    }
+
+    /**
+     * @brief 设计端，批量计算群延迟，系数和频率都没变时直接返回上一次的结果
+     *        单个极点 r*e^{j*theta} 的群延迟 (1-r^2) / ((1-r)^2 + 4r*sin^2((w-theta)/2))，共轭极点同理
+     *        半角的正弦用和差公式展开，避免w靠近极点时1-cos的相消误差
+     * @param w 0~pi
+     * @param out unit: samples，至少和w一样长
+     */
+    void GetGroupDelay(std::span<const float> w, std::span<float> out) {
+        using qwqdsp_simd_element::PackFloat;
+        assert(out.size() >= w.size());
+
+        if (gd_version_ == design_version_ && std::ranges::equal(w, gd_w_)) {
+            std::ranges::copy(gd_out_, out.begin());
+            return;
+        }
+        if (gd_version_ != design_version_) {
+            UpdateGroupDelayTerms();
+        }
+        gd_version_ = design_version_;
+        gd_w_.assign(w.begin(), w.end());
+
+        size_t const num_w = w.size();
+        size_t const padded = (num_w + 7) & ~size_t{7};
+        gd_sin_half_w_.resize(padded);
+        gd_cos_half_w_.resize(padded);
+        gd_out_.resize(padded);
+        for (size_t i = 0; i < padded; ++i) {
+            float const half_w = i < num_w ? w[i] * 0.5f : 0.0f;
+            gd_sin_half_w_[i] = std::sin(half_w);
+            gd_cos_half_w_[i] = std::cos(half_w);
+        }
+
+        size_t const num_filters = num_cascade_filters_;
+        for (size_t i = 0; i < padded; i += 8) {
+            PackFloat<8> sin_w;
+            PackFloat<8> cos_w;
+            sin_w.Load(gd_sin_half_w_.data() + i);
+            cos_w.Load(gd_cos_half_w_.data() + i);
+            PackFloat<8> delay{};
+            for (size_t k = 0; k < num_filters; ++k) {
+                auto const& term = gd_terms_[k];
+                PackFloat<8> const a = sin_w * term.cos_half;
+                PackFloat<8> const b = cos_w * term.sin_half;
+                // sin((w-theta)/2), sin((w+theta)/2)
+                PackFloat<8> const d_minus = a - b;
+                PackFloat<8> const d_plus = a + b;
+                delay += term.num / (term.radius4 * d_minus * d_minus + term.den);
+                delay += term.num / (term.radius4 * d_plus * d_plus + term.den);
             }
+            delay.Store(gd_out_.data() + i);
+        }
+        gd_out_.resize(num_w);
+        std::ranges::copy(gd_out_, out.begin());
+    }
+
+    /**
+     * @brief 设计端
+     */
+    size_t GetNumFilters() const {
+        return num_cascade_filters_;
+    }
+private:
+    struct alignas(32) CascadeFilterContent {
+        float lag1[8]{};
+        float lag2[8]{};
+        float lag1_second[8]{};
+        float lag2_second[8]{};
+        float a2[8]{};
+        float a1[8]{};
+
+        void ClearLags() noexcept {
+            std::fill_n(lag1, 8, 0);
+            std::fill_n(lag2, 8, 0);
+            std::fill_n(lag1_second, 8, 0);
+            std::fill_n(lag2_second, 8, 0);
         }
-        for (size_t j = 0; j < scalar_loop; ++j) {
-            auto radius = GetPoleRadius(bw_[fidx]);
-            radius_[fidx] = radius;
-            filters_[simd_loop].a1[j] = -2 * radius * std::cos(center_[fidx]);
-            filters_[simd_loop].a2[j] = radius * radius;
-            ++fidx;
-        }
-    }
-
-    float GetGroupDelay(float w) const {
-        auto const z = std::polar(1.0f, w);
-        std::complex<float> delay{};
-        size_t const num_simd = num_cascade_filters_ / 8;
-        size_t const num_scalar = num_cascade_filters_ & 7;
-        float const* radius_ptr = radius_.data();
-        float const* w_ptr = center_.data();
-        for (size_t i = 0; i < num_simd; ++i) {
-            std::array<std::complex<float>, 8> poles{
-                std::polar(*radius_ptr++, *w_ptr++),
-                std::polar(*radius_ptr++, *w_ptr++),
-                std::polar(*radius_ptr++, *w_ptr++),
-                std::polar(*radius_ptr++, *w_ptr++),
-                std::polar(*radius_ptr++, *w_ptr++),
-                std::polar(*radius_ptr++, *w_ptr++),
-                std::polar(*radius_ptr++, *w_ptr++),
-                std::polar(*radius_ptr++, *w_ptr++),
-            };
-            std::array<std::complex<float>, 8> delays;
+    };
+
+    /**
+     * @brief 一套完整的级联系数和状态，由设计端写系数，音频线程独占状态
+     */
+    struct Cascade {
+        std::vector<CascadeFilterContent> filters = std::vector<CascadeFilterContent>(kMaxCascade / 8 + 1);
+        size_t num_filters{};
+        uint32_t version{};
+    };
+
+    /**
+     * @brief 一个样本通过整个IIR级联
+     */
+    void TickCascade(Cascade& cascade, float& x_first, float& x_second) noexcept {
+        size_t const cascade_loop_count = cascade.num_filters / 8;
+        size_t const scalar_loop_count = cascade.num_filters & 7;
+        alignas(32) float vy_first[8]{};
+        alignas(32) float vy_second[8]{};
+#ifndef __AVX2__
+        alignas(32) float vx[9]{};
+#endif
+        /**
+         * 简要的概况并行加速，所有的biquad均为转置直接二型
+         * 更新步骤即为 y = x*a2 + lag1
+         *         lag1 = (x-y)*a1 + lag2
+         *         lag2 = x - y*a2
+         * 注意到我们可以缓存每个滤波器的y和x，因为底层lag1和lag2的更新在每个滤波器是独立的
+         * 因此我们只需要顺序计算y，然后并行更新滤波器的lag1和lag2
+         */
+        auto* filter_ptr = cascade.filters.data();
+        for (size_t i = 0; i < cascade_loop_count; ++i) {
+            float const begin_x_input_first = x_first;
+            float const begin_x_input_second = x_second;
+            // left channel serial
+            float* a2_ptr = filter_ptr->a2;
+            float* lag1_ptr = filter_ptr->lag1;
             for (size_t j = 0; j < 8; ++j) {
-                delays[j] = (poles[j] * z) / (poles[j] * z - 1.0f);
-                delays[j] -= z / (z - poles[j]);
-                poles[j] = std::conj(poles[j]);
-                delays[j] += (poles[j] * z) / (poles[j] * z - 1.0f);
-                delays[j] -= z / (z - poles[j]);
+                x_first = x_first * *a2_ptr + *lag1_ptr;
+                vy_first[j] = x_first;
+                ++a2_ptr;
+                ++lag1_ptr;
             }
+            // right channel serial
+            a2_ptr = filter_ptr->a2;
+            float* lag1_ptr_2 = filter_ptr->lag1_second;
             for (size_t j = 0; j < 8; ++j) {
-                delay += delays[j];
+                x_second = x_second * *a2_ptr + *lag1_ptr_2;
+                vy_second[j] = x_second;
+                ++a2_ptr;
+                ++lag1_ptr_2;
             }
+            a2_ptr = filter_ptr->a2;
+
+            // vy现在是每个滤波器的输出
+            // left channel
+#ifdef __AVX2__
+            auto shuffle_mask = _mm256_set_epi32(6, 5, 4, 3, 2, 1, 0, 7);
+#endif
+            auto y = _mm256_load_ps(vy_first);
+#ifndef __AVX2__
+            vx[0] = begin_x_input_first;
+            _mm256_storeu_ps(vx + 1, y);
+            auto x = _mm256_load_ps(vx);
+#else
+            auto shuffled_reg = _mm256_permutevar8x32_ps(y, shuffle_mask);
+            auto iwantx = _mm256_set1_ps(begin_x_input_first);
+            auto x = _mm256_blend_ps(shuffled_reg, iwantx, 0b00000001);
+#endif
+            // update lag1
+            auto a1 = _mm256_load_ps(filter_ptr->a1);
+            auto lag2 = _mm256_load_ps(filter_ptr->lag2);
+            auto lag1 = _mm256_add_ps(lag2, _mm256_sub_ps(_mm256_mul_ps(x, a1), _mm256_mul_ps(y, a1)));
+            _mm256_store_ps(filter_ptr->lag1, lag1);
+
+            // update lag2
+            auto a2 = _mm256_load_ps(a2_ptr);
+            lag2 = _mm256_sub_ps(x, _mm256_mul_ps(y, a2));
+            _mm256_store_ps(filter_ptr->lag2, lag2);
+
+
+            // right channel
+            y = _mm256_load_ps(vy_second);
+#ifndef __AVX2__
+            vx[0] = begin_x_input_second;
+            _mm256_storeu_ps(vx + 1, y);
+            x = _mm256_load_ps(vx);
+#else
+            shuffled_reg = _mm256_permutevar8x32_ps(y, shuffle_mask);
+            iwantx = _mm256_set1_ps(begin_x_input_second);
+            x = _mm256_blend_ps(shuffled_reg, iwantx, 0b00000001);
+#endif
+            // update lag1
+            lag2 = _mm256_load_ps(filter_ptr->lag2_second);
+            lag1 = _mm256_add_ps(lag2, _mm256_sub_ps(_mm256_mul_ps(x, a1), _mm256_mul_ps(y, a1)));
+            _mm256_store_ps(filter_ptr->lag1_second, lag1);
+
+            // update lag2
+            lag2 = _mm256_sub_ps(x, _mm256_mul_ps(y, a2));
+            _mm256_store_ps(filter_ptr->lag2_second, lag2);
+
+            ++filter_ptr;
         }
-        for (size_t i = 0; i < num_scalar; ++i) {
-            auto pole = std::polar(*radius_ptr++, *w_ptr++);
-            delay += (pole * z) / (pole * z - 1.0f);
-            delay -= z / (z - pole);
-            pole = std::conj(pole);
-            delay += (pole * z) / (pole * z - 1.0f);
-            delay -= z / (z - pole);
+
+        //// 处理凑不齐8个的
+        float begin_x_input_first = x_first;
+        float begin_x_input_second = x_second;
+        // left channel
+        float* a2_ptr = filter_ptr->a2;
+        float* lag1_ptr = filter_ptr->lag1;
+        for (size_t j = 0; j < scalar_loop_count; ++j) {
+            x_first = x_first * *a2_ptr + *lag1_ptr;
+            vy_first[j] = x_first;
+            ++a2_ptr;
+            ++lag1_ptr;
+        }
+        // right channel
+        a2_ptr = filter_ptr->a2;
+        float* lag1_ptr_2 = filter_ptr->lag1_second;
+        for (size_t j = 0; j < scalar_loop_count; ++j) {
+            x_second = x_second * *a2_ptr + *lag1_ptr_2;
+            vy_second[j] = x_second;
+            ++a2_ptr;
+            ++lag1_ptr_2;
         }
-        return std::abs(delay.real());
+        a2_ptr = filter_ptr->a2;
+
+        // left channel
+#ifdef __AVX2__
+        auto shuffle_mask = _mm256_set_epi32(6, 5, 4, 3, 2, 1, 0, 7);
+#endif
+        auto y = _mm256_load_ps(vy_first);
+#ifndef __AVX2__
+        vx[0] = begin_x_input_first;
+        _mm256_storeu_ps(vx + 1, y);
+        auto x = _mm256_load_ps(vx);
+#else
+        auto shuffled_reg = _mm256_permutevar8x32_ps(y, shuffle_mask);
+        auto iwantx = _mm256_set1_ps(begin_x_input_first);
+        auto x = _mm256_blend_ps(shuffled_reg, iwantx, 0b00000001);
+#endif
+        // update lag1
+        auto a1 = _mm256_load_ps(filter_ptr->a1);
+        auto lag2 = _mm256_load_ps(filter_ptr->lag2);
+        auto lag1 = _mm256_add_ps(lag2, _mm256_sub_ps(_mm256_mul_ps(x, a1), _mm256_mul_ps(y, a1)));
+        _mm256_store_ps(filter_ptr->lag1, lag1);
+
+        // update lag2
+        auto a2 = _mm256_load_ps(a2_ptr);
+        lag2 = _mm256_sub_ps(x, _mm256_mul_ps(y, a2));
+        _mm256_store_ps(filter_ptr->lag2, lag2);
+
+
+        // right channel
+        y = _mm256_load_ps(vy_second);
+#ifndef __AVX2__
+        vx[0] = begin_x_input_second;
+        _mm256_storeu_ps(vx + 1, y);
+        x = _mm256_load_ps(vx);
+#else
+        shuffled_reg = _mm256_permutevar8x32_ps(y, shuffle_mask);
+        iwantx = _mm256_set1_ps(begin_x_input_second);
+        x = _mm256_blend_ps(shuffled_reg, iwantx, 0b00000001);
+#endif
+        // update lag1
+        lag2 = _mm256_load_ps(filter_ptr->lag2_second);
+        lag1 = _mm256_add_ps(lag2, _mm256_sub_ps(_mm256_mul_ps(x, a1), _mm256_mul_ps(y, a1)));
+        _mm256_store_ps(filter_ptr->lag1_second, lag1);
+
+        // update lag2
+        lag2 = _mm256_sub_ps(x, _mm256_mul_ps(y, a2));
+        _mm256_store_ps(filter_ptr->lag2_second, lag2);
     }
 
-    size_t GetNumFilters() const {
-        return num_cascade_filters_;
+    /**
+     * @brief 一个样本通过FIR，头部直接卷积，尾部的分块卷积输出提前一个block算好
+     */
+    void TickFir(float& x_first, float& x_second) noexcept {
+        using qwqdsp_simd_element::PackFloat;
+
+        left_head_hist_[head_wpos_] = x_first;
+        left_head_hist_[head_wpos_ + kFirHeadSize] = x_first;
+        right_head_hist_[head_wpos_] = x_second;
+        right_head_hist_[head_wpos_ + kFirHeadSize] = x_second;
+        left_tail_block_[tail_pos_] = x_first;
+        right_tail_block_[tail_pos_] = x_second;
+
+        // 窗口 [wpos+1, wpos+kFirHeadSize] 是最近kFirHeadSize个输入，旧的在前
+        float const* left_hist = left_head_hist_.data() + head_wpos_ + 1;
+        float const* right_hist = right_head_hist_.data() + head_wpos_ + 1;
+        PackFloat<8> left_sum{};
+        PackFloat<8> right_sum{};
+        for (size_t i = 0; i < kFirHeadSize; i += 8) {
+            PackFloat<8> h;
+            PackFloat<8> l;
+            PackFloat<8> r;
+            h.Load(head_.data() + i);
+            l.Load(left_hist + i);
+            r.Load(right_hist + i);
+            left_sum += h * l;
+            right_sum += h * r;
+        }
+        x_first = left_sum.ReduceAdd() + left_tail_out_[tail_pos_];
+        x_second = right_sum.ReduceAdd() + right_tail_out_[tail_pos_];
+
+        head_wpos_ = (head_wpos_ + 1) & (kFirHeadSize - 1);
+        if (++tail_pos_ == kFirHeadSize) {
+            tail_pos_ = 0;
+            // 尾部IR从kFirHeadSize开始，这个block的卷积结果正好是下一个block需要的
+            left_tail_out_ = left_tail_block_;
+            right_tail_out_ = right_tail_block_;
+            left_tail_.Process(left_tail_out_);
+            right_tail_.Process(right_tail_out_);
+        }
     }
-private:
+
+    /**
+     * @brief 切换系数时新旧级联同时运行并交叉淡化
+     */
+    void TickIIR(float& x_first, float& x_second) noexcept {
+        if (fading_ == nullptr || cascade_fade_pos_ >= kCascadeFadeSamples) {
+            TickCascade(*current_, x_first, x_second);
+            return;
+        }
+        float old_first = x_first;
+        float old_second = x_second;
+        TickCascade(*current_, x_first, x_second);
+        TickCascade(*fading_, old_first, old_second);
+        if (cascade_warmup_ != 0) {
+            --cascade_warmup_;
+            x_first = old_first;
+            x_second = old_second;
+            return;
+        }
+        ++cascade_fade_pos_;
+        float const mix = static_cast<float>(cascade_fade_pos_) / static_cast<float>(kCascadeFadeSamples);
+        x_first = old_first + mix * (x_first - old_first);
+        x_second = old_second + mix * (x_second - old_second);
+    }
+
+    void InstallPendingCascade() noexcept {
+        Cascade* next = pending_cascade_.exchange(nullptr, std::memory_order_acquire);
+        if (next == nullptr) {
+            return;
+        }
+
+        // 系数是慢慢拖动的，同一序号的滤波器几乎不变，沿用旧状态可以保留延迟线里的尾巴
+        Cascade& old = *current_;
+        size_t const num_groups = (next->num_filters + 7) / 8;
+        for (size_t i = 0; i < num_groups; ++i) {
+            next->filters[i].ClearLags();
+        }
+        size_t const num_copy = std::min(old.num_filters, next->num_filters);
+        for (size_t i = 0; i < num_copy; ++i) {
+            auto const& src = old.filters[i / 8];
+            auto& dst = next->filters[i / 8];
+            dst.lag1[i & 7] = src.lag1[i & 7];
+            dst.lag2[i & 7] = src.lag2[i & 7];
+            dst.lag1_second[i & 7] = src.lag1_second[i & 7];
+            dst.lag2_second[i & 7] = src.lag2_second[i & 7];
+        }
+
+        fading_ = std::move(current_);
+        current_.reset(next);
+        // IIR没有在运行时或者之前没有级联时不需要淡化
+        bool const direct = iir_stale_ || !cascade_installed_;
+        cascade_installed_ = true;
+        cascade_fade_pos_ = direct ? kCascadeFadeSamples : 0;
+        // 数量变化时按序号沿用的状态对不上，多出来的滤波器也是零状态，淡化之前先预热
+        cascade_warmup_ = direct || old.num_filters == next->num_filters ? 0 : kCascadeWarmupSamples;
+        RetireFadingCascade();
+    }
+
+    /**
+     * @brief 音频线程不释放内存，如果上一个还没被回收则之后再试
+     */
+    void RetireFadingCascade() noexcept {
+        if (cascade_fade_pos_ < kCascadeFadeSamples) {
+            return;
+        }
+        Cascade* expect = nullptr;
+        if (retired_cascade_.compare_exchange_strong(expect, fading_.get(), std::memory_order_release)) {
+            (void)fading_.release();
+        }
+    }
+
+    /**
+     * @brief 设计端
+     */
+    void FreeRetiredCascade() noexcept {
+        Cascade* cascade = retired_cascade_.exchange(nullptr, std::memory_order_acquire);
+        if (cascade != nullptr) {
+            free_cascades_.emplace_back(cascade);
+        }
+    }
+
+    bool FirReady() const noexcept {
+        return fir_version_ == current_->version && fir_warmup_ == 0;
+    }
+
+    void InstallPendingIR() noexcept {
+        if (retiring_fir_ != nullptr) {
+            RetireFir();
+        }
+        if (retiring_fir_ != nullptr) {
+            return;
+        }
+        // 尾部卷积器还没取走上一个IR时，再发布会在音频线程释放被替换的分块
+        if (left_tail_.HasPendingIR() || right_tail_.HasPendingIR()) {
+            return;
+        }
+        FirIR* fir = pending_fir_.exchange(nullptr, std::memory_order_acquire);
+        if (fir == nullptr) {
+            return;
+        }
+        head_ = fir->head;
+        left_tail_.PublishIR(std::move(fir->left_tail));
+        right_tail_.PublishIR(std::move(fir->right_tail));
+        fir_version_ = fir->version;
+        last_fir_length_ = fir->length;
+        // 大分块的历史输入还没有进入新IR，等待一个IR长度之后输出才和IIR一致
+        fir_warmup_ = fir->length;
+        retiring_fir_ = fir;
+        RetireFir();
+    }
+
+    /**
+     * @brief 音频线程不释放内存，如果上一个还没被释放则之后再试
+     */
+    void RetireFir() noexcept {
+        FirIR* expect = nullptr;
+        if (retired_fir_.compare_exchange_strong(expect, retiring_fir_, std::memory_order_release)) {
+            retiring_fir_ = nullptr;
+        }
+    }
+
+    void ResetFir() noexcept {
+        left_head_hist_.fill(0.0f);
+        right_head_hist_.fill(0.0f);
+        left_tail_block_.fill(0.0f);
+        right_tail_block_.fill(0.0f);
+        left_tail_out_.fill(0.0f);
+        right_tail_out_.fill(0.0f);
+        head_wpos_ = 0;
+        tail_pos_ = 0;
+        left_tail_.Reset();
+        right_tail_.Reset();
+        fir_warmup_ = fir_version_ == current_->version ? last_fir_length_ : 0;
+        if (fir_mix_ > 0.0f) {
+            iir_stale_ = true;
+        }
+        fir_mix_ = 0.0f;
+    }
+
+    void ClearCascadeLags() noexcept {
+        ClearLags(*current_);
+    }
+
+    /**
+     * @brief 设计端，群延迟公式里只和极点有关的部分
+     */
+    void UpdateGroupDelayTerms() {
+        gd_terms_.resize(num_cascade_filters_);
+        for (size_t i = 0; i < num_cascade_filters_; ++i) {
+            float const r = radius_[i];
+            auto& term = gd_terms_[i];
+            term.cos_half = std::cos(center_[i] * 0.5f);
+            term.sin_half = std::sin(center_[i] * 0.5f);
+            term.num = 1.0f - r * r;
+            term.den = (1.0f - r) * (1.0f - r);
+            term.radius4 = 4.0f * r;
+        }
+    }
+
+    static void ClearLags(Cascade& cascade) noexcept {
+        size_t const simd_loop = (cascade.num_filters + 7) / 8;
+        for (size_t i = 0; i < simd_loop; ++i) {
+            cascade.filters[i].ClearLags();
+        }
+    }
+
     float GetPoleRadius(float bw) const {
         float ret{};
         if (bw < 0.01f) {
@@ -419,31 +952,36 @@ private:
         return std::min(std::max(0.0f, ret), 0.999995f);
     }
 
-    size_t num_cascade_filters_{};
     using SimdAllocator = qwqdsp_simd_element::AlignedAllocator<float, 32>;
 
-    struct alignas(32) CascadeFilterContent {
-        float lag1[8]{};
-        float lag2[8]{};
-        float lag1_second[8]{};
-        float lag2_second[8]{};
-        float a2[8]{};
-        float a1[8]{};
+    // 音频线程
+    std::unique_ptr<Cascade> current_;
+    std::unique_ptr<Cascade> fading_;
+    size_t cascade_fade_pos_{};
+    size_t cascade_warmup_{};
+    bool cascade_installed_{};
+    // 设计端 -> 音频线程 -> 设计端
+    std::atomic<Cascade*> pending_cascade_{};
+    std::atomic<Cascade*> retired_cascade_{};
+    // 设计端
+    std::vector<std::unique_ptr<Cascade>> free_cascades_;
+    size_t num_cascade_filters_{};
+    uint32_t design_version_{1};
 
-        void ClearLags() noexcept {
-            std::fill_n(lag1, 8, 0);
-            std::fill_n(lag2, 8, 0);
-            std::fill_n(lag1_second, 8, 0);
-            std::fill_n(lag2_second, 8, 0);
-        }
-        void ClearLags(size_t offset) noexcept {
-            std::fill_n(lag1 + offset, 8 - offset, 0);
-            std::fill_n(lag2 + offset, 8 - offset, 0);
-            std::fill_n(lag1_second + offset, 8 - offset, 0);
-            std::fill_n(lag2_second + offset, 8 - offset, 0);
-        }
+    // 设计端，群延迟缓存
+    struct GroupDelayTerm {
+        float cos_half;
+        float sin_half;
+        float num;
+        float den;
+        float radius4;
     };
-    std::vector<CascadeFilterContent> filters_;
+    std::vector<GroupDelayTerm> gd_terms_;
+    std::vector<float> gd_w_;
+    std::vector<float> gd_sin_half_w_;
+    std::vector<float> gd_cos_half_w_;
+    std::vector<float> gd_out_;
+    uint32_t gd_version_{};
 
     qwqdsp_filter::OnePoleFilter left_damp_;
     qwqdsp_filter::OnePoleFilter right_damp_;
@@ -456,6 +994,31 @@ private:
     std::vector<float> bw_;
     std::vector<float> radius_;
 
+    // fir
+    bool fir_enable_{};
+    bool iir_stale_{};
+    float fir_mix_{};
+    float ir_threshold_{1e-8f};
+    uint32_t render_version_{};
+    uint32_t fir_version_{};
+    size_t fir_warmup_{};
+    size_t iir_warmup_{};
+    size_t last_fir_length_{};
+    alignas(32) std::array<float, kFirHeadSize> head_{};
+    std::array<float, kFirHeadSize * 2> left_head_hist_{};
+    std::array<float, kFirHeadSize * 2> right_head_hist_{};
+    size_t head_wpos_{};
+    std::array<float, kFirHeadSize> left_tail_block_{};
+    std::array<float, kFirHeadSize> right_tail_block_{};
+    std::array<float, kFirHeadSize> left_tail_out_{};
+    std::array<float, kFirHeadSize> right_tail_out_{};
+    size_t tail_pos_{};
+    qwqdsp_fx::NonUniformConvolution left_tail_;
+    qwqdsp_fx::NonUniformConvolution right_tail_;
+    std::atomic<FirIR*> pending_fir_{};
+    std::atomic<FirIR*> retired_fir_{};
+    FirIR* retiring_fir_{};
+
     float sample_rate_{48000.0f};
     float beta_{0.5f}; // 最大群延迟的分数延迟
     float magic_beta_{};
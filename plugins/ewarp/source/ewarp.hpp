@@ -1,5 +1,7 @@
 #pragma once
 
+#include <algorithm>
+#include <array>
 #include <qwqdsp/oscillator/dsf_correct.hpp>
 #include <qwqdsp/convert.hpp>
 
@@ -7,6 +9,7 @@ namespace ewarp {
 class Ewarp {
 public:
     static constexpr float kBaseFreq = 20000.0f;
+    static constexpr size_t kBlockSize = 64;
 
     void Reset() noexcept {
         dsf_.Reset();
@@ -18,17 +21,24 @@ public:
         float wet_mix = am2rm * normalize_gain_;
         float normal_mix = 1.0f - reverse_mix_;
         float reverse_mix = reverse_mix_;
-        for (size_t i = 0; i < num_samples; ++i) {
-            float x0 = left[i];
-            float x1 = right[i];
-            float reverse_x0 = x0 * reverse_spectrum_gain_;
-            float reverse_x1 = x1 * reverse_spectrum_gain_;
-            float avg_x0 = normal_mix * x0 + reverse_mix * reverse_x0;
-            float avg_x1 = normal_mix * x1 + reverse_mix * reverse_x1;
-            float mod = dsf_.Tick() * wet_mix + dry_mix;
-            left[i] = avg_x0 * mod;
-            right[i] = avg_x1 * mod;
-            reverse_spectrum_gain_ = -reverse_spectrum_gain_;
+        while (num_samples != 0) {
+            size_t cando = std::min(num_samples, kBlockSize);
+            dsf_.ProcessBlock({mod_buffer_.data(), cando});
+            for (size_t i = 0; i < cando; ++i) {
+                float x0 = left[i];
+                float x1 = right[i];
+                float reverse_x0 = x0 * reverse_spectrum_gain_;
+                float reverse_x1 = x1 * reverse_spectrum_gain_;
+                float avg_x0 = normal_mix * x0 + reverse_mix * reverse_x0;
+                float avg_x1 = normal_mix * x1 + reverse_mix * reverse_x1;
+                float mod = mod_buffer_[i] * wet_mix + dry_mix;
+                left[i] = avg_x0 * mod;
+                right[i] = avg_x1 * mod;
+                reverse_spectrum_gain_ = -reverse_spectrum_gain_;
+            }
+            left += cando;
+            right += cando;
+            num_samples -= cando;
         }
     }
 
@@ -56,5 +66,6 @@ private:
     float normalize_gain_{};
     float reverse_spectrum_gain_{1.0f};
     qwqdsp_oscillator::DSFCorrect<12> dsf_;
+    std::array<float, kBlockSize> mod_buffer_{};
 };
 }
@@ -224,6 +224,15 @@ AudioPluginAudioProcessor::AudioPluginAudioProcessor()
             p, [this](int l) { burg_lpc_.SetQuality(static_cast<green_vocoder::dsp::LeakyBurgLPC::Quality>(l)); });
         layout.add(std::move(p));
     }
+    {
+        auto p = std::make_unique<juce::AudioParameterChoice>(juce::ParameterID{id::kBlockLPCAnalysis, 1},
+                                                              id::kBlockLPCAnalysis,
+                                                              juce::StringArray{"Burg", "Autocorrelation"}, 0);
+        paramListeners_.Add(p, [this](int l) {
+            block_burg_lpc_.SetAnalysis(static_cast<green_vocoder::dsp::BlockBurgLPC::Analysis>(l));
+        });
+        layout.add(std::move(p));
+    }
     {
         auto p = std::make_unique<juce::AudioParameterFloat>(
             juce::ParameterID{id::kLPCOrder, 1}, id::kLPCOrder,
@@ -412,9 +421,18 @@ AudioPluginAudioProcessor::AudioPluginAudioProcessor()
     value_tree_ = std::make_unique<juce::AudioProcessorValueTreeState>(*this, nullptr, kParameterValueTreeIdentify,
                                                                        std::move(layout));
     preset_manager_ = std::make_unique<pluginshared::PresetManager>(*value_tree_, *this);
+
+    // 留一半的核心给宿主和其他插件
+    int num_workers = std::clamp(juce::SystemStats::getNumCpus() / 2 - 1, 0, 3);
+    channel_vocoder_pool_.Start(static_cast<size_t>(num_workers));
+    channel_vocoder_.SetWorkerPool(&channel_vocoder_pool_);
+
+    buffer_thread_->addTimeSliceClient(this);
 }
 
 AudioPluginAudioProcessor::~AudioPluginAudioProcessor() {
+    buffer_thread_->removeTimeSliceClient(this);
+    channel_vocoder_pool_.Stop();
     paramListeners_.Clear();
     value_tree_ = nullptr;
 }
@@ -498,6 +516,12 @@ void AudioPluginAudioProcessor::prepareToPlay(double sampleRate, int samplesPerB
     output_driver_.Reset();
 
     paramListeners_.MarkAll();
+    // 在这里同步一次参数，当前模式的缓冲在开始播放前就准备好
+    paramListeners_.HandleDirty();
+    active_vocoder_type_ = vocoder_type_param_->getIndex();
+    UpdateEngineBuffers();
+    ServiceEngineBuffers();
+    UpdateEngineBuffers();
 }
 
 void AudioPluginAudioProcessor::releaseResources() {
@@ -532,6 +556,7 @@ void AudioPluginAudioProcessor::processBlock(juce::AudioBuffer<float>& buffer, j
     juce::ScopedNoDenormals noDenormals;
 
     paramListeners_.HandleDirty();
+    UpdateEngineBuffers();
 
     int main_ch = main_channel_config_->getIndex();
     int side_ch = side_channel_config_->getIndex();
@@ -679,7 +704,7 @@ void AudioPluginAudioProcessor::processBlock(juce::AudioBuffer<float>& buffer, j
         }
 
         // vocoder
-        switch (vocoder_type_param_->getIndex()) {
+        switch (active_vocoder_type_) {
             case eVocoderType_LeakyBurgLPC:
                 burg_lpc_.Process({crossing_main_buffer_.data(), num_process},
                                   {crossing_side_buffer_.data(), num_process});
@@ -775,13 +800,59 @@ void AudioPluginAudioProcessor::Panic() {
     const juce::ScopedLock lock{getCallbackLock()};
 }
 
+void AudioPluginAudioProcessor::UpdateEngineBuffers() {
+    int const want = vocoder_type_param_->getIndex();
+    auto const selected = [this, want](int type) {
+        return type == want || type == active_vocoder_type_;
+    };
+    bool const stft_ready = stft_vocoder_.UpdateBuffers(selected(eVocoderType_STFTVocoder));
+    bool const mfcc_ready = mfcc_vocoder_.UpdateBuffers(selected(eVocoderType_MFCCVocoder));
+    bool const block_burg_ready = block_burg_lpc_.UpdateBuffers(selected(eVocoderType_BlockBurgLPC));
+
+    bool want_ready = true;
+    switch (want) {
+        case eVocoderType_STFTVocoder:
+            want_ready = stft_ready;
+            break;
+        case eVocoderType_MFCCVocoder:
+            want_ready = mfcc_ready;
+            break;
+        case eVocoderType_BlockBurgLPC:
+            want_ready = block_burg_ready;
+            break;
+        default:
+            break;
+    }
+    if (want_ready) {
+        active_vocoder_type_ = want;
+    }
+    // 帧长在新缓冲换上时才生效
+    SetLatency();
+}
+
+bool AudioPluginAudioProcessor::ServiceEngineBuffers() {
+    bool busy = stft_vocoder_.ServiceBuffers();
+    busy |= mfcc_vocoder_.ServiceBuffers();
+    busy |= block_burg_lpc_.ServiceBuffers();
+    return busy;
+}
+
+int AudioPluginAudioProcessor::useTimeSlice() {
+    // 没有等待的缓冲时少醒几次
+    return ServiceEngineBuffers() ? 10 : 100;
+}
+
 void AudioPluginAudioProcessor::SetLatency() {
     int latency = 0;
-    switch (vocoder_type_param_->getIndex()) {
+    switch (active_vocoder_type_) {
         case eVocoderType_STFTVocoder:
+            latency += static_cast<int>(stft_vocoder_.GetFFTSize());
+            break;
         case eVocoderType_MFCCVocoder:
+            latency += static_cast<int>(mfcc_vocoder_.GetFFTSize());
+            break;
         case eVocoderType_BlockBurgLPC:
-            latency += stft_vocoder_.GetFFTSize();
+            latency += static_cast<int>(block_burg_lpc_.GetBlockSize());
             break;
         default:
             break;
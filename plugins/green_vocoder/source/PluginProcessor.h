@@ -21,8 +21,21 @@
 #include <qwqdsp/simd_element/algebraic_waveshaper.hpp>
 #include <qwqdsp/oscillator/noise.hpp>
 
+// 所有实例共用一个后台线程分配和释放分帧引擎的缓冲
+struct EngineBufferThread : juce::TimeSliceThread {
+    EngineBufferThread()
+        : juce::TimeSliceThread("green vocoder buffers") {
+        startThread(juce::Thread::Priority::low);
+    }
+
+    ~EngineBufferThread() override {
+        stopThread(-1);
+    }
+};
+
 //==============================================================================
 class AudioPluginAudioProcessor final : public juce::AudioProcessor
+                                      , private juce::TimeSliceClient
 {
 public:
     static constexpr auto kParameterValueTreeIdentify = "PARAMETERS";
@@ -64,6 +77,11 @@ public:
 
     void Panic();
     void SetLatency();
+    void UpdateEngineBuffers();
+    /**
+     * @return 还有没换上的缓冲
+     */
+    bool ServiceEngineBuffers();
     JuceParamListener paramListeners_;
     std::unique_ptr<juce::AudioProcessorValueTreeState> value_tree_;
     std::unique_ptr<pluginshared::PresetManager> preset_manager_;
@@ -83,6 +101,7 @@ public:
     green_vocoder::dsp::STFTVocoder stft_vocoder_;
     green_vocoder::dsp::MFCCVocoder mfcc_vocoder_;
     green_vocoder::dsp::ChannelVocoder channel_vocoder_;
+    pluginshared::RTWorkerPool channel_vocoder_pool_;
     green_vocoder::dsp::Ensemble ensemble_;
     qwqdsp_oscillator::WhiteNoise noise_;
 
@@ -110,7 +129,13 @@ public:
     std::atomic<int> latency_{};
 
     juce::AudioParameterChoice* vocoder_type_param_{};
+    // 正在处理的模式，新模式的缓冲准备好之前继续使用旧模式
+    int active_vocoder_type_{};
 private:
+    int useTimeSlice() override;
+
+    juce::SharedResourcePointer<EngineBufferThread> buffer_thread_;
+
     //==============================================================================
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (AudioPluginAudioProcessor)
 };
@@ -41,7 +41,9 @@
     #define AUDIOFFT_OOURA
   #endif
   #define AUDIOFFT_OOURA_USED
+  #include <memory>
   #include <vector>
+  #include <qwqdsp/spectral/fft_plan_cache.hpp>
 #endif
 
 
@@ -108,8 +110,9 @@ namespace audiofft
     OouraFFT() :
       detail::AudioFFTImpl(),
       _size(0),
+      _plan(),
+      _w(nullptr),
       _ip(),
-      _w(),
       _buffer()
     {
     }
@@ -121,14 +124,14 @@ namespace audiofft
     {
       if (_size != size)
       {
-        _ip.resize(2 + static_cast<int>(std::sqrt(static_cast<double>(size))));
-        _w.resize(size / 2);
+        // rdft only reads w, ip[2...] is the bit reversal work area and stays per instance
+        _plan = qwqdsp_spectral::FFTPlanCache<Plan>::Get(size);
+        _w = const_cast<double*>(_plan->w.data());
+        _ip.assign(2 + static_cast<int>(std::sqrt(static_cast<double>(size))), 0);
+        _ip[0] = _plan->nw;
+        _ip[1] = _plan->nc;
         _buffer.resize(size);
         _size = size;
-
-        const int size4 = static_cast<int>(_size) / 4;
-        makewt(size4, _ip.data(), _w.data());
-        makect(size4, _ip.data(), _w.data() + size4);
       }
     }
 
@@ -137,7 +140,7 @@ namespace audiofft
       // Convert into the format as required by the Ooura FFT
       detail::ConvertBuffer(_buffer.data(), data, _size);
 
-      rdft(static_cast<int>(_size), +1, _buffer.data(), _ip.data(), _w.data());
+      rdft(static_cast<int>(_size), +1, _buffer.data(), _ip.data(), _w);
 
       // Convert back to split-complex
       {
@@ -173,16 +176,40 @@ namespace audiofft
         _buffer[1] = re[_size / 2];
       }
 
-      rdft(static_cast<int>(_size), -1, _buffer.data(), _ip.data(), _w.data());
+      rdft(static_cast<int>(_size), -1, _buffer.data(), _ip.data(), _w);
 
       // Convert back to split-complex
       detail::ScaleBuffer(data, _buffer.data(), 2.0 / static_cast<double>(_size), _size);
     }
 
   private:
+    /**
+     * @brief Twiddle tables, shared by all instances of the same size
+     */
+    struct Plan
+    {
+      explicit Plan(size_t size) :
+        w(size / 2),
+        nw(0),
+        nc(0)
+      {
+        std::vector<int> ip(2 + static_cast<int>(std::sqrt(static_cast<double>(size))));
+        const int size4 = static_cast<int>(size) / 4;
+        makewt(size4, ip.data(), w.data());
+        makect(size4, ip.data(), w.data() + size4);
+        nw = ip[0];
+        nc = ip[1];
+      }
+
+      std::vector<double> w;
+      int nw;
+      int nc;
+    };
+
     size_t _size;
+    std::shared_ptr<const Plan> _plan;
+    double* _w;
     std::vector<int> _ip;
-    std::vector<double> _w;
     std::vector<double> _buffer;
 
     void rdft(int n, int isgn, double *a, int *ip, double *w)
@@ -226,7 +253,7 @@ namespace audiofft
 
     /* -------- initializing routines -------- */
 
-    void makewt(int nw, int *ip, double *w)
+    static void makewt(int nw, int *ip, double *w)
     {
       int j, nwh;
       double delta, x, y;
@@ -255,7 +282,7 @@ namespace audiofft
     }
 
 
-    void makect(int nc, int *ip, double *c)
+    static void makect(int nc, int *ip, double *c)
     {
       int j, nch;
       double delta;
@@ -277,7 +304,7 @@ namespace audiofft
     /* -------- child routines -------- */
 
 
-    void bitrv2(int n, int *ip, double *a)
+    static void bitrv2(int n, int *ip, double *a)
     {
       int j, j1, k, k1, l, m, m2;
       double xr, xi, yr, yi;
@@ -13,19 +13,46 @@ namespace green_vocoder::dsp {
 
 void BlockBurgLPC::Init(float fs) {
     sample_rate_ = fs;
-    update_rate_ = fs;
+    // 已经换上的块长沿用，否则等第一次换上缓冲时再算
+    update_rate_ = hop_size_ != 0 ? fs / static_cast<float>(hop_size_) : fs;
     SetBlockSize(1024);
 }
 
 void BlockBurgLPC::SetBlockSize(size_t size) {
-    fft_size_ = size;
-    hann_window_.resize(size);
-    eb_.resize(size);
-    ef_.resize(size);
-    hop_size_ = size / 4;
+    want_block_size_ = size;
+}
+
+BlockBurgLPC::FrameState::FrameState(size_t size)
+    : StreamBuffers(size) {
+    hann_window.resize(size);
+    eb.resize(size);
+    ef.resize(size);
     for (size_t i = 0; i < size; ++i) {
-        hann_window_[i] = 0.5f - 0.5f * std::cos(2.0f* std::numbers::pi_v<float> * static_cast<float>(i) / static_cast<float>(size));
+        hann_window[i] = 0.5f - 0.5f * std::cos(2.0f* std::numbers::pi_v<float> * static_cast<float>(i) / static_cast<float>(size));
     }
+}
+
+BlockBurgLPC::AcfState::AcfState(size_t size, float allpass_coeff)
+    : fft_size(size) {
+    // 补零到两倍长度，前kMaxPoles个延迟的自相关不会被循环卷积混叠
+    size_t const acf_size = size * 2;
+    acf_fft.Init(acf_size);
+    acf_re.resize(acf_size);
+    acf_im.resize(acf_size);
+    acf_power.resize(size + 2);
+    warp_pos.resize(size + 1);
+    warp_gain.resize(size + 1);
+    for (size_t i = 0; i < size; ++i) {
+        float const w = 0.5f - 0.5f * std::cos(2.0f* std::numbers::pi_v<float> * static_cast<float>(i) / static_cast<float>(size));
+        window_power += w * w;
+    }
+    UpdateWarpTable(allpass_coeff);
+}
+
+void BlockBurgLPC::InstallFrame(FrameState& frame) {
+    // 音频线程，只更新和块长有关的标量
+    fft_size_ = frame.fft_size;
+    hop_size_ = fft_size_ / 4;
     update_rate_ = sample_rate_ / static_cast<float>(hop_size_);
     SetAttack(attack_ms_);
     SetSmear(smear_ms_);
@@ -47,7 +74,27 @@ void BlockBurgLPC::SetAttack(float ms) {
 }
 
 void BlockBurgLPC::SetFormantShift(float shift) {
-    fir_allpass_coeff_ = std::clamp(-shift, -0.99f, 0.99f);
+    // 变形表在下一个自相关分析帧才重算，Burg分析不需要
+    fir_allpass_coeff_.store(std::clamp(-shift, -0.99f, 0.99f), std::memory_order_relaxed);
+}
+
+void BlockBurgLPC::SetAnalysis(Analysis analysis) {
+    analysis_ = analysis;
+}
+
+void BlockBurgLPC::AcfState::UpdateWarpTable(float allpass_coeff) {
+    // Burg里eb每级经过的全通 (a + z^-1) / (1 + a z^-1) 把频率w映射到theta
+    // 自相关法在均匀的theta上重采样功率谱，w(theta)是系数取反的全通
+    float const a = allpass_coeff;
+    warp_coeff = allpass_coeff;
+    size_t const last_bin = warp_pos.size() - 1;
+    float const rad_to_bin = static_cast<float>(last_bin) / std::numbers::pi_v<float>;
+    for (size_t i = 0; i <= last_bin; ++i) {
+        float const theta = static_cast<float>(i) / rad_to_bin;
+        float const w = theta + 2.0f * std::atan2(a * std::sin(theta), 1.0f - a * std::cos(theta));
+        warp_pos[i] = std::clamp(w * rad_to_bin, 0.0f, static_cast<float>(last_bin));
+        warp_gain[i] = (1.0f - a * a) / (1.0f + a * a - 2.0f * a * std::cos(theta));
+    }
 }
 
 void BlockBurgLPC::Process(
@@ -55,45 +102,33 @@ void BlockBurgLPC::Process(
     qwqdsp_simd_element::PackFloat<2>* side_ptr,
     size_t num_samples
 ) {
+    if (frame_ == nullptr) {
+        // 缓冲还在后台准备
+        std::fill_n(main_ptr, num_samples, qwqdsp_simd_element::PackFloat<2>{});
+        return;
+    }
+    FrameState& buf = *frame_;
     // adding some noise
     for (size_t i = 0; i < num_samples; ++i) {
         main_ptr[i] += noise_.Next() * kNoiseGain;
     }
     // -------------------- copy buffer --------------------
-    std::copy_n(main_ptr, num_samples, main_inputBuffer_.begin() + static_cast<int>(numInput_));
-    std::copy_n(side_ptr, num_samples, side_inputBuffer_.begin() + static_cast<int>(numInput_));
-    numInput_ += num_samples;
-    while (numInput_ >= fft_size_) {
+    buf.main_input.Push({main_ptr, num_samples});
+    buf.side_input.Push({side_ptr, num_samples});
+    buf.numInput += num_samples;
+    while (buf.numInput >= fft_size_) {
         // get the block
-        std::span<qwqdsp_simd_element::PackFloat<2> const> main{main_inputBuffer_.data(), fft_size_};
-        std::span<qwqdsp_simd_element::PackFloat<2> const> side{side_inputBuffer_.data(), fft_size_};
+        std::span<qwqdsp_simd_element::PackFloat<2> const> main = buf.MainFrame();
+        std::span<qwqdsp_simd_element::PackFloat<2> const> side = buf.SideFrame();
         // -------------------- lpc --------------------
-        // forward fir lattice
-        std::copy(main.begin(), main.end(), ef_.begin());
-        std::copy(main.begin(), main.end(), eb_.begin());
         std::array<qwqdsp_simd_element::PackFloat<2>, kMaxPoles> latticek{};
-        for (size_t kidx = 0; kidx < num_poles_; ++kidx) {
-            auto& k = latticek[kidx];
-
-            qwqdsp_simd_element::PackFloat<2> up{};
-            qwqdsp_simd_element::PackFloat<2> down{};
-            qwqdsp_simd_element::PackFloat<2> s_iir{};
-            for (size_t i = 0; i < ef_.size(); ++i) {
-                auto y = fir_allpass_coeff_ * eb_[i] + s_iir;
-                s_iir = eb_[i] - fir_allpass_coeff_ * y;
-                eb_[i] = y;
-                up += ef_[i] * y;
-                down += ef_[i] * ef_[i];
-                down += y * y;
-            }
-            k = -2.0f * up / down;
-
-            for (size_t i = 0; i < ef_.size(); ++i) {
-                auto upgo = ef_[i] + eb_[i] * k;
-                auto downgo = eb_[i] + ef_[i] * k;
-                ef_[i] = upgo;
-                eb_[i] = downgo;
-            }
+        qwqdsp_simd_element::PackFloat<2> atten{};
+        // 自相关的缓冲还在后台准备时先用Burg
+        if (analysis_ == Analysis::Autocorrelation && acf_ != nullptr && acf_->fft_size == fft_size_) {
+            atten = AnalyzeAutocorrelation(buf, *acf_, main, latticek);
+        }
+        else {
+            atten = AnalyzeBurg(buf, main, latticek);
         }
         // smear
         // the FIR and IIR lattice coeffient are reversed
@@ -109,21 +144,15 @@ void BlockBurgLPC::Process(
             iir_1 += fir_1 * (1.0f - smear_factor_);
             iir_2 += fir_2 * (1.0f - smear_factor_);
         }
-        // eval gain
-        qwqdsp_simd_element::PackFloat<2> gain{};
-        for (size_t i = 0; i < ef_.size(); ++i) {
-            gain += ef_[i] * ef_[i];
-        }
-        gain = qwqdsp_simd_element::PackOps::Sqrt(gain);
-        qwqdsp_simd_element::PackFloat<2> gain_side{};
-        gain_side.Broadcast(std::sqrt(static_cast<float>(fft_size_)));
-        auto atten = gain / (gain_side);
+        gui_lattice_.PublishWith(num_poles_, [this](std::span<float> buffer) {
+            CopyLatticeCoeffient(buffer, buffer.size());
+        });
         // atten smooth
         gain_lag_ *= attack_factor_;
         gain_lag_ += (1.0f - attack_factor_) * atten;
         // iir lattice
         std::array<qwqdsp_simd_element::PackFloat<2>, kMaxPoles + 1> l_iir{};
-        for (size_t j = 0; j < ef_.size(); ++j) {
+        for (size_t j = 0; j < buf.ef.size(); ++j) {
             auto x0 = side[j] * gain_lag_;
             for (size_t idx = 0; idx < num_poles_; idx += 2) {
                 auto x1 = x0 - latticek_[idx] * l_iir[idx + 1];
@@ -135,42 +164,25 @@ void BlockBurgLPC::Process(
                 l_iir[idx + 1] = l1;
             }
             l_iir[num_poles_] = x0;
-            ef_[j] = x0;
+            buf.ef[j] = x0;
         }
         // pull input buffer a hop size
-        numInput_ -= hop_size_;
-        for (size_t i = 0; i < numInput_; i++) {
-            main_inputBuffer_[i] = main_inputBuffer_[i + hop_size_];
-        }
-        for (size_t i = 0; i < numInput_; i++) {
-            side_inputBuffer_[i] = side_inputBuffer_[i + hop_size_];
-        }
+        buf.numInput -= hop_size_;
         // overlay add
         for (size_t i = 0; i < fft_size_; i++) {
-            main_outputBuffer_[i + writeAddBegin_] += ef_[i] * hann_window_[i];
+            buf.ef[i] *= buf.hann_window[i];
         }
-        writeEnd_ = writeAddBegin_ + fft_size_;
-        writeAddBegin_ += hop_size_;
+        buf.main_output.Add(buf.writeAddBegin, {buf.ef.data(), fft_size_});
+        buf.writeAddBegin += hop_size_;
     }
     // -------------------- output --------------------
-    if (writeAddBegin_ >= num_samples) {
+    if (buf.writeAddBegin >= num_samples) {
         // extract output
-        size_t extractSize = num_samples;
-        for (size_t i = 0; i < extractSize; ++i) {
-            main_ptr[i] = main_outputBuffer_[i] * 0.25f;
-        }
-        // shift output buffer
-        size_t shiftSize = writeEnd_ - extractSize;
-        for (size_t i = 0; i < shiftSize; i++) {
-            main_outputBuffer_[i] = main_outputBuffer_[i + extractSize];
+        buf.main_output.Extract({main_ptr, num_samples});
+        for (size_t i = 0; i < num_samples; ++i) {
+            main_ptr[i] *= 0.25f;
         }
-        writeAddBegin_ -= extractSize;
-        size_t newWriteEnd = writeEnd_ - extractSize;
-        // zero shifed buffer
-        for (size_t i = newWriteEnd; i < writeEnd_; ++i) {
-            main_outputBuffer_[i].Broadcast(0);
-        }
-        writeEnd_ = newWriteEnd;
+        buf.writeAddBegin -= num_samples;
     }
     else {
         // zero buffer
@@ -178,9 +190,133 @@ void BlockBurgLPC::Process(
     }
 }
 
+qwqdsp_simd_element::PackFloat<2> BlockBurgLPC::AnalyzeBurg(
+    FrameState& frame,
+    std::span<qwqdsp_simd_element::PackFloat<2> const> main,
+    std::span<qwqdsp_simd_element::PackFloat<2>> latticek
+) {
+    float const allpass_coeff = fir_allpass_coeff_.load(std::memory_order_relaxed);
+    // forward fir lattice
+    std::copy(main.begin(), main.end(), frame.ef.begin());
+    std::copy(main.begin(), main.end(), frame.eb.begin());
+    for (size_t kidx = 0; kidx < num_poles_; ++kidx) {
+        auto& k = latticek[kidx];
+
+        qwqdsp_simd_element::PackFloat<2> up{};
+        qwqdsp_simd_element::PackFloat<2> down{};
+        qwqdsp_simd_element::PackFloat<2> s_iir{};
+        for (size_t i = 0; i < frame.ef.size(); ++i) {
+            auto y = allpass_coeff * frame.eb[i] + s_iir;
+            s_iir = frame.eb[i] - allpass_coeff * y;
+            frame.eb[i] = y;
+            up += frame.ef[i] * y;
+            down += frame.ef[i] * frame.ef[i];
+            down += y * y;
+        }
+        k = -2.0f * up / down;
+
+        for (size_t i = 0; i < frame.ef.size(); ++i) {
+            auto upgo = frame.ef[i] + frame.eb[i] * k;
+            auto downgo = frame.eb[i] + frame.ef[i] * k;
+            frame.ef[i] = upgo;
+            frame.eb[i] = downgo;
+        }
+    }
+    // eval gain
+    qwqdsp_simd_element::PackFloat<2> gain{};
+    for (size_t i = 0; i < frame.ef.size(); ++i) {
+        gain += frame.ef[i] * frame.ef[i];
+    }
+    gain = qwqdsp_simd_element::PackOps::Sqrt(gain);
+    qwqdsp_simd_element::PackFloat<2> gain_side{};
+    gain_side.Broadcast(std::sqrt(static_cast<float>(fft_size_)));
+    return gain / gain_side;
+}
+
+qwqdsp_simd_element::PackFloat<2> BlockBurgLPC::AnalyzeAutocorrelation(
+    FrameState& frame,
+    AcfState& acf,
+    std::span<qwqdsp_simd_element::PackFloat<2> const> main,
+    std::span<qwqdsp_simd_element::PackFloat<2>> latticek
+) {
+    float const allpass_coeff = fir_allpass_coeff_.load(std::memory_order_relaxed);
+    if (acf.warp_coeff != allpass_coeff) {
+        acf.UpdateWarpTable(allpass_coeff);
+    }
+
+    // 加窗，左声道作为实部，右声道作为虚部，一次复数FFT得到两个声道的频谱
+    size_t const acf_size = acf.acf_re.size();
+    for (size_t i = 0; i < fft_size_; ++i) {
+        acf.acf_re[i] = main[i][0] * frame.hann_window[i];
+        acf.acf_im[i] = main[i][1] * frame.hann_window[i];
+    }
+    std::fill(acf.acf_re.begin() + static_cast<int>(fft_size_), acf.acf_re.end(), 0.0f);
+    std::fill(acf.acf_im.begin() + static_cast<int>(fft_size_), acf.acf_im.end(), 0.0f);
+    acf.acf_fft.FFT(acf.acf_re.data(), acf.acf_im.data());
+
+    // X_l[k] = (Z[k] + Z*[N-k]) / 2, X_r[k] = (Z[k] - Z*[N-k]) / 2i
+    size_t const num_bins = fft_size_ + 1;
+    for (size_t i = 0; i < num_bins; ++i) {
+        size_t const mirror = (acf_size - i) & (acf_size - 1);
+        float const sum_re = acf.acf_re[i] + acf.acf_re[mirror];
+        float const sum_im = acf.acf_im[i] - acf.acf_im[mirror];
+        float const diff_re = acf.acf_re[i] - acf.acf_re[mirror];
+        float const diff_im = acf.acf_im[i] + acf.acf_im[mirror];
+        acf.acf_power[i] = qwqdsp_simd_element::PackFloat<2>{
+            sum_re * sum_re + sum_im * sum_im,
+            diff_re * diff_re + diff_im * diff_im
+        } * 0.25f;
+    }
+    acf.acf_power[num_bins] = acf.acf_power[num_bins - 1];
+
+    // 在变形后的频率上重采样，两个实偶功率谱作为实部和虚部一次逆变换
+    for (size_t i = 0; i < num_bins; ++i) {
+        float const pos = acf.warp_pos[i];
+        size_t const idx = static_cast<size_t>(pos);
+        float const frac = pos - static_cast<float>(idx);
+        auto const power = (acf.acf_power[idx] + (acf.acf_power[idx + 1] - acf.acf_power[idx]) * frac) * acf.warp_gain[i];
+        acf.acf_re[i] = power[0];
+        acf.acf_im[i] = power[1];
+    }
+    for (size_t i = 1; i < fft_size_; ++i) {
+        acf.acf_re[acf_size - i] = acf.acf_re[i];
+        acf.acf_im[acf_size - i] = acf.acf_im[i];
+    }
+    acf.acf_fft.IFFT(acf.acf_re.data(), acf.acf_im.data());
+
+    std::array<qwqdsp_simd_element::PackFloat<2>, kMaxPoles + 1> r{};
+    float const norm = 1.0f / static_cast<float>(acf_size);
+    for (size_t i = 0; i <= num_poles_; ++i) {
+        r[i] = qwqdsp_simd_element::PackFloat<2>{acf.acf_re[i], acf.acf_im[i]} * norm;
+    }
+    r[0] *= kWhiteNoiseCorrection;
+
+    // Levinson-Durbin，和Burg一样输出每一级的反射系数
+    std::array<qwqdsp_simd_element::PackFloat<2>, kMaxPoles> a{};
+    std::array<qwqdsp_simd_element::PackFloat<2>, kMaxPoles> prev_a{};
+    qwqdsp_simd_element::PackFloat<2> err = r[0];
+    for (size_t m = 0; m < num_poles_; ++m) {
+        qwqdsp_simd_element::PackFloat<2> acc = r[m + 1];
+        for (size_t i = 0; i < m; ++i) {
+            acc += a[i] * r[m - i];
+        }
+        auto const k = -1.0f * acc / err;
+
+        std::copy_n(a.begin(), m, prev_a.begin());
+        for (size_t i = 0; i < m; ++i) {
+            a[i] += k * prev_a[m - 1 - i];
+        }
+        a[m] = k;
+        latticek[m] = k;
+        err *= 1.0f - k * k;
+    }
+
+    // 窗的能量折算回每个样本的残差
+    return qwqdsp_simd_element::PackOps::Sqrt(err / acf.window_power);
+}
+
 void BlockBurgLPC::CopyLatticeCoeffient(std::span<float> buffer, size_t order) {
-    auto const backup = latticek_;
-    auto reverse_iir_it = backup.begin() + static_cast<int>(order);
+    auto reverse_iir_it = latticek_.begin() + static_cast<int>(order);
     for (size_t i = 0; i < order; ++i) {
         buffer[i] = (*(--reverse_iir_it))[0];
     }
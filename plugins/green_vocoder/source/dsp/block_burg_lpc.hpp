@@ -1,9 +1,13 @@
 #pragma once
 #include <array>
+#include <atomic>
 #include <vector>
 #include <span>
 #include <qwqdsp/simd_element/simd_pack.hpp>
 #include <qwqdsp/oscillator/noise.hpp>
+#include <qwqdsp/spectral/split_complex_fft.hpp>
+#include "pluginshared/snapshot.hpp"
+#include "stream_buffers.hpp"
 
 namespace green_vocoder::dsp {
 
@@ -11,6 +15,15 @@ class BlockBurgLPC {
 public:
     static constexpr size_t kMaxPoles = 80;
     static constexpr float kNoiseGain = 1e-5f;
+    // 自相关法的白噪声修正，保证Levinson-Durbin在float下稳定
+    static constexpr float kWhiteNoiseCorrection = 1.0001f;
+
+    enum class Analysis {
+        // 逐级Burg格型，O(block * order)
+        Burg = 0,
+        // 加窗自相关(FFT) + Levinson-Durbin，O(block * log(block) + order^2)
+        Autocorrelation
+    };
 
     void Init(float fs);
     void Process(
@@ -23,23 +36,101 @@ public:
     void SetSmear(float ms);
     void SetAttack(float ms);
     void SetFormantShift(float shift);
+    void SetAnalysis(Analysis analysis);
 
-    void CopyLatticeCoeffient(std::span<float> buffer, size_t order);
+    size_t GetBlockSize() const { return fft_size_; }
+
+    /**
+     * @brief 音频线程每个block调用一次，没有被选中时缓冲交给后台释放
+     *        新块长的缓冲准备好之前继续用旧块长和旧缓冲处理，换上之后SetBlockSize才生效
+     * @return 是否有缓冲可以处理
+     */
+    bool UpdateBuffers(bool selected) {
+        FrameState* frame = buffers_.Update(selected ? want_block_size_ : 0);
+        if (frame != frame_) {
+            frame_ = frame;
+            if (frame != nullptr) {
+                InstallFrame(*frame);
+            }
+        }
+        // 自相关的缓冲只在选了自相关分析时准备，块长跟着正在用的缓冲
+        bool const use_acf = frame != nullptr && analysis_ == Analysis::Autocorrelation;
+        acf_ = acf_buffers_.Update(use_acf ? fft_size_ : 0);
+        return frame != nullptr;
+    }
+    /**
+     * @brief 后台线程，构造或释放缓冲
+     * @return 还有没换上的缓冲
+     */
+    bool ServiceBuffers() {
+        bool busy = buffers_.Service();
+        busy |= acf_buffers_.Service(fir_allpass_coeff_.load(std::memory_order_relaxed));
+        return busy;
+    }
+
+    // 每个block更新后发布给UI的lattice系数
+    pluginshared::ArraySnapshot<float, kMaxPoles> gui_lattice_;
 private:
+    /**
+     * @brief 一个块长需要的全部缓冲，在后台线程构造
+     */
+    struct FrameState : StreamBuffers {
+        explicit FrameState(size_t size);
+
+        std::vector<float> hann_window;
+        std::vector<qwqdsp_simd_element::PackFloat<2>> eb;
+        std::vector<qwqdsp_simd_element::PackFloat<2>> ef;
+    };
+
+    /**
+     * @brief 自相关分析的缓冲，只在选了自相关分析时在后台线程构造
+     *        左右声道作为实部和虚部共用一次复数FFT
+     */
+    struct AcfState {
+        AcfState(size_t size, float allpass_coeff);
+
+        void UpdateWarpTable(float allpass_coeff);
+
+        size_t fft_size;
+        qwqdsp_spectral::SplitComplexFFT acf_fft;
+        std::vector<float> acf_re;
+        std::vector<float> acf_im;
+        std::vector<qwqdsp_simd_element::PackFloat<2>> acf_power;
+        // 全通变形后的频点在原频谱中的位置和 dw/dtheta
+        std::vector<float> warp_pos;
+        std::vector<float> warp_gain;
+        float warp_coeff{};
+        float window_power{};
+    };
+
+    void CopyLatticeCoeffient(std::span<float> buffer, size_t order);
+    /**
+     * @return 残差的均方根
+     */
+    qwqdsp_simd_element::PackFloat<2> AnalyzeBurg(
+        FrameState& frame,
+        std::span<qwqdsp_simd_element::PackFloat<2> const> main,
+        std::span<qwqdsp_simd_element::PackFloat<2>> latticek
+    );
+    qwqdsp_simd_element::PackFloat<2> AnalyzeAutocorrelation(
+        FrameState& frame,
+        AcfState& acf,
+        std::span<qwqdsp_simd_element::PackFloat<2> const> main,
+        std::span<qwqdsp_simd_element::PackFloat<2>> latticek
+    );
+    void InstallFrame(FrameState& frame);
+
     qwqdsp_oscillator::WhiteNoise noise_;
-    std::vector<float> hann_window_{};
-    std::array<qwqdsp_simd_element::PackFloat<2>, 32768> main_inputBuffer_{};
-    std::array<qwqdsp_simd_element::PackFloat<2>, 32768> side_inputBuffer_{};
-    std::array<qwqdsp_simd_element::PackFloat<2>, 32768> main_outputBuffer_{};
-    std::vector<qwqdsp_simd_element::PackFloat<2>> eb_;
-    std::vector<qwqdsp_simd_element::PackFloat<2>> ef_;
+    LazyStreamBuffers<FrameState> buffers_;
+    FrameState* frame_{};
+    LazyStreamBuffers<AcfState> acf_buffers_;
+    AcfState* acf_{};
     std::array<qwqdsp_simd_element::PackFloat<2>, kMaxPoles> latticek_{};
-    float fir_allpass_coeff_{};
+    // 后台构造自相关缓冲时读取
+    std::atomic<float> fir_allpass_coeff_{};
     size_t fft_size_{};
+    size_t want_block_size_{};
     size_t hop_size_{};
-    size_t numInput_{};
-    size_t writeEnd_{};
-    size_t writeAddBegin_{};
     size_t num_poles_{};
     float sample_rate_{};
     float update_rate_{};
@@ -48,6 +139,7 @@ private:
     qwqdsp_simd_element::PackFloat<2> gain_lag_{};
     float attack_ms_{};
     float attack_factor_{};
+    Analysis analysis_{Analysis::Burg};
 };
 
 }
@@ -460,14 +460,62 @@ void ChannelVocoder::ProcessBlock(qwqdsp_simd_element::PackFloat<2>* main, qwqds
             _ProcessBlock<6, false>(main, side, num_samples);
             break;
     }
+    gui_peaks_.PublishWith(static_cast<size_t>(num_bans_), [this](std::span<float> peaks) {
+        for (size_t i = 0; i < peaks.size(); ++i) {
+            peaks[i] = main_peaks_[i / 4][0][i & 3];
+        }
+    });
 }
 
 template <size_t kFilterNumbers, bool kOnlyPole>
 void ChannelVocoder::_ProcessBlock(qwqdsp_simd_element::PackFloat<2>* main, qwqdsp_simd_element::PackFloat<2>* side,
                                    size_t num_samples) {
-    std::fill_n(output_.begin(), num_samples, qwqdsp_simd_element::PackFloat<2>{});
+    size_t num_parts = 1;
+    if (worker_pool_ != nullptr) {
+        num_parts = std::min(worker_pool_->GetNumWorkers() + 1, num_filters_ / kMinFiltersPerPart);
+        num_parts = std::max<size_t>(num_parts, 1);
+    }
+
+    if (num_parts == 1) {
+        std::fill_n(output_.begin(), num_samples, qwqdsp_simd_element::PackFloat<2>{});
+        _ProcessFilters<kFilterNumbers, kOnlyPole>(main, side, num_samples, 0, num_filters_, output_.data());
+        std::copy_n(output_.begin(), num_samples, main);
+        return;
+    }
+
+    num_parts_ = num_parts;
+    part_main_ = main;
+    part_side_ = side;
+    part_num_samples_ = num_samples;
+    worker_pool_->Run(&ChannelVocoder::_ProcessPart<kFilterNumbers, kOnlyPole>, this, num_parts);
+
+    // 按固定顺序求和，结果和线程调度无关
+    std::copy_n(part_output_[0].begin(), num_samples, main);
+    for (size_t part = 1; part < num_parts; ++part) {
+        for (size_t i = 0; i < num_samples; ++i) {
+            main[i] += part_output_[part][i];
+        }
+    }
+}
+
+template <size_t kFilterNumbers, bool kOnlyPole>
+void ChannelVocoder::_ProcessPart(void* ctx, size_t part) noexcept {
+    auto& self = *static_cast<ChannelVocoder*>(ctx);
+    size_t const filter_begin = self.num_filters_ * part / self.num_parts_;
+    size_t const filter_end = self.num_filters_ * (part + 1) / self.num_parts_;
+    auto* output = self.part_output_[part].data();
+    std::fill_n(output, self.part_num_samples_, qwqdsp_simd_element::PackFloat<2>{});
+    self._ProcessFilters<kFilterNumbers, kOnlyPole>(self.part_main_, self.part_side_, self.part_num_samples_,
+                                                    filter_begin, filter_end, output);
+}
+
+template <size_t kFilterNumbers, bool kOnlyPole>
+void ChannelVocoder::_ProcessFilters(qwqdsp_simd_element::PackFloat<2> const* main,
+                                     qwqdsp_simd_element::PackFloat<2> const* side, size_t num_samples,
+                                     size_t filter_begin, size_t filter_end,
+                                     qwqdsp_simd_element::PackFloat<2>* output) noexcept {
     auto vgate_peak = qwqdsp_simd_element::PackFloat<4>::vBroadcast(gate_peak_);
-    for (size_t filter_idx = 0; filter_idx < num_filters_; ++filter_idx) {
+    for (size_t filter_idx = filter_begin; filter_idx < filter_end; ++filter_idx) {
         for (size_t sample_idx = 0; sample_idx < num_samples; ++sample_idx) {
             // filtering
             qwqdsp_simd_element::PackFloat<4> main_l;
@@ -512,11 +560,10 @@ void ChannelVocoder::_ProcessBlock(qwqdsp_simd_element::PackFloat<2>* main, qwqd
             // output
             float l = qwqdsp_simd_element::PackOps::ReduceAdd(lag_l * side_l);
             float r = qwqdsp_simd_element::PackOps::ReduceAdd(lag_r * side_r);
-            output_[sample_idx][0] += l;
-            output_[sample_idx][1] += r;
+            output[sample_idx][0] += l;
+            output[sample_idx][1] += r;
         }
     }
-    std::copy_n(output_.begin(), num_samples, main);
 }
 
 } // namespace green_vocoder::dsp
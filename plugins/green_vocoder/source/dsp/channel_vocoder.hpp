@@ -2,6 +2,8 @@
 #include "param_ids.hpp"
 #include <array>
 #include <qwqdsp/simd_element/simd_pack.hpp>
+#include "pluginshared/rt_worker_pool.hpp"
+#include "pluginshared/snapshot.hpp"
 #include <qwqdsp/filter/iir_design_extra.hpp>
 #include <qwqdsp/filter/iir_design.hpp>
 
@@ -282,6 +284,10 @@ class ChannelVocoder {
 public:
     static constexpr int kMaxOrder = 100;
     static constexpr int kMinOrder = 4;
+    static constexpr size_t kMaxBlockSize = 256;
+    // 每个线程至少分到这么多组(每组4个频带)才值得并行
+    static constexpr size_t kMinFiltersPerPart = 4;
+    static constexpr size_t kMaxParts = pluginshared::RTWorkerPool::kMaxWorkers + 1;
 
     enum class FilterBankMode {
         StackButterworth12,
@@ -315,12 +321,19 @@ public:
     void SetFilterBankMode(FilterBankMode mode);
     void SetGate(float db);
     void SetFormantShift(float shift);
+    /**
+     * @brief 频带较多时把滤波器组分给线程池并行处理，nullptr为单线程
+     */
+    void SetWorkerPool(pluginshared::RTWorkerPool* pool) { worker_pool_ = pool; }
 
     int GetNumBins() const { return num_bans_; }
     qwqdsp_simd_element::PackFloat<2> GetBinPeak(size_t idx) const {
         auto v = main_peaks_[idx / 4];
         return {v[0][idx & 3], v[1][idx & 3]};
     }
+
+    // 每个block发布一次左声道的频带峰值给UI
+    pluginshared::ArraySnapshot<float, kMaxOrder> gui_peaks_;
 private:
     void UpdateFilters();
 
@@ -337,6 +350,22 @@ private:
         size_t num_samples
     );
 
+    /**
+     * @brief 处理 [filter_begin, filter_end) 的滤波器组，输出累加到output
+     */
+    template<size_t kFilterNumbers, bool kOnlyPole>
+    void _ProcessFilters(
+        qwqdsp_simd_element::PackFloat<2> const* main,
+        qwqdsp_simd_element::PackFloat<2> const* side,
+        size_t num_samples,
+        size_t filter_begin,
+        size_t filter_end,
+        qwqdsp_simd_element::PackFloat<2>* output
+    ) noexcept;
+
+    template<size_t kFilterNumbers, bool kOnlyPole>
+    static void _ProcessPart(void* ctx, size_t part) noexcept;
+
     float carry_w_mul_{1.0f};
     float gate_peak_{0.0f};
     float gain_{1.0f};
@@ -355,7 +384,15 @@ private:
     eChannelVocoderMap map_{};
     std::array<std::pair<CascadeBPSVF, CascadeBPSVF>, kMaxOrder> filters_;
     std::array<qwqdsp_simd_element::PackFloat<4>[2], kMaxOrder> main_peaks_{};
-    std::array<qwqdsp_simd_element::PackFloat<2>, 256> output_{};
+    std::array<qwqdsp_simd_element::PackFloat<2>, kMaxBlockSize> output_{};
+
+    // 多线程
+    pluginshared::RTWorkerPool* worker_pool_{};
+    size_t num_parts_{1};
+    qwqdsp_simd_element::PackFloat<2> const* part_main_{};
+    qwqdsp_simd_element::PackFloat<2> const* part_side_{};
+    size_t part_num_samples_{};
+    std::array<std::array<qwqdsp_simd_element::PackFloat<2>, kMaxBlockSize>, kMaxParts> part_output_{};
 };
 
 }
@@ -26,6 +26,9 @@ void LeakyBurgLPC::Process(
             ProcessWithDicimate<kDicimateTable[2]>(main, side);
             break;
     }
+    gui_lattice_.PublishWith(static_cast<size_t>(lpc_order_), [this](std::span<float> buffer) {
+        CopyLatticeCoeffient(buffer, buffer.size());
+    });
 }
 
 template<size_t kDicimate>
@@ -206,8 +209,7 @@ void LeakyBurgLPC::SetGainHold(float ms) {
 }
 
 void LeakyBurgLPC::CopyLatticeCoeffient(std::span<float> buffer, size_t order) {
-    auto const backup = iir_k_;
-    auto reverse_iir_it = backup.begin() + static_cast<int>(order);
+    auto reverse_iir_it = iir_k_.begin() + static_cast<int>(order);
     for (size_t i = 0; i < order; ++i) {
         buffer[i] = (*(--reverse_iir_it))[0];
     }
@@ -5,6 +5,7 @@
 #include <qwqdsp/oscillator/noise.hpp>
 #include <qwqdsp/simd_element/simd_pack.hpp>
 #include <qwqdsp/simd_element/envelope_follower.hpp>
+#include "pluginshared/snapshot.hpp"
 
 namespace green_vocoder::dsp {
 class LeakyBurgLPC {
@@ -38,8 +39,11 @@ public:
     void SetQuality(Quality quality);
     void SetFormantShift(float shift);
 
-    void CopyLatticeCoeffient(std::span<float> buffer, size_t order);
+    // 每次Process后发布给UI的lattice系数
+    pluginshared::ArraySnapshot<float, kNumPoles> gui_lattice_;
 private:
+    void CopyLatticeCoeffient(std::span<float> buffer, size_t order);
+
     template<size_t kDicimate>
     void ProcessWithDicimate(
         std::span<qwqdsp_simd_element::PackFloat<2>> main,
@@ -42,25 +42,39 @@ void MFCCVocoder::Init(float fs) {
 }
 
 void MFCCVocoder::SetFFTSize(size_t size) {
-    fft_size_ = size;
-    fft_.init(size);
-    hann_window_.resize(size);
-    temp_main_.resize(size * 2);
-    temp_side_.resize(size * 2);
-    hop_size_ = size / 4;
+    want_fft_size_ = size;
+}
+
+MFCCVocoder::FrameState::FrameState(size_t size)
+    : StreamBuffers(size) {
+    fft.Init(size, 4);
+    hann_window.resize(size);
+    temp_main.resize(size * 2);
+    temp_side.resize(size * 2);
+    ola_frame.resize(size);
     for (size_t i = 0; i < size; ++i) {
-        hann_window_[i] =
+        hann_window[i] =
             0.5f - 0.5f * std::cos(2.0f * std::numbers::pi_v<float> * static_cast<float>(i) / static_cast<float>(size));
     }
-    size_t num_bins = fft_.ComplexSize(size);
-    real_main_.resize(num_bins);
-    imag_main_.resize(num_bins);
-    real_side_.resize(num_bins);
-    imag_side_.resize(num_bins);
-    fill_gains_.resize(num_bins + 1);
+    size_t num_bins = fft.NumBins();
+    real_main.resize(num_bins);
+    imag_main.resize(num_bins);
+    real_side.resize(num_bins);
+    imag_side.resize(num_bins);
+    real_main_right.resize(num_bins);
+    imag_main_right.resize(num_bins);
+    real_side_right.resize(num_bins);
+    imag_side_right.resize(num_bins);
+    fill_gains.resize(num_bins + 1);
+    window_gain = 2.0f / std::accumulate(hann_window.begin(), hann_window.end(), 0.0f);
+    window_gain *= GetFixGain(size);
+}
+
+void MFCCVocoder::InstallFrame(FrameState& frame) {
+    // 音频线程，只更新和帧长有关的标量
+    fft_size_ = frame.fft_size;
+    hop_size_ = fft_size_ / 4;
     SetRelease(release_ms_);
-    window_gain_ = 2.0f / std::accumulate(hann_window_.begin(), hann_window_.end(), 0.0f);
-    window_gain_ *= GetFixGain(size);
     SetNumMfcc(num_mfcc_);
 }
 
@@ -98,67 +112,65 @@ void MFCCVocoder::SetFormantShift(float formant_shift) {
 
 void MFCCVocoder::Process(qwqdsp_simd_element::PackFloat<2>* main, qwqdsp_simd_element::PackFloat<2>* side,
                           size_t num_samples) {
+    if (frame_ == nullptr) {
+        // 缓冲还在后台准备
+        std::fill_n(main, num_samples, qwqdsp_simd_element::PackFloat<2>{});
+        return;
+    }
+    FrameState& buf = *frame_;
     // -------------------- doing left --------------------
-    std::copy_n(main, num_samples, main_inputBuffer_.begin() + static_cast<int>(numInput_));
-    std::copy_n(side, num_samples, side_inputBuffer_.begin() + static_cast<int>(numInput_));
-    numInput_ += num_samples;
-    while (numInput_ >= fft_size_) {
+    buf.main_input.Push({main, num_samples});
+    buf.side_input.Push({side, num_samples});
+    buf.numInput += num_samples;
+    while (buf.numInput >= fft_size_) {
+        auto const main_frame = buf.MainFrame();
+        auto const side_frame = buf.SideFrame();
         for (size_t i = 0; i < fft_size_; ++i) {
-            temp_main_[i] = main_inputBuffer_[i][0];
-            temp_main_[i + fft_size_] = main_inputBuffer_[i][1];
+            buf.temp_main[i] = main_frame[i][0];
+            buf.temp_main[i + fft_size_] = main_frame[i][1];
         }
         for (size_t i = 0; i < fft_size_; ++i) {
-            temp_side_[i] = side_inputBuffer_[i][0];
-            temp_side_[i + fft_size_] = side_inputBuffer_[i][1];
-        }
-        numInput_ -= hop_size_;
-        for (size_t i = 0; i < numInput_; i++) {
-            main_inputBuffer_[i] = main_inputBuffer_[i + hop_size_];
+            buf.temp_side[i] = side_frame[i][0];
+            buf.temp_side[i + fft_size_] = side_frame[i][1];
         }
-        for (size_t i = 0; i < numInput_; i++) {
-            side_inputBuffer_[i] = side_inputBuffer_[i + hop_size_];
-        }
-
+        buf.numInput -= hop_size_;
+
+        // -------------------- fft --------------------
+        std::array<float const*, 4> const times{
+            buf.temp_main.data(), buf.temp_side.data(), buf.temp_main.data() + fft_size_, buf.temp_side.data() + fft_size_
+        };
+        std::array<float*, 4> const reals{
+            buf.real_main.data(), buf.real_side.data(), buf.real_main_right.data(), buf.real_side_right.data()
+        };
+        std::array<float*, 4> const imags{
+            buf.imag_main.data(), buf.imag_side.data(), buf.imag_main_right.data(), buf.imag_side_right.data()
+        };
+        buf.fft.FFTBatch(times, reals, imags);
         // -------------------- left --------------------
-        fft_.fft(temp_main_.data(), real_main_.data(), imag_main_.data());
-        fft_.fft(temp_side_.data(), real_side_.data(), imag_side_.data());
-        SpectralProcess(real_main_, imag_main_, real_side_, imag_side_, gains_);
-        fft_.ifft(temp_main_.data(), real_side_.data(), imag_side_.data());
+        SpectralProcess(buf, buf.real_main, buf.imag_main, buf.real_side, buf.imag_side, gains_);
         // -------------------- right --------------------
-        fft_.fft(temp_main_.data() + fft_size_, real_main_.data(), imag_main_.data());
-        fft_.fft(temp_side_.data() + fft_size_, real_side_.data(), imag_side_.data());
-        SpectralProcess(real_main_, imag_main_, real_side_, imag_side_, gains_);
-        fft_.ifft(temp_main_.data() + fft_size_, real_side_.data(), imag_side_.data());
+        SpectralProcess(buf, buf.real_main_right, buf.imag_main_right, buf.real_side_right, buf.imag_side_right, gains_);
+        // -------------------- ifft --------------------
+        std::array<float*, 2> const outs{buf.temp_main.data(), buf.temp_main.data() + fft_size_};
+        std::array<float const*, 2> const out_reals{buf.real_side.data(), buf.real_side_right.data()};
+        std::array<float const*, 2> const out_imags{buf.imag_side.data(), buf.imag_side_right.data()};
+        buf.fft.IFFTBatch(outs, out_reals, out_imags);
+        gui_gains_.Publish({gains_.data(), num_mfcc_});
 
         // overlay add
         for (size_t i = 0; i < fft_size_; i++) {
-            float left = temp_main_[i] * hann_window_[i];
-            float right = temp_main_[i + fft_size_] * hann_window_[i];
-            main_outputBuffer_[i + writeAddBegin_] += {left, right};
+            float left = buf.temp_main[i] * buf.hann_window[i];
+            float right = buf.temp_main[i + fft_size_] * buf.hann_window[i];
+            buf.ola_frame[i] = {left, right};
         }
-        writeEnd_ = writeAddBegin_ + fft_size_;
-        writeAddBegin_ += hop_size_;
+        buf.main_output.Add(buf.writeAddBegin, {buf.ola_frame.data(), fft_size_});
+        buf.writeAddBegin += hop_size_;
     }
     // -------------------- output --------------------
-    if (writeAddBegin_ >= num_samples) {
+    if (buf.writeAddBegin >= num_samples) {
         // extract output
-        size_t extractSize = num_samples;
-        for (size_t i = 0; i < extractSize; ++i) {
-            main[i] = main_outputBuffer_[i];
-        }
-
-        // shift output buffer
-        size_t shiftSize = writeEnd_ - extractSize;
-        for (size_t i = 0; i < shiftSize; i++) {
-            main_outputBuffer_[i] = main_outputBuffer_[i + extractSize];
-        }
-        writeAddBegin_ -= extractSize;
-        size_t newWriteEnd = writeEnd_ - extractSize;
-        // zero shifed buffer
-        for (size_t i = newWriteEnd; i < writeEnd_; ++i) {
-            main_outputBuffer_[i].Broadcast(0);
-        }
-        writeEnd_ = newWriteEnd;
+        buf.main_output.Extract({main, num_samples});
+        buf.writeAddBegin -= num_samples;
     }
     else {
         // zero buffer
@@ -166,7 +178,8 @@ void MFCCVocoder::Process(qwqdsp_simd_element::PackFloat<2>* main, qwqdsp_simd_e
     }
 }
 
-void MFCCVocoder::SpectralProcess(std::vector<float>& real_in, std::vector<float>& imag_in,
+void MFCCVocoder::SpectralProcess(FrameState& frame,
+                                  std::vector<float>& real_in, std::vector<float>& imag_in,
                                   std::vector<float>& real_out, std::vector<float>& imag_out,
                                   std::array<float, kMaxNumMfcc>& gains) {
     for (size_t mcff_idx = 0; mcff_idx < num_mfcc_; ++mcff_idx) {
@@ -181,7 +194,7 @@ void MFCCVocoder::SpectralProcess(std::vector<float>& real_in, std::vector<float
         sum /= static_cast<float>(end - begin + 1);
         sum = std::sqrt(sum);
 
-        float gain = sum * window_gain_;
+        float gain = sum * frame.window_gain;
         if (gain > gains[mcff_idx]) {
             gains[mcff_idx] = attck_ * gains[mcff_idx] + (1 - attck_) * gain;
         }
@@ -190,12 +203,12 @@ void MFCCVocoder::SpectralProcess(std::vector<float>& real_in, std::vector<float
         }
 
         for (size_t i = begin; i < end; ++i) {
-            fill_gains_[i] = gains[mcff_idx];
+            frame.fill_gains[i] = gains[mcff_idx];
         }
     }
     
     size_t num_bins = fft_size_ / 2 + 1;
-    fill_gains_[num_bins] = fill_gains_[0];
+    frame.fill_gains[num_bins] = frame.fill_gains[0];
     // apply formant
     for (size_t i = 0; i < num_bins; ++i) {
         float idx = static_cast<float>(i) * formant_mul_;
@@ -204,7 +217,7 @@ void MFCCVocoder::SpectralProcess(std::vector<float>& real_in, std::vector<float
 
         float g = 0;
         if (iidx < num_bins) {
-            g = qwqdsp::Interpolation::Linear(fill_gains_[iidx], fill_gains_[iidx + 1], frac);
+            g = qwqdsp::Interpolation::Linear(frame.fill_gains[iidx], frame.fill_gains[iidx + 1], frac);
         }
 
         real_out[i] *= g;
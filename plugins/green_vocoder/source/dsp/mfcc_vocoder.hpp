@@ -2,7 +2,9 @@
 #include <array>
 #include <vector>
 #include <qwqdsp/simd_element/simd_pack.hpp>
-#include "AudioFFT/AudioFFT.h"
+#include <qwqdsp/spectral/real_fft.hpp>
+#include "pluginshared/snapshot.hpp"
+#include "stream_buffers.hpp"
 
 namespace green_vocoder::dsp {
 
@@ -26,36 +28,66 @@ public:
 
     size_t GetFFTSize() const { return fft_size_; }
 
+    // 同BlockBurgLPC::UpdateBuffers / ServiceBuffers
+    bool UpdateBuffers(bool selected) {
+        FrameState* frame = buffers_.Update(selected ? want_fft_size_ : 0);
+        if (frame != frame_) {
+            frame_ = frame;
+            if (frame != nullptr) {
+                InstallFrame(*frame);
+            }
+        }
+        return frame != nullptr;
+    }
+    bool ServiceBuffers() {
+        return buffers_.Service();
+    }
+
     std::array<float, kMaxNumMfcc> gains_{};
     std::array<float, kMaxNumMfcc> gains2_{};
+    // 每个hop发布一次给UI
+    pluginshared::ArraySnapshot<float, kMaxNumMfcc> gui_gains_;
 private:
-    void SpectralProcess(std::vector<float>& real_in, std::vector<float>& imag_in,
+    /**
+     * @brief 一个帧长需要的全部缓冲，FFT和窗都在后台线程构造
+     */
+    struct FrameState : StreamBuffers {
+        explicit FrameState(size_t size);
+
+        // 每个hop的四帧(左右声道的main和side)一起正变换
+        qwqdsp_spectral::RealFFT fft;
+        std::vector<float> hann_window;
+        std::vector<float> temp_main;
+        std::vector<float> temp_side;
+        std::vector<qwqdsp_simd_element::PackFloat<2>> ola_frame;
+        std::vector<float> real_main;
+        std::vector<float> real_side;
+        std::vector<float> imag_main;
+        std::vector<float> imag_side;
+        std::vector<float> real_main_right;
+        std::vector<float> real_side_right;
+        std::vector<float> imag_main_right;
+        std::vector<float> imag_side_right;
+        std::vector<float> fill_gains;
+        float window_gain{};
+    };
+
+    void InstallFrame(FrameState& frame);
+    void SpectralProcess(FrameState& frame,
+                         std::vector<float>& real_in, std::vector<float>& imag_in,
                          std::vector<float>& real_out, std::vector<float>& imag_out,
                          std::array<float, kMaxNumMfcc>& gains);
-                         
-    audiofft::AudioFFT fft_;
-    std::vector<float> hann_window_{};
-    std::vector<float> temp_main_{};
-    std::vector<float> temp_side_{};
-    std::vector<float> real_main_{};
-    std::vector<float> real_side_{};
-    std::vector<float> imag_main_{};
-    std::vector<float> imag_side_{};
-    std::vector<float> fill_gains_{};
-    std::array<qwqdsp_simd_element::PackFloat<2>, 32768> main_inputBuffer_{};
-    std::array<qwqdsp_simd_element::PackFloat<2>, 32768> side_inputBuffer_{};
-    std::array<qwqdsp_simd_element::PackFloat<2>, 32768> main_outputBuffer_{};
+
+    LazyStreamBuffers<FrameState> buffers_;
+    FrameState* frame_{};
     std::array<size_t, kMaxNumMfcc + 1> mfcc_indexs_{};
     size_t num_mfcc_{};
     size_t fft_size_{};
+    size_t want_fft_size_{};
     size_t hop_size_{};
-    size_t numInput_{};
-    size_t writeEnd_{};
-    size_t writeAddBegin_{};
     float decay_{};
     float attck_{};
     float sample_rate_{};
-    float window_gain_{};
     float release_ms_{};
     float attack_ms_{};
     float formant_mul_{1};
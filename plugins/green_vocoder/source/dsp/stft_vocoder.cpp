@@ -20,33 +20,75 @@ void STFTVocoder::Init(float fs) {
 }
 
 void STFTVocoder::SetFFTSize(size_t size) {
-    fft_size_ = size;
-    fft_.init(size);
-    cep_fft_.Init(size);
-    hann_window_.resize(size);
-    window_.resize(size);
-    temp_main_.resize(size * 2);
-    temp_side_.resize(size * 2);
-    hop_size_ = size / 4;
+    assert(size <= kMaxFFTSize);
+    want_fft_size_ = size;
+}
+
+STFTVocoder::FrameState::FrameState(size_t size, float bw, float detail_amount)
+    : StreamBuffers(size) {
+    fft.Init(size, 4);
+    cep_fft.Init(size);
+    hann_window.resize(size);
+    window.resize(size);
+    temp_main.resize(size * 2);
+    temp_side.resize(size * 2);
+    ola_frame.resize(size);
     for (size_t i = 0; i < size; ++i) {
-        hann_window_[i] =
+        hann_window[i] =
             0.5f - 0.5f * std::cos(2.0f * std::numbers::pi_v<float> * static_cast<float>(i) / static_cast<float>(size));
     }
-    size_t num_bins = fft_.ComplexSize(size);
-    gains_.resize(num_bins + kExtraGainSize);
-    gains2_.resize(num_bins + kExtraGainSize);
-    real_main_.resize(num_bins);
-    imag_main_.resize(num_bins);
-    real_side_.resize(num_bins);
-    imag_side_.resize(num_bins);
-    cep_window_.resize(fft_size_);
-    cep_window_fft_.resize(fft_size_);
-    temp_.resize(fft_size_ + 1);
-    re1_.resize(fft_size_);
-    phase_.resize(fft_size_);
+    size_t num_bins = fft.NumBins();
+    gains.resize(num_bins + kExtraGainSize);
+    real_main.resize(num_bins);
+    imag_main.resize(num_bins);
+    real_side.resize(num_bins);
+    imag_side.resize(num_bins);
+    real_main_right.resize(num_bins);
+    imag_main_right.resize(num_bins);
+    real_side_right.resize(num_bins);
+    imag_side_right.resize(num_bins);
+    cep_window.resize(size);
+    cep_window_fft.resize(size);
+    temp.resize(size + 1);
+    re1.resize(size);
+    phase.resize(size);
+    SetBandwidth(bw);
+    SetDetail(detail_amount);
+}
+
+void STFTVocoder::FrameState::SetBandwidth(float bw) {
+    bandwidth = bw;
+    // generate sinc window
+    float f0 = bandwidth * static_cast<float>(fft_size) / 1024.0f;
+    for (size_t i = 0; i < fft_size; i++) {
+        float x = (2 * std::numbers::pi_v<float> * f0 * (static_cast<float>(i) - static_cast<float>(fft_size) / 2.0f))
+                / static_cast<float>(fft_size);
+        float sinc = std::abs(x) < 1e-6 ? 1.0f : std::sin(x) / x;
+        window[i] = sinc * hann_window[i];
+    }
+    window_gain = 2.0f / std::accumulate(window.begin(), window.end(), 0.0f);
+}
+
+void STFTVocoder::FrameState::SetDetail(float detail_amount) {
+    detail = detail_amount;
+    qwqdsp_filter::WindowFIR::Lowpass(cep_window, detail * std::numbers::pi_v<float> * 0.5f);
+    qwqdsp_window::Hann::ApplyWindow(cep_window, false);
+    cep_fft.FFTGainPhase(cep_window, cep_window_fft);
+}
+
+void STFTVocoder::InstallFrame(FrameState& frame) {
+    // 音频线程，只更新和帧长有关的标量，后台构造之后改过的参数再补上
+    fft_size_ = frame.fft_size;
+    hop_size_ = fft_size_ / 4;
     SetRelease(release_ms_);
-    SetBandwidth(bandwidth_);
-    SetDetail(detail_);
+    float const bandwidth = bandwidth_.load(std::memory_order_relaxed);
+    if (frame.bandwidth != bandwidth) {
+        frame.SetBandwidth(bandwidth);
+    }
+    float const detail = detail_.load(std::memory_order_relaxed);
+    if (frame.detail != detail) {
+        frame.SetDetail(detail);
+    }
 }
 
 void STFTVocoder::SetRelease(float ms) {
@@ -66,78 +108,81 @@ void STFTVocoder::SetBlend(float blend) {
 
 void STFTVocoder::Process(qwqdsp_simd_element::PackFloat<2>* main, qwqdsp_simd_element::PackFloat<2>* side,
                           size_t num_samples) {
+    if (frame_ == nullptr) {
+        // 缓冲还在后台准备
+        std::fill_n(main, num_samples, qwqdsp_simd_element::PackFloat<2>{});
+        return;
+    }
+    FrameState& buf = *frame_;
     // -------------------- doing left --------------------
-    std::copy_n(main, num_samples, main_inputBuffer_.begin() + static_cast<int>(numInput_));
-    std::copy_n(side, num_samples, side_inputBuffer_.begin() + static_cast<int>(numInput_));
-    numInput_ += num_samples;
-    while (numInput_ >= fft_size_) {
+    buf.main_input.Push({main, num_samples});
+    buf.side_input.Push({side, num_samples});
+    buf.numInput += num_samples;
+    while (buf.numInput >= fft_size_) {
+        auto const main_frame = buf.MainFrame();
+        auto const side_frame = buf.SideFrame();
         for (size_t i = 0; i < fft_size_; ++i) {
-            temp_main_[i] = window_[i] * main_inputBuffer_[i][0];
-            temp_main_[i + fft_size_] = window_[i] * main_inputBuffer_[i][1];
+            buf.temp_main[i] = buf.window[i] * main_frame[i][0];
+            buf.temp_main[i + fft_size_] = buf.window[i] * main_frame[i][1];
         }
         for (size_t i = 0; i < fft_size_; ++i) {
-            temp_side_[i] = side_inputBuffer_[i][0];
-            temp_side_[i + fft_size_] = side_inputBuffer_[i][1];
-        }
-        numInput_ -= hop_size_;
-        for (size_t i = 0; i < numInput_; i++) {
-            main_inputBuffer_[i] = main_inputBuffer_[i + hop_size_];
-        }
-        for (size_t i = 0; i < numInput_; i++) {
-            side_inputBuffer_[i] = side_inputBuffer_[i + hop_size_];
+            buf.temp_side[i] = side_frame[i][0];
+            buf.temp_side[i + fft_size_] = side_frame[i][1];
         }
+        buf.numInput -= hop_size_;
+
+        // -------------------- fft --------------------
+        std::array<float const*, 4> const times{
+            buf.temp_main.data(), buf.temp_side.data(), buf.temp_main.data() + fft_size_, buf.temp_side.data() + fft_size_
+        };
+        std::array<float*, 4> const reals{
+            buf.real_main.data(), buf.real_side.data(), buf.real_main_right.data(), buf.real_side_right.data()
+        };
+        std::array<float*, 4> const imags{
+            buf.imag_main.data(), buf.imag_side.data(), buf.imag_main_right.data(), buf.imag_side_right.data()
+        };
+        buf.fft.FFTBatch(times, reals, imags);
 
         // -------------------- left --------------------
-        fft_.fft(temp_main_.data(), real_main_.data(), imag_main_.data());
-        fft_.fft(temp_side_.data(), real_side_.data(), imag_side_.data());
         if (use_v2_) {
-            SpectralProcess2(real_main_, imag_main_, real_side_, imag_side_, gains_);
+            SpectralProcess2(buf, buf.real_main, buf.imag_main, buf.real_side, buf.imag_side);
         }
         else {
-            SpectralProcess(real_main_, imag_main_, real_side_, imag_side_, gains_);
+            SpectralProcess(buf, buf.real_main, buf.imag_main, buf.real_side, buf.imag_side);
         }
-        fft_.ifft(temp_main_.data(), real_side_.data(), imag_side_.data());
 
         // -------------------- right --------------------
-        fft_.fft(temp_main_.data() + fft_size_, real_main_.data(), imag_main_.data());
-        fft_.fft(temp_side_.data() + fft_size_, real_side_.data(), imag_side_.data());
         if (use_v2_) {
-            SpectralProcess2(real_main_, imag_main_, real_side_, imag_side_, gains_);
+            SpectralProcess2(buf, buf.real_main_right, buf.imag_main_right, buf.real_side_right, buf.imag_side_right);
         }
         else {
-            SpectralProcess(real_main_, imag_main_, real_side_, imag_side_, gains_);
+            SpectralProcess(buf, buf.real_main_right, buf.imag_main_right, buf.real_side_right, buf.imag_side_right);
         }
-        fft_.ifft(temp_main_.data() + fft_size_, real_side_.data(), imag_side_.data());
+
+        // -------------------- ifft --------------------
+        std::array<float*, 2> const outs{buf.temp_main.data(), buf.temp_main.data() + fft_size_};
+        std::array<float const*, 2> const out_reals{buf.real_side.data(), buf.real_side_right.data()};
+        std::array<float const*, 2> const out_imags{buf.imag_side.data(), buf.imag_side_right.data()};
+        buf.fft.IFFTBatch(outs, out_reals, out_imags);
+        gui_gains_.Publish(buf.gains);
 
         // overlay add
         for (size_t i = 0; i < fft_size_; i++) {
-            float left = temp_main_[i] * hann_window_[i];
-            float right = temp_main_[i + fft_size_] * hann_window_[i];
-            main_outputBuffer_[i + writeAddBegin_] += {left, right};
+            float left = buf.temp_main[i] * buf.hann_window[i];
+            float right = buf.temp_main[i + fft_size_] * buf.hann_window[i];
+            buf.ola_frame[i] = {left, right};
         }
-        writeEnd_ = writeAddBegin_ + fft_size_;
-        writeAddBegin_ += hop_size_;
+        buf.main_output.Add(buf.writeAddBegin, {buf.ola_frame.data(), fft_size_});
+        buf.writeAddBegin += hop_size_;
     }
     // -------------------- output --------------------
-    if (writeAddBegin_ >= num_samples) {
+    if (buf.writeAddBegin >= num_samples) {
         // extract output
-        size_t extractSize = num_samples;
-        for (size_t i = 0; i < extractSize; ++i) {
-            main[i] = main_outputBuffer_[i] * 4.0f;
+        buf.main_output.Extract({main, num_samples});
+        for (size_t i = 0; i < num_samples; ++i) {
+            main[i] *= 4.0f;
         }
-
-        // shift output buffer
-        size_t shiftSize = writeEnd_ - extractSize;
-        for (size_t i = 0; i < shiftSize; i++) {
-            main_outputBuffer_[i] = main_outputBuffer_[i + extractSize];
-        }
-        writeAddBegin_ -= extractSize;
-        size_t newWriteEnd = writeEnd_ - extractSize;
-        // zero shifed buffer
-        for (size_t i = newWriteEnd; i < writeEnd_; ++i) {
-            main_outputBuffer_[i].Broadcast(0);
-        }
-        writeEnd_ = newWriteEnd;
+        buf.writeAddBegin -= num_samples;
     }
     else {
         // zero buffer
@@ -146,16 +191,10 @@ void STFTVocoder::Process(qwqdsp_simd_element::PackFloat<2>* main, qwqdsp_simd_e
 }
 
 void STFTVocoder::SetBandwidth(float bw) {
-    bandwidth_ = bw;
-    // generate sinc window
-    float f0 = bandwidth_ * static_cast<float>(fft_size_) / 1024.0f;
-    for (size_t i = 0; i < fft_size_; i++) {
-        float x = (2 * std::numbers::pi_v<float> * f0 * (static_cast<float>(i) - static_cast<float>(fft_size_) / 2.0f))
-                / static_cast<float>(fft_size_);
-        float sinc = std::abs(x) < 1e-6 ? 1.0f : std::sin(x) / x;
-        window_[i] = sinc * hann_window_[i];
+    bandwidth_.store(bw, std::memory_order_relaxed);
+    if (frame_ != nullptr) {
+        frame_->SetBandwidth(bw);
     }
-    window_gain_ = 2.0f / std::accumulate(window_.begin(), window_.end(), 0.0f);
 }
 
 float STFTVocoder::Blend(float x) {
@@ -174,20 +213,21 @@ void STFTVocoder::SetUseV2(bool use) {
 }
 
 void STFTVocoder::SetDetail(float detail) {
-    detail_ = detail;
-    qwqdsp_filter::WindowFIR::Lowpass(cep_window_, detail * std::numbers::pi_v<float> * 0.5f);
-    qwqdsp_window::Hann::ApplyWindow(cep_window_, false);
-    cep_fft_.FFTGainPhase(cep_window_, cep_window_fft_);
+    detail_.store(detail, std::memory_order_relaxed);
+    if (frame_ != nullptr) {
+        frame_->SetDetail(detail);
+    }
 }
 
-void STFTVocoder::SpectralProcess(std::vector<float>& real_in, std::vector<float>& imag_in,
-                                  std::vector<float>& real_out, std::vector<float>& imag_out,
-                                  std::vector<float>& gains) {
+void STFTVocoder::SpectralProcess(FrameState& frame,
+                                  std::vector<float>& real_in, std::vector<float>& imag_in,
+                                  std::vector<float>& real_out, std::vector<float>& imag_out) {
+    std::vector<float>& gains = frame.gains;
     // a bad formant extra
-    size_t num_bins = fft_.ComplexSize(fft_size_);
+    size_t num_bins = frame.fft.NumBins();
     for (size_t i = 0; i < num_bins; ++i) {
         float power = std::abs(real_in[i] * real_in[i] + imag_in[i] * imag_in[i]);
-        float gain = std::sqrt(power) * window_gain_;
+        float gain = std::sqrt(power) * frame.window_gain;
         gain = Blend(gain);
 
         if (gain > gains[i]) {
@@ -214,36 +254,37 @@ void STFTVocoder::SpectralProcess(std::vector<float>& real_in, std::vector<float
     }
 }
 
-void STFTVocoder::SpectralProcess2(std::vector<float>& real_in, std::vector<float>& imag_in,
-                                   std::vector<float>& real_out, std::vector<float>& imag_out,
-                                   std::vector<float>& gains) {
+void STFTVocoder::SpectralProcess2(FrameState& frame,
+                                   std::vector<float>& real_in, std::vector<float>& imag_in,
+                                   std::vector<float>& real_out, std::vector<float>& imag_out) {
+    std::vector<float>& gains = frame.gains;
     size_t num_bins = fft_size_ / 2 + 1;
     for (size_t i = 0; i < fft_size_ / 2; ++i) {
         float re = real_in[i];
         float im = imag_in[i];
-        float pow = std::sqrt(re * re + im * im) * window_gain_;
+        float pow = std::sqrt(re * re + im * im) * frame.window_gain;
         pow = std::log(pow + 1e-12f);
-        temp_[i] = pow;
-        temp_[fft_size_ - i] = pow;
+        frame.temp[i] = pow;
+        frame.temp[fft_size_ - i] = pow;
     }
     {
         size_t i = fft_size_ / 2;
         float re = real_in[i];
         float im = imag_in[i];
-        float pow = std::sqrt(re * re + im * im) * window_gain_;
+        float pow = std::sqrt(re * re + im * im) * frame.window_gain;
         pow = std::log(pow + 1e-12f);
-        temp_[i] = pow;
+        frame.temp[i] = pow;
     }
 
-    std::fill_n(phase_.begin(), fft_size_, 0.0f);
-    cep_fft_.IFFT(re1_, {temp_.data(), fft_size_}, phase_);
+    std::fill_n(frame.phase.begin(), fft_size_, 0.0f);
+    frame.cep_fft.IFFT(frame.re1, {frame.temp.data(), fft_size_}, frame.phase);
     for (size_t i = 0; i < fft_size_; ++i) {
-        re1_[i] *= cep_window_fft_[i];
+        frame.re1[i] *= frame.cep_window_fft[i];
     }
-    cep_fft_.FFT(re1_, {temp_.data(), fft_size_}, phase_);
+    frame.cep_fft.FFT(frame.re1, {frame.temp.data(), fft_size_}, frame.phase);
 
     for (size_t i = 0; i < num_bins; ++i) {
-        float gain = std::exp(temp_[i]);
+        float gain = std::exp(frame.temp[i]);
         gain = Blend(gain);
 
         if (gain > gains[i]) {
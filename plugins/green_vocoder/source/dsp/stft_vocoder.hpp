@@ -1,16 +1,20 @@
 #pragma once
 #include <array>
+#include <atomic>
 #include <vector>
 
 #include <qwqdsp/simd_element/simd_pack.hpp>
+#include <qwqdsp/spectral/real_fft.hpp>
 #include <qwqdsp/spectral/complex_fft.hpp>
-#include "AudioFFT/AudioFFT.h"
+#include "pluginshared/snapshot.hpp"
+#include "stream_buffers.hpp"
 
 namespace green_vocoder::dsp {
 
 class STFTVocoder {
 public:
     static constexpr size_t kExtraGainSize = 1;
+    static constexpr size_t kMaxFFTSize = 4096;
 
     void Init(float fs);
     void Process(qwqdsp_simd_element::PackFloat<2>* main, qwqdsp_simd_element::PackFloat<2>* side, size_t num_samples);
@@ -29,54 +33,87 @@ public:
         return fft_size_;
     }
 
-    std::vector<float> gains_{};
-    std::vector<float> gains2_{};
+    // 同BlockBurgLPC::UpdateBuffers / ServiceBuffers
+    bool UpdateBuffers(bool selected) {
+        FrameState* frame = buffers_.Update(selected ? want_fft_size_ : 0);
+        if (frame != frame_) {
+            frame_ = frame;
+            if (frame != nullptr) {
+                InstallFrame(*frame);
+            }
+        }
+        return frame != nullptr;
+    }
+    bool ServiceBuffers() {
+        return buffers_.Service(bandwidth_.load(std::memory_order_relaxed), detail_.load(std::memory_order_relaxed));
+    }
+
+    // 每个hop发布一次给UI
+    pluginshared::ArraySnapshot<float, kMaxFFTSize / 2 + 1 + kExtraGainSize> gui_gains_;
 private:
+    /**
+     * @brief 一个帧长需要的全部缓冲，FFT和窗都在后台线程构造
+     */
+    struct FrameState : StreamBuffers {
+        FrameState(size_t size, float bw, float detail_amount);
+
+        void SetBandwidth(float bw);
+        void SetDetail(float detail_amount);
+
+        // 每个hop的四帧(左右声道的main和side)一起正变换
+        qwqdsp_spectral::RealFFT fft;
+        std::vector<float> window;
+        std::vector<float> hann_window;
+        std::vector<float> temp_main;
+        std::vector<float> temp_side;
+        std::vector<qwqdsp_simd_element::PackFloat<2>> ola_frame;
+        std::vector<float> real_main;
+        std::vector<float> real_side;
+        std::vector<float> imag_main;
+        std::vector<float> imag_side;
+        std::vector<float> real_main_right;
+        std::vector<float> real_side_right;
+        std::vector<float> imag_main_right;
+        std::vector<float> imag_side_right;
+        std::vector<float> gains;
+        float bandwidth{};
+        float window_gain{};
+
+        // v2 cepstrum processing
+        float detail{};
+        std::vector<float> temp;
+        std::vector<float> re1;
+        std::vector<float> phase;
+        qwqdsp_spectral::ComplexFFT cep_fft;
+        std::vector<float> cep_window;
+        std::vector<float> cep_window_fft;
+    };
+
+    void InstallFrame(FrameState& frame);
     float Blend(float x);
-    void SpectralProcess(std::vector<float>& real_in, std::vector<float>& imag_in,
-                         std::vector<float>& real_out, std::vector<float>& imag_out,
-                         std::vector<float>& gains);
-    void SpectralProcess2(std::vector<float>& real_in, std::vector<float>& imag_in,
-                          std::vector<float>& real_out, std::vector<float>& imag_out,
-                          std::vector<float>& gains);
+    void SpectralProcess(FrameState& frame,
+                         std::vector<float>& real_in, std::vector<float>& imag_in,
+                         std::vector<float>& real_out, std::vector<float>& imag_out);
+    void SpectralProcess2(FrameState& frame,
+                          std::vector<float>& real_in, std::vector<float>& imag_in,
+                          std::vector<float>& real_out, std::vector<float>& imag_out);
 
-    audiofft::AudioFFT fft_;
-    std::vector<float> window_{};
-    std::vector<float> hann_window_{};
-    std::vector<float> temp_main_{};
-    std::vector<float> temp_side_{};
-    std::vector<float> real_main_{};
-    std::vector<float> real_side_{};
-    std::vector<float> imag_main_{};
-    std::vector<float> imag_side_{};
-    
-    std::array<qwqdsp_simd_element::PackFloat<2>, 32768> main_inputBuffer_{};
-    std::array<qwqdsp_simd_element::PackFloat<2>, 32768> side_inputBuffer_{};
-    std::array<qwqdsp_simd_element::PackFloat<2>, 32768> main_outputBuffer_{};
+    LazyStreamBuffers<FrameState> buffers_;
+    FrameState* frame_{};
     size_t fft_size_{};
+    size_t want_fft_size_{};
     size_t hop_size_{};
-    size_t numInput_{};
-    size_t writeEnd_{};
-    size_t writeAddBegin_{};
-    float bandwidth_{};
+    // 后台构造新帧状态时读取
+    std::atomic<float> bandwidth_{};
+    std::atomic<float> detail_{};
     float decay_{};
     float attck_{};
     float sample_rate_{};
     float blend_{};
-    float window_gain_{};
     float release_ms_{};
     float attack_ms_{};
     float formant_mul_{};
-
-    // v2 cepstrum processing
     bool use_v2_{};
-    float detail_{};
-    std::vector<float> temp_;
-    std::vector<float> re1_;
-    std::vector<float> phase_;
-    qwqdsp_spectral::ComplexFFT cep_fft_;
-    std::vector<float> cep_window_{};
-    std::vector<float> cep_window_fft_{};
 };
 
 } // namespace green_vocoder::dsp
@@ -0,0 +1,123 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <qwqdsp/segement/ring.hpp>
+#include <qwqdsp/simd_element/simd_pack.hpp>
+
+namespace green_vocoder::dsp {
+
+/**
+ * @brief 分帧引擎的输入环形缓冲和叠加输出环形缓冲，长度由帧长决定
+ *        每个hop只移动读写位置，不搬移数据
+ */
+struct StreamBuffers {
+    // 每次Process最多的样本数，和处理器的交叉缓冲一致
+    static constexpr size_t kMaxProcessSize = 256;
+
+    explicit StreamBuffers(size_t size)
+        : fft_size(size) {
+        main_input.SetCapacity(size + kMaxProcessSize);
+        side_input.SetCapacity(size + kMaxProcessSize);
+        main_output.SetCapacity(2 * size + 2 * kMaxProcessSize);
+    }
+
+    /**
+     * @brief 当前帧，最近写入的numInput个样本里最早的fft_size个
+     */
+    std::span<const qwqdsp_simd_element::PackFloat<2>> MainFrame() const noexcept {
+        return main_input.Latest(numInput).first(fft_size);
+    }
+
+    std::span<const qwqdsp_simd_element::PackFloat<2>> SideFrame() const noexcept {
+        return side_input.Latest(numInput).first(fft_size);
+    }
+
+    size_t fft_size;
+    // 还没有被完整跳过的输入样本数
+    size_t numInput{};
+    // 下一帧叠加到输出读位置之后的偏移
+    size_t writeAddBegin{};
+    qwqdsp_segement::BasicMirrorRing<qwqdsp_simd_element::PackFloat<2>> main_input;
+    qwqdsp_segement::BasicMirrorRing<qwqdsp_simd_element::PackFloat<2>> side_input;
+    qwqdsp_segement::BasicOverlapAddRing<qwqdsp_simd_element::PackFloat<2>> main_output;
+};
+
+/**
+ * @brief 只在被选中时持有一份按帧长构造的Buffers(StreamBuffers或派生的引擎帧状态)
+ *        音频线程只声明需要的帧长并交换指针，构造和释放都在后台线程的Service里完成
+ */
+template<class Buffers>
+class LazyStreamBuffers {
+public:
+    ~LazyStreamBuffers() {
+        delete pending_.exchange(nullptr);
+        delete retired_.exchange(nullptr);
+    }
+
+    /**
+     * @brief 音频线程，size = 0 表示释放
+     * @return 当前的缓冲，size的缓冲准备好之前仍然是旧帧长的缓冲，没有缓冲时返回nullptr
+     */
+    Buffers* Update(size_t size) noexcept {
+        want_.store(size, std::memory_order_relaxed);
+
+        if (retired_.load(std::memory_order_acquire) == nullptr) {
+            Buffers* ready = pending_.exchange(nullptr, std::memory_order_acq_rel);
+            if (ready != nullptr) {
+                if (current_ != nullptr && current_->fft_size == ready->fft_size) {
+                    // 后台重复准备的，原样退回
+                    retired_.store(ready, std::memory_order_release);
+                }
+                else {
+                    retired_.store(current_.release(), std::memory_order_release);
+                    current_.reset(ready);
+                }
+            }
+            else if (size == 0 && current_ != nullptr) {
+                retired_.store(current_.release(), std::memory_order_release);
+            }
+            current_size_.store(current_ != nullptr ? current_->fft_size : 0, std::memory_order_release);
+        }
+
+        return current_.get();
+    }
+
+    /**
+     * @brief 不在音频线程调用，释放被换下的缓冲并准备需要的缓冲
+     * @param args 帧长之后传给Buffers构造函数的参数
+     * @return 音频线程还没有换上需要的缓冲，需要尽快再次调用
+     */
+    template<class... Args>
+    bool Service(Args const&... args) {
+        std::scoped_lock lock{service_lock_};
+        delete retired_.exchange(nullptr, std::memory_order_acq_rel);
+
+        size_t const want = want_.load(std::memory_order_relaxed);
+        Buffers* pending = pending_.load(std::memory_order_acquire);
+        if (pending != nullptr && pending->fft_size != want) {
+            // 音频线程可能同时取走，只有交换成功才归这里释放
+            if (pending_.compare_exchange_strong(pending, nullptr, std::memory_order_acq_rel)) {
+                delete pending;
+            }
+            pending = pending_.load(std::memory_order_acquire);
+        }
+
+        if (want != 0 && pending == nullptr && current_size_.load(std::memory_order_acquire) != want) {
+            pending_.store(new Buffers(want, args...), std::memory_order_release);
+        }
+        return current_size_.load(std::memory_order_acquire) != want;
+    }
+
+private:
+    std::unique_ptr<Buffers> current_;
+    std::atomic<size_t> current_size_{};
+    std::atomic<size_t> want_{};
+    std::atomic<Buffers*> pending_{};
+    std::atomic<Buffers*> retired_{};
+    std::mutex service_lock_;
+};
+
+}
@@ -53,6 +53,7 @@ static constexpr auto kLPCGainAttack = "lpc_attack";
 static constexpr auto kLPCGainHold = "lpc_hold";
 static constexpr auto kLPCGainRelease = "lpc_release";
 static constexpr auto kLPCDicimate = "lpc_dicimate";
+static constexpr auto kBlockLPCAnalysis = "block_lpc_analysis";
 
 static constexpr auto kStftWindowWidth = "stft_bandwidth";
 static constexpr auto kMfccNumBands = "mfcc_nbands";
@@ -26,6 +26,8 @@ BurgLPC::BurgLPC(AudioPluginAudioProcessor& processor)
 
     block_size_.BindParam(apvts, id::kStftSize);
     addChildComponent(block_size_);
+    analysis_.BindParam(apvts, id::kBlockLPCAnalysis);
+    addChildComponent(analysis_);
 
     MakeGui();
 }
@@ -50,6 +52,7 @@ void BurgLPC::resized() {
         auto block = b.removeFromTop(65);
         smear_.setBounds(block.removeFromLeft(50));
         attack_.setBounds(block.removeFromLeft(50));
+        analysis_.setBounds(block.removeFromLeft(100).removeFromTop(30));
     }
 }
 
@@ -64,6 +67,7 @@ void BurgLPC::MakeGui() {
     release_.setVisible(!block_mode_);
     hold_.setVisible(!block_mode_);
     block_size_.setVisible(block_mode_);
+    analysis_.setVisible(block_mode_);
     resized();
 }
 
@@ -140,17 +144,13 @@ void BurgLPC::paint(juce::Graphics& g) {
     }
 
     // lattice to tf
-    std::array<float, dsp::LeakyBurgLPC::kNumPoles> lattice_buff;
     std::array<float, dsp::LeakyBurgLPC::kNumPoles + 1> upgoing{1};
     std::array<float, dsp::LeakyBurgLPC::kNumPoles + 1> downgoing{1};
 
-    size_t order = static_cast<size_t>(order_.slider.getValue());;
-    if (block_mode_) {
-        processor_.block_burg_lpc_.CopyLatticeCoeffient(lattice_buff, order);
-    }
-    else {
-        processor_.burg_lpc_.CopyLatticeCoeffient(lattice_buff, order);
-    }
+    auto& snapshot = block_mode_ ? processor_.block_burg_lpc_.gui_lattice_ : processor_.burg_lpc_.gui_lattice_;
+    snapshot.Update();
+    auto const lattice = snapshot.View();
+    size_t order = lattice.size();
 
     for (size_t kidx = 0; kidx < order; ++kidx) {
         for (size_t i = kidx + 1; i != 0; --i) {
@@ -159,8 +159,8 @@ void BurgLPC::paint(juce::Graphics& g) {
         downgoing[0] = 0;
 
         for (size_t i = 0; i < kidx + 2; ++i) {
-            float up = upgoing[i] + lattice_buff[kidx] * downgoing[i];
-            float down = downgoing[i] + lattice_buff[kidx] * upgoing[i];
+            float up = upgoing[i] + lattice[kidx] * downgoing[i];
+            float down = downgoing[i] + lattice[kidx] * upgoing[i];
             upgoing[i] = up;
             downgoing[i] = down;
         }
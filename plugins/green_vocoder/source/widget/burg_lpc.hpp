@@ -26,6 +26,7 @@ private:
     ui::Dial hold_{"hold"};
     ui::Dial release_{"release"};
     ui::FlatCombobox block_size_;
+    ui::FlatCombobox analysis_;
 };
 
 }
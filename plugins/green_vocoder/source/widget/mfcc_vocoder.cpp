@@ -41,10 +41,11 @@ void MFCCVocoder::paint(juce::Graphics& g) {
     constexpr float up = 0.0f;
     constexpr float down = -60.0f;
 
-    size_t nbands = static_cast<size_t>(mfcc_size_.slider.getValue());
+    p_.mfcc_vocoder_.gui_gains_.Update();
+    auto const peaks = p_.mfcc_vocoder_.gui_gains_.View();
+    size_t nbands = peaks.size();
     float width = bb.getWidth() / static_cast<float>(nbands);
     float x = bb.getX();
-    auto peaks = p_.mfcc_vocoder_.gains_;
     for (size_t i = 0; i < nbands; ++i) {
         juce::Rectangle<float> rect{ x + width * 0.25f, bb.getY(), width * 0.5f, bb.getHeight() };
         float gain = peaks[i];
@@ -1,7 +1,6 @@
 #include "stft_vocoder.hpp"
 #include "PluginProcessor.h"
 #include "param_ids.hpp"
-#include <vector>
 
 namespace green_vocoder::widget {
 
@@ -55,11 +54,8 @@ void STFTVocoder::paint(juce::Graphics& g) {
     g.setColour(ui::black_bg);
     g.fillRect(bb);
     auto current_font = g.getCurrentFont();
-    std::vector<float> gains;
-    {
-        juce::ScopedLock _{processor_.getCallbackLock()};
-        gains = processor_.stft_vocoder_.gains_;
-    }
+    processor_.stft_vocoder_.gui_gains_.Update();
+    auto const gains = processor_.stft_vocoder_.gui_gains_.View();
 
     constexpr float top_line_db = 10.0f;
     constexpr float last_line_db = -60.0f;
@@ -132,7 +128,7 @@ void STFTVocoder::paint(juce::Graphics& g) {
     float mul_val = std::pow(10.0f, freq_pow / b.getWidth());
     float mul_begin = 1.0f;
     float omega_base = freq_begin * 2.0f / static_cast<float>(processor_.getSampleRate());
-    for (int x = 0; x < bb.getWidth(); ++x) {
+    for (int x = 0; x < bb.getWidth() && !gains.empty(); ++x) {
         float omega = omega_base * mul_begin;
         mul_begin *= mul_val;
         
@@ -1,4 +1,7 @@
 #pragma once
+#include <array>
+#include <cstdint>
+#include <pluginshared/voice_allocator.hpp>
 #include "config.hpp"
 
 struct Voice
@@ -21,50 +24,46 @@ public:
      * @return 分配到的复音的 ID，如果找不到则返回 -1 (理论上不会发生)。
      */
     int noteOn(int note, bool round_robin) {
+        uint32_t id = Allocator::kInvalid;
         if (round_robin) {
             // 测试循环位
-            if (!voices[round_robin_].isActive) {
-                int id = activateVoice(static_cast<int>(round_robin_), note);
+            if (allocator_.IsFree(static_cast<uint32_t>(round_robin_))) {
+                id = static_cast<uint32_t>(round_robin_);
                 ++round_robin_;
                 round_robin_ &= (kNumResonators - 1);
-                return id;
             }
         }
 
         // 尝试找到一个空闲的复音
-        for (size_t id = 0; id < kNumResonators; ++id) {
-            if (!voices[id].isActive) {
-                // 找到空闲复音：直接分配
-                return activateVoice(static_cast<int>(id), note);
-            }
+        if (id == Allocator::kInvalid) {
+            id = allocator_.FindFree();
         }
 
         // --- 所有复音都被占用：FIFO 替换最旧的 ---
-        
-        // 获取最旧的复音 ID (deque 的头部)
-        int oldestVoiceID = activationOrder.front();
-        activationOrder.pop_front();
+        if (id == Allocator::kInvalid) {
+            id = allocator_.Oldest();
+        }
 
-        // 激活新音高并返回 ID
-        return activateVoice(oldestVoiceID, note);
+        if (id == Allocator::kInvalid) {
+            return -1;
+        }
+        activateVoice(id, note);
+        return static_cast<int>(id);
     }
 
     /**
      * @brief 处理 NoteOff 事件，释放对应的复音。
+     *        同一个音高按了多次时，每次释放其中最早触发的一个
      * @param note 要释放的 MIDI 音高。
      * @return 返回被关闭的id，如果没有则是kNumResonators
      */
     int noteOff(int note) {
-        // 找到所有分配给该音高的复音并释放
-        for (size_t id = 0; id < kNumResonators; ++id) {
-            if (voices[id].isActive && voices[id].midiNote == note) {
-                deactivateVoice(static_cast<int>(id));
-                // 注意：如果有多个复音分配到同一个音高，这里只会释放找到的第一个。
-                // 如果需要支持单音高多复音，则可以继续循环或使用更复杂的映射。
-                return static_cast<int>(id);
-            }
+        uint32_t const id = allocator_.FindOldest(note);
+        if (id == Allocator::kInvalid) {
+            return kNumResonators;
         }
-        return kNumResonators;
+        deactivateVoice(id);
+        return static_cast<int>(id);
     }
     
     // -----------------------------------------------------------
@@ -80,32 +79,28 @@ public:
             voices[i].midiNote = -1;
             voices[i].isActive = false;
         }
+        allocator_.Clear();
         round_robin_ = 0;
     }
 
 private:
+    using Allocator = pluginshared::VoiceAllocator<kNumResonators>;
+
     std::array<Voice, kNumResonators> voices;           // 存储所有复音实例
-    std::deque<int> activationOrder;     // 存储正在使用复音的 ID，用于 FIFO 替换
+    Allocator allocator_;                                // 激活顺序(LRU)和音高查找表，用于 FIFO 替换
     size_t round_robin_{};
 
-    int activateVoice(int id, int note) {
-        voices[static_cast<size_t>(id)].midiNote = note;
-        voices[static_cast<size_t>(id)].isActive = true;
+    void activateVoice(uint32_t id, int note) {
+        voices[id].midiNote = note;
+        voices[id].isActive = true;
         
-        // 将此复音 ID 添加到激活队列的尾部，表示它现在是“最新”的
-        activationOrder.push_back(id);
-        return id;
+        // 将此复音 ID 放到激活顺序的尾部，表示它现在是“最新”的
+        allocator_.Activate(id, note);
     }
 
-    void deactivateVoice(int id) {
-        voices[static_cast<size_t>(id)].isActive = false;
-        voices[static_cast<size_t>(id)].midiNote = -1;
-
-        // 从激活队列中移除此 ID，因为它不再是“激活”状态
-        // 使用 std::remove_if + erase idiom
-        activationOrder.erase(
-            std::remove(activationOrder.begin(), activationOrder.end(), id),
-            activationOrder.end()
-        );
+    void deactivateVoice(uint32_t id) {
+        voices[id].isActive = false;
+        voices[id].midiNote = -1;
+        allocator_.Free(id);
     }
 };
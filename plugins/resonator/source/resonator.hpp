@@ -9,7 +9,11 @@
 #include <qwqdsp/simd_element/simd_pack.hpp>
 #include <qwqdsp/simd_element/one_pole_tpt.hpp>
 
-using SimdType = qwqdsp_simd_element::PackFloat<4>;
+#include "simd_detector.h"
+
+// 一个声道的8个谐振器刚好放进一个寄存器
+using SimdType = qwqdsp_simd_element::PackFloat<8>;
+using SimdUintType = qwqdsp_simd_element::PackUint32<8>;
 
 class ThrianDispersion {
 public:
@@ -32,13 +36,9 @@ public:
 
     void SetGroupDelay(SimdType const& delay) noexcept {
         SimdType temp = (SimdType::vBroadcast(1) - delay) / (SimdType::vBroadcast(1) + delay);
-        SimdType zero = SimdType::vBroadcast(0);
-        a1_ = SimdType{
-            delay[0] < 1.0f ? zero[0] : temp[0],
-            delay[1] < 1.0f ? zero[1] : temp[1],
-            delay[2] < 1.0f ? zero[2] : temp[2],
-            delay[3] < 1.0f ? zero[3] : temp[3]
-        };
+        for (size_t i = 0; i < SimdType::kSize; ++i) {
+            a1_[i] = delay[i] < 1.0f ? 0.0f : temp[i];
+        }
     }
 
     void SetGroupDelay(size_t idx, float delay) noexcept {
@@ -95,8 +95,8 @@ public:
      * @param delay 环路延迟
      * @return 还剩下多少延迟
      */
-    qwqdsp_simd_element::PackUint32<4> SetDelay(SimdType const& delay) noexcept {
-        qwqdsp_simd_element::PackUint32<4> r;
+    SimdUintType SetDelay(SimdType const& delay) noexcept {
+        SimdUintType r;
         for (size_t i = 0; i < SimdType::kSize; ++i) {
             // thiran delay limit to 0.5 ~ 1.5
             if (delay[i] < 0.5f) {
@@ -139,8 +139,33 @@ private:
     SimdType alpha_{};
 };
 
+/**
+ * @brief 左右声道各是一个独立的8谐振器网络，谐振器之间通过散射矩阵耦合
+ *        网络内的信号全部衰减到阈值以下并且没有输入时，整个声道清零休眠，不再计算
+ */
 class Resonator {
 public:
+    enum class ProcessArch {
+        kVector4,
+        kVector8,
+        kNothing
+    };
+
+    static_assert(kNumResonators == SimdType::kSize, "scatter network is designed for 8 resonators per channel");
+
+    // 低于这个幅度认为是静音
+    static constexpr float kSilenceThreshold = 1e-6f;
+
+    Resonator() {
+        process_arch_ = ProcessArch::kNothing;
+        if (simd_detector::is_supported(simd_detector::InstructionSet::PLUGIN_VEC8_DISPATCH_ISET)) {
+            process_arch_ = ProcessArch::kVector8;
+        }
+        else if (simd_detector::is_supported(simd_detector::InstructionSet::PLUGIN_VEC4_DISPATCH_ISET)) {
+            process_arch_ = ProcessArch::kVector4;
+        }
+    }
+
     void Init(float fs, float min_pitch) {
         fs_ = fs;
         float const min_frequency = qwqdsp::convert::Pitch2Freq(min_pitch);
@@ -151,165 +176,75 @@ public:
         while (a < max_samples) {
             a *= 2;
         }
-        for (auto& v : delay_buffer_) {
-            v.resize(a);
+        for (auto& c : channels_) {
+            c.delay_buffer.resize(a);
         }
         delay_mask_ = static_cast<uint32_t>(a - 1);
     }
 
     void Reset() noexcept {
-        delay_wpos_ = 0;
-        for (auto& v : delay_buffer_) {
-            std::ranges::fill(v, SimdType{});
-        }
-        for (auto& v : thrian_interp_) {
-            v.Reset();
-        }
-        for (auto& d : dispersion_) {
-            d.Reset();
-        }
-        for (auto& d : damp_) {
-            d.Reset();
+        for (auto& c : channels_) {
+            c.Reset();
         }
     }
 
     void Process(float* left_ptr, float* right_ptr, size_t len) noexcept {
-        for (size_t i = 0; i < len; ++i) {
-            // input
-            auto output_l = SimdType::vBroadcast(left_ptr[i]);
-            auto output_r = SimdType::vBroadcast(right_ptr[i]);
-            auto input_1_l = input_volume_[0] * output_l + fb_values_[0];
-            auto input_2_l = input_volume_[1] * output_l + fb_values_[1];
-            auto input_1_r = input_volume_[0] * output_r + fb_values_[2];
-            auto input_2_r = input_volume_[1] * output_r + fb_values_[3];
-            output_l *= SimdType::vBroadcast(dry);
-            output_r *= SimdType::vBroadcast(dry);
-            output_l += fb_values_[0] * output_volume_[0];
-            output_l += fb_values_[1] * output_volume_[1];
-            output_r += fb_values_[2] * output_volume_[0];
-            output_r += fb_values_[3] * output_volume_[1];
-
-            // delayline
-            delay_buffer_[0][delay_wpos_] = input_1_l;
-            delay_buffer_[1][delay_wpos_] = input_2_l;
-            delay_buffer_[2][delay_wpos_] = input_1_r;
-            delay_buffer_[3][delay_wpos_] = input_2_r;
-            delay_wpos_ = (delay_wpos_ + 1) & delay_mask_;
-            auto delay_out1_l = ReadFeedback(0, delay_wpos_, 0);
-            auto delay_out2_l = ReadFeedback(1, delay_wpos_, 1);
-            auto delay_out1_r = ReadFeedback(2, delay_wpos_, 0);
-            auto delay_out2_r = ReadFeedback(3, delay_wpos_, 1);
-
-            // dispersion and damp
-            delay_out1_l = dispersion_[0].Tick(delay_out1_l);
-            delay_out2_l = dispersion_[1].Tick(delay_out2_l);
-            delay_out1_r = dispersion_[2].Tick(delay_out1_r);
-            delay_out2_r = dispersion_[3].Tick(delay_out2_r);
-            delay_out1_l = damp_[0].TickHighshelf(delay_out1_l, damp_highshelf_coeff[0], damp_highshelf_gain[0]);
-            delay_out2_l = damp_[1].TickHighshelf(delay_out2_l, damp_highshelf_coeff[1], damp_highshelf_gain[1]);
-            delay_out1_r = damp_[2].TickHighshelf(delay_out1_r, damp_highshelf_coeff[0], damp_highshelf_gain[0]);
-            delay_out2_r = damp_[3].TickHighshelf(delay_out2_r, damp_highshelf_coeff[1], damp_highshelf_gain[1]);
-            delay_out1_l = dc_blocker[0].TickHighpass(delay_out1_l, SimdType::vBroadcast(0.0005f));
-            delay_out2_l = dc_blocker[1].TickHighpass(delay_out2_l, SimdType::vBroadcast(0.0005f));
-            delay_out1_r = dc_blocker[2].TickHighpass(delay_out1_r, SimdType::vBroadcast(0.0005f));
-            delay_out2_r = dc_blocker[3].TickHighpass(delay_out2_r, SimdType::vBroadcast(0.0005f));
-
-            // scatter signals
-            // first
-            SimdType scatter_sin = qwqdsp_simd_element::PackOps::Sin(reflections_[0]);
-            SimdType scatter_cos = qwqdsp_simd_element::PackOps::Cos(reflections_[0]);
-            SimdType scatter_a_l{
-                delay_out1_l[0], delay_out1_l[2], delay_out2_l[0], delay_out2_l[2]
-            };
-            SimdType scatter_b_l{
-                delay_out1_l[1], delay_out1_l[3], delay_out2_l[1], delay_out2_l[3]
-            };
-            SimdType scatter_a_r{
-                delay_out1_r[0], delay_out1_r[2], delay_out2_r[0], delay_out2_r[2]
-            };
-            SimdType scatter_b_r{
-                delay_out1_r[1], delay_out1_r[3], delay_out2_r[1], delay_out2_r[3]
-            };
-            // [0, 2, 4, 6]
-            SimdType scatter_outa_l = scatter_cos * scatter_a_l - scatter_sin * scatter_b_l;
-            SimdType scatter_outa_r = scatter_cos * scatter_a_r - scatter_sin * scatter_b_r;
-            // [1, 3, 5, 7]
-            SimdType scatter_outb_l = scatter_sin * scatter_a_l + scatter_cos * scatter_b_l;
-            SimdType scatter_outb_r = scatter_sin * scatter_a_r + scatter_cos * scatter_b_r;
-
-            // second
-            scatter_sin = qwqdsp_simd_element::PackOps::Sin(reflections_[1]);
-            scatter_cos = qwqdsp_simd_element::PackOps::Cos(reflections_[1]);
-            SimdType scatter2_ina_l = scatter_outb_l;
-            SimdType scatter2_inb_l = qwqdsp_simd_element::PackOps::Shuffle<1, 2, 3, 0>(scatter_outa_l);
-            SimdType scatter2_ina_r = scatter_outb_r;
-            SimdType scatter2_inb_r = qwqdsp_simd_element::PackOps::Shuffle<1, 2, 3, 0>(scatter_outa_r);
-            // [1, 3, 5, 7]
-            scatter_outa_l = scatter_cos * scatter2_ina_l - scatter_sin * scatter2_inb_l;
-            scatter_outa_r = scatter_cos * scatter2_ina_r - scatter_sin * scatter2_inb_r;
-            // [2, 4, 6, 0]
-            scatter_outb_l = scatter_sin * scatter2_ina_l + scatter_cos * scatter2_inb_l;
-            scatter_outb_r = scatter_sin * scatter2_ina_r + scatter_cos * scatter2_inb_r;
-
-            // shuffle output
-            SimdType pipe_a_l{
-                scatter_outb_l[3], scatter_outa_l[0], scatter_outb_l[0], scatter_outa_l[1]
-            };
-            SimdType pipe_b_l{
-                scatter_outb_l[1], scatter_outa_l[2], scatter_outb_l[2], scatter_outa_l[3]
-            };
-
-            SimdType pipe_a_r{
-                scatter_outb_r[3], scatter_outa_r[0], scatter_outb_r[0], scatter_outa_r[1]
-            };
-            SimdType pipe_b_r{
-                scatter_outb_r[1], scatter_outa_r[2], scatter_outb_r[2], scatter_outa_r[3]
-            };
-            
-            // write
-            fb_values_[0] = feedback_gain_[0] * pipe_a_l;
-            fb_values_[1] = feedback_gain_[1] * pipe_b_l;
-            fb_values_[2] = feedback_gain_[0] * pipe_a_r;
-            fb_values_[3] = feedback_gain_[1] * pipe_b_r;
-            left_ptr[i] = qwqdsp_simd_element::PackOps::ReduceAdd(output_l);
-            right_ptr[i] = qwqdsp_simd_element::PackOps::ReduceAdd(output_r);
+        if (process_arch_ == ProcessArch::kVector8) {
+            ProcessVec8(left_ptr, right_ptr, len);
+        }
+        else if (process_arch_ == ProcessArch::kVector4) {
+            ProcessVec4(left_ptr, right_ptr, len);
+        }
+        else {
+            // 不支持的CPU用默认编译选项处理
+            ProcessChannel(channels_[0], left_ptr, len);
+            ProcessChannel(channels_[1], right_ptr, len);
         }
     }
 
+    // 在vec4.cpp/vec8.cpp里定义，使用对应的编译选项
+    void ProcessVec4(float* left_ptr, float* right_ptr, size_t len) noexcept;
+    void ProcessVec8(float* left_ptr, float* right_ptr, size_t len) noexcept;
+
     void UpdateBasicParams() noexcept {
         // output mix volumes
-        for (size_t j = 0; j < kMonoContainerSize; ++j) {
-            for (size_t i = 0; i < SimdType::kSize; ++i) {
-                size_t const param_idx = j * SimdType::kSize + i;
-                float const db = mix_db[param_idx];
-                if (db < -60.0f) {
-                    output_volume_[j][i] = 0;
-                }
-                else {
-                    output_volume_[j][i] = qwqdsp::convert::Db2Gain(db);
-                }
+        for (size_t i = 0; i < kNumResonators; ++i) {
+            float const db = mix_db[i];
+            if (db < -60.0f) {
+                output_volume_[i] = 0;
+            }
+            else {
+                output_volume_[i] = qwqdsp::convert::Db2Gain(db);
             }
         }
 
         // update scatter matrix
-        for (size_t j = 0; j < kMonoContainerSize; ++j) {
-            for (size_t i = 0; i < SimdType::kSize; ++i) {
-                size_t const param_idx = j * SimdType::kSize + i;
-                reflections_[j][i] = norm_reflections[param_idx] * std::numbers::pi_v<float>;
-            }
+        // 第一级旋转 (0,1) (2,3) (4,5) (6,7)，第二级旋转 (1,2) (3,4) (5,6) (7,0)
+        constexpr size_t kNumPairs = kNumResonators / 2;
+        for (size_t p = 0; p < kNumPairs; ++p) {
+            float const w1 = norm_reflections[p] * std::numbers::pi_v<float>;
+            float const w2 = norm_reflections[p + kNumPairs] * std::numbers::pi_v<float>;
+            size_t const lo = 2 * p;
+            size_t const hi = 2 * p + 1;
+            size_t const next = (2 * p + 2) & (kNumResonators - 1);
+            scatter1_cos_[lo] = std::cos(w1);
+            scatter1_cos_[hi] = std::cos(w1);
+            scatter1_sin_[lo] = -std::sin(w1);
+            scatter1_sin_[hi] = std::sin(w1);
+            scatter2_cos_[hi] = std::cos(w2);
+            scatter2_cos_[next] = std::cos(w2);
+            scatter2_sin_[hi] = -std::sin(w2);
+            scatter2_sin_[next] = std::sin(w2);
         }
 
         // update damp filter
-        for (size_t j = 0; j < kMonoContainerSize; ++j) {
-            SimdType omega;
-            for (size_t i = 0; i < SimdType::kSize; ++i) {
-                size_t const param_idx = j * SimdType::kSize + i;
-                float const freq = qwqdsp::convert::Pitch2Freq(damp_pitch[param_idx]);
-                omega[i] = freq * std::numbers::pi_v<float> * 2 / fs_;
-                damp_highshelf_gain[j][i] = qwqdsp::convert::Db2Gain(damp_gain_db[param_idx]);
-            }
-            damp_highshelf_coeff[j] = qwqdsp_simd_element::OnePoleTPT<4>::ComputeCoeffs(omega);
+        SimdType omega;
+        for (size_t i = 0; i < kNumResonators; ++i) {
+            float const freq = qwqdsp::convert::Pitch2Freq(damp_pitch[i]);
+            omega[i] = freq * std::numbers::pi_v<float> * 2 / fs_;
+            damp_highshelf_gain[i] = qwqdsp::convert::Db2Gain(damp_gain_db[i]);
         }
+        damp_highshelf_coeff = qwqdsp_simd_element::OnePoleTPT<SimdType::kSize>::ComputeCoeffs(omega);
     }
 
     /**
@@ -325,61 +260,55 @@ public:
     * - Feedback gain (gain of the feedback path)
     */
     void UpdateAllPitches() noexcept {
-        for (size_t i = 0; i < kMonoContainerSize; ++i) {
-            SimdType omega;
-            SimdType loop_samples;
-            SimdType allpass_set_delay;
-            for (size_t j = 0; j < SimdType::kSize; ++j) {
-                size_t param_idx = i * SimdType::kSize + j;
-                float pitch = pitches[param_idx] + fine_tune[param_idx] / 100.0f;
-                if (polarity[param_idx]) {
-                    pitch += 12;
-                }
-                float const freq = qwqdsp::convert::Pitch2Freq(pitch);
-                omega[j] = freq * std::numbers::pi_v<float> / fs_;
-                loop_samples[j] = fs_ / freq;
-                allpass_set_delay[j] = loop_samples[j] * dispersion[param_idx] / (ThrianDispersion::kNumAPF + 0.1f);
+        SimdType omega;
+        SimdType loop_samples;
+        SimdType allpass_set_delay;
+        for (size_t i = 0; i < kNumResonators; ++i) {
+            float pitch = pitches[i] + fine_tune[i] / 100.0f;
+            if (polarity[i]) {
+                pitch += 12;
             }
-    
-            // update allpass filters
-            dispersion_[i].SetGroupDelay(allpass_set_delay);
-            dispersion_[i + kMonoContainerSize].SetGroupDelay(allpass_set_delay);
-            SimdType allpass_delay = dispersion_[i].GetPhaseDelay(omega);
-    
-            // remove allpass delays
-            SimdType delay_samples = loop_samples - allpass_delay;
-            delay_samples = qwqdsp_simd_element::PackOps::Max(delay_samples, SimdType::vBroadcast(0.0f));
-    
-            // process frac delays
-            delay_samples_[i] = thrian_interp_[i].SetDelay(delay_samples);
-            thrian_interp_[i + kMonoContainerSize].SetDelay(delay_samples);
-
-            // feedback decay
-            for (size_t j = 0; j < SimdType::kSize; ++j) {
-                size_t param_idx = i * SimdType::kSize + j;
-                float feedback_gain = 0;
-                if (decay_ms[param_idx] > 0.5f) {
-                    float const mul = -3.0f * loop_samples[j] / (fs_ * decay_ms[param_idx] / 1000.0f);
-                    feedback_gain = std::pow(10.0f, mul);
-                    feedback_gain = std::min(feedback_gain, 1.0f);
-                }
-                else {
-                    feedback_gain = 0;
-                }
-                if (polarity[param_idx]) {
-                    feedback_gain = -feedback_gain;
-                }
-                feedback_gain_[i][j] = feedback_gain;
+            float const freq = qwqdsp::convert::Pitch2Freq(pitch);
+            omega[i] = freq * std::numbers::pi_v<float> / fs_;
+            loop_samples[i] = fs_ / freq;
+            allpass_set_delay[i] = loop_samples[i] * dispersion[i] / (ThrianDispersion::kNumAPF + 0.1f);
+        }
+
+        // update allpass filters
+        for (auto& c : channels_) {
+            c.dispersion.SetGroupDelay(allpass_set_delay);
+        }
+        SimdType allpass_delay = channels_[0].dispersion.GetPhaseDelay(omega);
+
+        // remove allpass delays
+        SimdType delay_samples = loop_samples - allpass_delay;
+        delay_samples = qwqdsp_simd_element::PackOps::Max(delay_samples, SimdType::vBroadcast(0.0f));
+
+        // process frac delays
+        delay_samples_ = channels_[0].thrian_interp.SetDelay(delay_samples);
+        channels_[1].thrian_interp.SetDelay(delay_samples);
+
+        // feedback decay
+        for (size_t i = 0; i < kNumResonators; ++i) {
+            float feedback_gain = 0;
+            if (decay_ms[i] > 0.5f) {
+                float const mul = -3.0f * loop_samples[i] / (fs_ * decay_ms[i] / 1000.0f);
+                feedback_gain = std::pow(10.0f, mul);
+                feedback_gain = std::min(feedback_gain, 1.0f);
+            }
+            else {
+                feedback_gain = 0;
+            }
+            if (polarity[i]) {
+                feedback_gain = -feedback_gain;
             }
+            feedback_gain_[i] = feedback_gain;
         }
     }
 
     void NoteOn(size_t idx, float pitch, float velocity) noexcept {
-        size_t const simd_idx = idx / SimdType::kSize;
-        size_t const scalar_idx = idx & (SimdType::kSize - 1);
-
         pitches[idx] = pitch;
-        input_volume_[simd_idx][scalar_idx] = velocity;
+        input_volume_[idx] = velocity;
         pitch = pitches[idx] + fine_tune[idx] / 100.0f;
         if (polarity[idx]) {
             pitch += 12;
@@ -390,17 +319,18 @@ public:
         float const allpass_set_delay = loop_samples * dispersion[idx] / (ThrianDispersion::kNumAPF + 0.1f);
 
         // update allpass filters
-        dispersion_[simd_idx].SetGroupDelay(scalar_idx, allpass_set_delay);
-        dispersion_[simd_idx + kMonoContainerSize].SetGroupDelay(scalar_idx, allpass_set_delay);
-        float allpass_delay = dispersion_[simd_idx].GetPhaseDelay(scalar_idx, omega);
+        for (auto& c : channels_) {
+            c.dispersion.SetGroupDelay(idx, allpass_set_delay);
+        }
+        float allpass_delay = channels_[0].dispersion.GetPhaseDelay(idx, omega);
 
         // remove allpass delays
         float delay_samples = loop_samples - allpass_delay;
         delay_samples = std::max(delay_samples, 0.0f);
 
         // process frac delays
-        delay_samples_[simd_idx][scalar_idx] = thrian_interp_[simd_idx].SetDelay(scalar_idx, delay_samples);
-        thrian_interp_[simd_idx + kMonoContainerSize].SetDelay(scalar_idx, delay_samples);
+        delay_samples_[idx] = channels_[0].thrian_interp.SetDelay(idx, delay_samples);
+        channels_[1].thrian_interp.SetDelay(idx, delay_samples);
 
         // feedback decay
         float feedback_gain = 0;
@@ -415,17 +345,32 @@ public:
         if (polarity[idx]) {
             feedback_gain = -feedback_gain;
         }
-        feedback_gain_[simd_idx][scalar_idx] = feedback_gain;
+        feedback_gain_[idx] = feedback_gain;
     }
 
     void TrunOnAllInput(float v) noexcept {
-        std::ranges::fill(input_volume_, SimdType::vBroadcast(v));
+        input_volume_.Broadcast(v);
     }
 
+    /**
+     * @param idx PolyphonyManager::noteOff没有找到复音时是kNumResonators，忽略
+     */
     void Noteoff(size_t idx) noexcept {
-        size_t simd_idx = idx / SimdType::kSize;
-        size_t scalar_idx = idx & (SimdType::kSize - 1);
-        input_volume_[simd_idx][scalar_idx] = 0;
+        if (idx < kNumResonators) {
+            input_volume_[idx] = 0;
+        }
+    }
+
+    // -------------------- lookup --------------------
+    ProcessArch GetProcessArch() const noexcept {
+        return process_arch_;
+    }
+
+    /**
+     * @param channel 0:left 1:right
+     */
+    bool IsSleeping(size_t channel) const noexcept {
+        return channels_[channel].sleeping;
     }
 
     // -------------------- params --------------------
@@ -440,33 +385,123 @@ public:
     std::array<float, kNumResonators> norm_reflections{};
     float dry{};
 private:
-    SimdType ReadFeedback(uint32_t idx, uint32_t wpos, uint32_t delay_idx) noexcept {
-        auto rpos = qwqdsp_simd_element::PackUint32<4>::vBroadcast(wpos + delay_mask_) - delay_samples_[delay_idx];
-        rpos &= qwqdsp_simd_element::PackUint32<4>::vBroadcast(delay_mask_);
+    // 原来每个声道有两个4通道容器，dry在每个通道上各加一次，这里保持原来的响度
+    static constexpr float kDryScale = 4.0f;
+
+    struct Channel {
+        std::vector<SimdType> delay_buffer;
+        uint32_t delay_wpos{};
+        TunningFilter thrian_interp;
+        ThrianDispersion dispersion;
+        qwqdsp_simd_element::OnePoleTPT<SimdType::kSize> damp;
+        qwqdsp_simd_element::OnePoleTPT<SimdType::kSize> dc_blocker;
+        SimdType fb_value{};
+        // 连续静音的样本数，超过延迟线长度时整条延迟线都已经是静音
+        size_t quiet_samples{};
+        bool sleeping{true};
+
+        void Reset() noexcept {
+            delay_wpos = 0;
+            std::ranges::fill(delay_buffer, SimdType{});
+            thrian_interp.Reset();
+            dispersion.Reset();
+            damp.Reset();
+            dc_blocker.Reset();
+            fb_value = SimdType{};
+            quiet_samples = 0;
+            sleeping = true;
+        }
+    };
+
+    QWQDSP_FORCE_INLINE
+    void ProcessChannel(Channel& c, float* ptr, size_t len) noexcept {
+        float const dry_gain = dry * kDryScale;
+
+        if (c.sleeping) {
+            float input_peak = 0;
+            for (size_t i = 0; i < len; ++i) {
+                input_peak = std::max(input_peak, std::abs(ptr[i]));
+            }
+            float max_input_volume = 0;
+            for (size_t i = 0; i < SimdType::kSize; ++i) {
+                max_input_volume = std::max(max_input_volume, input_volume_[i]);
+            }
+            if (input_peak * max_input_volume < kSilenceThreshold) {
+                for (size_t i = 0; i < len; ++i) {
+                    ptr[i] *= dry_gain;
+                }
+                return;
+            }
+            c.sleeping = false;
+        }
+
+        SimdType written_peak{};
+        for (size_t i = 0; i < len; ++i) {
+            // input
+            float const x = ptr[i];
+            SimdType const input = input_volume_ * x + c.fb_value;
+            float const output = x * dry_gain + qwqdsp_simd_element::PackOps::ReduceAdd(c.fb_value * output_volume_);
+            written_peak = qwqdsp_simd_element::PackOps::Max(written_peak, qwqdsp_simd_element::PackOps::Abs(input));
+
+            // delayline
+            c.delay_buffer[c.delay_wpos] = input;
+            c.delay_wpos = (c.delay_wpos + 1) & delay_mask_;
+            auto delay_out = ReadFeedback(c);
+
+            // dispersion and damp
+            delay_out = c.dispersion.Tick(delay_out);
+            delay_out = c.damp.TickHighshelf(delay_out, damp_highshelf_coeff, damp_highshelf_gain);
+            delay_out = c.dc_blocker.TickHighpass(delay_out, SimdType::vBroadcast(0.0005f));
+
+            // scatter signals
+            delay_out = scatter1_cos_ * delay_out
+                + scatter1_sin_ * qwqdsp_simd_element::PackOps::Shuffle<1, 0, 3, 2, 5, 4, 7, 6>(delay_out);
+            delay_out = scatter2_cos_ * delay_out
+                + scatter2_sin_ * qwqdsp_simd_element::PackOps::Shuffle<7, 2, 1, 4, 3, 6, 5, 0>(delay_out);
+
+            // write
+            c.fb_value = feedback_gain_ * delay_out;
+            ptr[i] = output;
+        }
+
+        float peak = 0;
+        for (size_t i = 0; i < SimdType::kSize; ++i) {
+            peak = std::max(peak, written_peak[i]);
+        }
+        if (peak < kSilenceThreshold) {
+            c.quiet_samples += len;
+            if (c.quiet_samples > delay_mask_) {
+                c.Reset();
+            }
+        }
+        else {
+            c.quiet_samples = 0;
+        }
+    }
+
+    QWQDSP_FORCE_INLINE
+    SimdType ReadFeedback(Channel& c) noexcept {
+        auto rpos = SimdUintType::vBroadcast(c.delay_wpos + delay_mask_) - delay_samples_;
+        rpos &= SimdUintType::vBroadcast(delay_mask_);
         SimdType delay_output;
         for (size_t k = 0; k < SimdType::kSize; ++k) {
-            delay_output[k] = delay_buffer_[idx][static_cast<size_t>(rpos[k])][k];
+            delay_output[k] = c.delay_buffer[static_cast<size_t>(rpos[k])][k];
         }
-        return thrian_interp_[idx].Tick(delay_output);
+        return c.thrian_interp.Tick(delay_output);
     }
 
-    static constexpr size_t kContainerSize = 2 * kNumResonators / SimdType::kSize;
-    static constexpr size_t kMonoContainerSize = kNumResonators / SimdType::kSize;
-
-    std::array<std::vector<SimdType>, kContainerSize> delay_buffer_;
-    uint32_t delay_wpos_{};
+    ProcessArch process_arch_{};
+    std::array<Channel, 2> channels_;
     uint32_t delay_mask_{};
-    std::array<TunningFilter, kContainerSize> thrian_interp_;
-    std::array<ThrianDispersion, kContainerSize> dispersion_;
-    std::array<qwqdsp_simd_element::OnePoleTPT<4>, kContainerSize> damp_;
-    std::array<qwqdsp_simd_element::OnePoleTPT<4>, kContainerSize> dc_blocker;
-    std::array<SimdType, kMonoContainerSize + 1> input_volume_{};
-    std::array<SimdType, kMonoContainerSize> output_volume_{};
-    std::array<SimdType, kMonoContainerSize> reflections_{};
-    std::array<SimdType, kMonoContainerSize> damp_highshelf_coeff{};
-    std::array<SimdType, kMonoContainerSize> damp_highshelf_gain{};
-    std::array<SimdType, kMonoContainerSize> feedback_gain_{};
-    std::array<qwqdsp_simd_element::PackUint32<4>, kMonoContainerSize> delay_samples_{};
-    std::array<SimdType, kContainerSize> fb_values_{};
+    SimdType input_volume_{};
+    SimdType output_volume_{};
+    SimdType scatter1_cos_{};
+    SimdType scatter1_sin_{};
+    SimdType scatter2_cos_{};
+    SimdType scatter2_sin_{};
+    SimdType damp_highshelf_coeff{};
+    SimdType damp_highshelf_gain{};
+    SimdType feedback_gain_{};
+    SimdUintType delay_samples_{};
     float fs_{};
 };
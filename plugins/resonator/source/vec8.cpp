@@ -0,0 +1,6 @@
+#include "resonator.hpp"
+
+void Resonator::ProcessVec8(float* left_ptr, float* right_ptr, size_t len) noexcept {
+    ProcessChannel(channels_[0], left_ptr, len);
+    ProcessChannel(channels_[1], right_ptr, len);
+}
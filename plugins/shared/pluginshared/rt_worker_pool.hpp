@@ -0,0 +1,151 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <juce_core/juce_core.h>
+
+namespace pluginshared {
+/**
+ * @brief 音频线程把一份工作拆成几块交给预先创建的实时线程
+ *        热路径上没有锁也不分配内存，worker先自旋一段时间再睡眠
+ *        第0块总是由调用者自己执行，Run返回时所有块都已完成
+ */
+class RTWorkerPool {
+public:
+    static constexpr size_t kMaxWorkers = 7;
+    static constexpr int kSpinCount = 4096;
+
+    /**
+     * @param ctx 调用Run时传入的指针
+     * @param part 第几块，0 ~ num_parts-1
+     */
+    using Task = void(*)(void* ctx, size_t part);
+
+    ~RTWorkerPool() {
+        Stop();
+    }
+
+    /**
+     * @brief 不在音频线程调用，启动失败的worker会被忽略
+     */
+    void Start(size_t num_workers) {
+        Stop();
+        num_workers = std::min(num_workers, kMaxWorkers);
+        for (size_t i = 0; i < num_workers; ++i) {
+            auto worker = std::make_unique<Worker>(*this);
+            bool started = worker->startRealtimeThread(juce::Thread::RealtimeOptions{});
+            if (!started) {
+                started = worker->startThread(juce::Thread::Priority::highest);
+            }
+            if (!started) {
+                break;
+            }
+            workers_[num_workers_++] = std::move(worker);
+        }
+    }
+
+    void Stop() {
+        for (size_t i = 0; i < num_workers_; ++i) {
+            auto& worker = *workers_[i];
+            worker.signalThreadShouldExit();
+            worker.Wake();
+            worker.stopThread(-1);
+            workers_[i] = nullptr;
+        }
+        num_workers_ = 0;
+    }
+
+    size_t GetNumWorkers() const noexcept {
+        return num_workers_;
+    }
+
+    /**
+     * @brief 只在音频线程调用，不可重入
+     * @param num_parts 超过GetNumWorkers()+1的部分由调用者串行执行
+     */
+    void Run(Task task, void* ctx, size_t num_parts) noexcept {
+        size_t const num_dispatch = std::min(num_parts - 1, num_workers_);
+        task_ = task;
+        ctx_ = ctx;
+        remain_.store(num_dispatch, std::memory_order_relaxed);
+        for (size_t i = 0; i < num_dispatch; ++i) {
+            workers_[i]->Dispatch(i + 1);
+        }
+
+        task(ctx, 0);
+        for (size_t i = num_dispatch + 1; i < num_parts; ++i) {
+            task(ctx, i);
+        }
+
+        while (remain_.load(std::memory_order_acquire) != 0) {
+            std::this_thread::yield();
+        }
+    }
+
+private:
+    class Worker : public juce::Thread {
+    public:
+        explicit Worker(RTWorkerPool& pool)
+            : juce::Thread("rt worker")
+            , pool_(pool)
+        {}
+
+        void Dispatch(size_t part) noexcept {
+            part_ = part;
+            generation_.fetch_add(1, std::memory_order_seq_cst);
+            if (parked_.load(std::memory_order_seq_cst)) {
+                generation_.notify_one();
+            }
+        }
+
+        void Wake() noexcept {
+            generation_.fetch_add(1, std::memory_order_seq_cst);
+            generation_.notify_one();
+        }
+
+        void run() override {
+            juce::ScopedNoDenormals no_denormals;
+            uint32_t seen = generation_.load(std::memory_order_acquire);
+            for (;;) {
+                // 自旋等待下一个block，等不到再睡眠
+                uint32_t now = generation_.load(std::memory_order_acquire);
+                for (int i = 0; i < kSpinCount && now == seen; ++i) {
+                    std::this_thread::yield();
+                    now = generation_.load(std::memory_order_acquire);
+                }
+                if (now == seen) {
+                    if (threadShouldExit()) {
+                        return;
+                    }
+                    parked_.store(true, std::memory_order_seq_cst);
+                    generation_.wait(seen, std::memory_order_seq_cst);
+                    parked_.store(false, std::memory_order_relaxed);
+                    now = generation_.load(std::memory_order_acquire);
+                }
+                seen = now;
+                if (threadShouldExit()) {
+                    return;
+                }
+
+                pool_.task_(pool_.ctx_, part_);
+                pool_.remain_.fetch_sub(1, std::memory_order_release);
+            }
+        }
+
+    private:
+        RTWorkerPool& pool_;
+        std::atomic<uint32_t> generation_{};
+        std::atomic<bool> parked_{};
+        size_t part_{};
+    };
+
+    std::array<std::unique_ptr<Worker>, kMaxWorkers> workers_;
+    size_t num_workers_{};
+    Task task_{};
+    void* ctx_{};
+    std::atomic<size_t> remain_{};
+};
+}
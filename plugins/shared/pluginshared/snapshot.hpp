@@ -0,0 +1,118 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+namespace pluginshared {
+/**
+ * @brief 单写单读的无锁三缓冲
+ *        写者永远不会等待读者，读者只会拿到最后一次完整写入的数据
+ *        通常DSP写、UI读，UI不需要再锁音频回调
+ */
+template<class T>
+class TripleBuffer {
+public:
+    /**
+     * @brief 写线程独占的缓冲区，里面是更早之前写入的旧数据
+     */
+    T& BeginWrite() noexcept {
+        return buffers_[write_];
+    }
+
+    /**
+     * @brief 发布BeginWrite返回的缓冲区
+     */
+    void EndWrite() noexcept {
+        write_ = middle_.exchange(write_ | kDirtyBit, std::memory_order_acq_rel) & kIndexMask;
+    }
+
+    /**
+     * @return 没有新数据时返回nullptr
+     */
+    T const* Read() noexcept {
+        if ((middle_.load(std::memory_order_relaxed) & kDirtyBit) == 0) {
+            return nullptr;
+        }
+        read_ = middle_.exchange(read_, std::memory_order_acq_rel) & kIndexMask;
+        return &buffers_[read_];
+    }
+
+    /**
+     * @brief 读线程最后一次Read到的数据，还没写入过时是T{}
+     */
+    T const& Current() const noexcept {
+        return buffers_[read_];
+    }
+private:
+    static constexpr uint32_t kIndexMask = 3;
+    static constexpr uint32_t kDirtyBit = 4;
+
+    std::array<T, 3> buffers_{};
+    uint32_t write_{0};
+    std::atomic<uint32_t> middle_{1};
+    uint32_t read_{2};
+};
+
+/**
+ * @brief 定长数组，size为有效长度
+ */
+template<class T, size_t kCapacity>
+struct SnapshotArray {
+    std::array<T, kCapacity> data{};
+    size_t size{};
+
+    std::span<const T> View() const noexcept {
+        return {data.data(), size};
+    }
+};
+
+/**
+ * @brief 变长数组(不超过kCapacity)的快照，用来给UI看增益、系数、包络等
+ */
+template<class T, size_t kCapacity>
+class ArraySnapshot {
+public:
+    static constexpr size_t kMaxSize = kCapacity;
+
+    /**
+     * @brief 写线程调用，超过kCapacity的部分被丢弃
+     */
+    void Publish(std::span<const T> values) noexcept {
+        auto& buffer = slot_.BeginWrite();
+        buffer.size = std::min(values.size(), kCapacity);
+        std::copy_n(values.begin(), buffer.size, buffer.data.begin());
+        slot_.EndWrite();
+    }
+
+    /**
+     * @brief 写线程调用，直接在快照里填数据，避免额外的复制
+     */
+    template<class Func>
+    void PublishWith(size_t size, Func&& fill) noexcept {
+        auto& buffer = slot_.BeginWrite();
+        buffer.size = std::min(size, kCapacity);
+        fill(std::span<T>{buffer.data.data(), buffer.size});
+        slot_.EndWrite();
+    }
+
+    /**
+     * @brief 读线程调用，取走最新的数据
+     * @return 有新数据时返回true
+     */
+    bool Update() noexcept {
+        return slot_.Read() != nullptr;
+    }
+
+    /**
+     * @brief 读线程最后一次Update到的数据
+     */
+    std::span<const T> View() const noexcept {
+        return slot_.Current().View();
+    }
+private:
+    TripleBuffer<SnapshotArray<T, kCapacity>> slot_;
+};
+}
@@ -0,0 +1,297 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+
+namespace pluginshared {
+/**
+ * @brief 固定容量的复音分配器，音频线程上不分配内存，所有操作都是O(1)
+ *        活动的复音按触发顺序串成侵入式双向链表(LRU)，从旧到新遍历
+ *        按住同一个音高的复音另外串成链表，通过128项的表查找
+ */
+template<size_t kMaxVoices>
+class VoiceAllocator {
+public:
+    static_assert(kMaxVoices > 0 && kMaxVoices <= 64);
+
+    static constexpr uint32_t kInvalid = static_cast<uint32_t>(kMaxVoices);
+    static constexpr size_t kNumNotes = 128;
+
+    class Iterator {
+    public:
+        Iterator(VoiceAllocator const& a, uint32_t voice) noexcept
+            : a_(&a), voice_(voice) {}
+
+        uint32_t operator*() const noexcept {
+            return voice_;
+        }
+
+        Iterator& operator++() noexcept {
+            voice_ = a_->next_[voice_];
+            return *this;
+        }
+
+        bool operator!=(Iterator const& other) const noexcept {
+            return voice_ != other.voice_;
+        }
+    private:
+        VoiceAllocator const* a_;
+        uint32_t voice_;
+    };
+
+    VoiceAllocator() noexcept {
+        SetNumVoices(kMaxVoices);
+    }
+
+    /**
+     * @brief 修改可以使用的复音数，所有复音都被释放
+     */
+    void SetNumVoices(size_t num_voices) noexcept {
+        num_voices_ = std::min(num_voices, kMaxVoices);
+        Clear();
+    }
+
+    size_t GetNumVoices() const noexcept {
+        return num_voices_;
+    }
+
+    /**
+     * @brief 释放所有复音
+     */
+    void Clear() noexcept {
+        free_mask_ = num_voices_ == 64 ? ~uint64_t{} : (uint64_t{1} << num_voices_) - 1;
+        oldest_ = kInvalid;
+        newest_ = kInvalid;
+        num_active_ = 0;
+        note_head_.fill(kInvalid);
+        note_tail_.fill(kInvalid);
+        notes_.fill(-1);
+        active_.fill(false);
+    }
+
+    // -------------------- allocate --------------------
+    /**
+     * @return 编号最小的空闲复音，没有时返回kInvalid
+     */
+    uint32_t FindFree() const noexcept {
+        if (free_mask_ == 0) {
+            return kInvalid;
+        }
+        return static_cast<uint32_t>(std::countr_zero(free_mask_));
+    }
+
+    bool IsFree(uint32_t voice) const noexcept {
+        return voice < kMaxVoices && ((free_mask_ >> voice) & 1) != 0;
+    }
+
+    /**
+     * @brief 把复音(空闲或者已经活动)设为最新的，并按住note
+     * @param note -1表示不按住任何音高
+     */
+    void Activate(uint32_t voice, int note) noexcept {
+        assert(voice < num_voices_);
+        if (active_[voice]) {
+            UnlinkOrder(voice);
+        }
+        else {
+            free_mask_ &= ~(uint64_t{1} << voice);
+            active_[voice] = true;
+            ++num_active_;
+        }
+        LinkOrderNewest(voice);
+        Retarget(voice, note);
+    }
+
+    /**
+     * @brief 活动的复音换一个音高，不改变它在LRU里的位置
+     */
+    void Retarget(uint32_t voice, int note) noexcept {
+        assert(active_[voice]);
+        UnlinkNote(voice);
+        LinkNote(voice, note);
+    }
+
+    /**
+     * @brief 松开音高，复音仍然是活动的(例如还在release)
+     */
+    void DetachNote(uint32_t voice) noexcept {
+        UnlinkNote(voice);
+    }
+
+    /**
+     * @brief 复音回到空闲状态
+     */
+    void Free(uint32_t voice) noexcept {
+        if (!active_[voice]) {
+            return;
+        }
+        UnlinkNote(voice);
+        UnlinkOrder(voice);
+        active_[voice] = false;
+        --num_active_;
+        free_mask_ |= uint64_t{1} << voice;
+    }
+
+    // -------------------- lookup --------------------
+    bool IsActive(uint32_t voice) const noexcept {
+        return voice < kMaxVoices && active_[voice];
+    }
+
+    bool Empty() const noexcept {
+        return num_active_ == 0;
+    }
+
+    size_t NumActive() const noexcept {
+        return num_active_;
+    }
+
+    /**
+     * @return 没有活动复音时返回kInvalid
+     */
+    uint32_t Oldest() const noexcept {
+        return oldest_;
+    }
+
+    uint32_t Newest() const noexcept {
+        return newest_;
+    }
+
+    /**
+     * @return LRU里更新的一个复音，已经是最新时返回kInvalid
+     */
+    uint32_t Next(uint32_t voice) const noexcept {
+        return next_[voice];
+    }
+
+    /**
+     * @return 没有按住音高时返回-1
+     */
+    int GetNote(uint32_t voice) const noexcept {
+        return notes_[voice];
+    }
+
+    /**
+     * @return 按住note的最早触发的复音，没有时返回kInvalid
+     */
+    uint32_t FindOldest(int note) const noexcept {
+        if (!IsValidNote(note)) {
+            return kInvalid;
+        }
+        return note_head_[static_cast<size_t>(note)];
+    }
+
+    /**
+     * @brief 从旧到新遍历按住note的复音，func里可以DetachNote/Free当前的复音
+     */
+    template<class Func>
+    void ForEachVoiceOfNote(int note, Func&& func) {
+        uint32_t voice = FindOldest(note);
+        while (voice != kInvalid) {
+            uint32_t const next = note_next_[voice];
+            func(voice);
+            voice = next;
+        }
+    }
+
+    Iterator begin() const noexcept {
+        return {*this, oldest_};
+    }
+
+    Iterator end() const noexcept {
+        return {*this, kInvalid};
+    }
+private:
+    static bool IsValidNote(int note) noexcept {
+        return note >= 0 && note < static_cast<int>(kNumNotes);
+    }
+
+    void LinkOrderNewest(uint32_t voice) noexcept {
+        prev_[voice] = newest_;
+        next_[voice] = kInvalid;
+        if (newest_ != kInvalid) {
+            next_[newest_] = voice;
+        }
+        else {
+            oldest_ = voice;
+        }
+        newest_ = voice;
+    }
+
+    void UnlinkOrder(uint32_t voice) noexcept {
+        uint32_t const prev = prev_[voice];
+        uint32_t const next = next_[voice];
+        if (prev != kInvalid) {
+            next_[prev] = next;
+        }
+        else {
+            oldest_ = next;
+        }
+        if (next != kInvalid) {
+            prev_[next] = prev;
+        }
+        else {
+            newest_ = prev;
+        }
+    }
+
+    void LinkNote(uint32_t voice, int note) noexcept {
+        if (!IsValidNote(note)) {
+            notes_[voice] = -1;
+            return;
+        }
+        size_t const idx = static_cast<size_t>(note);
+        notes_[voice] = note;
+        note_prev_[voice] = note_tail_[idx];
+        note_next_[voice] = kInvalid;
+        if (note_tail_[idx] != kInvalid) {
+            note_next_[note_tail_[idx]] = voice;
+        }
+        else {
+            note_head_[idx] = voice;
+        }
+        note_tail_[idx] = voice;
+    }
+
+    void UnlinkNote(uint32_t voice) noexcept {
+        int const note = notes_[voice];
+        if (note < 0) {
+            return;
+        }
+        size_t const idx = static_cast<size_t>(note);
+        uint32_t const prev = note_prev_[voice];
+        uint32_t const next = note_next_[voice];
+        if (prev != kInvalid) {
+            note_next_[prev] = next;
+        }
+        else {
+            note_head_[idx] = next;
+        }
+        if (next != kInvalid) {
+            note_prev_[next] = prev;
+        }
+        else {
+            note_tail_[idx] = prev;
+        }
+        notes_[voice] = -1;
+    }
+
+    size_t num_voices_{};
+    size_t num_active_{};
+    uint64_t free_mask_{};
+    // LRU, oldest_ -> next_ -> ... -> newest_
+    uint32_t oldest_{kInvalid};
+    uint32_t newest_{kInvalid};
+    std::array<uint32_t, kMaxVoices> prev_{};
+    std::array<uint32_t, kMaxVoices> next_{};
+    std::array<bool, kMaxVoices> active_{};
+    // 同一个音高的复音，按触发顺序
+    std::array<int, kMaxVoices> notes_{};
+    std::array<uint32_t, kMaxVoices> note_prev_{};
+    std::array<uint32_t, kMaxVoices> note_next_{};
+    std::array<uint32_t, kNumNotes> note_head_{};
+    std::array<uint32_t, kNumNotes> note_tail_{};
+};
+}
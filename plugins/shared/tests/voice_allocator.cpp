@@ -0,0 +1,165 @@
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include "pluginshared/voice_allocator.hpp"
+
+// 满复音快速按下/松开，大部分按下走偷取最旧复音的路径
+// 和一个直接扫描的参考实现逐个事件对比，最后测一下每个事件的平均耗时
+
+static constexpr size_t kMaxVoices = 32;
+using Allocator = pluginshared::VoiceAllocator<kMaxVoices>;
+
+struct Reference {
+    explicit Reference(size_t num_voices)
+        : notes(num_voices, -1)
+        , stamps(num_voices, 0)
+        , active(num_voices, false) {}
+
+    uint32_t FindFree() const {
+        for (size_t i = 0; i < active.size(); ++i) {
+            if (!active[i]) {
+                return static_cast<uint32_t>(i);
+            }
+        }
+        return Allocator::kInvalid;
+    }
+
+    uint32_t Oldest() const {
+        return order.empty() ? Allocator::kInvalid : order.front();
+    }
+
+    uint32_t FindOldest(int note) const {
+        uint32_t ret = Allocator::kInvalid;
+        uint64_t best = UINT64_MAX;
+        for (size_t i = 0; i < notes.size(); ++i) {
+            if (active[i] && notes[i] == note && stamps[i] < best) {
+                best = stamps[i];
+                ret = static_cast<uint32_t>(i);
+            }
+        }
+        return ret;
+    }
+
+    void Activate(uint32_t voice, int note) {
+        std::erase(order, voice);
+        order.push_back(voice);
+        active[voice] = true;
+        notes[voice] = note;
+        stamps[voice] = ++clock;
+    }
+
+    void DetachNote(uint32_t voice) {
+        notes[voice] = -1;
+    }
+
+    void Free(uint32_t voice) {
+        std::erase(order, voice);
+        active[voice] = false;
+        notes[voice] = -1;
+    }
+
+    std::vector<uint32_t> order;
+    std::vector<int> notes;
+    std::vector<uint64_t> stamps;
+    std::vector<bool> active;
+    uint64_t clock{};
+};
+
+static bool Same(Allocator const& a, Reference const& r) {
+    if (a.NumActive() != r.order.size()) {
+        return false;
+    }
+    size_t i = 0;
+    for (uint32_t voice : a) {
+        if (i >= r.order.size() || voice != r.order[i] || a.GetNote(voice) != r.notes[voice]) {
+            return false;
+        }
+        ++i;
+    }
+    for (int note = 0; note < 128; ++note) {
+        if (a.FindOldest(note) != r.FindOldest(note)) {
+            return false;
+        }
+    }
+    return a.FindFree() == r.FindFree();
+}
+
+/**
+ * @return 偷取的次数，出错时返回SIZE_MAX
+ */
+static size_t Stress(Allocator& a, Reference* r, size_t num_events, uint32_t seed) {
+    std::mt19937 rng{seed};
+    // 音域很窄，同一个音高经常被重复按下
+    std::uniform_int_distribution<int> note_dist{48, 60};
+    std::uniform_int_distribution<int> action_dist{0, 9};
+    size_t num_steal = 0;
+
+    for (size_t n = 0; n < num_events; ++n) {
+        int const action = action_dist(rng);
+        int const note = note_dist(rng);
+        if (action < 6) {
+            // note on
+            uint32_t voice = a.FindFree();
+            if (voice == Allocator::kInvalid) {
+                voice = a.Oldest();
+                ++num_steal;
+            }
+            a.Activate(voice, note);
+            if (r != nullptr) {
+                r->Activate(voice, note);
+            }
+        }
+        else if (action < 9) {
+            // note off，复音进入release
+            uint32_t const voice = a.FindOldest(note);
+            if (voice != Allocator::kInvalid) {
+                a.DetachNote(voice);
+                if (r != nullptr) {
+                    r->DetachNote(voice);
+                }
+            }
+        }
+        else {
+            // release结束
+            uint32_t const voice = a.Oldest();
+            if (voice != Allocator::kInvalid && a.GetNote(voice) < 0) {
+                a.Free(voice);
+                if (r != nullptr) {
+                    r->Free(voice);
+                }
+            }
+        }
+
+        if (r != nullptr && !Same(a, *r)) {
+            std::printf("mismatch at event %zu\n", n);
+            return SIZE_MAX;
+        }
+    }
+    return num_steal;
+}
+
+int main() {
+    for (size_t num_voices : {size_t{1}, size_t{8}, kMaxVoices}) {
+        Allocator a;
+        a.SetNumVoices(num_voices);
+        Reference r{num_voices};
+        size_t const num_steal = Stress(a, &r, 200000, static_cast<uint32_t>(num_voices));
+        if (num_steal == SIZE_MAX) {
+            return 1;
+        }
+        std::printf("voices %zu: ok, %zu steals\n", num_voices, num_steal);
+    }
+
+    Allocator a;
+    constexpr size_t kNumEvents = 10000000;
+    auto const begin = std::chrono::steady_clock::now();
+    size_t const num_steal = Stress(a, nullptr, kNumEvents, 1);
+    auto const end = std::chrono::steady_clock::now();
+    double const ns = std::chrono::duration<double, std::nano>(end - begin).count();
+    std::printf("%zu events, %zu steals, %.2f ns/event\n", kNumEvents, num_steal, ns / static_cast<double>(kNumEvents));
+}
@@ -7,10 +7,11 @@
 // ---------------------------------------- time prev ----------------------------------------
 
 void TimeView::UpdateGui() {
-    std::ranges::copy(p_.dsp_.GetUsingCoeffs(), coeff_buffer_.begin());
+    auto const coeffs = p_.gui_coeffs_.View();
+    std::ranges::copy(coeffs, coeff_buffer_.begin());
 
-    if (p_.dsp_param_.fir_coeff_len != 0) {
-        coeff_buffer_[p_.dsp_param_.fir_coeff_len] = coeff_buffer_[p_.dsp_param_.fir_coeff_len - 1];
+    if (!coeffs.empty()) {
+        coeff_buffer_[coeffs.size()] = coeff_buffer_[coeffs.size() - 1];
     }
     repaint();
 }
@@ -101,12 +102,13 @@ void TimeView::mouseUp(const juce::MouseEvent& e) {
 }
 
 void TimeView::SendCoeffs() {
+    p_.dsp_param_.custom_coeffs_snapshot_.Publish(p_.dsp_param_.custom_coeffs_);
     p_.dsp_param_.is_using_custom_ = true;
     p_.dsp_param_.should_update_fir_ = true;
 }
 
 void TimeView::CopyCoeffesToCustom() {
-    std::ranges::copy(p_.dsp_.GetUsingCoeffs(), p_.dsp_param_.custom_coeffs_.begin());
+    std::ranges::copy(p_.gui_coeffs_.View(), p_.dsp_param_.custom_coeffs_.begin());
     std::ranges::copy(p_.dsp_param_.custom_coeffs_, coeff_buffer_.begin());
     repaint();
 }
@@ -349,6 +351,8 @@ SteepFlangerAudioProcessorEditor::SteepFlangerAudioProcessorEditor (SteepFlanger
 
     setSize(600, 264 + 30);
     custom_.setToggleState(p.dsp_param_.is_using_custom_, juce::sendNotificationSync);
+    p_.gui_coeffs_.Update();
+    UpdateGui();
     startTimerHz(30);
 }
 
@@ -448,7 +452,7 @@ void SteepFlangerAudioProcessorEditor::resized() {
 }
 
 void SteepFlangerAudioProcessorEditor::timerCallback() {
-    if (p_.dsp_.have_new_coeff_.exchange(false)) {
+    if (p_.gui_coeffs_.Update()) {
         UpdateGui();
     }
 }
@@ -222,13 +222,43 @@ SteepFlangerAudioProcessor::SteepFlangerAudioProcessor()
 
     value_tree_ = std::make_unique<juce::AudioProcessorValueTreeState>(*this, nullptr, "PARAMETERS", std::move(layout));
     preset_manager_ = std::make_unique<pluginshared::PresetManager>(*value_tree_, *this);
+
+    fir_design_thread_.startThread();
 }
 
 SteepFlangerAudioProcessor::~SteepFlangerAudioProcessor()
 {
+    fir_design_thread_.stopThread(-1);
     value_tree_ = nullptr;
 }
 
+void SteepFlangerAudioProcessor::UpdateFirCoeffs()
+{
+    juce::ScopedLock lock{fir_design_lock_};
+
+    param_listener_.HandleDirty();
+    if (!dsp_param_.should_update_fir_.exchange(false)) {
+        return;
+    }
+
+    fir_design_param_.cutoff = param_fir_cutoff_->get();
+    fir_design_param_.coeff_len = static_cast<size_t>(param_fir_coeff_len_->get());
+    fir_design_param_.side_lobe = param_fir_side_lobe_->get();
+    fir_design_param_.min_phase = param_fir_min_phase_->get();
+    fir_design_param_.highpass = param_fir_highpass_->get();
+    fir_design_param_.use_custom = dsp_param_.is_using_custom_.load();
+    dsp_param_.custom_coeffs_snapshot_.Update();
+    auto const custom_coeffs = dsp_param_.custom_coeffs_snapshot_.View();
+    std::ranges::copy(custom_coeffs, fir_design_param_.custom_coeffs.begin());
+    std::fill(fir_design_param_.custom_coeffs.begin() + static_cast<std::ptrdiff_t>(custom_coeffs.size()),
+              fir_design_param_.custom_coeffs.end(), 0.0f);
+
+    auto& coeffs = dsp_.coeff_slot_.BeginWrite();
+    fir_designer_.Design(fir_design_param_, coeffs);
+    gui_coeffs_.Publish({coeffs.coeffs.data(), coeffs.coeff_len});
+    dsp_.coeff_slot_.EndWrite();
+}
+
 //==============================================================================
 const juce::String SteepFlangerAudioProcessor::getName() const
 {
@@ -301,7 +331,9 @@ void SteepFlangerAudioProcessor::prepareToPlay (double sampleRate, int samplesPe
     
     dsp_.Init(static_cast<float>(sampleRate), 30.0f);
     dsp_.Reset();
+    // 第一个块就需要系数，这里同步设计一次
     dsp_param_.should_update_fir_ = true;
+    UpdateFirCoeffs();
 }
 
 void SteepFlangerAudioProcessor::releaseResources()
@@ -443,6 +475,7 @@ void SteepFlangerAudioProcessor::setStateInformation (const void* data, int size
                     dsp_param_.custom_spectral_gains[i] = static_cast<float>(item.getProperty("SPECTRAL", 0.0));
                     ++i;
                 }
+                dsp_param_.custom_coeffs_snapshot_.Publish(dsp_param_.custom_coeffs_);
                 dsp_param_.should_update_fir_ = true;
             }
         }
@@ -66,11 +66,43 @@ public:
     
     SteepFlanger dsp_;
     SteepFlangerParameter dsp_param_;
+    // 设计线程 -> UI，当前使用的FIR系数
+    pluginshared::ArraySnapshot<float, kMaxCoeffLen> gui_coeffs_;
 
     pluginshared::BpmSyncLFO<false> delay_lfo_state_;
     pluginshared::BpmSyncLFO<true> barber_lfo_state_;
 
+    /**
+     * @brief 处理参数变化，需要时重新设计FIR并发布给dsp_，不在音频线程调用
+     */
+    void UpdateFirCoeffs();
+
 private:
+    class FirDesignThread : public juce::Thread {
+    public:
+        static constexpr int kPollIntervalMs = 10;
+
+        explicit FirDesignThread(SteepFlangerAudioProcessor& p)
+            : juce::Thread("fir design")
+            , processor_(p)
+        {}
+
+        void run() override {
+            while (!threadShouldExit()) {
+                processor_.UpdateFirCoeffs();
+                wait(kPollIntervalMs);
+            }
+        }
+    private:
+        SteepFlangerAudioProcessor& processor_;
+    };
+
+    juce::CriticalSection fir_design_lock_;
+    SteepFlangerCoeffDesigner fir_designer_;
+    SteepFlangerFirParameter fir_design_param_{};
+    // 最后构造，最先停止
+    FirDesignThread fir_design_thread_{*this};
+
     //==============================================================================
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (SteepFlangerAudioProcessor)
 };
@@ -14,6 +14,8 @@
 #include "x86/sse4.1.h"
 #include "x86/avx.h"
 
+#include <pluginshared/snapshot.hpp>
+
 struct Complex32x4 {
     qwqdsp_simd_element::PackFloat<4> re;
     qwqdsp_simd_element::PackFloat<4> im;
@@ -30,6 +32,33 @@ struct Complex32x8 {
     constexpr Complex32x8& operator*=(const Complex32x8& a) noexcept;
 };
 
+static constexpr size_t kSIMDMaxCoeffLen = ((kMaxCoeffLen + 7) / 8) * 8;
+
+/**
+ * @brief 等间隔抽头 k*spacing 的抽头序号和当前间隔
+ *        间隔每个样本都可能变化，读取偏移在GetEvenTapsAfterPush里按组现算，不再整表重建
+ */
+struct Vec8EvenTaps {
+    static constexpr size_t kMaxGroups = kSIMDMaxCoeffLen / 8;
+
+    Vec8EvenTaps() noexcept {
+        for (size_t i = 0; i < kMaxGroups; ++i) {
+            for (size_t j = 0; j < 8; ++j) {
+                index[i][j] = static_cast<float>(i * 8 + j);
+            }
+        }
+    }
+
+    // 第i组是 8i ~ 8i+7 号抽头
+    std::array<qwqdsp_simd_element::PackFloat<8>, kMaxGroups> index;
+    qwqdsp_simd_element::PackFloat<8> spacing{};
+
+    QWQDSP_FORCE_INLINE
+    void SetSpacing(float new_spacing) noexcept {
+        spacing = qwqdsp_simd_element::PackFloat<8>::vBroadcast(new_spacing);
+    }
+};
+
 class Vec4DelayLine {
 public:
     void Init(float max_ms, float fs) {
@@ -56,8 +85,11 @@ public:
     QWQDSP_FORCE_INLINE
     qwqdsp_simd_element::PackFloat<4> GetAfterPush(qwqdsp_simd_element::PackFloat<4> const& delay_samples) const noexcept;
 
+    /**
+     * @brief 读取第group组等间隔抽头，AVX2 gather直接得到SoA排列的插值点
+     */
     QWQDSP_FORCE_INLINE
-    qwqdsp_simd_element::PackFloat<8> GetAfterPush(qwqdsp_simd_element::PackFloat<8> const& delay_samples) const noexcept;
+    qwqdsp_simd_element::PackFloat<8> GetEvenTapsAfterPush(Vec8EvenTaps const& taps, size_t group) const noexcept;
 
     QWQDSP_FORCE_INLINE
     void Push(float x) noexcept {
@@ -100,8 +132,117 @@ public:
     float drywet; // 0~1
     std::atomic<bool> should_update_fir_{}; // tell flanger to update coeffs
     std::atomic<bool> is_using_custom_{};
+    // 只在消息线程编辑
     std::array<float, kMaxCoeffLen> custom_coeffs_{};
     std::array<float, kMaxCoeffLen> custom_spectral_gains{};
+    // 消息线程 -> 设计线程，发送时的custom_coeffs_
+    pluginshared::ArraySnapshot<float, kMaxCoeffLen> custom_coeffs_snapshot_;
+};
+
+/**
+ * @brief 设计完成的一组FIR系数，kSIMDMaxCoeffLen之内超出coeff_len的部分都是0
+ */
+struct SteepFlangerCoeffs {
+    alignas(32) std::array<float, kSIMDMaxCoeffLen> coeffs{};
+    size_t coeff_len{};
+    float fir_gain{1.0f};
+};
+
+/**
+ * @brief 设计线程 -> 音频线程
+ */
+using SteepFlangerCoeffSlot = pluginshared::TripleBuffer<SteepFlangerCoeffs>;
+
+/**
+ * @brief FIR设计所需参数的快照
+ */
+struct SteepFlangerFirParameter {
+    float cutoff; // 0~pi
+    size_t coeff_len; // 4~kMaxCoeffLen
+    float side_lobe; // >20
+    bool min_phase;
+    bool highpass;
+    bool use_custom;
+    std::array<float, kMaxCoeffLen> custom_coeffs;
+};
+
+/**
+ * @brief 在非音频线程中设计FIR，所有缓冲区都在构造时分配
+ */
+class SteepFlangerCoeffDesigner {
+public:
+    SteepFlangerCoeffDesigner() {
+        complex_fft_.Init(kFFTSize);
+    }
+
+    void Design(SteepFlangerFirParameter const& param, SteepFlangerCoeffs& out) noexcept {
+        size_t const coeff_len = std::clamp<size_t>(param.coeff_len, 1, kMaxCoeffLen);
+        out.coeff_len = coeff_len;
+        std::fill(out.coeffs.begin(), out.coeffs.end(), 0.0f);
+
+        std::span<float> kernel{out.coeffs.data(), coeff_len};
+        if (!param.use_custom) {
+            float const cutoff_w = param.cutoff;
+            if (param.highpass) {
+                qwqdsp_filter::WindowFIR::Highpass(kernel, std::numbers::pi_v<float> - cutoff_w);
+            }
+            else {
+                qwqdsp_filter::WindowFIR::Lowpass(kernel, cutoff_w);
+            }
+            float const beta = qwqdsp_window::Kaiser::Beta(param.side_lobe);
+            qwqdsp_window::Kaiser::ApplyWindow(kernel, beta, false);
+        }
+        else {
+            std::copy_n(param.custom_coeffs.begin(), coeff_len, kernel.begin());
+        }
+
+        std::fill(pad_.begin(), pad_.end(), 0.0f);
+        std::copy(kernel.begin(), kernel.end(), pad_.begin());
+        complex_fft_.FFTGainPhase(pad_, gains_);
+        if (param.min_phase) {
+            for (size_t i = 0; i < kNumBins; ++i) {
+                log_gains_[i] = std::log(gains_[i] + 1e-18f);
+            }
+
+            std::fill(phases_.begin(), phases_.end(), 0.0f);
+            complex_fft_.IFFT(pad_, log_gains_, phases_);
+            pad_[0] = 0;
+            pad_[kNumBins / 2] = 0;
+            for (size_t i = kNumBins / 2 + 1; i < kNumBins; ++i) {
+                pad_[i] = -pad_[i];
+            }
+
+            complex_fft_.FFT(pad_, log_gains_, phases_);
+            complex_fft_.IFFTGainPhase(pad_, gains_, phases_);
+
+            for (size_t i = 0; i < kernel.size(); ++i) {
+                kernel[i] = pad_[i];
+            }
+        }
+
+        float const max_spectral_gain = *std::max_element(gains_.begin(), gains_.end());
+        float gain = 1.0f / (max_spectral_gain + 1e-10f);
+        if (max_spectral_gain < 1e-10f) {
+            gain = 1.0f;
+        }
+        for (auto& x : kernel) {
+            x *= gain;
+        }
+
+        float energy = 0;
+        for (auto x : kernel) {
+            energy += x * x;
+        }
+        out.fir_gain = 1.0f / std::sqrt(energy + 1e-10f);
+    }
+private:
+    static constexpr size_t kNumBins = qwqdsp_spectral::ComplexFFT::NumBins(kFFTSize);
+
+    qwqdsp_spectral::ComplexFFT complex_fft_;
+    std::array<float, kFFTSize> pad_{};
+    std::array<float, kNumBins> gains_{};
+    std::array<float, kNumBins> log_gains_{};
+    std::array<float, kNumBins> phases_{};
 };
 
 class SteepFlanger {
@@ -113,8 +254,6 @@ public:
     };
 
     SteepFlanger() {
-        complex_fft_.Init(kFFTSize);
-
         process_arch_ = ProcessArch::kNothing;
         if (simd_detector::is_supported(simd_detector::InstructionSet::PLUGIN_VEC8_DISPATCH_ISET)) {
             process_arch_ = ProcessArch::kVector8;
@@ -183,98 +322,22 @@ public:
     }
 
     // -------------------- lookup --------------------
-    std::span<const float> GetUsingCoeffs() const noexcept {
-        return {coeffs_.data(), coeff_len_};
-    }
-
     ProcessArch GetProcessArch() const noexcept {
         return process_arch_;
     }
 
-    std::atomic<bool> have_new_coeff_{};
+    // 由设计线程写入，音频线程在块开始时取走
+    SteepFlangerCoeffSlot coeff_slot_;
 private:
-    void UpdateCoeff(SteepFlangerParameter& param) noexcept {
-        size_t coeff_len = static_cast<size_t>(param.fir_coeff_len);
-        coeff_len_ = coeff_len;
-
-        if (!param.is_using_custom_) {
-            std::span<float> kernel{coeffs_.data(), coeff_len};
-            float const cutoff_w = param.fir_cutoff;
-            if (param.fir_highpass) {
-                qwqdsp_filter::WindowFIR::Highpass(kernel, std::numbers::pi_v<float> - cutoff_w);
-            }
-            else {
-                qwqdsp_filter::WindowFIR::Lowpass(kernel, cutoff_w);
-            }
-            float const beta = qwqdsp_window::Kaiser::Beta(param.fir_side_lobe);
-            qwqdsp_window::Kaiser::ApplyWindow(kernel, beta, false);
-        }
-        else {
-            std::copy_n(param.custom_coeffs_.begin(), coeff_len, coeffs_.begin());
-        }
-
-        if (process_arch_ == ProcessArch::kVector4) {
-            size_t const coeff_len_div_4 = (coeff_len + 3) / 4;
-            size_t const idxend = coeff_len_div_4 * 4;
-            for (size_t i = coeff_len; i < idxend; ++i) {
-                coeffs_[i] = 0;
-            }
-        }
-        else if (process_arch_ == ProcessArch::kVector8) {
-            size_t const coeff_len_div_8 = (coeff_len + 7) / 8;
-            size_t const idxend = coeff_len_div_8 * 8;
-            for (size_t i = coeff_len; i < idxend; ++i) {
-                coeffs_[i] = 0;
-            }
-        }
-
-        std::span<float> kernel{coeffs_.data(), coeff_len};
-        float pad[kFFTSize]{};
-        constexpr size_t num_bins = complex_fft_.NumBins(kFFTSize);
-        std::array<float, num_bins> gains{};
-        std::copy(kernel.begin(), kernel.end(), pad);
-        complex_fft_.FFTGainPhase(pad, gains);
-        if (param.fir_min_phase) {
-            float log_gains[num_bins]{};
-            for (size_t i = 0; i < num_bins; ++i) {
-                log_gains[i] = std::log(gains[i] + 1e-18f);
-            }
-
-            float phases[num_bins]{};
-            complex_fft_.IFFT(pad, log_gains, phases);
-            pad[0] = 0;
-            pad[num_bins / 2] = 0;
-            for (size_t i = num_bins / 2 + 1; i < num_bins; ++i) {
-                pad[i] = -pad[i];
-            }
-
-            complex_fft_.FFT(pad, log_gains, phases);
-            complex_fft_.IFFTGainPhase(pad, gains, phases);
-
-            for (size_t i = 0; i < kernel.size(); ++i) {
-                kernel[i] = pad[i];
-            }
-        }
-
-        float const max_spectral_gain = *std::max_element(gains.begin(), gains.end());
-        float gain = 1.0f / (max_spectral_gain + 1e-10f);
-        if (max_spectral_gain < 1e-10f) {
-            gain = 1.0f;
-        }
-        for (auto& x : kernel) {
-            x *= gain;
-        }
-
-        float energy = 0;
-        for (auto x : kernel) {
-            energy += x * x;
+    QWQDSP_FORCE_INLINE
+    void PullCoeff() noexcept {
+        if (auto const* c = coeff_slot_.Read(); c != nullptr) {
+            coeffs_ = c->coeffs;
+            coeff_len_ = c->coeff_len;
+            fir_gain_ = c->fir_gain;
         }
-        fir_gain_ = 1.0f / std::sqrt(energy + 1e-10f);
-
-        have_new_coeff_ = true;
     }
 
-    static constexpr size_t kSIMDMaxCoeffLen = ((kMaxCoeffLen + 7) / 8) * 8;
     static constexpr float kDelaySmoothMs = 20.0f;
 
     ProcessArch process_arch_{};
@@ -285,6 +348,8 @@ private:
     // fir
     alignas(32) std::array<float, kSIMDMaxCoeffLen> coeffs_{};
     alignas(32) std::array<float, kSIMDMaxCoeffLen> last_coeffs_{};
+    Vec8EvenTaps left_taps_;
+    Vec8EvenTaps right_taps_;
     float fir_gain_{1.0f};
     size_t coeff_len_{};
 
@@ -307,6 +372,4 @@ private:
     qwqdsp_oscillator::VicSineOsc barber_oscillator_;
     size_t barber_osc_keep_amp_counter_{};
     size_t barber_osc_keep_amp_need_{};
-
-    qwqdsp_spectral::ComplexFFT complex_fft_;
 };
@@ -70,9 +70,7 @@ void SteepFlanger::ProcessVec4(
         size_t num_process = std::min<size_t>(512, cando);
         cando -= num_process;
 
-        if (param.should_update_fir_.exchange(false)) {
-            UpdateCoeff(param);
-        }
+        PullCoeff();
 
         constexpr float kWarpFactor = -0.8f;
         float warp_drywet = param.drywet;
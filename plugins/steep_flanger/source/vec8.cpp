@@ -1,5 +1,7 @@
 #include "PluginProcessor.h"
 
+#include "x86/avx2.h"
+
 #include "qwqdsp/convert.hpp"
 #include "qwqdsp/polymath.hpp"
 
@@ -13,66 +15,24 @@ constexpr Complex32x8& Complex32x8::operator*=(const Complex32x8& a) noexcept {
 }
 
 QWQDSP_FORCE_INLINE
-qwqdsp_simd_element::PackFloat<8> Vec4DelayLine::GetAfterPush(qwqdsp_simd_element::PackFloat<8> const& delay_samples) const noexcept {
-    auto frpos = static_cast<float>(wpos_ + delay_length_) - delay_samples;
-    auto t = qwqdsp_simd_element::PackOps::Frac(frpos);
-    auto rpos = frpos.ToUint() - 1u;
-    auto irpos = rpos & mask_;
-
-    qwqdsp_simd_element::PackFloat<8> interp0;
-    simde_mm_store_ps(interp0.data, simde_mm_loadu_ps(buffer_.data() + irpos[0]));
-    qwqdsp_simd_element::PackFloat<8> interp1;
-    simde_mm_store_ps(interp1.data, simde_mm_loadu_ps(buffer_.data() + irpos[1]));
-    qwqdsp_simd_element::PackFloat<8> interp2;
-    simde_mm_store_ps(interp2.data, simde_mm_loadu_ps(buffer_.data() + irpos[2]));
-    qwqdsp_simd_element::PackFloat<8> interp3;
-    simde_mm_store_ps(interp3.data, simde_mm_loadu_ps(buffer_.data() + irpos[3]));
-    qwqdsp_simd_element::PackFloat<8> interp4;
-    simde_mm_store_ps(interp4.data, simde_mm_loadu_ps(buffer_.data() + irpos[4]));
-    qwqdsp_simd_element::PackFloat<8> interp5;
-    simde_mm_store_ps(interp5.data, simde_mm_loadu_ps(buffer_.data() + irpos[5]));
-    qwqdsp_simd_element::PackFloat<8> interp6;
-    simde_mm_store_ps(interp6.data, simde_mm_loadu_ps(buffer_.data() + irpos[6]));
-    qwqdsp_simd_element::PackFloat<8> interp7;
-    simde_mm_store_ps(interp7.data, simde_mm_loadu_ps(buffer_.data() + irpos[7]));
+qwqdsp_simd_element::PackFloat<8> Vec4DelayLine::GetEvenTapsAfterPush(Vec8EvenTaps const& taps, size_t group) const noexcept {
+    auto const delay = taps.index[group] * taps.spacing;
+    // rpos = floor(wpos + len - delay) - 1 = wpos + len - (ceil(delay) + 1)
+    auto const ceil_delay = 0.0f - qwqdsp_simd_element::PackOps::Floor(0.0f - delay);
+    auto const irpos = (qwqdsp_simd_element::Pack4Bytes<uint32_t, 8>::vBroadcast(wpos_) - (ceil_delay.ToUint() + 1u)) & mask_;
+    auto const vrpos = simde_mm256_load_si256(reinterpret_cast<simde__m256i const*>(irpos.data));
+    float const* buffer = buffer_.data();
 
     qwqdsp_simd_element::PackFloat<8> yn1;
-    yn1[0] = interp0[0];
-    yn1[1] = interp1[0];
-    yn1[2] = interp2[0];
-    yn1[3] = interp3[0];
-    yn1[4] = interp4[0];
-    yn1[5] = interp5[0];
-    yn1[6] = interp6[0];
-    yn1[7] = interp7[0];
+    simde_mm256_store_ps(yn1.data, simde_mm256_i32gather_ps(buffer, vrpos, 4));
     qwqdsp_simd_element::PackFloat<8> y0;
-    y0[0] = interp0[1];
-    y0[1] = interp1[1];
-    y0[2] = interp2[1];
-    y0[3] = interp3[1];
-    y0[4] = interp4[1];
-    y0[5] = interp5[1];
-    y0[6] = interp6[1];
-    y0[7] = interp7[1];
+    simde_mm256_store_ps(y0.data, simde_mm256_i32gather_ps(buffer + 1, vrpos, 4));
     qwqdsp_simd_element::PackFloat<8> y1;
-    y1[0] = interp0[2];
-    y1[1] = interp1[2];
-    y1[2] = interp2[2];
-    y1[3] = interp3[2];
-    y1[4] = interp4[2];
-    y1[5] = interp5[2];
-    y1[6] = interp6[2];
-    y1[7] = interp7[2];
+    simde_mm256_store_ps(y1.data, simde_mm256_i32gather_ps(buffer + 2, vrpos, 4));
     qwqdsp_simd_element::PackFloat<8> y2;
-    y2[0] = interp0[3];
-    y2[1] = interp1[3];
-    y2[2] = interp2[3];
-    y2[3] = interp3[3];
-    y2[4] = interp4[3];
-    y2[5] = interp5[3];
-    y2[6] = interp6[3];
-    y2[7] = interp7[3];
+    simde_mm256_store_ps(y2.data, simde_mm256_i32gather_ps(buffer + 3, vrpos, 4));
 
+    auto const t = ceil_delay - delay;
     auto d0 = (y1 - yn1) * 0.5f;
     auto d1 = (y2 - y0) * 0.5f;
     auto d = y1 - y0;
@@ -94,9 +54,7 @@ void SteepFlanger::ProcessVec8(
         size_t num_process = std::min<size_t>(512, cando);
         cando -= num_process;
 
-        if (param.should_update_fir_.exchange(false)) {
-            UpdateCoeff(param);
-        }
+        PullCoeff();
 
         constexpr float kWarpFactor = -0.8f;
         float warp_drywet = param.drywet;
@@ -167,41 +125,19 @@ void SteepFlanger::ProcessVec8(
                 }
     
                 float left_sum = 0;
-                float const left_num_notch = curr_num_notch[0];
-                qwqdsp_simd_element::PackFloat<8> current_delay;
-                current_delay[0] = 0;
-                current_delay[1] = left_num_notch;
-                current_delay[2] = left_num_notch * 2;
-                current_delay[3] = left_num_notch * 3;
-                current_delay[4] = left_num_notch * 4;
-                current_delay[5] = left_num_notch * 5;
-                current_delay[6] = left_num_notch * 6;
-                current_delay[7] = left_num_notch * 7;
-                auto delay_inc = qwqdsp_simd_element::PackFloat<8>::vBroadcast(left_num_notch * 8);
+                left_taps_.SetSpacing(curr_num_notch[0]);
                 delay_left_.Push(*left_ptr + left_fb_ * feedback_mul);
                 for (size_t i = 0; i < coeff_len_div8; ++i) {
-                    auto taps_out = delay_left_.GetAfterPush(current_delay);
-                    current_delay += delay_inc;
-
+                    auto taps_out = delay_left_.GetEvenTapsAfterPush(left_taps_, i);
                     taps_out *= last_coeffs_ptr[i];
                     left_sum += qwqdsp_simd_element::PackOps::ReduceAdd(taps_out);
                 }
 
                 float right_sum = 0;
-                float const right_num_notch = curr_num_notch[1];
-                current_delay[0] = 0;
-                current_delay[1] = right_num_notch;
-                current_delay[2] = right_num_notch * 2;
-                current_delay[3] = right_num_notch * 3;
-                current_delay[4] = right_num_notch * 4;
-                current_delay[5] = right_num_notch * 5;
-                current_delay[6] = right_num_notch * 6;
-                current_delay[7] = right_num_notch * 7;
-                delay_inc = qwqdsp_simd_element::PackFloat<8>::vBroadcast(right_num_notch * 8);
+                right_taps_.SetSpacing(curr_num_notch[1]);
                 delay_right_.Push(*right_ptr + right_fb_ * feedback_mul);
                 for (size_t i = 0; i < coeff_len_div8; ++i) {
-                    auto taps_out = delay_right_.GetAfterPush(current_delay);
-                    current_delay += delay_inc;
+                    auto taps_out = delay_right_.GetEvenTapsAfterPush(right_taps_, i);
                     taps_out *= last_coeffs_ptr[i];
                     right_sum += qwqdsp_simd_element::PackOps::ReduceAdd(taps_out);
                 }
@@ -231,28 +167,8 @@ void SteepFlanger::ProcessVec8(
                 delay_left_.Push(*left_ptr + left_fb_ * feedback_mul);
                 delay_right_.Push(*right_ptr + right_fb_ * feedback_mul);
 
-                float const left_num_notch = curr_num_notch[0];
-                float const right_num_notch = curr_num_notch[1];
-                qwqdsp_simd_element::PackFloat<8> left_current_delay;
-                qwqdsp_simd_element::PackFloat<8> right_current_delay;
-                left_current_delay[0] = 0;
-                left_current_delay[1] = left_num_notch;
-                left_current_delay[2] = left_num_notch * 2;
-                left_current_delay[3] = left_num_notch * 3;
-                left_current_delay[4] = left_num_notch * 4;
-                left_current_delay[5] = left_num_notch * 5;
-                left_current_delay[6] = left_num_notch * 6;
-                left_current_delay[7] = left_num_notch * 7;
-                right_current_delay[0] = 0;
-                right_current_delay[1] = right_num_notch;
-                right_current_delay[2] = right_num_notch * 2;
-                right_current_delay[3] = right_num_notch * 3;
-                right_current_delay[4] = right_num_notch * 4;
-                right_current_delay[5] = right_num_notch * 5;
-                right_current_delay[6] = right_num_notch * 6;
-                right_current_delay[7] = right_num_notch * 7;
-                auto left_delay_inc = qwqdsp_simd_element::PackFloat<8>::vBroadcast(left_num_notch * 8);
-                auto right_delay_inc = qwqdsp_simd_element::PackFloat<8>::vBroadcast(right_num_notch * 8);
+                left_taps_.SetSpacing(curr_num_notch[0]);
+                right_taps_.SetSpacing(curr_num_notch[1]);
 
                 auto const addition_rotation = std::polar(1.0f, barber_phase_smoother_.Tick() * std::numbers::pi_v<float> * 2);
                 barber_oscillator_.Tick();
@@ -297,10 +213,8 @@ void SteepFlanger::ProcessVec8(
                 float right_re_sum = 0;
                 float right_im_sum = 0;
                 for (size_t i = 0; i < coeff_len_div8; ++i) {
-                    auto left_taps_out = delay_left_.GetAfterPush(left_current_delay);
-                    auto right_taps_out = delay_right_.GetAfterPush(right_current_delay);
-                    left_current_delay += left_delay_inc;
-                    right_current_delay += right_delay_inc;
+                    auto left_taps_out = delay_left_.GetEvenTapsAfterPush(left_taps_, i);
+                    auto right_taps_out = delay_right_.GetEvenTapsAfterPush(right_taps_, i);
 
                     left_taps_out *= last_coeffs_ptr[i];
                     auto temp = left_taps_out * left_rotation_coeff.re;
@@ -1,8 +1,14 @@
 #pragma once
 #include <algorithm>
+#include <cstddef>
 #include <span>
 #include <cmath>
 
+namespace qwqdsp_simd_element {
+template<size_t N>
+class AdsrEnvelope;
+}
+
 namespace qwqdsp {
 class AdsrEnvelope {
 public:
@@ -236,6 +242,9 @@ public:
         return last_out_;
     }
 private:
+    template<size_t>
+    friend class qwqdsp_simd_element::AdsrEnvelope;
+
     static float ComputeSmoothFactor(float samples, float close_ratio = 3) noexcept {
         if (samples < 1.0f) {
             return 0.0f;
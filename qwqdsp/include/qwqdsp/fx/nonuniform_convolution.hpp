@@ -0,0 +1,548 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cassert>
+#include <cstddef>
+#include <memory>
+#include <span>
+#include <vector>
+#include "qwqdsp/extension_marcos.hpp"
+#include "qwqdsp/segement/slice.hpp"
+#include "qwqdsp/simd_element/align_allocator.hpp"
+#include "qwqdsp/simd_element/simd_pack.hpp"
+#include "qwqdsp/spectral/real_fft.hpp"
+
+namespace qwqdsp_fx {
+/**
+ * @brief 非均匀分块卷积(Gardner/Wefers)
+ *        头部分块大小为block_size，延迟为block_size，调用者保证块长是block_size的整数倍时为0(见Latency)；
+ *        之后每一级分块大小x4，第l级的起始偏移为 2*N_l - 2*block_size，
+ *        所以大分块的复数乘加可以被平摊到之后的 N_l/block_size 个block里，每个block的计算量基本恒定
+ * @note 输出使用环形缓冲区叠加，不会移动数据
+ *
+ * 实时切换IR:
+ *   工作线程: auto set = conv.PrepareIR(ir); conv.PublishIR(std::move(set)); ... conv.FreeRetiredIR();
+ *   音频线程: conv.Process(block); 会在block边界取走新的IR，并在SetCrossfadeBlocks个block内交叉淡化
+ */
+class NonUniformConvolution {
+public:
+    static constexpr size_t kGrowFactor = 4;
+    static constexpr size_t kMaxPartitionSize = 8192;
+
+    /**
+     * @brief 一个IR的全部分块频谱和卷积状态，可以在任意线程创建
+     */
+    class PartitionSet {
+    public:
+        /**
+         * @param block_size 必须和使用它的卷积器相同
+         */
+        void Init(size_t block_size, std::span<const float> ir) {
+            assert(std::has_single_bit(block_size));
+            block_size_ = block_size;
+            stages_.clear();
+
+            size_t const ir_len = ir.size();
+            size_t size = block_size;
+            size_t offset = 0;
+            while (offset < ir_len) {
+                auto& s = stages_.emplace_back(std::make_unique<Stage>());
+                s->size = size;
+                s->offset = offset;
+
+                size_t const next_size = size * kGrowFactor;
+                size_t const next_offset = 2 * next_size - 2 * block_size;
+                bool const can_grow = next_size <= std::max(kMaxPartitionSize, block_size)
+                    && ir_len >= next_offset + next_size;
+                size_t const end = can_grow ? next_offset : ir_len;
+                s->num_parts = (end - offset + size - 1) / size;
+                BuildStage(*s, ir);
+
+                offset = end;
+                size = next_size;
+            }
+
+            size_t max_input = block_size;
+            size_t max_reach = 2 * block_size;
+            for (auto const& s : stages_) {
+                max_input = std::max(max_input, s->size);
+                max_reach = std::max(max_reach, s->offset + 2 * s->size);
+            }
+            size_t const input_size = std::bit_ceil(max_input);
+            input_ring_.assign(input_size * 2, 0.0f);
+            input_mask_ = input_size - 1;
+            size_t const output_size = std::bit_ceil(max_reach + 4 * block_size);
+            output_ring_.assign(output_size, 0.0f);
+            output_mask_ = output_size - 1;
+            Reset(0);
+        }
+
+        size_t BlockSize() const noexcept {
+            return block_size_;
+        }
+
+        size_t NumStages() const noexcept {
+            return stages_.size();
+        }
+    private:
+        friend class NonUniformConvolution;
+        using AlignedVector = std::vector<float, qwqdsp_simd_element::AlignedAllocator<float, 32>>;
+        static constexpr size_t kSIMDWidth = 8;
+
+        struct Stage {
+            size_t size{};       // 分块大小N
+            size_t offset{};     // 在IR中的起始位置D
+            size_t num_parts{};  // 分块数量M
+            size_t num_slices{}; // N / block_size
+            size_t num_bins{};
+            size_t stride{};     // num_bins对齐到kSIMDWidth
+            size_t chunk{};      // 每个slice处理的频点数量
+            size_t slice{};
+            size_t fdl_pos{};
+            size_t out_pos{};
+            qwqdsp_spectral::RealFFT fft;
+            AlignedVector ir_re;
+            AlignedVector ir_im;
+            AlignedVector fdl_re;
+            AlignedVector fdl_im;
+            AlignedVector acc_re;
+            AlignedVector acc_im;
+            std::vector<float> time;
+        };
+
+        static constexpr size_t AlignUp(size_t x) noexcept {
+            return (x + kSIMDWidth - 1) / kSIMDWidth * kSIMDWidth;
+        }
+
+        void BuildStage(Stage& s, std::span<const float> ir) {
+            size_t const fft_size = s.size * 2;
+            s.num_slices = s.size / block_size_;
+            s.num_bins = qwqdsp_spectral::RealFFT::NumBins(fft_size);
+            s.stride = AlignUp(s.num_bins);
+            s.chunk = AlignUp((s.stride + s.num_slices - 1) / s.num_slices);
+            s.fft.Init(fft_size);
+            s.time.assign(fft_size, 0.0f);
+            s.ir_re.assign(s.num_parts * s.stride, 0.0f);
+            s.ir_im.assign(s.num_parts * s.stride, 0.0f);
+            s.fdl_re.assign(s.num_parts * s.stride, 0.0f);
+            s.fdl_im.assign(s.num_parts * s.stride, 0.0f);
+            s.acc_re.assign(s.stride, 0.0f);
+            s.acc_im.assign(s.stride, 0.0f);
+
+            // IR的分块一次变换kMaxBatch个，只在这里用到批量变换的工作区
+            constexpr size_t kBatch = qwqdsp_spectral::RealFFT::kMaxBatch;
+            qwqdsp_spectral::RealFFT batch_fft;
+            batch_fft.Init(fft_size, kBatch);
+            std::vector<float> times(kBatch * fft_size);
+            std::array<float const*, kBatch> time_ptrs;
+            std::array<float*, kBatch> re_ptrs;
+            std::array<float*, kBatch> im_ptrs;
+            for (size_t i = 0; i < s.num_parts; i += kBatch) {
+                size_t const num_frames = std::min(kBatch, s.num_parts - i);
+                std::fill(times.begin(), times.end(), 0.0f);
+                for (size_t j = 0; j < num_frames; ++j) {
+                    size_t const begin = std::min(ir.size(), s.offset + (i + j) * s.size);
+                    size_t const end = std::min(ir.size(), begin + s.size);
+                    std::copy(ir.begin() + begin, ir.begin() + end, times.begin() + j * fft_size);
+                    time_ptrs[j] = times.data() + j * fft_size;
+                    re_ptrs[j] = s.ir_re.data() + (i + j) * s.stride;
+                    im_ptrs[j] = s.ir_im.data() + (i + j) * s.stride;
+                }
+                batch_fft.FFTBatch({time_ptrs.data(), num_frames}, {re_ptrs.data(), num_frames}, {im_ptrs.data(), num_frames});
+            }
+        }
+
+        /**
+         * @param block_pos 下一个完成的block在输出中的绝对位置
+         */
+        void Reset(size_t block_pos) noexcept {
+            std::fill(input_ring_.begin(), input_ring_.end(), 0.0f);
+            std::fill(output_ring_.begin(), output_ring_.end(), 0.0f);
+            for (auto& s : stages_) {
+                std::fill(s->fdl_re.begin(), s->fdl_re.end(), 0.0f);
+                std::fill(s->fdl_im.begin(), s->fdl_im.end(), 0.0f);
+                std::fill(s->acc_re.begin(), s->acc_re.end(), 0.0f);
+                std::fill(s->acc_im.begin(), s->acc_im.end(), 0.0f);
+                s->fdl_pos = 0;
+                s->out_pos = 0;
+            }
+            Align(block_pos);
+        }
+
+        /**
+         * @brief 分块N的输入在 (block_pos + block_size) % N == 0 时凑齐，此时需要处于slice 0
+         */
+        void Align(size_t block_pos) noexcept {
+            size_t const block_idx = block_pos / block_size_;
+            for (auto& s : stages_) {
+                s->slice = (block_idx + 1) % s->num_slices;
+            }
+        }
+
+        void PushInput(size_t pos, std::span<const float> in) noexcept {
+            size_t const ring_size = input_mask_ + 1;
+            for (float x : in) {
+                size_t const wpos = pos & input_mask_;
+                input_ring_[wpos] = x;
+                input_ring_[wpos + ring_size] = x;
+                ++pos;
+            }
+        }
+
+        /**
+         * @brief 从另一个IR复制输入历史，切换后头部分块不会缺少之前的输入
+         */
+        void CopyInputHistory(PartitionSet const& other, size_t input_end) noexcept {
+            size_t const len = std::min(input_mask_, other.input_mask_) + 1;
+            size_t rpos = input_end - len;
+            size_t const ring_size = input_mask_ + 1;
+            for (size_t i = 0; i < len; ++i) {
+                float const x = other.input_ring_[rpos & other.input_mask_];
+                size_t const wpos = rpos & input_mask_;
+                input_ring_[wpos] = x;
+                input_ring_[wpos + ring_size] = x;
+                ++rpos;
+            }
+        }
+
+        void PopOutput(size_t pos, std::span<float> out) noexcept {
+            size_t const rpos = pos & output_mask_;
+            size_t const first = std::min(out.size(), output_ring_.size() - rpos);
+            std::copy_n(output_ring_.begin() + rpos, first, out.begin());
+            std::fill_n(output_ring_.begin() + rpos, first, 0.0f);
+            std::copy_n(output_ring_.begin(), out.size() - first, out.begin() + first);
+            std::fill_n(output_ring_.begin(), out.size() - first, 0.0f);
+        }
+
+        void AddOutput(size_t pos, std::span<const float> x) noexcept {
+            size_t const first = std::min(x.size(), output_ring_.size() - pos);
+            float* dst = output_ring_.data() + pos;
+            for (size_t i = 0; i < first; ++i) {
+                dst[i] += x[i];
+            }
+            dst = output_ring_.data();
+            for (size_t i = first; i < x.size(); ++i) {
+                dst[i - first] += x[i];
+            }
+        }
+
+        /**
+         * @param input_end 输入的绝对位置，最近N个样本是 [input_end - N, input_end)
+         * @param block_pos 刚完成的block在输出中的绝对位置
+         */
+        void ProcessBlock(size_t input_end, size_t block_pos) noexcept {
+            for (auto& s : stages_) {
+                ProcessStage(*s, input_end, block_pos);
+            }
+        }
+
+        void ProcessStage(Stage& s, size_t input_end, size_t block_pos) noexcept {
+            size_t const slice = s.slice;
+            if (slice == 0) {
+                // 刚好凑齐了一个新的输入分块
+                float const* src = input_ring_.data() + ((input_end - s.size) & input_mask_);
+                std::copy_n(src, s.size, s.time.begin());
+                std::fill(s.time.begin() + static_cast<std::ptrdiff_t>(s.size), s.time.end(), 0.0f);
+                s.fdl_pos = s.fdl_pos + 1 == s.num_parts ? 0 : s.fdl_pos + 1;
+                s.fft.FFT(s.time,
+                          {s.fdl_re.data() + s.fdl_pos * s.stride, s.num_bins},
+                          {s.fdl_im.data() + s.fdl_pos * s.stride, s.num_bins});
+                s.out_pos = (block_pos + block_size_ + s.offset - s.size) & output_mask_;
+            }
+
+            size_t const begin = slice * s.chunk;
+            size_t const end = std::min(begin + s.chunk, s.stride);
+            if (begin < end) {
+                for (size_t i = 0; i < s.num_parts; ++i) {
+                    size_t const x_idx = s.fdl_pos >= i ? s.fdl_pos - i : s.fdl_pos + s.num_parts - i;
+                    ComplexMulAdd(i != 0, s.acc_re.data(), s.acc_im.data(),
+                                  s.fdl_re.data() + x_idx * s.stride, s.fdl_im.data() + x_idx * s.stride,
+                                  s.ir_re.data() + i * s.stride, s.ir_im.data() + i * s.stride,
+                                  begin, end);
+                }
+            }
+
+            if (slice + 1 == s.num_slices) {
+                s.fft.IFFT(s.time, {s.acc_re.data(), s.num_bins}, {s.acc_im.data(), s.num_bins});
+                AddOutput(s.out_pos, s.time);
+                s.slice = 0;
+            }
+            else {
+                s.slice = slice + 1;
+            }
+        }
+
+        /**
+         * @brief 分离实虚部的复数乘加 acc (+)= x * h
+         * @param begin,end 必须对齐到kSIMDWidth
+         */
+        QWQDSP_FORCE_INLINE
+        static void ComplexMulAdd(
+            bool accumulate,
+            float* acc_re, float* acc_im,
+            float const* x_re, float const* x_im,
+            float const* h_re, float const* h_im,
+            size_t begin, size_t end
+        ) noexcept {
+            using qwqdsp_simd_element::PackFloat;
+            for (size_t i = begin; i < end; i += kSIMDWidth) {
+                PackFloat<kSIMDWidth> xr;
+                PackFloat<kSIMDWidth> xi;
+                PackFloat<kSIMDWidth> hr;
+                PackFloat<kSIMDWidth> hi;
+                xr.Load(x_re + i);
+                xi.Load(x_im + i);
+                hr.Load(h_re + i);
+                hi.Load(h_im + i);
+                auto re = xr * hr - xi * hi;
+                auto im = xr * hi + xi * hr;
+                if (accumulate) {
+                    PackFloat<kSIMDWidth> ar;
+                    PackFloat<kSIMDWidth> ai;
+                    ar.Load(acc_re + i);
+                    ai.Load(acc_im + i);
+                    re += ar;
+                    im += ai;
+                }
+                re.Store(acc_re + i);
+                im.Store(acc_im + i);
+            }
+        }
+
+        size_t block_size_{};
+        std::vector<std::unique_ptr<Stage>> stages_;
+        // 镜像输入环，最近N个样本总是连续的
+        std::vector<float> input_ring_;
+        size_t input_mask_{};
+        std::vector<float> output_ring_;
+        size_t output_mask_{};
+    };
+
+    NonUniformConvolution() = default;
+    NonUniformConvolution(NonUniformConvolution const&) = delete;
+    NonUniformConvolution& operator=(NonUniformConvolution const&) = delete;
+
+    ~NonUniformConvolution() {
+        delete pending_.exchange(nullptr);
+        delete retired_.exchange(nullptr);
+    }
+
+    /**
+     * @param block_size 头部分块大小，必须是2的幂
+     * @param fixed_blocks 调用者保证之后每次Process的长度都是block_size的整数倍
+     */
+    void Init(size_t block_size, bool fixed_blocks = false) {
+        assert(std::has_single_bit(block_size));
+        block_size_ = block_size;
+        fixed_blocks_ = fixed_blocks;
+        current_ = nullptr;
+        fading_ = nullptr;
+        delete pending_.exchange(nullptr);
+        FreeRetiredIR();
+        fade_buffer_.assign(block_size, 0.0f);
+        Reset();
+    }
+
+    /**
+     * @return Init时保证了fixed_blocks为0，否则为block_size
+     * @note 不保证块长时总是按最坏情况先输出block_size个零，之后宿主的块长怎么变化延迟都不变；
+     *       延迟取决于block_size，如果block_size跟随宿主的块长，重新Init之后调用者需要重新报告延迟
+     */
+    float Latency() const noexcept {
+        return fixed_blocks_ ? 0.0f : static_cast<float>(block_size_);
+    }
+
+    void Reset() noexcept {
+        if (current_ != nullptr) {
+            current_->Reset(0);
+        }
+        if (fading_ != nullptr) {
+            fading_->Reset(0);
+        }
+        input_wpos_ = 0;
+        input_pos_ = 0;
+        block_pos_ = 0;
+        // 先输出延迟长度的零，之后读取不会追上写入
+        output_ready_ = static_cast<size_t>(Latency());
+        output_rpos_ = 0 - output_ready_;
+        fade_pos_ = fade_len_;
+    }
+
+    /**
+     * @brief 直接在调用线程计算并替换IR，会分配内存，不要在音频线程调用
+     */
+    void SetIR(std::span<const float> ir) {
+        current_ = PrepareIR(ir);
+        current_->Reset(block_pos_);
+        fading_ = nullptr;
+        fade_pos_ = fade_len_;
+    }
+
+    /**
+     * @brief 在工作线程计算IR分块，之后使用PublishIR交给音频线程
+     */
+    std::unique_ptr<PartitionSet> PrepareIR(std::span<const float> ir) const {
+        auto set = std::make_unique<PartitionSet>();
+        set->Init(block_size_, ir);
+        return set;
+    }
+
+    /**
+     * @brief 无锁地把IR交给音频线程，如果上一个还没被取走则会被替换并在这里释放
+     * @note 只允许一个线程调用；在音频线程调用时必须先确认HasPendingIR为false，否则会在音频线程释放内存
+     */
+    void PublishIR(std::unique_ptr<PartitionSet> set) noexcept {
+        assert(set == nullptr || set->BlockSize() == block_size_);
+        delete pending_.exchange(set.release(), std::memory_order_acq_rel);
+    }
+
+    /**
+     * @return 上一次PublishIR的IR是否还没被Process取走
+     */
+    bool HasPendingIR() const noexcept {
+        return pending_.load(std::memory_order_acquire) != nullptr;
+    }
+
+    /**
+     * @brief 释放音频线程淡出完成的旧IR，在工作线程或消息线程定期调用
+     */
+    void FreeRetiredIR() noexcept {
+        delete retired_.exchange(nullptr, std::memory_order_acquire);
+    }
+
+    /**
+     * @param num_blocks 切换IR时交叉淡化的block数量，0为直接切换
+     */
+    void SetCrossfadeBlocks(size_t num_blocks) noexcept {
+        crossfade_blocks_ = num_blocks;
+    }
+
+    bool IsCrossfading() const noexcept {
+        return fading_ != nullptr;
+    }
+
+    size_t NumStages() const noexcept {
+        return current_ != nullptr ? current_->NumStages() : 0;
+    }
+
+    void Process(std::span<float> block) noexcept {
+        assert(!fixed_blocks_ || block.size() % block_size_ == 0);
+
+        if (fading_ == nullptr) {
+            InstallPending();
+        }
+
+        qwqdsp_segement::Slice1D input{block};
+        while (!input.IsEnd()) {
+            size_t need = block_size_ - input_wpos_;
+            auto in = input.GetSome(need);
+            if (current_ != nullptr) {
+                current_->PushInput(input_pos_, in);
+            }
+            if (fading_ != nullptr) {
+                fading_->PushInput(input_pos_, in);
+            }
+            input_pos_ += in.size();
+            input_wpos_ += in.size();
+            if (input_wpos_ >= block_size_) {
+                input_wpos_ -= block_size_;
+                if (current_ != nullptr) {
+                    current_->ProcessBlock(input_pos_, block_pos_);
+                }
+                if (fading_ != nullptr) {
+                    fading_->ProcessBlock(input_pos_, block_pos_);
+                }
+                block_pos_ += block_size_;
+                output_ready_ += block_size_;
+            }
+
+            if (output_ready_ >= in.size()) {
+                if (current_ != nullptr) {
+                    current_->PopOutput(output_rpos_, in);
+                }
+                else {
+                    std::fill(in.begin(), in.end(), 0.0f);
+                }
+                if (fading_ != nullptr) {
+                    std::span<float> old{fade_buffer_.data(), in.size()};
+                    fading_->PopOutput(output_rpos_, old);
+                    MixFade(in, old);
+                }
+                output_rpos_ += in.size();
+                output_ready_ -= in.size();
+            }
+            else {
+                std::fill(in.begin(), in.end(), 0.0f);
+            }
+        }
+
+        if (fading_ != nullptr && fade_pos_ >= fade_len_) {
+            RetireFading();
+        }
+    }
+private:
+    void InstallPending() noexcept {
+        PartitionSet* set = pending_.exchange(nullptr, std::memory_order_acquire);
+        if (set == nullptr) {
+            return;
+        }
+        assert(set->BlockSize() == block_size_);
+        set->Align(block_pos_);
+        if (current_ != nullptr) {
+            set->CopyInputHistory(*current_, input_pos_);
+        }
+        fading_.reset(current_.release());
+        current_.reset(set);
+        fade_len_ = crossfade_blocks_ * block_size_;
+        fade_pos_ = 0;
+        if (fading_ == nullptr) {
+            fade_pos_ = fade_len_;
+        }
+        else if (fade_len_ == 0) {
+            RetireFading();
+        }
+    }
+
+    /**
+     * @brief 音频线程不释放内存，交给FreeRetiredIR；如果上一个还没被释放则之后再试
+     */
+    void RetireFading() noexcept {
+        PartitionSet* expect = nullptr;
+        if (retired_.compare_exchange_strong(expect, fading_.get(), std::memory_order_release)) {
+            static_cast<void>(fading_.release());
+        }
+    }
+
+    void MixFade(std::span<float> out, std::span<const float> old) noexcept {
+        if (fade_pos_ >= fade_len_) {
+            return;
+        }
+        float const inv_len = 1.0f / static_cast<float>(fade_len_);
+        for (size_t i = 0; i < out.size(); ++i) {
+            float const g = static_cast<float>(std::min(fade_pos_, fade_len_)) * inv_len;
+            out[i] = old[i] + g * (out[i] - old[i]);
+            ++fade_pos_;
+        }
+    }
+
+    size_t block_size_{};
+    size_t input_wpos_{};
+    // 绝对位置，环形缓冲区长度都是2的幂，溢出回绕后依然正确
+    size_t input_pos_{};
+    size_t block_pos_{};
+    size_t output_rpos_{};
+    size_t output_ready_{};
+    bool fixed_blocks_{};
+
+    std::unique_ptr<PartitionSet> current_;
+    std::unique_ptr<PartitionSet> fading_;
+    std::atomic<PartitionSet*> pending_{};
+    std::atomic<PartitionSet*> retired_{};
+    std::vector<float> fade_buffer_;
+    size_t crossfade_blocks_{8};
+    size_t fade_len_{};
+    size_t fade_pos_{};
+};
+}
@@ -0,0 +1,378 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cmath>
+#include <cstddef>
+#include <numbers>
+#include <span>
+#include <vector>
+#include "qwqdsp/simd_element/simd_pack.hpp"
+
+namespace qwqdsp_fx {
+/**
+ * @brief 两路一阶全通组成的多相半带IIR，一级2倍上采样和下采样，每个通道是独立的信号
+ *        相位不是线性的，但是延迟很低
+ * @ref https://github.com/unevens/hiir
+ */
+template<size_t N>
+class HalfbandIIR {
+public:
+    using Pack = qwqdsp_simd_element::PackFloat<N>;
+    static constexpr size_t kMaxCoeffs = 12;
+
+    /**
+     * @param num_coeffs 1~kMaxCoeffs 越多阻带衰减越大
+     * @param transition (0,0.25) 过渡带宽度，相对于高采样率
+     */
+    void Design(size_t num_coeffs, float transition) noexcept {
+        assert(num_coeffs >= 1 && num_coeffs <= kMaxCoeffs);
+        assert(transition > 0.0f && transition < 0.25f);
+        num_coeffs_ = num_coeffs;
+
+        double k = std::tan((1.0 - static_cast<double>(transition) * 2.0) * std::numbers::pi / 4.0);
+        k *= k;
+        double const kksqrt = std::pow(1.0 - k * k, 0.25);
+        double const e = 0.5 * (1.0 - kksqrt) / (1.0 + kksqrt);
+        double const e2 = e * e;
+        double const e4 = e2 * e2;
+        double const q = e * (1.0 + e4 * (2.0 + e4 * (15.0 + 150.0 * e4)));
+
+        double const order = static_cast<double>(num_coeffs * 2 + 1);
+        latency_ = 0.0f;
+        for (size_t i = 0; i < num_coeffs; ++i) {
+            double const c = static_cast<double>(i + 1);
+            double num = 0.0;
+            for (int j = 0; j < 64; ++j) {
+                double const v = std::pow(q, j * (j + 1)) * std::sin((j * 2 + 1) * c * std::numbers::pi / order);
+                num += (j % 2 == 0) ? v : -v;
+            }
+            num *= std::pow(q, 0.25);
+            double den = 0.5;
+            for (int j = 1; j < 64; ++j) {
+                double const v = std::pow(q, j * j) * std::cos(j * 2 * c * std::numbers::pi / order);
+                den += (j % 2 == 0) ? v : -v;
+            }
+            double const ww = num / den;
+            double const wwsq = ww * ww;
+            double const x = std::sqrt((1.0 - wwsq * k) * (1.0 - wwsq / k)) / (1.0 + wwsq);
+            double const a = (1.0 - x) / (1.0 + x);
+            coeffs_[i] = static_cast<float>(a);
+            // (a + z^-1)/(1 + a z^-1) 在直流处的群延迟
+            latency_ += static_cast<float>((1.0 - a) / (1.0 + a));
+        }
+    }
+
+    /**
+     * @brief Oversampler里第stage级的默认设计，越往后信号占的频带越窄，过渡带可以越宽
+     */
+    void DesignForStage(size_t stage) noexcept {
+        static constexpr std::array<size_t, 3> kNumCoeffs{8, 4, 3};
+        static constexpr std::array<float, 3> kTransition{0.04f, 0.12f, 0.18f};
+        size_t const idx = std::min(stage, kNumCoeffs.size() - 1);
+        Design(kNumCoeffs[idx], kTransition[idx]);
+    }
+
+    void Reset() noexcept {
+        for (size_t i = 0; i < kMaxCoeffs; ++i) {
+            up_x_[i].Broadcast(0);
+            up_y_[i].Broadcast(0);
+            down_x_[i].Broadcast(0);
+            down_y_[i].Broadcast(0);
+        }
+    }
+
+    /**
+     * @param out 长度为2*num_in
+     */
+    void Upsample(Pack const* in, Pack* out, size_t num_in) noexcept {
+        for (size_t i = 0; i < num_in; ++i) {
+            Pack even = in[i];
+            Pack odd = in[i];
+            TickPaths(even, odd, up_x_, up_y_);
+            out[2 * i] = even;
+            out[2 * i + 1] = odd;
+        }
+    }
+
+    /**
+     * @param in 长度为2*num_out
+     */
+    void Downsample(Pack const* in, Pack* out, size_t num_out) noexcept {
+        for (size_t i = 0; i < num_out; ++i) {
+            Pack even = in[2 * i + 1];
+            Pack odd = in[2 * i];
+            TickPaths(even, odd, down_x_, down_y_);
+            out[i] = 0.5f * (even + odd);
+        }
+    }
+
+    /**
+     * @brief 上采样再下采样在直流处的群延迟，单位是低采样率的样本
+     */
+    float GetLatency() const noexcept {
+        return latency_;
+    }
+
+private:
+    QWQDSP_FORCE_INLINE
+    void TickPaths(Pack& even, Pack& odd, std::array<Pack, kMaxCoeffs>& xs, std::array<Pack, kMaxCoeffs>& ys) noexcept {
+        size_t i = 0;
+        for (; i + 1 < num_coeffs_; i += 2) {
+            Pack const t0 = (even - ys[i]) * coeffs_[i] + xs[i];
+            Pack const t1 = (odd - ys[i + 1]) * coeffs_[i + 1] + xs[i + 1];
+            xs[i] = even;
+            xs[i + 1] = odd;
+            ys[i] = t0;
+            ys[i + 1] = t1;
+            even = t0;
+            odd = t1;
+        }
+        if (i < num_coeffs_) {
+            Pack const t0 = (even - ys[i]) * coeffs_[i] + xs[i];
+            xs[i] = even;
+            ys[i] = t0;
+            even = t0;
+        }
+    }
+
+    size_t num_coeffs_{};
+    float latency_{};
+    std::array<float, kMaxCoeffs> coeffs_{};
+    std::array<Pack, kMaxCoeffs> up_x_{};
+    std::array<Pack, kMaxCoeffs> up_y_{};
+    std::array<Pack, kMaxCoeffs> down_x_{};
+    std::array<Pack, kMaxCoeffs> down_y_{};
+};
+
+/**
+ * @brief Kaiser窗半带FIR，一级2倍上采样和下采样，每个通道是独立的信号
+ *        线性相位，除了中心以外偶数位置的系数都是0，只计算一半的乘法
+ */
+template<size_t N>
+class HalfbandFIR {
+public:
+    using Pack = qwqdsp_simd_element::PackFloat<N>;
+    static constexpr size_t kMaxCoeffs = 32;
+
+    /**
+     * @param num_coeffs 1~kMaxCoeffs 中心一侧的非零系数个数，滤波器长度为4*num_coeffs-1
+     * @param beta Kaiser窗的beta
+     */
+    void Design(size_t num_coeffs, float beta) noexcept {
+        assert(num_coeffs >= 1 && num_coeffs <= kMaxCoeffs);
+        num_coeffs_ = num_coeffs;
+        double const half = static_cast<double>(num_coeffs * 2);
+        double const i0_beta = std::cyl_bessel_i(0.0, static_cast<double>(beta));
+        double sum = 0.0;
+        std::array<double, kMaxCoeffs> h{};
+        for (size_t m = 0; m < num_coeffs; ++m) {
+            double const n = static_cast<double>(2 * m + 1);
+            double const u = n / half;
+            double const window = std::cyl_bessel_i(0.0, static_cast<double>(beta) * std::sqrt(std::max(0.0, 1.0 - u * u))) / i0_beta;
+            h[m] = ((m % 2 == 0) ? 1.0 : -1.0) / (std::numbers::pi * n) * window;
+            sum += h[m];
+        }
+        // 直流增益为1: 0.5 + 2 * sum(h) = 1，上采样时再乘2
+        for (size_t m = 0; m < num_coeffs; ++m) {
+            coeffs_[m] = static_cast<float>(h[m] * 0.25 / sum * 2.0);
+        }
+    }
+
+    void DesignForStage(size_t stage) noexcept {
+        static constexpr std::array<size_t, 3> kNumCoeffs{16, 6, 4};
+        static constexpr std::array<float, 3> kBeta{8.0f, 7.0f, 6.0f};
+        size_t const idx = std::min(stage, kNumCoeffs.size() - 1);
+        Design(kNumCoeffs[idx], kBeta[idx]);
+    }
+
+    void Reset() noexcept {
+        for (auto& x : up_history_) {
+            x.Broadcast(0);
+        }
+        for (auto& x : down_odd_) {
+            x.Broadcast(0);
+        }
+        for (auto& x : down_even_) {
+            x.Broadcast(0);
+        }
+        up_wpos_ = 0;
+        down_wpos_ = 0;
+    }
+
+    /**
+     * @param out 长度为2*num_in
+     */
+    void Upsample(Pack const* in, Pack* out, size_t num_in) noexcept {
+        size_t const len = num_coeffs_ * 2;
+        for (size_t i = 0; i < num_in; ++i) {
+            Pack const* w = Push(up_history_, up_wpos_, in[i]);
+            out[2 * i] = Convolve(w);
+            out[2 * i + 1] = w[num_coeffs_];
+            up_wpos_ = (up_wpos_ + 1) % len;
+        }
+    }
+
+    /**
+     * @param in 长度为2*num_out
+     */
+    void Downsample(Pack const* in, Pack* out, size_t num_out) noexcept {
+        size_t const len = num_coeffs_ * 2;
+        for (size_t i = 0; i < num_out; ++i) {
+            Pack const* even = Push(down_even_, down_wpos_, in[2 * i]);
+            Pack const* odd = Push(down_odd_, down_wpos_, in[2 * i + 1]);
+            // 上采样时乘过2
+            out[i] = 0.5f * (Convolve(odd) + even[num_coeffs_]);
+            down_wpos_ = (down_wpos_ + 1) % len;
+        }
+    }
+
+    /**
+     * @brief 上采样再下采样的延迟，单位是低采样率的样本
+     */
+    float GetLatency() const noexcept {
+        return static_cast<float>(num_coeffs_ * 2) - 1.5f;
+    }
+
+private:
+    using History = std::array<Pack, kMaxCoeffs * 4>;
+
+    /**
+     * @return 从旧到新连续的2*num_coeffs个样本
+     */
+    QWQDSP_FORCE_INLINE
+    Pack const* Push(History& history, size_t wpos, Pack const& x) noexcept {
+        size_t const len = num_coeffs_ * 2;
+        history[wpos] = x;
+        history[wpos + len] = x;
+        return history.data() + wpos + 1;
+    }
+
+    QWQDSP_FORCE_INLINE
+    Pack Convolve(Pack const* w) const noexcept {
+        Pack sum{};
+        size_t const k = num_coeffs_;
+        for (size_t m = 0; m < k; ++m) {
+            sum += coeffs_[m] * (w[k - 1 - m] + w[k + m]);
+        }
+        return sum;
+    }
+
+    size_t num_coeffs_{1};
+    std::array<float, kMaxCoeffs> coeffs_{};
+    History up_history_{};
+    size_t up_wpos_{};
+    History down_even_{};
+    History down_odd_{};
+    size_t down_wpos_{};
+};
+
+/**
+ * @brief 多级半带组成的2^N倍过采样，只让非线性的部分在高采样率运行
+ *        Init之后可以每个block修改倍数，处理时不分配内存
+ * @tparam TStage HalfbandIIR<N>或者HalfbandFIR<N>
+ * @code
+ *  auto os = oversampler.Upsample(block, num_samples);
+ *  for (auto& x : os) x = Saturate(x);
+ *  oversampler.Downsample(block, num_samples);
+ * @endcode
+ */
+template<size_t N, class TStage = HalfbandIIR<N>>
+class Oversampler {
+public:
+    using Pack = qwqdsp_simd_element::PackFloat<N>;
+    static constexpr size_t kMaxStages = 3;
+
+    void Init(size_t max_block_size) {
+        max_block_size_ = max_block_size;
+        base_.resize(max_block_size);
+        for (size_t i = 0; i < kMaxStages; ++i) {
+            buffers_[i].resize(max_block_size << (i + 1));
+            stages_[i].DesignForStage(i);
+        }
+        Reset();
+    }
+
+    void Reset() noexcept {
+        for (auto& s : stages_) {
+            s.Reset();
+        }
+    }
+
+    /**
+     * @param num_stages 0~kMaxStages，对应1/2/4/8倍，新启用的级会被清空
+     */
+    void SetNumStages(size_t num_stages) noexcept {
+        num_stages = std::min(num_stages, kMaxStages);
+        for (size_t i = num_stages_; i < num_stages; ++i) {
+            stages_[i].Reset();
+        }
+        num_stages_ = num_stages;
+    }
+
+    size_t GetNumStages() const noexcept {
+        return num_stages_;
+    }
+
+    size_t GetFactor() const noexcept {
+        return size_t{1} << num_stages_;
+    }
+
+    /**
+     * @brief 可以在Init之后重新设计每一级的滤波器
+     */
+    TStage& GetStage(size_t stage) noexcept {
+        return stages_[stage];
+    }
+
+    /**
+     * @brief 上采样再下采样的延迟，单位是原采样率的样本
+     */
+    float GetLatency() const noexcept {
+        float latency = 0.0f;
+        for (size_t i = 0; i < num_stages_; ++i) {
+            latency += stages_[i].GetLatency() / static_cast<float>(size_t{1} << i);
+        }
+        return latency;
+    }
+
+    /**
+     * @param num_samples <= max_block_size
+     * @return 高采样率的信号，长度为num_samples*GetFactor()，在Downsample之前原位修改
+     */
+    std::span<Pack> Upsample(Pack const* in, size_t num_samples) noexcept {
+        assert(num_samples <= max_block_size_);
+        if (num_stages_ == 0) {
+            std::copy_n(in, num_samples, base_.begin());
+            return {base_.data(), num_samples};
+        }
+        Pack const* src = in;
+        for (size_t i = 0; i < num_stages_; ++i) {
+            stages_[i].Upsample(src, buffers_[i].data(), num_samples << i);
+            src = buffers_[i].data();
+        }
+        return {buffers_[num_stages_ - 1].data(), num_samples << num_stages_};
+    }
+
+    /**
+     * @param num_samples 和Upsample时相同
+     */
+    void Downsample(Pack* out, size_t num_samples) noexcept {
+        if (num_stages_ == 0) {
+            std::copy_n(base_.begin(), num_samples, out);
+            return;
+        }
+        for (size_t i = num_stages_; i-- > 0;) {
+            Pack* dst = i == 0 ? out : buffers_[i - 1].data();
+            stages_[i].Downsample(buffers_[i].data(), dst, num_samples << i);
+        }
+    }
+
+private:
+    size_t max_block_size_{};
+    size_t num_stages_{};
+    std::array<TStage, kMaxStages> stages_;
+    std::vector<Pack> base_;
+    std::array<std::vector<Pack>, kMaxStages> buffers_;
+};
+}
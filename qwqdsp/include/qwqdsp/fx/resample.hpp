@@ -1,106 +1,219 @@
 #pragma once
-#include <vector>
-#include <span>
+#include <algorithm>
 #include <cassert>
-#include "qwqdsp/interpolation.hpp"
+#include <cmath>
+#include <cstddef>
+#include <numbers>
+#include <span>
+#include <vector>
+#include "qwqdsp/extension_marcos.hpp"
+#include "qwqdsp/simd_element/align_allocator.hpp"
 #include "qwqdsp/window/kaiser.hpp"
 
 namespace qwqdsp_fx {
+/**
+ * @brief 固定比例的流式多相重采样器
+ *        target/source约分成up/down，每个相位一组预先计算的Kaiser-sinc系数
+ *        Process可以接受任意长度的输入，历史样本在两次调用之间保留
+ * @note 约分后up超过kMaxPhases的采样率会被近似成最接近的up<=kMaxPhases的比例
+ */
 class Resample {
 public:
+    static constexpr size_t kMaxPhases = 1024;
+    static constexpr size_t kTapAlign = 8;
+
     /**
-     * @param atten (>0)dB 这决定了target_fs/2处的衰减值
-     * @param kernel_len >=3 必须是奇数，越大过渡带越小，计算量越大
-     * @param oversample >0 越大质量越好，内存需求越大
+     * @param atten (>0)dB 这决定了阻带衰减
+     * @param kernel_len >=3 每个输出使用的输入样本数，越大过渡带越小，计算量越大
      */
-    void Init(float source_fs, float target_fs, float atten, size_t kernel_len, size_t oversample) {
-        assert(kernel_len % 2 == 1);
+    void Init(float source_fs, float target_fs, float atten, size_t kernel_len) {
+        assert(kernel_len >= 3);
 
-        phase_inc_ = source_fs / target_fs;
-        kernel_len_ = kernel_len;
-        oversample_plus1_ = oversample + 1;
+        FindRatio(static_cast<double>(source_fs) / static_cast<double>(target_fs));
+        taps_ = (kernel_len + kTapAlign - 1) / kTapAlign * kTapAlign;
+        size_t const pad = taps_ - kernel_len;
 
-        size_t const lut_size = kernel_len + (kernel_len - 1) * oversample;
-        kernel_.resize(lut_size + 1, 0.0f);
         float const beta = qwqdsp_window::Kaiser::Beta(atten);
         float const width = qwqdsp_window::Kaiser::MainLobeWidth(beta) * std::numbers::pi_v<float> * 2.0f / static_cast<float>(kernel_len);
-        
-        std::span kernel_block{kernel_.data(), lut_size};
-        {
-            float cutoff = 0.0f;
-            if (target_fs < source_fs) {
-                cutoff = std::numbers::pi_v<float> * target_fs / source_fs - width;
-            }
-            else {
-                cutoff = std::numbers::pi_v<float> - width;
-            }
+        float cutoff = std::numbers::pi_v<float> - width;
+        if (target_fs < source_fs) {
+            cutoff = std::numbers::pi_v<float> * target_fs / source_fs - width;
+        }
+        cutoff = std::max(cutoff, 0.01f);
 
-            float const center = (static_cast<float>(kernel_block.size()) - 1.0f) / 2.0f;
-            float const omega = cutoff / static_cast<float>(oversample_plus1_);
-            for (size_t i = 0; i < kernel_block.size(); ++i) {
-                float t = static_cast<float>(i) - center;
-                [[unlikely]]
-                if (t == 0.0f) {
-                    kernel_block[i] = cutoff / std::numbers::pi_v<float>;
-                }
-                else {
-                    kernel_block[i] = std::sin(omega * t) * static_cast<float>(oversample_plus1_) / (std::numbers::pi_v<float> * t);
+        // 输出点在第p个相位的位置是 center + p/up，左右对称地落在窗里
+        double const half = static_cast<double>(kernel_len) / 2.0;
+        double const center = half - 1.0 + 0.5 / static_cast<double>(up_);
+        double const i0_beta = std::cyl_bessel_i(0.0, static_cast<double>(beta));
+        coeffs_.assign(up_ * taps_, 0.0f);
+        for (size_t p = 0; p < up_; ++p) {
+            float* phase_coeffs = coeffs_.data() + p * taps_;
+            double sum = 0.0;
+            for (size_t j = 0; j < kernel_len; ++j) {
+                double const t = center + static_cast<double>(p) / static_cast<double>(up_) - static_cast<double>(j);
+                double sinc = static_cast<double>(cutoff) / std::numbers::pi;
+                if (t != 0.0) {
+                    sinc = std::sin(static_cast<double>(cutoff) * t) / (std::numbers::pi * t);
                 }
+                double const u = t / half;
+                double const window = std::cyl_bessel_i(0.0, static_cast<double>(beta) * std::sqrt(std::max(0.0, 1.0 - u * u))) / i0_beta;
+                double const v = sinc * window;
+                phase_coeffs[pad + j] = static_cast<float>(v);
+                sum += v;
+            }
+            // 每个相位的直流增益归一化
+            for (size_t j = 0; j < taps_; ++j) {
+                phase_coeffs[j] = static_cast<float>(phase_coeffs[j] / sum);
             }
         }
+        latency_ = static_cast<float>(static_cast<double>(kernel_len) - 1.0 - center);
 
-        qwqdsp_window::Kaiser::ApplyWindow(kernel_block, beta, false);
+        advance_ = down_ / up_;
+        advance_frac_ = down_ % up_;
+        buffer_.assign(taps_ + advance_ + 1 + kChunkSize, 0.0f);
+        Reset();
     }
 
-    std::vector<float> Process(std::span<float> x) {
-        std::vector<float> r;
-
-        float phase = 0.0f;
-        int const ikernel_len = static_cast<int>(kernel_len_);
-        int const xsize = static_cast<int>(x.size());
-        int const half_len = (static_cast<int>(kernel_len_) - 1) / 2;
-        int xrpos = -(static_cast<int>(kernel_len_) - 1) / 2;
-
-        while (xrpos < xsize - half_len) {
-            float sum{};
-
-            if (phase == 0.0f) {
-                int const begin = std::max(0, -xrpos);
-                int const xibegin = std::max(0, xrpos);
-                int const len = std::min(ikernel_len, xsize - xibegin);
-                for (int i = begin; i < len; ++i) {
-                    size_t const krpos = static_cast<size_t>(i) * oversample_plus1_;
-                    float const kernel_v = kernel_[krpos];
-                    sum += kernel_v * x[static_cast<size_t>(xibegin + i)];
-                }
-            }
-            else {
-                float const frac = 1.0f - phase;
-                int const begin = std::max(0, -xrpos);
-                int const xibegin = std::max(0, xrpos + 1);
-                int const len = std::min(ikernel_len - 1, xsize - xibegin);
-                for (int i = begin; i < len; ++i) {
-                    float const krpos = static_cast<float>(static_cast<size_t>(i) * oversample_plus1_) + frac * static_cast<float>(oversample_plus1_);
-                    size_t const ikrpos = static_cast<size_t>(krpos);
-                    float const frac_krpos = krpos - std::floor(krpos);
-                    float const kernel_v = qwqdsp::Interpolation::Linear(kernel_[ikrpos], kernel_[ikrpos + 1], frac_krpos);
-                    sum += kernel_v * x[static_cast<size_t>(xibegin + i)];
+    /**
+     * @brief 清空历史样本，当作之前输入的都是0
+     */
+    void Reset() noexcept {
+        std::fill(buffer_.begin(), buffer_.end(), 0.0f);
+        filled_ = taps_ - 1;
+        rpos_ = 0;
+        phase_ = 0;
+    }
+
+    /**
+     * @return 再输入num_input个样本时Process会输出的样本数
+     */
+    size_t GetOutputSize(size_t num_input) const noexcept {
+        size_t const available = filled_ + num_input;
+        if (available < rpos_ + taps_) {
+            return 0;
+        }
+        size_t const num_steps = available - rpos_ - taps_;
+        return ((num_steps + 1) * up_ - phase_ + down_ - 1) / down_;
+    }
+
+    /**
+     * @return 输入num_input个样本时最多的输出数量，与状态无关，用来预先分配
+     */
+    size_t GetMaxOutputSize(size_t num_input) const noexcept {
+        return (num_input * up_ + down_ - 1) / down_ + 1;
+    }
+
+    /**
+     * @brief 输出相对输入的延迟，单位是输入的样本
+     */
+    float GetLatency() const noexcept {
+        return latency_;
+    }
+
+    /**
+     * @param out 至少GetOutputSize(in.size())长
+     * @return 输出的样本数，等于调用前的GetOutputSize(in.size())
+     */
+    size_t Process(std::span<const float> in, std::span<float> out) noexcept {
+        size_t num_out = 0;
+        size_t in_pos = 0;
+        while (in_pos < in.size()) {
+            size_t const cando = std::min(in.size() - in_pos, buffer_.size() - filled_);
+            std::copy_n(in.data() + in_pos, cando, buffer_.data() + filled_);
+            filled_ += cando;
+            in_pos += cando;
+
+            while (rpos_ + taps_ <= filled_) {
+                assert(num_out < out.size());
+                out[num_out++] = Dot(coeffs_.data() + phase_ * taps_, buffer_.data() + rpos_);
+                rpos_ += advance_;
+                phase_ += advance_frac_;
+                if (phase_ >= up_) {
+                    phase_ -= up_;
+                    ++rpos_;
                 }
             }
-            r.push_back(sum);
 
-            phase += phase_inc_;
-            xrpos += static_cast<int>(std::floor(phase));
-            phase = phase - std::floor(phase);
+            // 丢掉用过的样本，rpos_可能因为降采样跳过还没输入的样本
+            size_t const consumed = std::min(rpos_, filled_);
+            std::copy(buffer_.begin() + static_cast<std::ptrdiff_t>(consumed),
+                      buffer_.begin() + static_cast<std::ptrdiff_t>(filled_),
+                      buffer_.begin());
+            filled_ -= consumed;
+            rpos_ -= consumed;
         }
+        return num_out;
+    }
 
+    /**
+     * @brief 离线处理一整段，会先Reset
+     */
+    std::vector<float> Process(std::span<const float> x) {
+        Reset();
+        std::vector<float> r(GetOutputSize(x.size()));
+        Process(x, r);
         return r;
     }
 
+    size_t GetUpFactor() const noexcept {
+        return up_;
+    }
+
+    size_t GetDownFactor() const noexcept {
+        return down_;
+    }
+
 private:
-    float phase_inc_{};
-    size_t oversample_plus1_{};
-    size_t kernel_len_{};
-    std::vector<float> kernel_;
+    static constexpr size_t kChunkSize = 256;
+
+    void FindRatio(double ratio) noexcept {
+        // ratio = down / up，找误差最小的up
+        double best_error = 1e30;
+        for (size_t up = 1; up <= kMaxPhases; ++up) {
+            double const down = std::max(1.0, std::round(ratio * static_cast<double>(up)));
+            double const error = std::abs(down / static_cast<double>(up) - ratio);
+            if (error < best_error * (1.0 - 1e-9)) {
+                best_error = error;
+                up_ = up;
+                down_ = static_cast<size_t>(down);
+                if (error <= ratio * 1e-9) {
+                    break;
+                }
+            }
+        }
+    }
+
+    QWQDSP_FORCE_INLINE
+    float Dot(float const* coeffs, float const* x) const noexcept {
+        // kTapAlign个独立的累加器，编译器会展开成一条SIMD乘加
+        float sum[kTapAlign]{};
+        for (size_t i = 0; i < taps_; i += kTapAlign) {
+            QWQDSP_AUTO_VECTORLIZE
+            for (size_t j = 0; j < kTapAlign; ++j) {
+                sum[j] += coeffs[i + j] * x[i + j];
+            }
+        }
+        for (size_t j = kTapAlign / 2; j != 0; j /= 2) {
+            QWQDSP_AUTO_VECTORLIZE
+            for (size_t k = 0; k < j; ++k) {
+                sum[k] += sum[k + j];
+            }
+        }
+        return sum[0];
+    }
+
+    size_t up_{1};
+    size_t down_{1};
+    size_t taps_{};
+    // 每个输出前进down/up个输入样本
+    size_t advance_{};
+    size_t advance_frac_{};
+    float latency_{};
+    std::vector<float, qwqdsp_simd_element::AlignedAllocator<float, 32>> coeffs_;
+
+    std::vector<float> buffer_;
+    size_t filled_{};
+    size_t rpos_{};
+    size_t phase_{};
 };
 }
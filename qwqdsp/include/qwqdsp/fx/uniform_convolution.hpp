@@ -1,8 +1,10 @@
 #pragma once
 #include <algorithm>
+#include <array>
 #include <cstddef>
 #include "qwqdsp/spectral/real_fft.hpp"
 #include "qwqdsp/segement/analyze_auto.hpp"
+#include "qwqdsp/segement/ring.hpp"
 #include "qwqdsp/segement/slice.hpp"
 #include "qwqdsp/window/helper.hpp"
 
@@ -16,9 +18,7 @@ public:
         if (input_buffer_.size() < block_size) {
             input_buffer_.resize(block_size);
         }
-        if (output_buffer_.size() < fft_size * 2) {
-            output_buffer_.resize(fft_size * 2);
-        }
+        output_ring_.SetCapacity(fft_size * 2);
         process_buffer_.resize(fft_size);
         Reset();
     }
@@ -28,13 +28,12 @@ public:
     }
 
     void Reset() noexcept {
-        std::fill_n(output_buffer_.begin(), write_end_, 0.0f);
+        output_ring_.Reset();
         for (auto& f : input_frames_) {
             std::fill(f.begin(), f.end(), std::complex<float>{});
         }
         input_wpos_ = 0;
         input_frame_wpos_ = 0;
-        write_end_ = 0;
         write_add_end_ = 0;
     }
 
@@ -50,12 +49,35 @@ public:
             input_frames_[i].resize(fft_.NumBins());
         }
         output_frame_.resize(fft_.NumBins());
+
+        // IR的分块一次变换kMaxBatch个，只在这里用到批量变换的工作区
+        constexpr size_t kBatch = qwqdsp_spectral::RealFFT::kMaxBatch;
+        size_t const fft_size = fft_.FFTSize();
+        qwqdsp_spectral::RealFFT batch_fft;
+        batch_fft.Init(fft_size, kBatch);
+        std::vector<float> times(kBatch * fft_size);
+        std::array<float const*, kBatch> time_ptrs;
+        std::array<std::complex<float>*, kBatch> spectral_ptrs;
         size_t i = 0;
-        analyze.Process(ir, [this, &i](std::span<const float> block) {
-            qwqdsp_window::Helper::ZeroPad(process_buffer_, block);
-            fft_.FFT(process_buffer_, ir_frames_[i]);
+        size_t num_batched = 0;
+        auto flush = [&] {
+            batch_fft.FFTBatch({time_ptrs.data(), num_batched}, {spectral_ptrs.data(), num_batched});
+            num_batched = 0;
+        };
+        analyze.Process(ir, [&](std::span<const float> block) {
+            std::span<float> time{times.data() + num_batched * fft_size, fft_size};
+            qwqdsp_window::Helper::ZeroPad(time, block);
+            time_ptrs[num_batched] = time.data();
+            spectral_ptrs[num_batched] = ir_frames_[i].data();
+            ++num_batched;
             ++i;
+            if (num_batched == kBatch) {
+                flush();
+            }
         });
+        if (num_batched != 0) {
+            flush();
+        }
     }
 
     void Process(std::span<float> block) noexcept {
@@ -85,10 +107,7 @@ public:
                 }
 
                 fft_.IFFT(process_buffer_, output_frame_);
-                for (int i = 0; i < block_size_ * 2; i++) {
-                    output_buffer_[i + write_add_end_] += process_buffer_[i];
-                }
-                write_end_ = write_add_end_ + block_size_ * 2;
+                output_ring_.Add(write_add_end_, {process_buffer_.data(), block_size_ * 2});
                 write_add_end_ += block_size_;
                 ++input_frame_wpos_;
                 if (input_frame_wpos_ >= ir_frames_.size()) {
@@ -98,23 +117,8 @@ public:
 
             if (write_add_end_ >= in.size()) {
                 // extract output
-                int extractSize = in.size();
-                for (int i = 0; i < extractSize; ++i) {
-                    in[i] = output_buffer_[i];
-                }
-                
-                // shift output buffer
-                int shiftSize = write_end_ - extractSize;
-                for (int i = 0; i < shiftSize; i++) {
-                    output_buffer_[i] = output_buffer_[i + extractSize];
-                }
-                write_add_end_ -= extractSize;
-                int newWriteEnd = write_end_ - extractSize;
-                // zero shifed buffer
-                for (int i = newWriteEnd; i < write_end_; ++i) {
-                    output_buffer_[i] = 0.0f;
-                }
-                write_end_ = newWriteEnd;
+                output_ring_.Extract(in);
+                write_add_end_ -= in.size();
             }
             else {
                 // zero buffer
@@ -127,11 +131,10 @@ private:
 
     size_t block_size_{};
     size_t input_wpos_{};
-    size_t write_end_{};
     size_t write_add_end_{};
     std::vector<float> input_buffer_;
     std::vector<float> process_buffer_;
-    std::vector<float> output_buffer_;
+    qwqdsp_segement::OverlapAddRing output_ring_;
 
     qwqdsp_spectral::RealFFT fft_;
     std::vector<Frame> ir_frames_;
@@ -2,6 +2,7 @@
 #include <cmath>
 #include <numbers>
 #include <complex>
+#include "qwqdsp/extension_marcos.hpp"
 
 namespace qwqdsp_oscillator::blep_coeff {
 static constexpr float x2(float x) noexcept {
@@ -111,12 +112,17 @@ struct BlackmanNutall {
     }
 };
 
+/**
+ * @note 只有四则运算，x也可以是qwqdsp_simd_element::PackFloat
+ */
 struct BlackmanNutallApprox {
     static constexpr float kHalfLen = 3.0f;
-    static float GetBlepHalf(float x) noexcept {
-        auto x2_ = x2(x);
-        auto x3_ = x3(x);
-        auto x4_ = x4(x);
+    template<class T>
+    QWQDSP_FORCE_INLINE
+    static T GetBlepHalf(T x) noexcept {
+        auto x2_ = x * x;
+        auto x3_ = x2_ * x;
+        auto x4_ = x2_ * x2_;
         // auto x5_ = x5(x);
         // auto up = -2.7673817498867354050e-16f + 0.45840339972415986730f * x
         //     - 0.16891181699025579563f * x2_ + 0.037114527838740719608f * x3_
@@ -126,17 +132,19 @@ struct BlackmanNutallApprox {
         // return up / down - 0.5f;
         auto up = -6.1021365199045747765e-15f + 0.45843297259388023674f * x
             - 0.21663097430062709809f * x2_ + 0.045461384847873654394f * x3_;
-        auto down = 1 - 0.47068729933220605095f * x + 0.29689585628509952473f * x2_
+        auto down = 1.0f - 0.47068729933220605095f * x + 0.29689585628509952473f * x2_
             - 0.081682128563515880655f * x3_ + 0.015452559765959259491f * x4_;
         return up / down - 0.5f;
     }
 
-    static float GetBlampHalf(float x) noexcept {
-        auto x2_ = x2(x);
-        auto x3_ = x3(x);
-        auto x4_ = x4(x);
+    template<class T>
+    QWQDSP_FORCE_INLINE
+    static T GetBlampHalf(T x) noexcept {
+        auto x2_ = x * x;
+        auto x3_ = x2_ * x;
+        auto x4_ = x2_ * x2_;
         auto up = 0.34004f - 0.460155f * x + 0.23447f * x2_ - 0.0533133f * x3_ + 0.0045636f * x4_;
-        auto down = 1 + 0.116039f * x + 0.196071f * x2_ + 0.0203012f * x3_ + 0.0337397f * x4_;
+        auto down = 1.0f + 0.116039f * x + 0.196071f * x2_ + 0.0203012f * x3_ + 0.0337397f * x4_;
         return up / down;
     }
 };
@@ -1,5 +1,9 @@
 #pragma once
+#include <algorithm>
 #include <complex>
+#include <span>
+#include "qwqdsp/extension_marcos.hpp"
+#include "qwqdsp/polymath.hpp"
 #include "qwqdsp/oscillator/table_sine_v3.hpp"
 
 namespace qwqdsp_oscillator {
@@ -40,6 +44,25 @@ public:
         return (up1 + up2 + up3) / down;
     }
 
+    /**
+     * @brief 等价于连续调用out.size()次Tick
+     *        每kBlockLanes个样本的相位独立计算，用多项式sin/cos代替查表，编译器可以展开成SIMD
+     */
+    void ProcessBlock(std::span<float> out) noexcept {
+        float* dst = out.data();
+        size_t remain = out.size();
+        while (remain != 0) {
+            size_t const cando = std::min(remain, kBlockLanes);
+            float lanes[kBlockLanes];
+            TickLanes(lanes);
+            std::copy_n(lanes, cando, dst);
+            w_phase_ += static_cast<uint32_t>(cando) * w_inc_;
+            w0_phase_ += static_cast<uint32_t>(cando) * w0_inc_;
+            dst += cando;
+            remain -= cando;
+        }
+    }
+
     /**
      * @param w0 0~pi
      */
@@ -103,6 +126,61 @@ private:
         a_pow_n_ = std::pow(a_, static_cast<float>(n_));
     }
 
+    static constexpr size_t kBlockLanes = 8;
+
+    /**
+     * @brief 完整周期的uint32相位 -> [-pi, pi)
+     */
+    QWQDSP_FORCE_INLINE
+    static float Phase2Radian(uint32_t phase) noexcept {
+        constexpr float kScale = std::numbers::pi_v<float> / 2147483648.0f;
+        return static_cast<float>(static_cast<int32_t>(phase)) * kScale;
+    }
+
+    /**
+     * @brief 计算之后kBlockLanes个样本，不推进相位
+     */
+    QWQDSP_FORCE_INLINE
+    void TickLanes(float* out) const noexcept {
+        float u[kBlockLanes];
+        float v[kBlockLanes];
+        float v_nsub1[kBlockLanes];
+        float v_n[kBlockLanes];
+        QWQDSP_AUTO_VECTORLIZE
+        for (size_t i = 0; i < kBlockLanes; ++i) {
+            uint32_t const lane = static_cast<uint32_t>(i + 1);
+            uint32_t const w_phase = w_phase_ + lane * w_inc_;
+            u[i] = Phase2Radian(w0_phase_ + lane * w0_inc_);
+            v[i] = Phase2Radian(w_phase);
+            v_nsub1[i] = Phase2Radian((n_ - 1) * w_phase);
+            v_n[i] = Phase2Radian(n_ * w_phase);
+        }
+
+        float const a = a_;
+        float const a_pow_n = a_pow_n_;
+        float const down_bias = 1.0f + a * a;
+        QWQDSP_AUTO_VECTORLIZE
+        for (size_t i = 0; i < kBlockLanes; ++i) {
+            float const sinu = qwqdsp::polymath::SinCycle(u[i]);
+            float const cosu = qwqdsp::polymath::CosCycle(u[i]);
+            float const sinv = qwqdsp::polymath::SinCycle(v[i]);
+            float const cosv = qwqdsp::polymath::CosCycle(v[i]);
+            float const sinv_nsub1 = qwqdsp::polymath::SinCycle(v_nsub1[i]);
+            float const cosv_nsub1 = qwqdsp::polymath::CosCycle(v_nsub1[i]);
+            float const sinv_n = qwqdsp::polymath::SinCycle(v_n[i]);
+            float const cosv_n = qwqdsp::polymath::CosCycle(v_n[i]);
+
+            float const up1 = -a * (cosv * cosu + sinv * sinu);
+            float const up2 = cosu;
+            float const up3 = a_pow_n * (
+                a * (cosu * cosv_nsub1 - sinu * sinv_nsub1)
+                - (cosu * cosv_n - sinu * sinv_n)
+            );
+            float const down = down_bias - 2.0f * a * cosv;
+            out[i] = (up1 + up2 + up3) / down;
+        }
+    }
+
     qwqdsp_oscillator::TableSineV3<float, kLookupTableFracBits> sine_lut_;
     uint32_t w0_phase_{};
     uint32_t w_phase_{};
@@ -3,6 +3,11 @@
 #include "qwqdsp/oscillator/blep_coeff.hpp"
 #include "qwqdsp/polymath.hpp"
 
+namespace qwqdsp_simd_element {
+template<class TCoeff, size_t N>
+class PolyBlepSync;
+}
+
 namespace qwqdsp_oscillator {
 /**
  * @note
@@ -257,6 +262,9 @@ public:
         return out;
     }
 private:
+    template<class, size_t>
+    friend class qwqdsp_simd_element::PolyBlepSync;
+
     static float NaiveSaw(float phase) noexcept {
         return phase;
     }
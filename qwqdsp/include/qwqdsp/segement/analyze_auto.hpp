@@ -1,13 +1,16 @@
 #pragma once
+#include <algorithm>
 #include <cstddef>
 #include <span>
 #include <cmath>
+#include "ring.hpp"
 #include "slice.hpp"
 
 namespace qwqdsp_segement {
 /**
  * @brief 仅支持分析的自动分块
- * @tparam kOffline true: 会将不足的部分也处理. false:适合实时音频流
+ * @tparam kOffline true: 会将不足的部分补0处理，帧的起点是所有小于输入长度的 k*hop. false:适合实时音频流
+ * @note 输入是镜像的环形缓冲，取帧时不移动数据
  */
 template<bool kOffline>
 class AnalyzeAuto {
@@ -24,26 +27,24 @@ public:
         while (!input.IsEnd()) {
             size_t need = size_ - input_wpos_;
             auto in = input.GetSome(need);
-            std::copy(in.begin(), in.end(), input_buffer_.begin() + input_wpos_);
+            input_ring_.Push(in);
             input_wpos_ += in.size();
             if (input_wpos_ >= size_) {
-                func({input_buffer_.data(), size_});
+                func(input_ring_.Latest(size_));
                 input_wpos_ -= hop_;
-                for (int i = 0; i < input_wpos_; i++) {
-                    input_buffer_[i] = input_buffer_[i + hop_];
-                }
             }
         }
         if constexpr (kOffline) {
-            while (input_wpos_ > 0) {
-                size_t need = size_ - input_wpos_;
-                std::fill_n(input_buffer_.begin() + input_wpos_, need, 0.0f);
-                input_wpos_ -= std::min(input_wpos_, hop_);
-                for (int i = 0; i < input_wpos_; i++) {
-                    input_buffer_[i] = input_buffer_[i + hop_];
-                }
-                func({input_buffer_.data(), size_});
+            // 剩下的样本补0继续按hop取帧，直到帧的起点越过最后一个样本
+            // 所以每一帧都是输入补0之后在 k*hop 处的窗口，不会混入上一帧留下的数据
+            size_t remain = input_wpos_;
+            while (remain > 0) {
+                input_ring_.PushZeros(size_ - input_wpos_);
+                func(input_ring_.Latest(size_));
+                input_wpos_ = size_ - hop_;
+                remain -= std::min(remain, hop_);
             }
+            input_wpos_ = 0;
         }
     }
 
@@ -53,9 +54,8 @@ public:
 
     void SetSize(size_t size) noexcept {
         size_ = size;
-        if (input_buffer_.size() < size) {
-            input_buffer_.resize(size);
-        }
+        input_ring_.SetCapacity(size);
+        input_wpos_ = 0;
     }
 
     void SetHop(size_t hop) noexcept {
@@ -63,10 +63,11 @@ public:
     }
 
     void Reset() noexcept {
+        input_ring_.Reset();
         input_wpos_ = 0;
     }
 private:
-    std::vector<float> input_buffer_;
+    MirrorRing input_ring_;
     size_t size_{};
     size_t hop_{};
     size_t input_wpos_{};
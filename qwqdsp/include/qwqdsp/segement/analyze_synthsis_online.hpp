@@ -2,11 +2,14 @@
 #include <algorithm>
 #include <cstddef>
 #include <span>
+#include <vector>
+#include "ring.hpp"
 #include "slice.hpp"
 
 namespace qwqdsp_segement {
 /**
  * @brief 适用于实时处理的分析合成
+ *        输入和叠加输出都是环形缓冲，每个hop只复制hop个样本
  */
 class AnalyzeSynthsisOnline {
 public:
@@ -19,43 +22,26 @@ public:
         Func&& func
     ) noexcept(noexcept(func(std::declval<std::span<const float>>(), std::declval<std::span<float>>()))) {
         Slice1D input{block};
+        float const norm = static_cast<float>(size_) / static_cast<float>(hop_);
         while (!input.IsEnd()) {
             size_t need = size_ - input_wpos_;
             auto in = input.GetSome(need);
-            std::copy(in.begin(), in.end(), input_buffer_.begin() + input_wpos_);
+            input_ring_.Push(in);
             input_wpos_ += in.size();
             if (input_wpos_ >= size_) {
-                func(std::span<const float>{input_buffer_.data(), size_}, std::span<float>{process_buffer_.data(), size_});
+                func(input_ring_.Latest(size_), std::span<float>{process_buffer_.data(), size_});
                 input_wpos_ -= hop_;
-                for (size_t i = 0; i < input_wpos_; i++) {
-                    input_buffer_[i] = input_buffer_[i + hop_];
-                }
-                for (size_t i = 0; i < size_; i++) {
-                    output_buffer_[i + write_add_end_] += process_buffer_[i];
-                }
-                write_end_ = write_add_end_ + size_;
+                output_ring_.Add(write_add_end_, {process_buffer_.data(), size_});
                 write_add_end_ += hop_;
             }
 
             if (write_add_end_ >= in.size()) {
                 // extract output
-                int extractSize = in.size();
-                for (int i = 0; i < extractSize; ++i) {
-                    in[i] = output_buffer_[i] / ((float)size_ / hop_);
-                }
-                
-                // shift output buffer
-                int shiftSize = write_end_ - extractSize;
-                for (int i = 0; i < shiftSize; i++) {
-                    output_buffer_[i] = output_buffer_[i + extractSize];
+                output_ring_.Extract(in);
+                for (auto& x : in) {
+                    x /= norm;
                 }
-                write_add_end_ -= extractSize;
-                int newWriteEnd = write_end_ - extractSize;
-                // zero shifed buffer
-                for (size_t i = newWriteEnd; i < write_end_; ++i) {
-                    output_buffer_[i] = 0.0f;
-                }
-                write_end_ = newWriteEnd;
+                write_add_end_ -= in.size();
             }
             else {
                 // zero buffer
@@ -66,35 +52,37 @@ public:
 
     void SetSize(size_t size) noexcept {
         size_ = size;
-        if (input_buffer_.size() < size) {
-            input_buffer_.resize(size);
-        }
-        if (output_buffer_.size() < (size + hop_) * 2) {
-            output_buffer_.resize((size + hop_) * 2);
-        }
         if (process_buffer_.size() < size) {
             process_buffer_.resize(size);
         }
+        UpdateCapacity();
     }
 
     void SetHop(size_t hop) noexcept {
         hop_ = hop;
+        UpdateCapacity();
     }
 
     void Reset() noexcept {
-        std::fill_n(output_buffer_.begin(), write_end_, 0.0f);
+        input_ring_.Reset();
+        output_ring_.Reset();
         input_wpos_ = 0;
-        write_end_ = 0;
         write_add_end_ = 0;
     }
 private:
-    std::vector<float> input_buffer_;
+    void UpdateCapacity() noexcept {
+        input_ring_.SetCapacity(size_);
+        output_ring_.SetCapacity((size_ + hop_) * 2);
+        input_wpos_ = 0;
+        write_add_end_ = 0;
+    }
+
+    MirrorRing input_ring_;
+    OverlapAddRing output_ring_;
     std::vector<float> process_buffer_;
-    std::vector<float> output_buffer_;
     size_t size_{};
     size_t hop_{};
     size_t input_wpos_{};
-    size_t write_end_{};
     size_t write_add_end_{};
 };
 }
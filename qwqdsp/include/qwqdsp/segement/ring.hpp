@@ -0,0 +1,145 @@
+#pragma once
+#include <algorithm>
+#include <bit>
+#include <cassert>
+#include <cstddef>
+#include <span>
+#include <vector>
+
+namespace qwqdsp_segement {
+/**
+ * @brief 2^N长度的环形输入缓冲，每个样本写两次(镜像)，任意时刻最近的capacity个样本都是连续的
+ *        取帧时不需要移动数据
+ * @tparam T float或者PackFloat这类可以默认构造为0的样本
+ */
+template<class T>
+class BasicMirrorRing {
+public:
+    /**
+     * @param min_capacity 可以取出的最长帧
+     */
+    void SetCapacity(size_t min_capacity) {
+        size_t const capacity = std::bit_ceil(std::max<size_t>(min_capacity, 1));
+        if (capacity != capacity_) {
+            capacity_ = capacity;
+            buffer_.assign(capacity * 2, T{});
+        }
+        mask_ = capacity_ - 1;
+        Reset();
+    }
+
+    void Reset() noexcept {
+        std::fill(buffer_.begin(), buffer_.end(), T{});
+        wpos_ = 0;
+    }
+
+    void Push(std::span<const T> x) noexcept {
+        T const* src = x.data();
+        size_t remain = x.size();
+        while (remain != 0) {
+            size_t const cando = std::min(remain, capacity_ - wpos_);
+            std::copy_n(src, cando, buffer_.data() + wpos_);
+            std::copy_n(src, cando, buffer_.data() + wpos_ + capacity_);
+            wpos_ = (wpos_ + cando) & mask_;
+            src += cando;
+            remain -= cando;
+        }
+    }
+
+    void PushZeros(size_t num) noexcept {
+        while (num != 0) {
+            size_t const cando = std::min(num, capacity_ - wpos_);
+            std::fill_n(buffer_.data() + wpos_, cando, T{});
+            std::fill_n(buffer_.data() + wpos_ + capacity_, cando, T{});
+            wpos_ = (wpos_ + cando) & mask_;
+            num -= cando;
+        }
+    }
+
+    /**
+     * @return 最近写入的size个样本，从旧到新
+     */
+    std::span<const T> Latest(size_t size) const noexcept {
+        assert(size <= capacity_);
+        size_t const start = (wpos_ + capacity_ - size) & mask_;
+        return {buffer_.data() + start, size};
+    }
+
+private:
+    std::vector<T> buffer_;
+    size_t capacity_{};
+    size_t mask_{};
+    size_t wpos_{};
+};
+
+using MirrorRing = BasicMirrorRing<float>;
+
+/**
+ * @brief 2^N长度的环形叠加输出缓冲，读出的部分直接清零，不需要移动数据
+ * @tparam T float或者PackFloat这类可以默认构造为0的样本
+ */
+template<class T>
+class BasicOverlapAddRing {
+public:
+    /**
+     * @param min_capacity 读位置之后同时存在的最长数据
+     */
+    void SetCapacity(size_t min_capacity) {
+        size_t const capacity = std::bit_ceil(std::max<size_t>(min_capacity, 1));
+        if (capacity != buffer_.size()) {
+            buffer_.assign(capacity, T{});
+        }
+        mask_ = capacity - 1;
+        Reset();
+    }
+
+    void Reset() noexcept {
+        std::fill(buffer_.begin(), buffer_.end(), T{});
+        rpos_ = 0;
+    }
+
+    /**
+     * @brief 叠加到读位置之后offset处
+     */
+    void Add(size_t offset, std::span<const T> x) noexcept {
+        assert(offset + x.size() <= buffer_.size());
+        size_t pos = (rpos_ + offset) & mask_;
+        T const* src = x.data();
+        size_t remain = x.size();
+        while (remain != 0) {
+            size_t const cando = std::min(remain, buffer_.size() - pos);
+            T* dst = buffer_.data() + pos;
+            for (size_t i = 0; i < cando; ++i) {
+                dst[i] += src[i];
+            }
+            pos = (pos + cando) & mask_;
+            src += cando;
+            remain -= cando;
+        }
+    }
+
+    /**
+     * @brief 取出读位置开始的out.size()个样本并清零，读位置前进
+     */
+    void Extract(std::span<T> out) noexcept {
+        T* dst = out.data();
+        size_t remain = out.size();
+        while (remain != 0) {
+            size_t const cando = std::min(remain, buffer_.size() - rpos_);
+            T* src = buffer_.data() + rpos_;
+            std::copy_n(src, cando, dst);
+            std::fill_n(src, cando, T{});
+            rpos_ = (rpos_ + cando) & mask_;
+            dst += cando;
+            remain -= cando;
+        }
+    }
+
+private:
+    std::vector<T> buffer_;
+    size_t mask_{};
+    size_t rpos_{};
+};
+
+using OverlapAddRing = BasicOverlapAddRing<float>;
+}
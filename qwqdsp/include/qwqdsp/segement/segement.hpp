@@ -3,4 +3,5 @@
 #include "analyze_synthsis_offline.hpp"
 #include "analyze_synthsis_online.hpp"
 #include "analyze.hpp"
+#include "ring.hpp"
 #include "slice.hpp"
@@ -0,0 +1,283 @@
+#pragma once
+#include <limits>
+#include "simd_pack.hpp"
+#include "qwqdsp/adsr_envelope.hpp"
+
+namespace qwqdsp_simd_element {
+/**
+ * @brief qwqdsp::AdsrEnvelope的多通道版本，每个通道是一个独立的包络
+ * @note 每个采样点所有通道一起推进，只有某个通道到达段落边界时才逐通道切换状态，
+ *       段落的增量和标量版本一样在进入段落时用剩余采样数计算，所以输出逐位相同
+ *       用Load/Store和标量版本交换状态
+ */
+template<size_t N>
+class AdsrEnvelope {
+public:
+    using Pack = PackFloat<N>;
+    using Mask = PackUint32<N>;
+    using Scalar = qwqdsp::AdsrEnvelope;
+    using State = Scalar::State;
+
+    void Load(size_t lane, Scalar const& env) noexcept {
+        state_[lane] = env.state_;
+        phase_[lane] = env.phase_;
+        attack_samples_[lane] = env.attack_samples_;
+        decay_samples_[lane] = env.decay_samples_;
+        release_samples_[lane] = env.release_samples_;
+        sustain_level_[lane] = env.sustain_level_;
+        last_out_[lane] = env.last_out_;
+    }
+
+    void Store(size_t lane, Scalar& env) const noexcept {
+        env.state_ = state_[lane];
+        env.phase_ = phase_[lane];
+        env.last_out_ = last_out_[lane];
+    }
+
+    /**
+     * @param block N个通道的输出，每个至少num_samples
+     */
+    void Process(float* const* block, size_t num_samples) noexcept {
+        ProcessImpl<false>(block, num_samples);
+    }
+
+    void ProcessExp(float* const* block, size_t num_samples) noexcept {
+        ProcessImpl<true>(block, num_samples);
+    }
+private:
+    static constexpr float kMaxFloat = std::numeric_limits<float>::max();
+    static constexpr int kNoEnd = std::numeric_limits<int>::max();
+
+    template<bool kExp>
+    void ProcessImpl(float* const* block, size_t num_samples) noexcept {
+        if (num_samples == 0) {
+            return;
+        }
+        int const samples = static_cast<int>(num_samples);
+        for (size_t lane = 0; lane < N; ++lane) {
+            Enter<kExp>(lane, samples);
+            while (SegmentDone<kExp>(lane)) {
+                Leave<kExp>(lane);
+                Enter<kExp>(lane, samples);
+            }
+        }
+
+        int i = 0;
+        while (i < samples) {
+            if (i != 0 && PackOps::Any(SegmentDoneMask<kExp>())) {
+                for (size_t lane = 0; lane < N; ++lane) {
+                    while (SegmentDone<kExp>(lane)) {
+                        Leave<kExp>(lane);
+                        Enter<kExp>(lane, samples - i);
+                    }
+                }
+            }
+
+            if constexpr (kExp) {
+                for (size_t lane = 0; lane < N; ++lane) {
+                    block[lane][i] = value_[lane];
+                }
+                value_ = PackOps::Select(exp_, target_ + factor_ * (value_ - target_), value_ + inc_);
+                left_ -= 1;
+                ++i;
+            }
+            else {
+                // 线性段在某个通道到达边界之前只是累加，每个通道一次写完这一段
+                int run = samples - i;
+                for (size_t lane = 0; lane < N; ++lane) {
+                    run = std::min(run, left_[lane]);
+                }
+                for (size_t lane = 0; lane < N; ++lane) {
+                    float v = value_[lane];
+                    float const inc = inc_[lane];
+                    float* out = block[lane] + i;
+                    for (int k = 0; k < run; ++k) {
+                        out[k] = v;
+                        v += inc;
+                    }
+                    value_[lane] = v;
+                }
+                left_ -= run;
+                i += run;
+            }
+        }
+
+        for (size_t lane = 0; lane < N; ++lane) {
+            Leave<kExp>(lane);
+        }
+    }
+
+    template<bool kExp>
+    QWQDSP_FORCE_INLINE
+    Mask SegmentDoneMask() const noexcept {
+        Mask done = left_ == PackInt32<N>::vBroadcast(0);
+        if constexpr (kExp) {
+            done |= (value_ >= upper_) | (value_ <= lower_);
+        }
+        return done;
+    }
+
+    template<bool kExp>
+    bool SegmentDone(size_t lane) const noexcept {
+        if (left_[lane] == 0) {
+            return true;
+        }
+        if constexpr (kExp) {
+            return !(value_[lane] < upper_[lane] && value_[lane] > lower_[lane]);
+        }
+        return false;
+    }
+
+    /**
+     * @brief 和标量版本每个case开头一样，用剩余的samples个采样点设置这一段
+     */
+    template<bool kExp>
+    void Enter(size_t lane, int samples) noexcept {
+        float const begin_val = last_out_[lane];
+        value_[lane] = begin_val;
+        inc_[lane] = 0.0f;
+        factor_[lane] = 0.0f;
+        target_[lane] = 0.0f;
+        upper_[lane] = kMaxFloat;
+        lower_[lane] = -kMaxFloat;
+        exp_[lane] = Mask::kFalse;
+        left_[lane] = samples;
+        seg_len_[lane] = samples;
+
+        auto linear = [&](int total, float target) {
+            int const can_do = std::clamp(total - phase_[lane], 0, samples);
+            inc_[lane] = (target - begin_val) / static_cast<float>(total - phase_[lane]);
+            left_[lane] = can_do;
+            seg_len_[lane] = can_do;
+        };
+        auto smooth = [&](int total, float target) {
+            exp_[lane] = Mask::kTrue;
+            factor_[lane] = Scalar::ComputeSmoothFactor(static_cast<float>(total));
+            target_[lane] = target;
+            left_[lane] = kNoEnd;
+        };
+
+        switch (state_[lane]) {
+            case State::Init:
+                value_[lane] = 0.0f;
+                phase_[lane] = 0;
+                last_out_[lane] = 0.0f;
+                break;
+            case State::Attack:
+                if constexpr (kExp) {
+                    smooth(attack_samples_[lane], 1.0f);
+                    upper_[lane] = 1.0f - 1e-3f;
+                }
+                else {
+                    linear(attack_samples_[lane], 1.0f);
+                }
+                break;
+            case State::Decay:
+                if constexpr (kExp) {
+                    smooth(decay_samples_[lane], sustain_level_[lane]);
+                    lower_[lane] = sustain_level_[lane];
+                }
+                else {
+                    linear(decay_samples_[lane], sustain_level_[lane]);
+                }
+                break;
+            case State::Sustain:
+                inc_[lane] = (sustain_level_[lane] - begin_val) / static_cast<float>(samples);
+                break;
+            case State::Release:
+                if constexpr (kExp) {
+                    smooth(release_samples_[lane], 0.0f);
+                    lower_[lane] = 1e-3f;
+                }
+                else {
+                    linear(release_samples_[lane], 0.0f);
+                }
+                break;
+        }
+    }
+
+    /**
+     * @brief 和标量版本每个case结尾一样，保存输出并检查是否进入下一段
+     */
+    template<bool kExp>
+    void Leave(size_t lane) noexcept {
+        float const end_val = value_[lane];
+        switch (state_[lane]) {
+            case State::Init:
+                break;
+            case State::Attack:
+                last_out_[lane] = end_val;
+                if constexpr (kExp) {
+                    if (end_val >= 1.0f - 1e-3f) {
+                        state_[lane] = State::Decay;
+                    }
+                }
+                else {
+                    phase_[lane] += seg_len_[lane];
+                    if (phase_[lane] >= attack_samples_[lane]) {
+                        state_[lane] = State::Decay;
+                        phase_[lane] = 0;
+                        last_out_[lane] = 1.0f;
+                    }
+                }
+                break;
+            case State::Decay:
+                last_out_[lane] = end_val;
+                if constexpr (kExp) {
+                    if (end_val <= sustain_level_[lane]) {
+                        state_[lane] = State::Sustain;
+                    }
+                }
+                else {
+                    phase_[lane] += seg_len_[lane];
+                    if (phase_[lane] >= decay_samples_[lane]) {
+                        state_[lane] = State::Sustain;
+                        phase_[lane] = 0;
+                        last_out_[lane] = sustain_level_[lane];
+                    }
+                }
+                break;
+            case State::Sustain:
+                last_out_[lane] = end_val;
+                phase_[lane] = 0;
+                break;
+            case State::Release:
+                last_out_[lane] = end_val;
+                if constexpr (kExp) {
+                    if (end_val <= 1e-3f) {
+                        state_[lane] = State::Init;
+                    }
+                }
+                else {
+                    phase_[lane] += seg_len_[lane];
+                    if (phase_[lane] >= release_samples_[lane]) {
+                        state_[lane] = State::Init;
+                        phase_[lane] = 0;
+                        last_out_[lane] = 0.0f;
+                    }
+                }
+                break;
+        }
+    }
+
+    // 每个采样点一起推进的状态
+    Pack value_{};
+    Pack inc_{};
+    Pack factor_{};
+    Pack target_{};
+    Pack upper_{};
+    Pack lower_{};
+    Mask exp_{};
+    PackInt32<N> left_{};
+
+    // 段落边界才用到的状态
+    State state_[N]{};
+    int phase_[N]{};
+    int seg_len_[N]{};
+    int attack_samples_[N]{};
+    int decay_samples_[N]{};
+    int release_samples_[N]{};
+    float sustain_level_[N]{};
+    float last_out_[N]{};
+};
+}
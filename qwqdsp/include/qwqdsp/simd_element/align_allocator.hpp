@@ -39,7 +39,9 @@ public:
 #ifdef _MSC_VER
         ptr = _aligned_malloc(n * sizeof(T), Alignment);
 #else
-        ptr = std::aligned_alloc(Alignment, n * sizeof(T));
+        // aligned_alloc要求大小是对齐的整数倍
+        size_t const bytes = (n * sizeof(T) + Alignment - 1) / Alignment * Alignment;
+        ptr = std::aligned_alloc(Alignment, bytes);
 #endif
         if (ptr == nullptr) {
             throw std::bad_alloc{};
@@ -0,0 +1,83 @@
+#pragma once
+#include "simd_pack.hpp"
+#include "qwqdsp/oscillator/blep_coeff.hpp"
+
+namespace qwqdsp_simd_element {
+/**
+ * @brief qwqdsp_oscillator::PolyBlep的静态波形，每个通道是一个独立的振荡器
+ * @tparam TCoeff GetBlepHalf/GetBlampHalf必须接受PackFloat，例如BlackmanNutallApprox
+ * @note phase在[0,1)，phase_inc在(0,1)，和标量版本一样会先把phase推进一次phase_inc
+ */
+template<class TCoeff, size_t N>
+class PolyBlep {
+public:
+    using Pack = PackFloat<N>;
+
+    QWQDSP_FORCE_INLINE
+    static Pack Sawtooth(Pack phase, Pack const& phase_inc) noexcept {
+        phase = Wrap(phase + phase_inc);
+        Pack const t = phase * 2.0f - 1.0f;
+        Pack const blep = 2.0f * Blep(phase, phase_inc);
+        return t - blep;
+    }
+
+    QWQDSP_FORCE_INLINE
+    static Pack PWM_Classic(Pack const& phase, Pack const& phase_inc, float pwm) noexcept {
+        return PWM_Classic(phase, phase_inc, Pack::vBroadcast(pwm));
+    }
+
+    /**
+     * @brief 每个通道一个pwm
+     */
+    QWQDSP_FORCE_INLINE
+    static Pack PWM_Classic(Pack phase, Pack const& phase_inc, Pack const& pwm) noexcept {
+        phase = Wrap(phase + phase_inc);
+        Pack const dt = PackOps::Min(phase_inc, Pack::vBroadcast(0.5f / TCoeff::kHalfLen));
+        Pack const pwm_clamp = PackOps::Clamp(pwm, TCoeff::kHalfLen * dt, 1.0f - TCoeff::kHalfLen * dt);
+        Pack const t = PackOps::Select(phase < pwm_clamp, 1.0f - pwm_clamp, 0.0f - pwm_clamp);
+        Pack const blep = Blep(phase, phase_inc) - BlepOffset(phase, dt, pwm_clamp);
+        return (t + blep) * 2.0f;
+    }
+
+    QWQDSP_FORCE_INLINE
+    static Pack Triangle(Pack phase, Pack const& phase_inc) noexcept {
+        phase = Wrap(phase + phase_inc);
+        Pack const t = PackOps::Select(phase < Pack::vBroadcast(0.5f), 1.0f - 4.0f * phase, 4.0f * phase - 3.0f);
+        Pack const phase2_wrap = Wrap(phase + 0.5f);
+        return t + 8.0f * phase_inc * (Blamp(phase2_wrap, phase_inc) - Blamp(phase, phase_inc));
+    }
+
+    /**
+     * @brief [0,2) -> [0,1)
+     */
+    QWQDSP_FORCE_INLINE
+    static Pack Wrap(Pack const& phase) noexcept {
+        return phase - PackOps::Select(phase >= Pack::vBroadcast(1.0f), 1.0f, 0.0f);
+    }
+private:
+    QWQDSP_FORCE_INLINE
+    static Pack Blep(Pack const& t, Pack const& dt) noexcept {
+        Pack const half_len = Pack::vBroadcast(TCoeff::kHalfLen);
+        Pack const t1 = PackOps::Min(t / dt, half_len);
+        Pack const t2 = PackOps::Min((1.0f - t) / dt, half_len);
+        return TCoeff::GetBlepHalf(t1) - TCoeff::GetBlepHalf(t2);
+    }
+
+    QWQDSP_FORCE_INLINE
+    static Pack BlepOffset(Pack const& t, Pack const& dt, Pack const& offset) noexcept {
+        Pack x = (t - offset) / dt;
+        x = PackOps::Clamp(x, Pack::vBroadcast(-TCoeff::kHalfLen), Pack::vBroadcast(TCoeff::kHalfLen));
+        Pack const y = PackOps::Abs(TCoeff::GetBlepHalf(PackOps::Abs(x)));
+        // -copysign(y, x)
+        return PackOps::Select(x < Pack::vBroadcast(0.0f), y, -1.0f * y);
+    }
+
+    QWQDSP_FORCE_INLINE
+    static Pack Blamp(Pack const& t, Pack const& dt) noexcept {
+        Pack const half_len = Pack::vBroadcast(TCoeff::kHalfLen);
+        Pack const t1 = PackOps::Min(t / dt, half_len);
+        Pack const t2 = PackOps::Min((1.0f - t) / dt, half_len);
+        return TCoeff::GetBlampHalf(t1) + TCoeff::GetBlampHalf(t2);
+    }
+};
+}
@@ -0,0 +1,310 @@
+#pragma once
+#include <numbers>
+#include "simd_pack.hpp"
+#include "qwqdsp/oscillator/polyblep_sync.hpp"
+
+namespace qwqdsp_simd_element {
+/**
+ * @brief qwqdsp_oscillator::PolyBlepSync的多通道版本，每个通道是一个独立的振荡器
+ * @tparam TCoeff GetBlepHalf/GetBlampHalf必须接受PackFloat，例如BlackmanNutallApprox
+ * @note 每个通道的分支用掩码处理，blep只在有通道需要时插入，没有跳跃的通道保持不变，
+ *       所以每个通道的输出和标量版本逐位相同
+ *       用Load/Store和标量版本交换状态，可以每个块把不同的复音打包到一起
+ */
+template<class TCoeff, size_t N>
+class PolyBlepSync {
+public:
+    using Pack = PackFloat<N>;
+    using Mask = PackUint32<N>;
+    using Scalar = qwqdsp_oscillator::PolyBlepSync<TCoeff>;
+    static constexpr size_t kDelay = Scalar::kDelay;
+    static constexpr size_t kDelaySize = Scalar::kDelaySize;
+    static constexpr size_t kDelayMask = Scalar::kDelayMask;
+
+    void SetFreq(Pack const& f, float fs) noexcept {
+        phase_inc_ = f / fs;
+    }
+
+    void SetPWM(Pack const& width) noexcept {
+        pwm_ = width;
+    }
+
+    /**
+     * @brief 把一个标量振荡器的状态放进lane通道
+     */
+    void Load(size_t lane, Scalar const& osc) noexcept {
+        phase_[lane] = osc.phase_;
+        phase_inc_[lane] = osc.phase_inc_;
+        pwm_[lane] = osc.pwm_;
+        for (size_t i = 0; i < kDelaySize; ++i) {
+            buffer_[(i + rpos_ - osc.rpos_) & kDelayMask][lane] = osc.buffer_[i];
+        }
+    }
+
+    /**
+     * @brief 把lane通道的状态写回标量振荡器
+     */
+    void Store(size_t lane, Scalar& osc) const noexcept {
+        osc.phase_ = phase_[lane];
+        osc.phase_inc_ = phase_inc_[lane];
+        osc.pwm_ = pwm_[lane];
+        for (size_t i = 0; i < kDelaySize; ++i) {
+            osc.buffer_[i] = buffer_[(i + rpos_ - osc.rpos_) & kDelayMask][lane];
+        }
+    }
+
+    QWQDSP_FORCE_INLINE
+    Pack Sawtooth() noexcept {
+        phase_ += phase_inc_;
+        Mask const wrap = phase_ > Pack::vBroadcast(1.0f);
+        phase_ -= PackOps::Select(wrap, 1.0f, 0.0f);
+        AddBlep(wrap, phase_ / phase_inc_, Pack::vBroadcast(-1.0f));
+        return 2.0f * Tick(phase_) - 1.0f;
+    }
+
+    QWQDSP_FORCE_INLINE
+    Pack Sawtooth(Mask const& reset, Pack const& sync_samples_before) noexcept {
+        Mask const free = reset ^ Mask::kTrue;
+        phase_ += phase_inc_;
+        Mask const wrap = phase_ > Pack::vBroadcast(1.0f);
+        phase_ -= PackOps::Select(wrap, 1.0f, 0.0f);
+        Pack const self_reset_samples_before = phase_ / phase_inc_;
+        // 无硬同步或者硬同步发生在溢出之后
+        Mask const self_reset = wrap & (free | (self_reset_samples_before > sync_samples_before));
+        AddBlep(self_reset, self_reset_samples_before, Pack::vBroadcast(-1.0f));
+        // 有硬同步且发生在溢出之前,用于计算jump
+        phase_ += PackOps::Select(wrap & (self_reset ^ Mask::kTrue), 1.0f, 0.0f);
+        if (PackOps::Any(reset)) {
+            Pack const sync_going = phase_inc_ * sync_samples_before;
+            Pack const jump_size = phase_ - sync_going;
+            AddBlep(reset, sync_samples_before, -1.0f * jump_size);
+            phase_ = PackOps::Select(reset, sync_going, phase_);
+        }
+        phase_ -= PackOps::Select(phase_ > Pack::vBroadcast(1.0f), 1.0f, 0.0f);
+        return 2.0f * Tick(phase_) - 1.0f;
+    }
+
+    QWQDSP_FORCE_INLINE
+    Pack PWM(Mask const& reset, Pack const& sync_frac_samples_before) noexcept {
+        Mask const free = reset ^ Mask::kTrue;
+        Mask high = phase_ < pwm_;
+        phase_ += phase_inc_;
+        // 先算出所有跳跃的位置，只有某个通道有跳跃时才插入blep
+        Mask const wrap0 = (high ^ Mask::kTrue) & (phase_ > Pack::vBroadcast(1.0f));
+        phase_ -= PackOps::Select(wrap0, 1.0f, 0.0f);
+        Pack const t0 = phase_ / phase_inc_;
+        Mask const jump0 = wrap0 & (free | (t0 > sync_frac_samples_before));
+        high |= jump0;
+
+        Mask const fall = high & (phase_ > pwm_);
+        Pack const t1 = (phase_ - pwm_) / phase_inc_;
+        Mask const jump1 = fall & (free | (t1 > sync_frac_samples_before));
+        high &= jump1 ^ Mask::kTrue;
+
+        Mask const wrap2 = (high ^ Mask::kTrue) & (phase_ > Pack::vBroadcast(1.0f));
+        phase_ -= PackOps::Select(wrap2, 1.0f, 0.0f);
+        Pack const t2 = phase_ / phase_inc_;
+        Mask const jump2 = wrap2 & (free | (t2 > sync_frac_samples_before));
+        high |= jump2;
+
+        if (PackOps::Any(jump0 | jump1 | jump2)) {
+            AddBlep(jump0, t0, Pack::vBroadcast(1.0f));
+            AddBlep(jump1, t1, Pack::vBroadcast(-1.0f));
+            AddBlep(jump2, t2, Pack::vBroadcast(1.0f));
+        }
+        if (PackOps::Any(reset)) {
+            Pack const sync_phase = sync_frac_samples_before * phase_inc_;
+            phase_ = PackOps::Select(reset, sync_phase, phase_);
+            Pack const trans = PackOps::Select(high, 0.0f, 1.0f);
+            AddBlep(reset, sync_frac_samples_before, trans);
+
+            Pack const tphase = phase_inc_ * sync_frac_samples_before;
+            AddBlep(reset & (tphase > pwm_), (tphase - pwm_) / phase_inc_, Pack::vBroadcast(-1.0f));
+        }
+        return 2.0f * Tick(NaivePwm(phase_)) - 1.0f;
+    }
+
+    QWQDSP_FORCE_INLINE
+    Pack PWM() noexcept {
+        Pack const last_phase = phase_;
+        phase_ += phase_inc_;
+        Mask const fall = (last_phase < pwm_) & (phase_ > pwm_);
+        Pack const t0 = (phase_ - pwm_) / phase_inc_;
+        Mask const wrap = phase_ > Pack::vBroadcast(1.0f);
+        phase_ -= PackOps::Select(wrap, 1.0f, 0.0f);
+        Mask const wrap_fall = wrap & (phase_ > pwm_);
+        if (PackOps::Any(fall | wrap)) {
+            AddBlep(fall, t0, Pack::vBroadcast(-1.0f));
+            AddBlep(wrap, phase_ / phase_inc_, Pack::vBroadcast(1.0f));
+            AddBlep(wrap_fall, (phase_ - pwm_) / phase_inc_, Pack::vBroadcast(-1.0f));
+        }
+        return 2.0f * Tick(NaivePwm(phase_)) - 1.0f;
+    }
+
+    QWQDSP_FORCE_INLINE
+    Pack Sine(Mask const& reset, Pack const& sync_frac_samples_before) noexcept {
+        phase_ = Wrap(phase_ + phase_inc_);
+
+        if (PackOps::Any(reset)) {
+            Pack const sync_phase = phase_ - sync_frac_samples_before * phase_inc_;
+            Pack const jump = 0.0f - PackOps::Sin(sync_phase * std::numbers::pi_v<float> * 2.0f);
+            Pack const old_d = std::numbers::pi_v<float> * 2.0f * phase_inc_ * PackOps::Cos(std::numbers::pi_v<float> * 2.0f * sync_phase);
+            Pack const new_d = std::numbers::pi_v<float> * 2.0f * phase_inc_;
+            AddBlep(reset, sync_frac_samples_before, jump);
+            AddBlamp(reset, sync_frac_samples_before, new_d - old_d);
+            phase_ = PackOps::Select(reset, sync_frac_samples_before * phase_inc_, phase_);
+        }
+
+        return Tick(PackOps::Sin(phase_ * std::numbers::pi_v<float> * 2.0f));
+    }
+
+    QWQDSP_FORCE_INLINE
+    Pack Sine() noexcept {
+        phase_ = Wrap(phase_ + phase_inc_);
+        return Tick(PackOps::Sin(phase_ * std::numbers::pi_v<float> * 2.0f));
+    }
+
+    QWQDSP_FORCE_INLINE
+    Pack Triangle(Mask const& reset, Pack const& sync_frac_samples_before) noexcept {
+        Mask const free = reset ^ Mask::kTrue;
+        Mask high = phase_ < Pack::vBroadcast(0.5f);
+        phase_ += phase_inc_;
+        Mask const wrap0 = (high ^ Mask::kTrue) & (phase_ > Pack::vBroadcast(1.0f));
+        phase_ -= PackOps::Select(wrap0, 1.0f, 0.0f);
+        Pack const t0 = phase_ / phase_inc_;
+        Mask const jump0 = wrap0 & (free | (t0 > sync_frac_samples_before));
+        high |= jump0;
+
+        Mask const fall = high & (phase_ > Pack::vBroadcast(0.5f));
+        Pack const t1 = (phase_ - 0.5f) / phase_inc_;
+        Mask const jump1 = fall & (free | (t1 > sync_frac_samples_before));
+        high &= jump1 ^ Mask::kTrue;
+
+        Mask const wrap2 = (high ^ Mask::kTrue) & (phase_ > Pack::vBroadcast(1.0f));
+        phase_ -= PackOps::Select(wrap2, 1.0f, 0.0f);
+        Pack const t2 = phase_ / phase_inc_;
+        Mask const jump2 = wrap2 & (free | (t2 > sync_frac_samples_before));
+        high |= jump2;
+
+        if (PackOps::Any(jump0 | jump1 | jump2)) {
+            AddBlamp(jump0, t0, -8.0f * phase_inc_);
+            AddBlamp(jump1, t1, 8.0f * phase_inc_);
+            AddBlamp(jump2, t2, -8.0f * phase_inc_);
+        }
+        if (PackOps::Any(reset)) {
+            Pack sync_phase = phase_ - sync_frac_samples_before * phase_inc_;
+            sync_phase -= PackOps::Floor(sync_phase);
+            Pack const jump = NaiveTriangle(Pack::vBroadcast(0.0f)) - NaiveTriangle(sync_phase);
+            AddBlep(reset, sync_frac_samples_before, jump);
+            AddBlamp(reset & (high ^ Mask::kTrue), sync_frac_samples_before, 8.0f * phase_inc_);
+
+            Pack const tphase = phase_inc_ * sync_frac_samples_before;
+            AddBlamp(reset & (tphase > Pack::vBroadcast(0.5f)), (tphase - 0.5f) / phase_inc_, 8.0f * phase_inc_);
+            phase_ = PackOps::Select(reset, tphase, phase_);
+        }
+        return Tick(NaiveTriangle(phase_));
+    }
+
+    QWQDSP_FORCE_INLINE
+    Pack Triangle() noexcept {
+        Mask high = phase_ < Pack::vBroadcast(0.5f);
+        phase_ += phase_inc_;
+        Mask const wrap0 = (high ^ Mask::kTrue) & (phase_ > Pack::vBroadcast(1.0f));
+        phase_ -= PackOps::Select(wrap0, 1.0f, 0.0f);
+        Pack const t0 = phase_ / phase_inc_;
+        high |= wrap0;
+
+        Mask const fall = high & (phase_ > Pack::vBroadcast(0.5f));
+        Pack const t1 = (phase_ - 0.5f) / phase_inc_;
+        high &= fall ^ Mask::kTrue;
+
+        Mask const wrap2 = (high ^ Mask::kTrue) & (phase_ > Pack::vBroadcast(1.0f));
+        phase_ -= PackOps::Select(wrap2, 1.0f, 0.0f);
+
+        if (PackOps::Any(wrap0 | fall | wrap2)) {
+            AddBlamp(wrap0, t0, -8.0f * phase_inc_);
+            AddBlamp(fall, t1, 8.0f * phase_inc_);
+            AddBlamp(wrap2, phase_ / phase_inc_, -8.0f * phase_inc_);
+        }
+        return Tick(NaiveTriangle(phase_));
+    }
+private:
+
+    /**
+     * @brief [0,2) -> [0,1)，和floor相同但不需要SSE4.1
+     */
+    QWQDSP_FORCE_INLINE
+    static Pack Wrap(Pack const& phase) noexcept {
+        return phase - PackOps::Select(phase >= Pack::vBroadcast(1.0f), 1.0f, 0.0f);
+    }
+
+    QWQDSP_FORCE_INLINE
+    Pack Tick(Pack const& naive) noexcept {
+        buffer_[wpos_] += naive;
+        Pack const out = buffer_[rpos_];
+        buffer_[rpos_] = Pack::vBroadcast(0.0f);
+        rpos_ = (rpos_ + 1) & kDelayMask;
+        wpos_ = (wpos_ + 1) & kDelayMask;
+        return out;
+    }
+
+    QWQDSP_FORCE_INLINE
+    Pack NaivePwm(Pack const& phase) const noexcept {
+        return PackOps::Select(phase < pwm_, 1.0f, 0.0f);
+    }
+
+    QWQDSP_FORCE_INLINE
+    static Pack NaiveTriangle(Pack const& phase) noexcept {
+        return PackOps::Select(phase < Pack::vBroadcast(0.5f), 1.0f - 4.0f * phase, 4.0f * phase - 3.0f);
+    }
+
+    /**
+     * @brief 在mask的通道插入blep，其余通道不变
+     * @param frac_samples_before 分数采样点
+     * @param scale blep大小
+     */
+    QWQDSP_FORCE_INLINE
+    void AddBlep(Mask const& mask, Pack const& frac_samples_before, Pack const& scale) noexcept {
+        if (!PackOps::Any(mask)) {
+            return;
+        }
+        size_t begin_idx = wpos_ - kDelay;
+        Pack x = frac_samples_before - static_cast<float>(kDelay);
+        for (size_t i = 0; i < 2 * kDelay; ++i) {
+            begin_idx &= kDelayMask;
+            Pack const t = PackOps::Clamp(x, Pack::vBroadcast(-TCoeff::kHalfLen), Pack::vBroadcast(TCoeff::kHalfLen));
+            Pack const y = PackOps::Abs(TCoeff::GetBlepHalf(PackOps::Abs(t)));
+            // copysign(y, t)
+            Pack const blep = scale * PackOps::Select(t < Pack::vBroadcast(0.0f), -1.0f * y, y);
+            buffer_[begin_idx] -= PackOps::Select(mask, blep, Pack::vBroadcast(0.0f));
+            ++begin_idx;
+            x += 1.0f;
+        }
+    }
+
+    QWQDSP_FORCE_INLINE
+    void AddBlamp(Mask const& mask, Pack const& frac_samples_before, Pack const& scale) noexcept {
+        if (!PackOps::Any(mask)) {
+            return;
+        }
+        size_t begin_idx = wpos_ - kDelay;
+        Pack x = frac_samples_before - static_cast<float>(kDelay);
+        for (size_t i = 0; i < 2 * kDelay; ++i) {
+            begin_idx &= kDelayMask;
+            Pack const t = PackOps::Clamp(x, Pack::vBroadcast(-TCoeff::kHalfLen), Pack::vBroadcast(TCoeff::kHalfLen));
+            Pack const blamp = scale * TCoeff::GetBlampHalf(PackOps::Abs(t));
+            buffer_[begin_idx] += PackOps::Select(mask, blamp, Pack::vBroadcast(0.0f));
+            ++begin_idx;
+            x += 1.0f;
+        }
+    }
+
+    Pack phase_{};
+    Pack phase_inc_ = Pack::vBroadcast(0.011f);
+    Pack pwm_{};
+
+    Pack buffer_[kDelaySize]{};
+    size_t wpos_{kDelay};
+    size_t rpos_{};
+};
+}
@@ -1,10 +1,13 @@
 #pragma once
+#include "adsr_envelope.hpp"
 #include "algebraic_waveshaper.hpp"
 #include "align_allocator.hpp"
 #include "biquads.hpp"
 #include "delay_allpass.hpp"
 #include "one_pole_tpt.hpp"
 #include "plate_reverb.hpp"
+#include "polyblep.hpp"
+#include "polyblep_sync.hpp"
 #include "simd_pack.hpp"
 #include "stereo_iir_hilbert_cpx.hpp"
 #include "delay_line_mono.hpp"
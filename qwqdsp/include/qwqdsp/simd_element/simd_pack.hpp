@@ -559,6 +559,16 @@ struct PackOps {
         return r;
     }
 
+    // any
+    template<size_t N>
+    QWQDSP_FORCE_INLINE
+    static inline constexpr bool Any(PackUint32<N> const& mask) noexcept {
+        uint32_t r = 0;
+        QWQDSP_AUTO_VECTORLIZE
+        for (size_t i = 0; i < N; ++i) r |= mask.data[i];
+        return r != 0;
+    }
+
     // -------------------- float --------------------
     // float.floor
     template<size_t N>
@@ -1,5 +1,6 @@
 #pragma once
 #include <cstddef>
+#include <memory>
 #include <span>
 #include <vector>
 #include <complex>
@@ -88,8 +89,16 @@ public:
 private:
     size_t fft_size_{};
     #ifndef QWQDSP_HAVE_IPP
+    // oouras的旋转因子表，同样大小的实例共享
+    struct Plan {
+        explicit Plan(size_t fft_size);
+        std::vector<float> w;
+        int nw{};
+        int nc{};
+    };
+    std::shared_ptr<const Plan> plan_;
+    float* w_{};
     std::vector<int> ip_;
-    std::vector<float> w_;
     std::vector<float> buffer_;
     #else
     std::unique_ptr<IppComplexFFT> fft_;
@@ -0,0 +1,34 @@
+#pragma once
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+namespace qwqdsp_spectral {
+/**
+ * @brief 进程内共享的只读FFT表，按表的类型和FFT大小区分
+ *        同样的表只计算一次，所有实例持有同一份，最后一个持有者释放时销毁
+ * @tparam TPlan 需要TPlan(size_t fft_size)构造函数，构造之后不再修改
+ * @note 每个动态库(插件)各自有一份
+ */
+template<class TPlan>
+class FFTPlanCache {
+public:
+    /**
+     * @brief 线程安全，不是实时安全的
+     */
+    static std::shared_ptr<const TPlan> Get(size_t fft_size) {
+        static std::mutex lock;
+        static std::unordered_map<size_t, std::weak_ptr<const TPlan>> plans;
+
+        std::lock_guard guard{lock};
+        std::weak_ptr<const TPlan>& slot = plans[fft_size];
+        std::shared_ptr<const TPlan> plan = slot.lock();
+        if (plan == nullptr) {
+            plan = std::make_shared<const TPlan>(fft_size);
+            slot = plan;
+        }
+        return plan;
+    }
+};
+}
@@ -3,6 +3,8 @@
 #include <bit>
 #include <cassert>
 #include <cmath>
+#include <memory>
+#include "qwqdsp/spectral/fft_plan_cache.hpp"
 
 namespace qwqdsp_spectral {
 /**
@@ -10,6 +12,24 @@ namespace qwqdsp_spectral {
  */
 class OourasComplexFFT {
 public:
+    /**
+     * @brief 旋转因子表，同样大小的实例共享
+     */
+    struct Plan {
+        explicit Plan(size_t fft_size) {
+            std::vector<int> ip(2 + std::ceil(std::sqrt(fft_size / 2.0f)));
+            w.resize(fft_size / 2);
+            const size_t size4 = fft_size / 2;
+            makewt(size4, ip.data(), w.data());
+            nw = ip[0];
+            nc = ip[1];
+        }
+
+        std::vector<float> w;
+        int nw{};
+        int nc{};
+    };
+
     /**
      * @param fft_size 必须是2^N
      */
@@ -17,11 +37,13 @@ public:
         assert(std::has_single_bit(fft_size));
         fft_size_ = fft_size;
 
-        ip_.resize(2 + std::ceil(std::sqrt(fft_size / 2.0f)));
-        w_.resize(fft_size / 2);
+        plan_ = FFTPlanCache<Plan>::Get(fft_size);
+        // 只读w，ip[2..]是位反转的工作区，每个实例一份
+        w_ = const_cast<float*>(plan_->w.data());
+        ip_.assign(2 + std::ceil(std::sqrt(fft_size / 2.0f)), 0);
+        ip_[0] = plan_->nw;
+        ip_[1] = plan_->nc;
         buffer_.resize(fft_size * 2);
-        const size_t size4 = fft_size / 2;
-        makewt(size4, ip_.data(), w_.data());
     }
 
     /**
@@ -38,7 +60,7 @@ public:
             buffer_[2 * i] = input_real[i];
             buffer_[2 * i + 1] = input_imag[i];
         }
-        cdft(fft_size_ * 2, 1, buffer_.data(), ip_.data(), w_.data());
+        cdft(fft_size_ * 2, 1, buffer_.data(), ip_.data(), w_);
         outupt_real[0] = buffer_[0];
         output_imag[0] = buffer_[1];
         for (size_t i = 1; i < fft_size_; ++i) {
@@ -63,7 +85,7 @@ public:
             buffer_[2 * i] = in_real[fft_size_ - i];
             buffer_[2 * i + 1] = in_imag[fft_size_ - i];
         }
-        cdft(fft_size_ * 2, -1, buffer_.data(), ip_.data(), w_.data());
+        cdft(fft_size_ * 2, -1, buffer_.data(), ip_.data(), w_);
         const float gain = 1.0f / fft_size_;
         for (size_t i = 0; i < fft_size_; ++i) {
             out_real[i] = buffer_[i * 2] * gain;
@@ -717,8 +739,9 @@ private:
     }
 
     size_t fft_size_{};
+    std::shared_ptr<const Plan> plan_;
+    float* w_{};
     std::vector<int> ip_;
-    std::vector<float> w_;
     std::vector<float> buffer_;
 };
 }
@@ -3,6 +3,8 @@
 #include <bit>
 #include <cassert>
 #include <cmath>
+#include <memory>
+#include "qwqdsp/spectral/fft_plan_cache.hpp"
 
 namespace qwqdsp_spectral {
 /**
@@ -10,6 +12,25 @@ namespace qwqdsp_spectral {
  */
 class OourasRealFFT {
 public:
+    /**
+     * @brief 旋转因子表，同样大小的实例共享
+     */
+    struct Plan {
+        explicit Plan(size_t fft_size) {
+            std::vector<int> ip(2 + std::ceil(std::sqrt(fft_size / 2.0f)));
+            w.resize(fft_size / 2);
+            const size_t size4 = fft_size / 4;
+            makewt(size4, ip.data(), w.data());
+            makect(size4, ip.data(), w.data() + size4);
+            nw = ip[0];
+            nc = ip[1];
+        }
+
+        std::vector<float> w;
+        int nw{};
+        int nc{};
+    };
+
     /**
      * @param fft_size 必须是2^N
      */
@@ -17,11 +38,12 @@ public:
         assert(std::has_single_bit(fft_size));
         fft_size_ = fft_size;
 
-        ip_.resize(2 + std::ceil(std::sqrt(fft_size / 2.0f)));
-        w_.resize(fft_size / 2);
-        const size_t size4 = fft_size / 4;
-        makewt(size4, ip_.data(), w_.data());
-        makect(size4, ip_.data(), w_.data() + size4);
+        plan_ = FFTPlanCache<Plan>::Get(fft_size);
+        // 只读w，ip[2..]是位反转的工作区，每个实例一份
+        w_ = const_cast<float*>(plan_->w.data());
+        ip_.assign(2 + std::ceil(std::sqrt(fft_size / 2.0f)), 0);
+        ip_[0] = plan_->nw;
+        ip_[1] = plan_->nc;
     }
 
     /**
@@ -30,7 +52,7 @@ public:
      */
     void FFT(const float* input, float* output) noexcept {
         std::copy_n(input, fft_size_, output);
-        rdft(fft_size_, 1, output, ip_.data(), w_.data());
+        rdft(fft_size_, 1, output, ip_.data(), w_);
         output[fft_size_] = -output[1];
         output[fft_size_ + 1] = 0.0f;
         output[1] = 0.0f;
@@ -52,7 +74,7 @@ public:
             output[2 * i] = input[2 * i];
             output[2 * i + 1] = -input[2 * i + 1];
         }
-        rdft(fft_size_, -1, output, ip_.data(), w_.data());
+        rdft(fft_size_, -1, output, ip_.data(), w_);
         float gain = 2.0f / fft_size_;
         for (size_t i = 0; i < fft_size_; ++i) {
             output[i] *= gain;
@@ -64,8 +86,9 @@ public:
     }
 private:
     size_t fft_size_{};
+    std::shared_ptr<const Plan> plan_;
+    float* w_{};
     std::vector<int> ip_;
-    std::vector<float> w_;
 
     static void cftmdl(int n, int l, float *a, float *w) noexcept
     {
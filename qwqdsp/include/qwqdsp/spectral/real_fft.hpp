@@ -1,13 +1,41 @@
 #pragma once
 #include <cstddef>
+#include <memory>
 #include <span>
 #include <vector>
 #include <complex>
 #include <cassert>
+#ifndef QWQDSP_HAVE_IPP
+#include "qwqdsp/spectral/split_complex_fft.hpp"
+#endif
 
 namespace qwqdsp_spectral {
 #ifdef QWQDSP_HAVE_IPP
 class IppRealFFT;
+#else
+/**
+ * @brief RealFFT里和SIMD有关的部分，每种指令集在各自的翻译单元里编译一份，运行时选择
+ * @note x/z 含义见 real_fft_kernel.hpp，tw为 e^{-2pi i k/N}, k = 0 ~ N/4
+ */
+struct RealFFTKernel {
+    template<class In, class Out>
+    using Fn = void(*)(SplitComplexFFT const& fft, float const* tw_re, float const* tw_im,
+                       In re_in, In im_in, Out re_out, Out im_out) noexcept;
+    template<size_t kLanes>
+    using LanesFn = void(*)(SplitComplexFFT const& fft, float const* tw_re, float const* tw_im,
+                            qwqdsp_simd_element::PackFloat<kLanes>* re, qwqdsp_simd_element::PackFloat<kLanes>* im) noexcept;
+
+    // z原位FFT之后拆分到x，x的元素间隔1或2
+    Fn<float*, float*> forward1;
+    Fn<float*, float*> forward2;
+    // x合并到z之后z原位IFFT
+    Fn<float const*, float*> backward1;
+    Fn<float const*, float*> backward2;
+    LanesFn<4> forward_lanes4;
+    LanesFn<8> forward_lanes8;
+    LanesFn<4> backward_lanes4;
+    LanesFn<8> backward_lanes8;
+};
 #endif
 
 class RealFFT {
@@ -17,7 +45,12 @@ public:
     ~RealFFT();
     #endif
 
-    void Init(size_t fft_size);
+    static constexpr size_t kMaxBatch = 8;
+
+    /**
+     * @param max_batch FFTBatch/IFFTBatch一次最多变换的帧数，不使用保持1即可
+     */
+    void Init(size_t fft_size, size_t max_batch = 1);
 
     void FFT(std::span<const float> time, std::span<std::complex<float>> spectral) noexcept;
 
@@ -36,6 +69,20 @@ public:
 
     void Hilbert(std::span<const float> input, std::span<float> shift90, bool clear_dc) noexcept;
 
+    /**
+     * @brief 同时变换多个等长的帧，每一帧占用一个SIMD通道，共享旋转因子
+     * @param time 每一帧 size()=fft_size，帧数不超过Init时的max_batch
+     * @param real,imag 每一帧 size()=num_bins
+     */
+    void FFTBatch(std::span<const float* const> time, std::span<float* const> real, std::span<float* const> imag) noexcept;
+
+    /**
+     * @param spectral 每一帧 size()=num_bins
+     */
+    void FFTBatch(std::span<const float* const> time, std::span<std::complex<float>* const> spectral) noexcept;
+
+    void IFFTBatch(std::span<float* const> time, std::span<const float* const> real, std::span<const float* const> imag) noexcept;
+
     /**
      * @brief 0 ~ N ---> -N/2 ~ N/2
      */
@@ -63,12 +110,46 @@ public:
 private:
     size_t fft_size_{};
 #ifndef QWQDSP_HAVE_IPP
-    std::vector<int> ip_;
-    std::vector<float> w_;
+    using AlignedVector = std::vector<float, qwqdsp_simd_element::AlignedAllocator<float, 32>>;
+
+    void Deinterleave(std::span<const float> time) noexcept;
+    void Interleave(std::span<float> time) const noexcept;
+    size_t BatchLanes(size_t num_frames) const noexcept;
+    template<size_t kStride>
+    void FFTBatchStride(std::span<const float* const> time, std::span<float* const> real, std::span<float* const> imag) noexcept;
+    template<size_t kLanes, size_t kStride>
+    void FFTBatchImpl(std::span<const float* const> time, std::span<float* const> real, std::span<float* const> imag) noexcept;
+    template<size_t kLanes>
+    void IFFTBatchImpl(std::span<float* const> time, std::span<const float* const> real, std::span<const float* const> imag) noexcept;
+
+    // 按CPU支持的指令集选择，所有实例相同
+    static RealFFTKernel const& SelectKernel() noexcept;
+
+    // N/2点复数FFT，偶数样本作为实部，奇数样本作为虚部
+    SplitComplexFFT fft_;
+    RealFFTKernel const* kernel_{};
+    // e^{-2pi i k/N}, k = 0 ~ N/4，同样大小的实例共享
+    struct Plan {
+        explicit Plan(size_t fft_size);
+        AlignedVector tw_re;
+        AlignedVector tw_im;
+    };
+    std::shared_ptr<const Plan> plan_;
+    AlignedVector work_re_;
+    AlignedVector work_im_;
+    // FFTBatch使用，每个频点的所有帧放在一个Pack里
+    template<size_t kLanes>
+    using LaneVector = std::vector<qwqdsp_simd_element::PackFloat<kLanes>, qwqdsp_simd_element::AlignedAllocator<qwqdsp_simd_element::PackFloat<kLanes>, 32>>;
+    LaneVector<4> batch4_re_;
+    LaneVector<4> batch4_im_;
+    LaneVector<8> batch8_re_;
+    LaneVector<8> batch8_im_;
+    size_t max_batch_{};
     std::vector<float> buffer_;
 #else
     std::unique_ptr<IppRealFFT> fft_;
     std::vector<float> buffer_;
+    size_t max_batch_{};
 #endif
 };
 }
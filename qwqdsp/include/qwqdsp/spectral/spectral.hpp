@@ -1,8 +1,10 @@
 #pragma once
 #include "complex_fft.hpp"
+#include "fft_plan_cache.hpp"
 #include "ipp_complex_fft.hpp"
 #include "ipp_real_fft.hpp"
 #include "oouras_complex_fft.hpp"
 #include "oouras_real_fft.hpp"
 #include "real_fft.hpp"
+#include "split_complex_fft.hpp"
 #include "reassignment.hpp"
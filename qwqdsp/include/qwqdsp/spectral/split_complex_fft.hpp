@@ -0,0 +1,309 @@
+#pragma once
+#include <bit>
+#include <cassert>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <numbers>
+#include <utility>
+#include <vector>
+#include "qwqdsp/extension_marcos.hpp"
+#include "qwqdsp/simd_element/align_allocator.hpp"
+#include "qwqdsp/simd_element/simd_pack.hpp"
+#include "qwqdsp/spectral/fft_plan_cache.hpp"
+
+namespace qwqdsp_spectral {
+/**
+ * @brief 实部虚部分离的原位复数FFT，radix-2^2 DIF + 位反转
+ *        蝶形在相邻的j上使用PackFloat并行，由编译选项决定SSE/AVX
+ * @note 正变换 X[k] = sum x[n] e^{-2pi i nk/N}，逆变换不归一化
+ * @note 用不同指令集编译的翻译单元各自传入一个IsaTag类型，得到互不相同的模板实例，
+ *       内部的蝶形都强制内联，链接器不会把AVX的代码合并给其他翻译单元使用
+ */
+class SplitComplexFFT {
+public:
+    /**
+     * @brief 只读的旋转因子和位反转表，同样大小的实例共享
+     */
+    struct Plan {
+        explicit Plan(size_t fft_size) {
+            // 每一级radix-4的旋转因子 [w1.re][w1.im][w2.re][w2.im][w3.re][w3.im]，每段q个
+            size_t span = fft_size;
+            while (span >= 4) {
+                size_t const q = span / 4;
+                stage_offset.push_back(twiddle.size());
+                twiddle.resize(twiddle.size() + 6 * q);
+                float* tw = twiddle.data() + stage_offset.back();
+                for (size_t j = 0; j < q; ++j) {
+                    for (size_t m = 1; m <= 3; ++m) {
+                        double const w = -2.0 * std::numbers::pi * static_cast<double>(m * j) / static_cast<double>(span);
+                        tw[(2 * m - 2) * q + j] = static_cast<float>(std::cos(w));
+                        tw[(2 * m - 1) * q + j] = static_cast<float>(std::sin(w));
+                    }
+                }
+                span /= 4;
+            }
+
+            size_t const bits = static_cast<size_t>(std::countr_zero(fft_size));
+            for (size_t i = 0; i < fft_size; ++i) {
+                size_t r = 0;
+                for (size_t b = 0; b < bits; ++b) {
+                    r |= ((i >> b) & 1) << (bits - 1 - b);
+                }
+                if (i < r) {
+                    bitrev.push_back(static_cast<uint32_t>(i));
+                    bitrev.push_back(static_cast<uint32_t>(r));
+                }
+            }
+        }
+
+        std::vector<float, qwqdsp_simd_element::AlignedAllocator<float, 32>> twiddle;
+        std::vector<size_t> stage_offset;
+        std::vector<uint32_t> bitrev;
+    };
+
+    /**
+     * @param fft_size 必须是2^N
+     */
+    void Init(size_t fft_size) {
+        assert(std::has_single_bit(fft_size));
+        fft_size_ = fft_size;
+        plan_ = FFTPlanCache<Plan>::Get(fft_size);
+    }
+
+    /**
+     * @brief 原位正变换，输出为自然顺序
+     */
+    template<class IsaTag = void>
+    void FFT(float* re, float* im) const noexcept {
+        size_t span = fft_size_;
+        size_t stage = 0;
+        while (span >= 4) {
+            float const* tw = plan_->twiddle.data() + plan_->stage_offset[stage];
+            size_t const q = span / 4;
+            if (q >= 8) {
+                Radix4Pass<8>(re, im, tw, span);
+            }
+            else if (q == 4) {
+                Radix4Pass<4>(re, im, tw, span);
+            }
+            else if (q == 2) {
+                Radix4Pass<2>(re, im, tw, span);
+            }
+            else {
+                Radix4PassNoTwiddle(re, im);
+            }
+            span /= 4;
+            ++stage;
+        }
+        if (span == 2) {
+            Radix2Pass(re, im);
+        }
+        BitReverse(re, im);
+    }
+
+    /**
+     * @brief 原位逆变换，没有除以N
+     */
+    template<class IsaTag = void>
+    void IFFT(float* re, float* im) const noexcept {
+        // ifft(x) = swap(fft(swap(x)))
+        FFT<IsaTag>(im, re);
+    }
+
+    /**
+     * @brief 原位正变换kLanes个等长的FFT，第n个元素的第l个通道属于第l个FFT
+     */
+    template<size_t kLanes, class IsaTag = void>
+    void FFTLanes(qwqdsp_simd_element::PackFloat<kLanes>* re, qwqdsp_simd_element::PackFloat<kLanes>* im) const noexcept {
+        size_t span = fft_size_;
+        size_t stage = 0;
+        while (span >= 4) {
+            if (span == 4) {
+                Radix4PassNoTwiddle(re, im);
+            }
+            else {
+                Radix4PassLanes<kLanes>(re, im, plan_->twiddle.data() + plan_->stage_offset[stage], span);
+            }
+            span /= 4;
+            ++stage;
+        }
+        if (span == 2) {
+            Radix2Pass(re, im);
+        }
+        BitReverse(re, im);
+    }
+
+    template<size_t kLanes, class IsaTag = void>
+    void IFFTLanes(qwqdsp_simd_element::PackFloat<kLanes>* re, qwqdsp_simd_element::PackFloat<kLanes>* im) const noexcept {
+        FFTLanes<kLanes, IsaTag>(im, re);
+    }
+
+    size_t FFTSize() const noexcept {
+        return fft_size_;
+    }
+
+private:
+    template<size_t kWidth>
+    QWQDSP_FORCE_INLINE
+    void Radix4Pass(float* re, float* im, float const* tw, size_t span) const noexcept {
+        using Pack = qwqdsp_simd_element::PackFloat<kWidth>;
+        size_t const q = span / 4;
+        for (size_t base = 0; base < fft_size_; base += span) {
+            float* r0 = re + base;
+            float* i0 = im + base;
+            for (size_t j = 0; j < q; j += kWidth) {
+                Pack ar, ai, br, bi, cr, ci, dr, di;
+                ar.Load(r0 + j);
+                ai.Load(i0 + j);
+                br.Load(r0 + j + q);
+                bi.Load(i0 + j + q);
+                cr.Load(r0 + j + 2 * q);
+                ci.Load(i0 + j + 2 * q);
+                dr.Load(r0 + j + 3 * q);
+                di.Load(i0 + j + 3 * q);
+
+                Pack const t0r = ar + cr;
+                Pack const t0i = ai + ci;
+                Pack const ur = ar - cr;
+                Pack const ui = ai - ci;
+                Pack const t2r = br + dr;
+                Pack const t2i = bi + di;
+                // v = -i * (b - d)
+                Pack const vr = bi - di;
+                Pack const vi = dr - br;
+
+                Pack w1r, w1i, w2r, w2i, w3r, w3i;
+                w1r.Load(tw + j);
+                w1i.Load(tw + q + j);
+                w2r.Load(tw + 2 * q + j);
+                w2i.Load(tw + 3 * q + j);
+                w3r.Load(tw + 4 * q + j);
+                w3i.Load(tw + 5 * q + j);
+
+                Pack const y0r = t0r + t2r;
+                Pack const y0i = t0i + t2i;
+                Pack const y1r = t0r - t2r;
+                Pack const y1i = t0i - t2i;
+                Pack const y2r = ur + vr;
+                Pack const y2i = ui + vi;
+                Pack const y3r = ur - vr;
+                Pack const y3i = ui - vi;
+
+                y0r.Store(r0 + j);
+                y0i.Store(i0 + j);
+                (y1r * w2r - y1i * w2i).Store(r0 + j + q);
+                (y1r * w2i + y1i * w2r).Store(i0 + j + q);
+                (y2r * w1r - y2i * w1i).Store(r0 + j + 2 * q);
+                (y2r * w1i + y2i * w1r).Store(i0 + j + 2 * q);
+                (y3r * w3r - y3i * w3i).Store(r0 + j + 3 * q);
+                (y3r * w3i + y3i * w3r).Store(i0 + j + 3 * q);
+            }
+        }
+    }
+
+    /**
+     * @brief 每个元素是kLanes个独立的FFT，旋转因子广播到所有通道
+     */
+    template<size_t kLanes>
+    QWQDSP_FORCE_INLINE
+    void Radix4PassLanes(qwqdsp_simd_element::PackFloat<kLanes>* re, qwqdsp_simd_element::PackFloat<kLanes>* im,
+                         float const* tw, size_t span) const noexcept {
+        using Pack = qwqdsp_simd_element::PackFloat<kLanes>;
+        size_t const q = span / 4;
+        for (size_t base = 0; base < fft_size_; base += span) {
+            Pack* r0 = re + base;
+            Pack* i0 = im + base;
+            for (size_t j = 0; j < q; ++j) {
+                Pack const t0r = r0[j] + r0[j + 2 * q];
+                Pack const t0i = i0[j] + i0[j + 2 * q];
+                Pack const ur = r0[j] - r0[j + 2 * q];
+                Pack const ui = i0[j] - i0[j + 2 * q];
+                Pack const t2r = r0[j + q] + r0[j + 3 * q];
+                Pack const t2i = i0[j + q] + i0[j + 3 * q];
+                Pack const vr = i0[j + q] - i0[j + 3 * q];
+                Pack const vi = r0[j + 3 * q] - r0[j + q];
+
+                float const w1r = tw[j];
+                float const w1i = tw[q + j];
+                float const w2r = tw[2 * q + j];
+                float const w2i = tw[3 * q + j];
+                float const w3r = tw[4 * q + j];
+                float const w3i = tw[5 * q + j];
+
+                Pack const y1r = t0r - t2r;
+                Pack const y1i = t0i - t2i;
+                Pack const y2r = ur + vr;
+                Pack const y2i = ui + vi;
+                Pack const y3r = ur - vr;
+                Pack const y3i = ui - vi;
+
+                r0[j] = t0r + t2r;
+                i0[j] = t0i + t2i;
+                r0[j + q] = y1r * w2r - y1i * w2i;
+                i0[j + q] = y1r * w2i + y1i * w2r;
+                r0[j + 2 * q] = y2r * w1r - y2i * w1i;
+                i0[j + 2 * q] = y2r * w1i + y2i * w1r;
+                r0[j + 3 * q] = y3r * w3r - y3i * w3i;
+                i0[j + 3 * q] = y3r * w3i + y3i * w3r;
+            }
+        }
+    }
+
+    /**
+     * @brief 最后一级radix-4，旋转因子都是1
+     */
+    template<class T>
+    QWQDSP_FORCE_INLINE
+    void Radix4PassNoTwiddle(T* re, T* im) const noexcept {
+        for (size_t base = 0; base < fft_size_; base += 4) {
+            T const t0r = re[base] + re[base + 2];
+            T const t0i = im[base] + im[base + 2];
+            T const ur = re[base] - re[base + 2];
+            T const ui = im[base] - im[base + 2];
+            T const t2r = re[base + 1] + re[base + 3];
+            T const t2i = im[base + 1] + im[base + 3];
+            T const vr = im[base + 1] - im[base + 3];
+            T const vi = re[base + 3] - re[base + 1];
+            re[base] = t0r + t2r;
+            im[base] = t0i + t2i;
+            re[base + 1] = t0r - t2r;
+            im[base + 1] = t0i - t2i;
+            re[base + 2] = ur + vr;
+            im[base + 2] = ui + vi;
+            re[base + 3] = ur - vr;
+            im[base + 3] = ui - vi;
+        }
+    }
+
+    template<class T>
+    QWQDSP_FORCE_INLINE
+    void Radix2Pass(T* re, T* im) const noexcept {
+        for (size_t base = 0; base < fft_size_; base += 2) {
+            T const ar = re[base];
+            T const ai = im[base];
+            re[base] = ar + re[base + 1];
+            im[base] = ai + im[base + 1];
+            re[base + 1] = ar - re[base + 1];
+            im[base + 1] = ai - im[base + 1];
+        }
+    }
+
+    template<class T>
+    QWQDSP_FORCE_INLINE
+    void BitReverse(T* re, T* im) const noexcept {
+        uint32_t const* bitrev = plan_->bitrev.data();
+        size_t const n = plan_->bitrev.size();
+        for (size_t i = 0; i < n; i += 2) {
+            size_t const a = bitrev[i];
+            size_t const b = bitrev[i + 1];
+            std::swap(re[a], re[b]);
+            std::swap(im[a], im[b]);
+        }
+    }
+
+    size_t fft_size_{};
+    std::shared_ptr<const Plan> plan_;
+};
+}
@@ -1,6 +1,7 @@
 #include "qwqdsp/spectral/complex_fft.hpp"
 
 #include <bit>
+#include "qwqdsp/spectral/fft_plan_cache.hpp"
 
 #ifndef QWQDSP_HAVE_IPP
 
@@ -22,14 +23,25 @@ void makect(int nc, int *ip, float *c) noexcept;
 } // qwq::spectral::internal
 
 
+ComplexFFT::Plan::Plan(size_t fft_size) {
+    std::vector<int> ip(2 + std::ceil(std::sqrt(fft_size / 2.0f)));
+    w.resize(fft_size / 2);
+    const size_t size4 = fft_size / 2;
+    internal::makewt(size4, ip.data(), w.data());
+    nw = ip[0];
+    nc = ip[1];
+}
+
 void ComplexFFT::Init(size_t fft_size) {
     assert(std::has_single_bit(fft_size));
     fft_size_ = fft_size;
-    ip_.resize(2 + std::ceil(std::sqrt(fft_size / 2.0f)));
-    w_.resize(fft_size / 2);
+    plan_ = FFTPlanCache<Plan>::Get(fft_size);
+    // cdft只读w，ip[2..]是位反转的工作区，每个实例一份
+    w_ = const_cast<float*>(plan_->w.data());
+    ip_.assign(2 + std::ceil(std::sqrt(fft_size / 2.0f)), 0);
+    ip_[0] = plan_->nw;
+    ip_[1] = plan_->nc;
     buffer_.resize(fft_size * 2);
-    const size_t size4 = fft_size / 2;
-    internal::makewt(size4, ip_.data(), w_.data());
 }
 
 
@@ -41,7 +53,7 @@ void ComplexFFT::FFT(std::span<const float> time, std::span<std::complex<float>>
         buffer_[2 * i] = time[i];
         buffer_[2 * i + 1] = 0.0f;
     }
-    internal::cdft(fft_size_ * 2, 1, buffer_.data(), ip_.data(), w_.data());
+    internal::cdft(fft_size_ * 2, 1, buffer_.data(), ip_.data(), w_);
 
     spectral[0].real(buffer_[0]);
     spectral[0].imag(buffer_[1]);
@@ -60,7 +72,7 @@ void ComplexFFT::FFT(std::span<const std::complex<float>> time, std::span<std::c
         buffer_[2 * i] = time[i].real();
         buffer_[2 * i + 1] = time[i].imag();
     }
-    internal::cdft(fft_size_ * 2, 1, buffer_.data(), ip_.data(), w_.data());
+    internal::cdft(fft_size_ * 2, 1, buffer_.data(), ip_.data(), w_);
 
     spectral[0].real(buffer_[0]);
     spectral[0].imag(buffer_[1]);
@@ -80,7 +92,7 @@ void ComplexFFT::FFT(std::span<const float> time, std::span<float> real, std::sp
         buffer_[2 * i] = time[i];
         buffer_[2 * i + 1] = 0.0f;
     }
-    internal::cdft(fft_size_ * 2, 1, buffer_.data(), ip_.data(), w_.data());
+    internal::cdft(fft_size_ * 2, 1, buffer_.data(), ip_.data(), w_);
 
     real[0] = (buffer_[0]);
     imag[0] = (buffer_[1]);
@@ -100,7 +112,7 @@ void ComplexFFT::FFT(std::span<const std::complex<float>> time, std::span<float>
         buffer_[2 * i] = time[i].real();
         buffer_[2 * i + 1] = time[i].imag();
     }
-    internal::cdft(fft_size_ * 2, 1, buffer_.data(), ip_.data(), w_.data());
+    internal::cdft(fft_size_ * 2, 1, buffer_.data(), ip_.data(), w_);
 
     real[0] = (buffer_[0]);
     imag[0] = (buffer_[1]);
@@ -122,7 +134,7 @@ void ComplexFFT::FFTGainPhase(std::span<const float> time, std::span<float> gain
         buffer_[2 * i] = time[i];
         buffer_[2 * i + 1] = 0;
     }
-    internal::cdft(fft_size_ * 2, 1, buffer_.data(), ip_.data(), w_.data());
+    internal::cdft(fft_size_ * 2, 1, buffer_.data(), ip_.data(), w_);
 
     {
         float real = (buffer_[0]);
@@ -146,7 +158,7 @@ void ComplexFFT::IFFT(std::span<float> time, std::span<const std::complex<float>
         buffer_[2 * i] = spectral[fft_size_ - i].real();
         buffer_[2 * i + 1] = spectral[fft_size_ - i].imag();
     }
-    internal::cdft(fft_size_ * 2, -1, buffer_.data(), ip_.data(), w_.data());
+    internal::cdft(fft_size_ * 2, -1, buffer_.data(), ip_.data(), w_);
     const float gain = 1.0f / fft_size_;
     for (size_t i = 0; i < fft_size_; ++i) {
         time[i] = buffer_[i * 2] * gain;
@@ -161,7 +173,7 @@ void ComplexFFT::IFFT(std::span<std::complex<float>> time, std::span<const std::
         buffer_[2 * i] = spectral[fft_size_ - i].real();
         buffer_[2 * i + 1] = spectral[fft_size_ - i].imag();
     }
-    internal::cdft(fft_size_ * 2, -1, buffer_.data(), ip_.data(), w_.data());
+    internal::cdft(fft_size_ * 2, -1, buffer_.data(), ip_.data(), w_);
     const float gain = 1.0f / fft_size_;
     for (size_t i = 0; i < fft_size_; ++i) {
         time[i].real(buffer_[i * 2] * gain);
@@ -177,7 +189,7 @@ void ComplexFFT::IFFT(std::span<float> time, std::span<const float> real, std::s
         buffer_[2 * i] = real[fft_size_ - i];
         buffer_[2 * i + 1] = imag[fft_size_ - i];
     }
-    internal::cdft(fft_size_ * 2, -1, buffer_.data(), ip_.data(), w_.data());
+    internal::cdft(fft_size_ * 2, -1, buffer_.data(), ip_.data(), w_);
     const float gain = 1.0f / fft_size_;
     for (size_t i = 0; i < fft_size_; ++i) {
         time[i] = buffer_[i * 2] * gain;
@@ -192,7 +204,7 @@ void ComplexFFT::IFFT(std::span<std::complex<float>> time, std::span<const float
         buffer_[2 * i] = real[fft_size_ - i];
         buffer_[2 * i + 1] = imag[fft_size_ - i];
     }
-    internal::cdft(fft_size_ * 2, -1, buffer_.data(), ip_.data(), w_.data());
+    internal::cdft(fft_size_ * 2, -1, buffer_.data(), ip_.data(), w_);
     const float gain = 1.0f / fft_size_;
     for (size_t i = 0; i < fft_size_; ++i) {
         time[i].real(buffer_[i * 2] * gain);
@@ -208,7 +220,7 @@ void ComplexFFT::IFFTGainPhase(std::span<float> time, std::span<const float> gai
         buffer_[2 * i] = gain[fft_size_ - i] * std::cos(phase[fft_size_ - i]);
         buffer_[2 * i + 1] = gain[fft_size_ - i] * std::sin(phase[fft_size_ - i]);
     }
-    internal::cdft(fft_size_ * 2, -1, buffer_.data(), ip_.data(), w_.data());
+    internal::cdft(fft_size_ * 2, -1, buffer_.data(), ip_.data(), w_);
     const float g = 1.0f / fft_size_;
     for (size_t i = 0; i < fft_size_; ++i) {
         time[i] = buffer_[i * 2] * g;
@@ -223,7 +235,7 @@ void ComplexFFT::IFFTGainPhase(std::span<std::complex<float>> time, std::span<co
         buffer_[2 * i] = gain[fft_size_ - i] * std::cos(phase[fft_size_ - i]);
         buffer_[2 * i + 1] = gain[fft_size_ - i] * std::sin(phase[fft_size_ - i]);
     }
-    internal::cdft(fft_size_ * 2, -1, buffer_.data(), ip_.data(), w_.data());
+    internal::cdft(fft_size_ * 2, -1, buffer_.data(), ip_.data(), w_);
     const float g = 1.0f / fft_size_;
     for (size_t i = 0; i < fft_size_; ++i) {
         time[i].real(buffer_[i * 2] * g);
@@ -240,7 +252,7 @@ void ComplexFFT::Hilbert(std::span<const float> time, std::span<std::complex<flo
         buffer_[2 * i] = time[i];
         buffer_[2 * i + 1] = 0.0f;
     }
-    internal::cdft(fft_size_ * 2, 1, buffer_.data(), ip_.data(), w_.data());
+    internal::cdft(fft_size_ * 2, 1, buffer_.data(), ip_.data(), w_);
     if (clear_dc) {
         // Z[0] = X[0]
         buffer_[0] = 0.0f;
@@ -262,7 +274,7 @@ void ComplexFFT::Hilbert(std::span<const float> time, std::span<std::complex<flo
         buffer_[2 * i] = 0.0f;
         buffer_[2 * i + 1] = 0.0f;
     }
-    internal::cdft(fft_size_ * 2, -1, buffer_.data(), ip_.data(), w_.data());
+    internal::cdft(fft_size_ * 2, -1, buffer_.data(), ip_.data(), w_);
     // Z[n] = 2 * X[n]
     const float gain = 2.0f / fft_size_;
     for (size_t i = 0; i < fft_size_; ++i) {
@@ -280,7 +292,7 @@ void ComplexFFT::Hilbert(std::span<const float> input, std::span<float> output90
         buffer_[2 * i] = input[i];
         buffer_[2 * i + 1] = 0.0f;
     }
-    internal::cdft(fft_size_ * 2, 1, buffer_.data(), ip_.data(), w_.data());
+    internal::cdft(fft_size_ * 2, 1, buffer_.data(), ip_.data(), w_);
     if (clear_dc) {
         // Z[0] = X[0]
         buffer_[0] = 0.0f;
@@ -303,7 +315,7 @@ void ComplexFFT::Hilbert(std::span<const float> input, std::span<float> output90
         buffer_[2 * i] = im;
         buffer_[2 * i + 1] = -re;
     }
-    internal::cdft(fft_size_ * 2, -1, buffer_.data(), ip_.data(), w_.data());
+    internal::cdft(fft_size_ * 2, -1, buffer_.data(), ip_.data(), w_);
     const float gain = 1.0f / fft_size_;
     for (size_t i = 0; i < fft_size_; ++i) {
         output90[i] = buffer_[i * 2] * gain;
@@ -1,42 +1,115 @@
 #include "qwqdsp/spectral/real_fft.hpp"
 
+#include <array>
 #include <bit>
 
 #ifndef QWQDSP_HAVE_IPP
 
+#include <numbers>
+#include "qwqdsp/simd_element/simd_pack.hpp"
+#include "qwqdsp/spectral/fft_plan_cache.hpp"
+
+#define QWQDSP_REAL_FFT_KERNEL kernel_generic
+#include "real_fft_kernel.hpp"
+#undef QWQDSP_REAL_FFT_KERNEL
+
+#ifdef QWQDSP_HAVE_SIMD_DETECTOR
+#include "simd_detector.h"
+#endif
+
 namespace qwqdsp_spectral {
-namespace internal {
-void rdft(int, int, float *, int *, float *) noexcept;
-void makewt(int nw, int *ip, float *w) noexcept;
-void makect(int nc, int *ip, float *c) noexcept;
-} // qwqdsp_spectral::internal
+#ifdef QWQDSP_HAVE_SIMD_DETECTOR
+// real_fft_vec4.cpp/real_fft_vec8.cpp
+RealFFTKernel const& GetRealFFTKernelVec4() noexcept;
+RealFFTKernel const& GetRealFFTKernelVec8() noexcept;
+#endif
+
+namespace {
+// 通道并行时工作区的float数量上限，大约为L1的一半
+constexpr size_t kMaxLaneElements = 4096;
+
+void SplitEvenOdd(float const* time, float* re, float* im, size_t n) noexcept {
+    for (size_t i = 0; i < n; ++i) {
+        re[i] = time[2 * i];
+        im[i] = time[2 * i + 1];
+    }
+}
+}
+
+RealFFTKernel const& RealFFT::SelectKernel() noexcept {
+#ifdef QWQDSP_HAVE_SIMD_DETECTOR
+    static RealFFTKernel const& kernel = []() -> RealFFTKernel const& {
+        if (simd_detector::is_supported(simd_detector::InstructionSet::PLUGIN_VEC8_DISPATCH_ISET)) {
+            return GetRealFFTKernelVec8();
+        }
+        else if (simd_detector::is_supported(simd_detector::InstructionSet::PLUGIN_VEC4_DISPATCH_ISET)) {
+            return GetRealFFTKernelVec4();
+        }
+        return kernel_generic::kKernel;
+    }();
+    return kernel;
+#else
+    return kernel_generic::kKernel;
+#endif
+}
 
-void RealFFT::Init(size_t fft_size) {
+RealFFT::Plan::Plan(size_t fft_size) {
+    size_t const m = fft_size / 2;
+    tw_re.resize(m / 2 + 1);
+    tw_im.resize(m / 2 + 1);
+    for (size_t k = 0; k <= m / 2; ++k) {
+        double const w = -2.0 * std::numbers::pi * static_cast<double>(k) / static_cast<double>(fft_size);
+        tw_re[k] = static_cast<float>(std::cos(w));
+        tw_im[k] = static_cast<float>(std::sin(w));
+    }
+}
+
+void RealFFT::Init(size_t fft_size, size_t max_batch) {
     assert(std::has_single_bit(fft_size));
+    assert(fft_size >= 2);
+    assert(max_batch >= 1 && max_batch <= kMaxBatch);
     fft_size_ = fft_size;
-    ip_.resize(2 + std::ceil(std::sqrt(fft_size / 2.0f)));
-    w_.resize(fft_size / 2);
+    size_t const m = fft_size / 2;
+    fft_.Init(m);
+    kernel_ = &SelectKernel();
+    plan_ = FFTPlanCache<Plan>::Get(fft_size);
+    work_re_.resize(m + 1);
+    work_im_.resize(m + 1);
     buffer_.resize(fft_size);
-    const size_t size4 = fft_size / 4;
-    internal::makewt(size4, ip_.data(), w_.data());
-    internal::makect(size4, ip_.data(), w_.data() + size4);
+
+    max_batch_ = max_batch;
+    // BatchLanes不会使用的通道数不分配
+    size_t const batch4_size = max_batch >= 4 && m * 4 <= kMaxLaneElements ? m + 1 : 0;
+    size_t const batch8_size = max_batch >= 5 && m * 8 <= kMaxLaneElements ? m + 1 : 0;
+    batch4_re_.resize(batch4_size);
+    batch4_im_.resize(batch4_size);
+    batch8_re_.resize(batch8_size);
+    batch8_im_.resize(batch8_size);
+}
+
+void RealFFT::Deinterleave(std::span<const float> time) noexcept {
+    SplitEvenOdd(time.data(), work_re_.data(), work_im_.data(), fft_size_ / 2);
+}
+
+/**
+ * @brief 逆变换后的 2M*z[n] -> x[2n], x[2n+1]
+ */
+void RealFFT::Interleave(std::span<float> time) const noexcept {
+    size_t const m = fft_size_ / 2;
+    float const gain = 1.0f / static_cast<float>(fft_size_);
+    for (size_t i = 0; i < m; ++i) {
+        time[2 * i] = work_re_[i] * gain;
+        time[2 * i + 1] = work_im_[i] * gain;
+    }
 }
 
 void RealFFT::FFT(std::span<const float> time, std::span<std::complex<float>> spectral) noexcept {
     assert(time.size() == fft_size_);
     assert(spectral.size() == NumBins());
 
-    std::copy(time.begin(), time.end(), buffer_.begin());
-    internal::rdft(fft_size_, 1, buffer_.data(), ip_.data(), w_.data());
-    spectral.front().real(buffer_[0]);
-    spectral.front().imag(0.0f);
-    spectral[fft_size_ / 2].real(-buffer_[1]);
-    spectral[fft_size_ / 2].imag(0.0f);
-    const size_t n = fft_size_ / 2;
-    for (size_t i = 1; i < n; ++i) {
-        spectral[i].real(buffer_[i * 2]);
-        spectral[i].imag(-buffer_[i * 2 + 1]);
-    }
+    Deinterleave(time);
+    float* out = reinterpret_cast<float*>(spectral.data());
+    kernel_->forward2(fft_, plan_->tw_re.data(), plan_->tw_im.data(), work_re_.data(), work_im_.data(), out, out + 1);
 }
 
 void RealFFT::FFT(std::span<const float> time, std::span<float> real, std::span<float> imag) noexcept {
@@ -44,35 +117,18 @@ void RealFFT::FFT(std::span<const float> time, std::span<float> real, std::span<
     assert(real.size() == NumBins());
     assert(imag.size() == NumBins());
 
-    std::copy(time.begin(), time.end(), buffer_.begin());
-    internal::rdft(fft_size_, 1, buffer_.data(), ip_.data(), w_.data());
-    real.front() = buffer_[0];
-    imag.front() = 0.0f;
-    real[fft_size_ / 2] = -buffer_[1];
-    imag[fft_size_ / 2] = 0.0f;
-    const size_t n = fft_size_ / 2;
-    for (size_t i = 1; i < n; ++i) {
-        real[i] = buffer_[i * 2];
-        imag[i] = -buffer_[i * 2 + 1];
-    }
+    // 直接在输出上原位计算
+    SplitEvenOdd(time.data(), real.data(), imag.data(), fft_size_ / 2);
+    kernel_->forward1(fft_, plan_->tw_re.data(), plan_->tw_im.data(), real.data(), imag.data(), real.data(), imag.data());
 }
 
 void RealFFT::IFFT(std::span<float> time, std::span<const std::complex<float>> spectral) noexcept {
     assert(time.size() == fft_size_);
     assert(spectral.size() == NumBins());
 
-    buffer_[0] = spectral.front().real();
-    buffer_[1] = -spectral[fft_size_ / 2].real();
-    const size_t n = fft_size_ / 2;
-    for (size_t i = 1; i < n; ++i) {
-        buffer_[2 * i] = spectral[i].real();
-        buffer_[2 * i + 1] = -spectral[i].imag();
-    }
-    internal::rdft(fft_size_, -1, buffer_.data(), ip_.data(), w_.data());
-    float gain = 2.0f / fft_size_;
-    for (size_t i = 0; i < fft_size_; ++i) {
-        time[i] = buffer_[i] * gain;
-    }
+    float const* in = reinterpret_cast<float const*>(spectral.data());
+    kernel_->backward2(fft_, plan_->tw_re.data(), plan_->tw_im.data(), in, in + 1, work_re_.data(), work_im_.data());
+    Interleave(time);
 }
 
 void RealFFT::IFFT(std::span<float> time, std::span<const float> real, std::span<const float> imag) noexcept {
@@ -80,18 +136,8 @@ void RealFFT::IFFT(std::span<float> time, std::span<const float> real, std::span
     assert(real.size() == NumBins());
     assert(imag.size() == NumBins());
 
-    buffer_[0] = real.front();
-    buffer_[1] = -real[fft_size_ / 2];
-    const size_t n = fft_size_ / 2;
-    for (size_t i = 1; i < n; ++i) {
-        buffer_[2 * i] = real[i];
-        buffer_[2 * i + 1] = -imag[i];
-    }
-    internal::rdft(fft_size_, -1, buffer_.data(), ip_.data(), w_.data());
-    float gain = 2.0f / fft_size_;
-    for (size_t i = 0; i < fft_size_; ++i) {
-        time[i] = buffer_[i] * gain;
-    }
+    kernel_->backward1(fft_, plan_->tw_re.data(), plan_->tw_im.data(), real.data(), imag.data(), work_re_.data(), work_im_.data());
+    Interleave(time);
 }
 
 void RealFFT::FFTGainPhase(std::span<const float> time, std::span<float> gain, std::span<float> phase) noexcept {
@@ -101,29 +147,17 @@ void RealFFT::FFTGainPhase(std::span<const float> time, std::span<float> gain, s
         assert(phase.size() == NumBins());
     }
 
-    std::copy(time.begin(), time.end(), buffer_.begin());
-    internal::rdft(fft_size_, 1, buffer_.data(), ip_.data(), w_.data());
-    if (phase.empty()) {
-        gain.front() = std::abs(buffer_[0]);
-        gain[fft_size_ / 2] = std::abs(buffer_[1]);
-        const size_t n = fft_size_ / 2;
-        for (size_t i = 1; i < n; ++i) {
-            float real = buffer_[i * 2];
-            float imag = -buffer_[i * 2 + 1];
-            gain[i] = std::sqrt(real * real + imag * imag);
-        }
+    Deinterleave(time);
+    kernel_->forward1(fft_, plan_->tw_re.data(), plan_->tw_im.data(), work_re_.data(), work_im_.data(), work_re_.data(), work_im_.data());
+    size_t const num_bins = NumBins();
+    for (size_t i = 0; i < num_bins; ++i) {
+        float const re = work_re_[i];
+        float const im = work_im_[i];
+        gain[i] = std::sqrt(re * re + im * im);
     }
-    else {
-        gain.front() = std::abs(buffer_[0]);
-        phase.front() = 0.0f;
-        gain[fft_size_ / 2] = std::abs(buffer_[1]);
-        phase[fft_size_ / 2] = 0.0f;
-        const size_t n = fft_size_ / 2;
-        for (size_t i = 1; i < n; ++i) {
-            float real = buffer_[i * 2];
-            float imag = -buffer_[i * 2 + 1];
-            gain[i] = std::sqrt(real * real + imag + imag);
-            phase[i] = std::atan2(imag, real);
+    if (!phase.empty()) {
+        for (size_t i = 0; i < num_bins; ++i) {
+            phase[i] = std::atan2(work_im_[i], work_re_[i]);
         }
     }
 }
@@ -133,42 +167,203 @@ void RealFFT::IFFTGainPhase(std::span<float> time, std::span<const float> gain,
     assert(gain.size() == NumBins());
     assert(phase.size() == NumBins());
 
-    buffer_[0] = gain[0];
-    buffer_[1] = -gain[fft_size_ / 2];
-    const size_t n = fft_size_ / 2;
-    for (size_t i = 1; i < n; ++i) {
-        buffer_[2 * i] = gain[i] * std::cos(phase[i]);
-        buffer_[2 * i + 1] = -gain[i] * std::sin(phase[i]);
-    }
-    internal::rdft(fft_size_, -1, buffer_.data(), ip_.data(), w_.data());
-    float g = 2.0f / fft_size_;
-    for (size_t i = 0; i < fft_size_; ++i) {
-        time[i] = buffer_[i] * g;
+    size_t const num_bins = NumBins();
+    for (size_t i = 0; i < num_bins; ++i) {
+        work_re_[i] = gain[i] * std::cos(phase[i]);
+        work_im_[i] = gain[i] * std::sin(phase[i]);
     }
+    kernel_->backward1(fft_, plan_->tw_re.data(), plan_->tw_im.data(), work_re_.data(), work_im_.data(), work_re_.data(), work_im_.data());
+    Interleave(time);
 }
 
 void RealFFT::Hilbert(std::span<const float> input, std::span<float> shift90, bool clear_dc) noexcept {
     assert(input.size() == fft_size_);
     assert(shift90.size() == fft_size_);
-    std::copy(input.begin(), input.end(), buffer_.begin());
-    internal::rdft(fft_size_, 1, buffer_.data(), ip_.data(), w_.data());
-    const size_t n = fft_size_ / 2;
+
+    Deinterleave(input);
+    kernel_->forward1(fft_, plan_->tw_re.data(), plan_->tw_im.data(), work_re_.data(), work_im_.data(), work_re_.data(), work_im_.data());
+    // X[k] * -i
+    size_t const n = fft_size_ / 2;
     for (size_t i = 1; i < n; ++i) {
-        float real = buffer_[i * 2];
-        float imag = -buffer_[i * 2 + 1];
-        float re = imag;
-        float im = -real;
-        buffer_[i * 2] = re;
-        buffer_[i * 2 + 1] = -im;
+        float const re = work_re_[i];
+        work_re_[i] = work_im_[i];
+        work_im_[i] = -re;
     }
     if (clear_dc) {
-        buffer_[0] = 0;
-        buffer_[1] = 0;
+        work_re_[0] = 0;
+        work_re_[n] = 0;
+    }
+    kernel_->backward1(fft_, plan_->tw_re.data(), plan_->tw_im.data(), work_re_.data(), work_im_.data(), work_re_.data(), work_im_.data());
+    Interleave(shift90);
+}
+
+/**
+ * @brief 单帧的FFT已经在频点上SIMD了，通道并行主要省下小级数的蝶形、位反转和拆分
+ *        但转置有额外开销，所以帧数太少或者工作区超出L1时逐帧变换更快
+ * @return 0为逐帧变换
+ */
+size_t RealFFT::BatchLanes(size_t num_frames) const noexcept {
+    size_t const m = fft_size_ / 2;
+    if (num_frames >= 5 && m * 8 <= kMaxLaneElements) {
+        return 8;
+    }
+    if (num_frames >= 4 && m * 4 <= kMaxLaneElements) {
+        return 4;
+    }
+    return 0;
+}
+
+template<size_t kLanes, size_t kStride>
+void RealFFT::FFTBatchImpl(std::span<const float* const> time, std::span<float* const> real, std::span<float* const> imag) noexcept {
+    using LanePack = qwqdsp_simd_element::PackFloat<kLanes>;
+    LanePack* re;
+    LanePack* im;
+    if constexpr (kLanes == 4) {
+        re = batch4_re_.data();
+        im = batch4_im_.data();
+    }
+    else {
+        re = batch8_re_.data();
+        im = batch8_im_.data();
+    }
+
+    size_t const m = fft_size_ / 2;
+    size_t const num_frames = time.size();
+    // 空余的通道输入零，输出到work里丢弃
+    std::fill(buffer_.begin(), buffer_.end(), 0.0f);
+    for (size_t l = 0; l < kLanes; ++l) {
+        float const* in = l < num_frames ? time[l] : buffer_.data();
+        for (size_t n = 0; n < m; ++n) {
+            re[n].data[l] = in[2 * n];
+            im[n].data[l] = in[2 * n + 1];
+        }
+    }
+
+    if constexpr (kLanes == 4) {
+        kernel_->forward_lanes4(fft_, plan_->tw_re.data(), plan_->tw_im.data(), re, im);
+    }
+    else {
+        kernel_->forward_lanes8(fft_, plan_->tw_re.data(), plan_->tw_im.data(), re, im);
+    }
+
+    size_t const num_bins = NumBins();
+    for (size_t l = 0; l < num_frames; ++l) {
+        float* out_re = real[l];
+        float* out_im = imag[l];
+        for (size_t k = 0; k < num_bins; ++k) {
+            out_re[k * kStride] = re[k].data[l];
+            out_im[k * kStride] = im[k].data[l];
+        }
+    }
+}
+
+template<size_t kLanes>
+void RealFFT::IFFTBatchImpl(std::span<float* const> time, std::span<const float* const> real, std::span<const float* const> imag) noexcept {
+    using LanePack = qwqdsp_simd_element::PackFloat<kLanes>;
+    LanePack* re;
+    LanePack* im;
+    if constexpr (kLanes == 4) {
+        re = batch4_re_.data();
+        im = batch4_im_.data();
+    }
+    else {
+        re = batch8_re_.data();
+        im = batch8_im_.data();
+    }
+
+    size_t const m = fft_size_ / 2;
+    size_t const num_frames = time.size();
+    size_t const num_bins = NumBins();
+    // 空余的通道输入零，输出到buffer里丢弃
+    std::fill(work_re_.begin(), work_re_.end(), 0.0f);
+    for (size_t l = 0; l < kLanes; ++l) {
+        float const* in_re = l < num_frames ? real[l] : work_re_.data();
+        float const* in_im = l < num_frames ? imag[l] : work_re_.data();
+        for (size_t k = 0; k < num_bins; ++k) {
+            re[k].data[l] = in_re[k];
+            im[k].data[l] = in_im[k];
+        }
+    }
+
+    if constexpr (kLanes == 4) {
+        kernel_->backward_lanes4(fft_, plan_->tw_re.data(), plan_->tw_im.data(), re, im);
+    }
+    else {
+        kernel_->backward_lanes8(fft_, plan_->tw_re.data(), plan_->tw_im.data(), re, im);
+    }
+
+    float const gain = 1.0f / static_cast<float>(fft_size_);
+    for (size_t l = 0; l < kLanes; ++l) {
+        float* out = l < num_frames ? time[l] : buffer_.data();
+        for (size_t n = 0; n < m; ++n) {
+            out[2 * n] = re[n].data[l] * gain;
+            out[2 * n + 1] = im[n].data[l] * gain;
+        }
+    }
+}
+
+template<size_t kStride>
+void RealFFT::FFTBatchStride(std::span<const float* const> time, std::span<float* const> real, std::span<float* const> imag) noexcept {
+    assert(time.size() == real.size());
+    assert(time.size() == imag.size());
+    assert(time.size() <= max_batch_);
+
+    size_t const num_frames = time.size();
+    size_t const lanes = BatchLanes(num_frames);
+    size_t i = 0;
+    if (lanes == 8) {
+        FFTBatchImpl<8, kStride>(time, real, imag);
+        i = num_frames;
+    }
+    else if (lanes == 4) {
+        for (; i + 4 <= num_frames; i += 4) {
+            FFTBatchImpl<4, kStride>(time.subspan(i, 4), real.subspan(i, 4), imag.subspan(i, 4));
+        }
+    }
+    for (; i < num_frames; ++i) {
+        if constexpr (kStride == 1) {
+            FFT({time[i], fft_size_}, {real[i], NumBins()}, {imag[i], NumBins()});
+        }
+        else {
+            FFT({time[i], fft_size_}, {reinterpret_cast<std::complex<float>*>(real[i]), NumBins()});
+        }
+    }
+}
+
+void RealFFT::FFTBatch(std::span<const float* const> time, std::span<float* const> real, std::span<float* const> imag) noexcept {
+    FFTBatchStride<1>(time, real, imag);
+}
+
+void RealFFT::FFTBatch(std::span<const float* const> time, std::span<std::complex<float>* const> spectral) noexcept {
+    assert(spectral.size() <= kMaxBatch);
+    std::array<float*, kMaxBatch> real;
+    std::array<float*, kMaxBatch> imag;
+    for (size_t i = 0; i < spectral.size(); ++i) {
+        real[i] = reinterpret_cast<float*>(spectral[i]);
+        imag[i] = real[i] + 1;
+    }
+    FFTBatchStride<2>(time, {real.data(), spectral.size()}, {imag.data(), spectral.size()});
+}
+
+void RealFFT::IFFTBatch(std::span<float* const> time, std::span<const float* const> real, std::span<const float* const> imag) noexcept {
+    assert(time.size() == real.size());
+    assert(time.size() == imag.size());
+    assert(time.size() <= max_batch_);
+
+    size_t const num_frames = time.size();
+    size_t const lanes = BatchLanes(num_frames);
+    size_t i = 0;
+    if (lanes == 8) {
+        IFFTBatchImpl<8>(time, real, imag);
+        i = num_frames;
+    }
+    else if (lanes == 4) {
+        for (; i + 4 <= num_frames; i += 4) {
+            IFFTBatchImpl<4>(time.subspan(i, 4), real.subspan(i, 4), imag.subspan(i, 4));
+        }
     }
-    internal::rdft(fft_size_, -1, buffer_.data(), ip_.data(), w_.data());
-    float gain = 2.0f / fft_size_;
-    for (size_t i = 0; i < fft_size_; ++i) {
-        shift90[i] = buffer_[i] * gain;
+    for (; i < num_frames; ++i) {
+        IFFT({time[i], fft_size_}, {real[i], NumBins()}, {imag[i], NumBins()});
     }
 }
 
@@ -186,10 +381,12 @@ RealFFT::RealFFT() {
 
 RealFFT::~RealFFT() = default;
 
-void RealFFT::Init(size_t fft_size) {
+void RealFFT::Init(size_t fft_size, size_t max_batch) {
+    assert(max_batch >= 1 && max_batch <= kMaxBatch);
     fft_->Init(fft_size);
     buffer_.resize(fft_size + 2);
     fft_size_ = fft_size;
+    max_batch_ = max_batch;
 }
 
 void RealFFT::FFT(std::span<const float> time, std::span<std::complex<float>> spectral) noexcept {
@@ -329,6 +526,36 @@ void RealFFT::Hilbert(std::span<const float>input, std::span<float> shift90, boo
     fft_->IFFT(buffer_.data(), shift90.data());
 }
 
+// IPP内部已经是SIMD的了，逐帧变换
+void RealFFT::FFTBatch(std::span<const float* const> time, std::span<float* const> real, std::span<float* const> imag) noexcept {
+    assert(time.size() == real.size());
+    assert(time.size() == imag.size());
+    assert(time.size() <= max_batch_);
+
+    for (size_t i = 0; i < time.size(); ++i) {
+        FFT({time[i], fft_size_}, {real[i], NumBins()}, {imag[i], NumBins()});
+    }
+}
+
+void RealFFT::FFTBatch(std::span<const float* const> time, std::span<std::complex<float>* const> spectral) noexcept {
+    assert(time.size() == spectral.size());
+    assert(time.size() <= max_batch_);
+
+    for (size_t i = 0; i < time.size(); ++i) {
+        FFT({time[i], fft_size_}, {spectral[i], NumBins()});
+    }
+}
+
+void RealFFT::IFFTBatch(std::span<float* const> time, std::span<const float* const> real, std::span<const float* const> imag) noexcept {
+    assert(time.size() == real.size());
+    assert(time.size() == imag.size());
+    assert(time.size() <= max_batch_);
+
+    for (size_t i = 0; i < time.size(); ++i) {
+        IFFT({time[i], fft_size_}, {real[i], NumBins()}, {imag[i], NumBins()});
+    }
+}
+
 
 } // qwqdsp_spectral
 
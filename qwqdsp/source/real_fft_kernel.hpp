@@ -0,0 +1,262 @@
+#pragma once
+// 只在qwqdsp/source内部包含，每个包含的翻译单元用不同的编译选项编译
+// 包含前需要定义 QWQDSP_REAL_FFT_KERNEL 为这个翻译单元独有的命名空间名
+
+#ifndef QWQDSP_REAL_FFT_KERNEL
+#error "define QWQDSP_REAL_FFT_KERNEL before including real_fft_kernel.hpp"
+#endif
+
+#include "qwqdsp/spectral/real_fft.hpp"
+#include "qwqdsp/simd_element/simd_pack.hpp"
+
+// --------------------------------------------------------------------------------
+// N点实数FFT = N/2点复数FFT z[n] = x[2n] + i x[2n+1] 加上一次拆分
+//   X[k]   = Fe[k] + W^k Fo[k]
+//   X[M-k] = conj(Fe[k] - W^k Fo[k])
+//   Fe[k] = (Z[k] + conj(Z[M-k])) / 2, Fo[k] = (Z[k] - conj(Z[M-k])) / 2i
+// 拆分时k和M-k成对处理，所以可以原位进行
+// --------------------------------------------------------------------------------
+
+namespace qwqdsp_spectral::QWQDSP_REAL_FFT_KERNEL {
+// 使SplitComplexFFT的模板实例只属于这个翻译单元
+struct IsaTag {};
+
+constexpr size_t kWidth = 8;
+using Pack = qwqdsp_simd_element::PackFloat<kWidth>;
+
+template<size_t kStride>
+Pack LoadStride(float const* ptr) noexcept {
+    Pack r;
+    for (size_t i = 0; i < kWidth; ++i) r.data[i] = ptr[i * kStride];
+    return r;
+}
+
+template<size_t kStride>
+void StoreStride(float* ptr, Pack const& v) noexcept {
+    for (size_t i = 0; i < kWidth; ++i) ptr[i * kStride] = v.data[i];
+}
+
+/**
+ * @param ptr 第一个元素，之后的元素地址递减
+ */
+template<size_t kStride>
+Pack LoadReverse(float const* ptr) noexcept {
+    Pack r;
+    for (size_t i = 0; i < kWidth; ++i) r.data[i] = *(ptr - i * kStride);
+    return r;
+}
+
+template<size_t kStride>
+void StoreReverse(float* ptr, Pack const& v) noexcept {
+    for (size_t i = 0; i < kWidth; ++i) *(ptr - i * kStride) = v.data[i];
+}
+
+/**
+ * @brief Z(连续的M个) -> X(M+1个，间隔kStride)，允许原位
+ */
+template<size_t kStride>
+void PostProcess(float const* tw_re, float const* tw_im, size_t m,
+                 float const* z_re, float const* z_im, float* x_re, float* x_im) noexcept {
+    float const z0_re = z_re[0];
+    float const z0_im = z_im[0];
+
+    size_t k = 1;
+    // [k, k+kWidth) 和 (m-k-kWidth, m-k] 不能重叠
+    for (; 2 * (k + kWidth) <= m; k += kWidth) {
+        Pack ar, ai, wr, wi;
+        ar.Load(z_re + k);
+        ai.Load(z_im + k);
+        Pack const br = LoadReverse<1>(z_re + m - k);
+        Pack const bi = Pack::vBroadcast(0.0f) - LoadReverse<1>(z_im + m - k);
+        wr.Load(tw_re + k);
+        wi.Load(tw_im + k);
+
+        Pack const fe_re = 0.5f * (ar + br);
+        Pack const fe_im = 0.5f * (ai + bi);
+        Pack const fo_re = 0.5f * (ai - bi);
+        Pack const fo_im = 0.5f * (br - ar);
+        Pack const t_re = wr * fo_re - wi * fo_im;
+        Pack const t_im = wr * fo_im + wi * fo_re;
+
+        StoreStride<kStride>(x_re + k * kStride, fe_re + t_re);
+        StoreStride<kStride>(x_im + k * kStride, fe_im + t_im);
+        StoreReverse<kStride>(x_re + (m - k) * kStride, fe_re - t_re);
+        StoreReverse<kStride>(x_im + (m - k) * kStride, t_im - fe_im);
+    }
+    for (; 2 * k <= m; ++k) {
+        float const ar = z_re[k];
+        float const ai = z_im[k];
+        float const br = z_re[m - k];
+        float const bi = -z_im[m - k];
+        float const fe_re = 0.5f * (ar + br);
+        float const fe_im = 0.5f * (ai + bi);
+        float const fo_re = 0.5f * (ai - bi);
+        float const fo_im = 0.5f * (br - ar);
+        float const t_re = tw_re[k] * fo_re - tw_im[k] * fo_im;
+        float const t_im = tw_re[k] * fo_im + tw_im[k] * fo_re;
+        x_re[k * kStride] = fe_re + t_re;
+        x_im[k * kStride] = fe_im + t_im;
+        x_re[(m - k) * kStride] = fe_re - t_re;
+        x_im[(m - k) * kStride] = t_im - fe_im;
+    }
+
+    x_re[0] = z0_re + z0_im;
+    x_im[0] = 0.0f;
+    x_re[m * kStride] = z0_re - z0_im;
+    x_im[m * kStride] = 0.0f;
+}
+
+/**
+ * @brief X(M+1个，间隔kStride) -> 2Z(连续的M个)，允许原位
+ */
+template<size_t kStride>
+void PreProcess(float const* tw_re, float const* tw_im, size_t m,
+                float const* x_re, float const* x_im, float* z_re, float* z_im) noexcept {
+    float const x0 = x_re[0];
+    float const xm = x_re[m * kStride];
+
+    size_t k = 1;
+    for (; 2 * (k + kWidth) <= m; k += kWidth) {
+        Pack wr, wi;
+        Pack const ar = LoadStride<kStride>(x_re + k * kStride);
+        Pack const ai = LoadStride<kStride>(x_im + k * kStride);
+        Pack const br = LoadReverse<kStride>(x_re + (m - k) * kStride);
+        Pack const bi = Pack::vBroadcast(0.0f) - LoadReverse<kStride>(x_im + (m - k) * kStride);
+        wr.Load(tw_re + k);
+        wi.Load(tw_im + k);
+
+        Pack const fe_re = ar + br;
+        Pack const fe_im = ai + bi;
+        Pack const d_re = ar - br;
+        Pack const d_im = ai - bi;
+        // Fo = D * conj(W)
+        Pack const fo_re = d_re * wr + d_im * wi;
+        Pack const fo_im = d_im * wr - d_re * wi;
+
+        (fe_re - fo_im).Store(z_re + k);
+        (fe_im + fo_re).Store(z_im + k);
+        StoreReverse<1>(z_re + m - k, fe_re + fo_im);
+        StoreReverse<1>(z_im + m - k, fo_re - fe_im);
+    }
+    for (; 2 * k <= m; ++k) {
+        float const ar = x_re[k * kStride];
+        float const ai = x_im[k * kStride];
+        float const br = x_re[(m - k) * kStride];
+        float const bi = -x_im[(m - k) * kStride];
+        float const fe_re = ar + br;
+        float const fe_im = ai + bi;
+        float const d_re = ar - br;
+        float const d_im = ai - bi;
+        float const fo_re = d_re * tw_re[k] + d_im * tw_im[k];
+        float const fo_im = d_im * tw_re[k] - d_re * tw_im[k];
+        z_re[k] = fe_re - fo_im;
+        z_im[k] = fe_im + fo_re;
+        z_re[m - k] = fe_re + fo_im;
+        z_im[m - k] = fo_re - fe_im;
+    }
+
+    z_re[0] = x0 + xm;
+    z_im[0] = x0 - xm;
+}
+
+/**
+ * @brief PostProcess的多通道版本，原位
+ */
+template<size_t kLanes>
+void PostProcessLanes(qwqdsp_simd_element::PackFloat<kLanes>* re, qwqdsp_simd_element::PackFloat<kLanes>* im,
+                      float const* tw_re, float const* tw_im, size_t m) noexcept {
+    using LanePack = qwqdsp_simd_element::PackFloat<kLanes>;
+    LanePack const z0_re = re[0];
+    LanePack const z0_im = im[0];
+    for (size_t k = 1; 2 * k <= m; ++k) {
+        LanePack const ar = re[k];
+        LanePack const ai = im[k];
+        LanePack const br = re[m - k];
+        LanePack const bi = LanePack::vBroadcast(0.0f) - im[m - k];
+        LanePack const fe_re = 0.5f * (ar + br);
+        LanePack const fe_im = 0.5f * (ai + bi);
+        LanePack const fo_re = 0.5f * (ai - bi);
+        LanePack const fo_im = 0.5f * (br - ar);
+        LanePack const t_re = tw_re[k] * fo_re - tw_im[k] * fo_im;
+        LanePack const t_im = tw_re[k] * fo_im + tw_im[k] * fo_re;
+        re[k] = fe_re + t_re;
+        im[k] = fe_im + t_im;
+        re[m - k] = fe_re - t_re;
+        im[m - k] = t_im - fe_im;
+    }
+    re[0] = z0_re + z0_im;
+    im[0] = LanePack::vBroadcast(0.0f);
+    re[m] = z0_re - z0_im;
+    im[m] = LanePack::vBroadcast(0.0f);
+}
+
+/**
+ * @brief PreProcess的多通道版本，原位
+ */
+template<size_t kLanes>
+void PreProcessLanes(qwqdsp_simd_element::PackFloat<kLanes>* re, qwqdsp_simd_element::PackFloat<kLanes>* im,
+                     float const* tw_re, float const* tw_im, size_t m) noexcept {
+    using LanePack = qwqdsp_simd_element::PackFloat<kLanes>;
+    LanePack const x0 = re[0];
+    LanePack const xm = re[m];
+    for (size_t k = 1; 2 * k <= m; ++k) {
+        LanePack const ar = re[k];
+        LanePack const ai = im[k];
+        LanePack const br = re[m - k];
+        LanePack const bi = LanePack::vBroadcast(0.0f) - im[m - k];
+        LanePack const fe_re = ar + br;
+        LanePack const fe_im = ai + bi;
+        LanePack const d_re = ar - br;
+        LanePack const d_im = ai - bi;
+        LanePack const fo_re = d_re * tw_re[k] + d_im * tw_im[k];
+        LanePack const fo_im = d_im * tw_re[k] - d_re * tw_im[k];
+        re[k] = fe_re - fo_im;
+        im[k] = fe_im + fo_re;
+        re[m - k] = fe_re + fo_im;
+        im[m - k] = fo_re - fe_im;
+    }
+    re[0] = x0 + xm;
+    im[0] = x0 - xm;
+}
+
+// ---------------------------------------- 导出给RealFFT的函数 ----------------------------------------
+
+template<size_t kStride>
+void Forward(SplitComplexFFT const& fft, float const* tw_re, float const* tw_im,
+             float* z_re, float* z_im, float* x_re, float* x_im) noexcept {
+    fft.FFT<IsaTag>(z_re, z_im);
+    PostProcess<kStride>(tw_re, tw_im, fft.FFTSize(), z_re, z_im, x_re, x_im);
+}
+
+template<size_t kStride>
+void Backward(SplitComplexFFT const& fft, float const* tw_re, float const* tw_im,
+              float const* x_re, float const* x_im, float* z_re, float* z_im) noexcept {
+    PreProcess<kStride>(tw_re, tw_im, fft.FFTSize(), x_re, x_im, z_re, z_im);
+    fft.IFFT<IsaTag>(z_re, z_im);
+}
+
+template<size_t kLanes>
+void ForwardLanes(SplitComplexFFT const& fft, float const* tw_re, float const* tw_im,
+                  qwqdsp_simd_element::PackFloat<kLanes>* re, qwqdsp_simd_element::PackFloat<kLanes>* im) noexcept {
+    fft.FFTLanes<kLanes, IsaTag>(re, im);
+    PostProcessLanes<kLanes>(re, im, tw_re, tw_im, fft.FFTSize());
+}
+
+template<size_t kLanes>
+void BackwardLanes(SplitComplexFFT const& fft, float const* tw_re, float const* tw_im,
+                   qwqdsp_simd_element::PackFloat<kLanes>* re, qwqdsp_simd_element::PackFloat<kLanes>* im) noexcept {
+    PreProcessLanes<kLanes>(re, im, tw_re, tw_im, fft.FFTSize());
+    fft.IFFTLanes<kLanes, IsaTag>(re, im);
+}
+
+inline constexpr RealFFTKernel kKernel{
+    &Forward<1>,
+    &Forward<2>,
+    &Backward<1>,
+    &Backward<2>,
+    &ForwardLanes<4>,
+    &ForwardLanes<8>,
+    &BackwardLanes<4>,
+    &BackwardLanes<8>,
+};
+}
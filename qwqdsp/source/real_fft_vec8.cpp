@@ -0,0 +1,16 @@
+// 使用 PLUGIN_VEC8_COMPLIER_OPTION 编译，只在 simd_detector 检测到 PLUGIN_VEC8_DISPATCH_ISET 时调用
+#include "qwqdsp/spectral/real_fft.hpp"
+
+#ifndef QWQDSP_HAVE_IPP
+
+#define QWQDSP_REAL_FFT_KERNEL kernel_vec8
+#include "real_fft_kernel.hpp"
+#undef QWQDSP_REAL_FFT_KERNEL
+
+namespace qwqdsp_spectral {
+RealFFTKernel const& GetRealFFTKernelVec8() noexcept {
+    return kernel_vec8::kKernel;
+}
+}
+
+#endif
@@ -0,0 +1,54 @@
+#include <cstddef>
+#include <cstdio>
+#include <vector>
+
+#include "qwqdsp/segement/analyze_auto.hpp"
+
+// 离线分块的尾部: 帧的起点是所有小于输入长度的 k*hop，超出输入的部分是0
+
+static bool Check(size_t size, size_t hop, size_t num_samples) {
+    std::vector<float> x(num_samples);
+    for (size_t i = 0; i < num_samples; ++i) {
+        x[i] = static_cast<float>(i + 1);
+    }
+
+    qwqdsp_segement::AnalyzeAuto<true> segement;
+    segement.SetSize(size);
+    segement.SetHop(hop);
+
+    std::vector<std::vector<float>> frames;
+    segement.Process(x, [&frames](std::span<const float> frame) {
+        frames.emplace_back(frame.begin(), frame.end());
+    });
+
+    size_t const expect_frames = (num_samples + hop - 1) / hop;
+    if (frames.size() != expect_frames) {
+        std::printf("size %zu hop %zu n %zu: %zu frames, expect %zu\n", size, hop, num_samples, frames.size(), expect_frames);
+        return false;
+    }
+    for (size_t k = 0; k < frames.size(); ++k) {
+        for (size_t i = 0; i < size; ++i) {
+            size_t const pos = k * hop + i;
+            float const expect = pos < num_samples ? x[pos] : 0.0f;
+            if (frames[k][i] != expect) {
+                std::printf("size %zu hop %zu n %zu: frame %zu[%zu] = %g, expect %g\n",
+                            size, hop, num_samples, k, i, frames[k][i], expect);
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+int main() {
+    for (size_t size : {8, 16}) {
+        for (size_t hop : {size / 4, size / 2 + 1, size}) {
+            for (size_t n = 1; n < 5 * size; ++n) {
+                if (!Check(size, hop, n)) {
+                    return 1;
+                }
+            }
+        }
+    }
+    std::printf("ok\n");
+}
@@ -2,6 +2,7 @@
 #include <numbers>
 
 #include "qwqdsp/fx/uniform_convolution.hpp"
+#include "qwqdsp/fx/nonuniform_convolution.hpp"
 
 int main() {
     float sin[513];
@@ -16,4 +17,29 @@ int main() {
     float test[4096]{1.0f};
     test[1024] = 1;
     conv.Process(test);
+
+    // long ir, small block
+    std::vector<float> reverb(48000 * 3);
+    for (size_t i = 0; i < reverb.size(); ++i) {
+        reverb[i] = std::sin(static_cast<float>(i) * 0.01f) * std::exp(-static_cast<float>(i) / 20000.0f);
+    }
+    qwqdsp_fx::NonUniformConvolution nconv;
+    nconv.Init(64);
+    nconv.SetIR(reverb);
+
+    float test2[4096]{1.0f};
+    test2[1024] = 1;
+    for (size_t i = 0; i < 4096; i += 64) {
+        nconv.Process({test2 + i, 64});
+    }
+
+    // swap ir while processing
+    for (auto& x : reverb) {
+        x *= 0.5f;
+    }
+    nconv.PublishIR(nconv.PrepareIR(reverb));
+    for (size_t i = 0; i < 4096; i += 64) {
+        nconv.Process({test2 + i, 64});
+    }
+    nconv.FreeRetiredIR();
 }